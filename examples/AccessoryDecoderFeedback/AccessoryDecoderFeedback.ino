@@ -5,6 +5,13 @@
  * using various RailCom messages. It simulates the operation of a turnout
  * and reports its status back to the command station.
  *
+ * The decoder runs on both cores of the RP2040 (arduino-pico core):
+ * - Core 1 (setup1/loop1) receives DCC, runs the DecoderStateMachine and sends
+ *   the RailCom reply in the cutout. Nothing else runs there.
+ * - Core 0 (setup/loop) runs the turnout and prints to Serial. However slow it
+ *   is, it cannot delay a cutout; it only talks to core 1 through the
+ *   DecoderRuntime queues.
+ *
  * Use Case Coverage:
  * - #10: Verifying Turnout Position (STAT4)
  * - #11: Reporting a Jammed Turnout (ERROR)
@@ -16,34 +23,73 @@
 #include <Railcom.h>
 #include <RailcomTx.h>
 #include <RP2040RailcomTxHardware.h>
+#include <DecoderStateMachine.h>
+#include <DecoderRuntime.h>
 
 // --- Configuration ---
 #define DCC_PIN 2
 #define DECODER_ADDRESS 100 // The base address for this decoder.
+const uint8_t CV28 = 0b00000011; // Enable both channels
+const uint8_t CV29 = 0b10001000; // Accessory decoder, RailCom enabled
 
 // --- Global Objects ---
 NmraDcc Dcc;
 // Correctly initialize the hardware with the UART and TX pin
 RP2040RailcomTxHardware railcom_hardware(uart1, 4); // Use UART1 on GP4
 RailcomTx railcom_tx(&railcom_hardware);
+DecoderStateMachine decoder(railcom_tx, DecoderType::ACCESSORY, DECODER_ADDRESS, CV28, CV29);
+DecoderRuntime runtime(decoder, railcom_tx);
 
-// --- Turnout State Machine ---
+// --- Turnout State Machine (core 0) ---
 enum TurnoutState { IDLE, MOVING, JAMMED };
 TurnoutState turnout_state = IDLE;
 unsigned long movement_start_time = 0;
+unsigned long last_report_time = 0;
 const unsigned long MOVEMENT_DURATION_MS = 2000; // 2 seconds
 uint8_t current_position = 0; // 0 = thrown, 1 = closed
 
-// Callback function to handle DCC accessory packets
-// This function name is automatically registered by NmraDcc when CV29_ACCESSORY_DECODER is set
-void notifyDccAccTurnoutOutput(uint16_t address, uint8_t direction, uint8_t power) {
-    // We handle a block of 4 addresses, but only care about the base address.
-    if (address != DECODER_ADDRESS) {
+// =====================================================================
+// Core 1: DCC reception and RailCom
+// =====================================================================
+
+// Called by NmraDcc on core 1 for every valid packet.
+// A DCC receiver that reports the end bit from its interrupt should call
+// runtime.onPacketEnd(time_us_32()) there. NmraDcc has no such hook, so
+// onPacket() takes the time itself and the reported latency leaves out the
+// time the packet waited for Dcc.process().
+void notifyDccMsg(DCC_MSG* Msg) {
+    runtime.onPacket(DCCMessage(Msg->Data, Msg->Size));
+    // NmraDcc has no cutout detection. For a real decoder, you would detect
+    // the cutout of the command station; here the reply is sent right away.
+    runtime.onCutout();
+}
+
+void setup1() {
+    Dcc.pin(DCC_PIN, false, true);
+    Dcc.init(MAN_ID_DIY, 10, CV29_ACCESSORY_DECODER | CV29_RAILCOM_ENABLE, 0);
+    railcom_tx.begin();
+}
+
+void loop1() {
+    Dcc.process();
+    runtime.task();
+}
+
+// =====================================================================
+// Core 0: application
+// =====================================================================
+
+// Handles a basic accessory packet: 10AAAAAA 1AAADAAR
+void handleAccessoryPacket(const DCCMessage& packet) {
+    const uint8_t* data = packet.getData();
+    if (packet.getLength() != 3 || (data[0] & 0xC0) != 0x80 || !(data[1] & 0x80)) {
         return;
     }
-
-    // Check if we are busy
-    if (turnout_state != IDLE) {
+    uint16_t board = (data[0] & 0x3F) | ((uint16_t)(~data[1] & 0x70) << 2);
+    uint16_t address = board * 4 + ((data[1] >> 1) & 0x03) - 3;
+    uint8_t direction = data[1] & 0x01;
+    // We handle a block of 4 addresses, but only care about the base address.
+    if (address != DECODER_ADDRESS || turnout_state != IDLE) {
         return;
     }
 
@@ -53,7 +99,7 @@ void notifyDccAccTurnoutOutput(uint16_t address, uint8_t direction, uint8_t powe
         turnout_state = JAMMED;
         Serial.println("Simulating a JAMMED turnout!");
         // Report the error on Channel 2. Error code 3 = Accessory Malfunction
-        railcom_tx.sendError(3);
+        runtime.send(RailcomID::ERROR, 3, 8);
     } else {
         turnout_state = MOVING;
         movement_start_time = millis();
@@ -68,49 +114,52 @@ void setup() {
     while (!Serial);
     Serial.println("Accessory Decoder with Feedback starting...");
 
-    // Initialize DCC listener
-    Dcc.pin(DCC_PIN, false, true);
-    // Use the correct CV29 constant
-    Dcc.init(MAN_ID_DIY, 10, CV29_ACCESSORY_DECODER | CV29_RAILCOM_ENABLE, 0);
-
-    // Initialize RailCom Transmitter
-    railcom_tx.begin();
-
     pinMode(LED_BUILTIN, OUTPUT);
     digitalWrite(LED_BUILTIN, HIGH);
 }
 
 void loop() {
-    // Process incoming DCC packets
-    Dcc.process();
-
-    // The new NmraDcc library doesn't have a cutout detection.
-    // For a real decoder, you would detect the absence of a DCC signal.
-    // For this example, we'll just periodically check our state machine
-    // and send messages. A better approach might be to trigger this
-    // right after Dcc.process() if a packet was received.
-    // To simulate, we just call on_cutout_start frequently.
-    railcom_tx.on_cutout_start();
+    DecoderEvent event;
+    while (runtime.pollEvent(event)) {
+        if (event.type == DecoderEventType::PACKET) {
+            handleAccessoryPacket(event.packet);
+        }
+    }
 
     // --- Handle Turnout State Machine ---
     if (turnout_state == MOVING) {
         unsigned long elapsed = millis() - movement_start_time;
         if (elapsed < MOVEMENT_DURATION_MS) {
-            // Still moving, report remaining time.
+            // Still moving, report remaining time (unit flag cleared: 0.1 s)
+            // whenever it changes.
+            static uint8_t last_reported = 0xFF;
             uint8_t time_remaining_deci_seconds = (MOVEMENT_DURATION_MS - elapsed) / 100;
-            // Send time with unit flag (false for 0.1s)
-            railcom_tx.sendTime(time_remaining_deci_seconds, false);
+            if (time_remaining_deci_seconds != last_reported &&
+                runtime.send(RailcomID::TIME, time_remaining_deci_seconds & 0x7F, 8)) {
+                last_reported = time_remaining_deci_seconds;
+            }
         } else {
             // Movement finished
             turnout_state = IDLE;
             Serial.println("Movement complete.");
             // Report the final status.
             uint8_t status_byte = (current_position == 1) ? 0b00000010 : 0b00000001;
-            railcom_tx.sendStatus4(status_byte);
+            runtime.send(RailcomID::STAT4, status_byte, 8);
         }
     } else if (turnout_state == JAMMED) {
         // After sending the error, we reset to IDLE.
         // In a real decoder, this might require manual intervention.
         turnout_state = IDLE;
     }
+
+    // Printing takes milliseconds, but it only delays this core.
+    if (millis() - last_report_time > 5000) {
+        last_report_time = millis();
+        Serial.print("Cutouts: ");
+        Serial.print(runtime.cutoutCount());
+        Serial.print(", worst cutout latency: ");
+        Serial.print(runtime.worstCutoutLatencyUs());
+        Serial.print(" us, dropped events: ");
+        Serial.println(runtime.droppedEvents());
+    }
 }
@@ -29,7 +29,7 @@ void loop() {
         lastDccPacketTime = millis();
 
         // Simulate a simplified function packet
-        uint8_t dcc_data[] = { (uint8_t)(DECODER_ADDRESS >> 8), (uint8_t)DECODER_ADDRESS, 0b10000000 };
+        uint8_t dcc_data[] = { (uint8_t)(0xC0 | (DECODER_ADDRESS >> 8)), (uint8_t)DECODER_ADDRESS, 0b10000000 };
         DCCMessage dcc_msg(dcc_data, sizeof(dcc_data));
 
         // Let the state machine decide what to queue (it will queue an ADR broadcast)
@@ -36,7 +36,7 @@ void loop() {
         lastDccPacketTime = millis();
 
         // 1. Create a simulated DCC packet
-        uint8_t dcc_data[] = { (uint8_t)(LOCOMOTIVE_ADDRESS >> 8), (uint8_t)LOCOMOTIVE_ADDRESS, 0};
+        uint8_t dcc_data[] = { (uint8_t)(0xC0 | (LOCOMOTIVE_ADDRESS >> 8)), (uint8_t)LOCOMOTIVE_ADDRESS, 0};
         DCCMessage dcc_msg(dcc_data, sizeof(dcc_data));
 
         // 2. Let the state machine decide what to queue
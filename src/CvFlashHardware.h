@@ -0,0 +1,59 @@
+/**
+ * @file CvFlashHardware.h
+ * @brief Defines the abstract hardware interface for persistent CV storage in flash.
+ */
+#ifndef CV_FLASH_HARDWARE_H
+#define CV_FLASH_HARDWARE_H
+
+#include <cstdint>
+#include <cstddef>
+
+/** @brief Size in bytes of a flash page, the unit of programming. */
+constexpr uint16_t CV_FLASH_PAGE_SIZE = 256;
+/** @brief Size in bytes of a flash sector, the unit of erasing. */
+constexpr uint16_t CV_FLASH_SECTOR_SIZE = 4096;
+
+/**
+ * @class CvFlashHardware
+ * @brief An abstract base class for the flash region that holds the CV journal.
+ * @details The region consists of `sectorCount()` consecutive sectors. All offsets
+ *          are relative to the start of the region. Erased flash reads as 0xFF and
+ *          programming can only clear bits, so a page may be programmed several
+ *          times as long as the bytes that are already in use are passed as 0xFF.
+ */
+class CvFlashHardware {
+public:
+    /**
+     * @brief Virtual destructor.
+     */
+    virtual ~CvFlashHardware() = default;
+
+    /**
+     * @brief Returns the number of sectors in the region.
+     * @return The number of sectors (at least 2).
+     */
+    virtual uint8_t sectorCount() const = 0;
+
+    /**
+     * @brief Reads bytes from the region.
+     * @param offset The offset from the start of the region.
+     * @param dst The destination buffer.
+     * @param len The number of bytes to read.
+     */
+    virtual void read(uint32_t offset, uint8_t* dst, size_t len) = 0;
+
+    /**
+     * @brief Erases one sector, setting all its bytes to 0xFF.
+     * @param sector The index of the sector within the region.
+     */
+    virtual void eraseSector(uint8_t sector) = 0;
+
+    /**
+     * @brief Programs one page.
+     * @param offset The page-aligned offset from the start of the region.
+     * @param data `CV_FLASH_PAGE_SIZE` bytes to program.
+     */
+    virtual void programPage(uint32_t offset, const uint8_t* data) = 0;
+};
+
+#endif // CV_FLASH_HARDWARE_H
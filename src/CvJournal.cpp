@@ -0,0 +1,303 @@
+/**
+ * @file CvJournal.cpp
+ * @brief Implementation of the CvJournal class.
+ */
+#include "CvJournal.h"
+#include "RailcomEncoding.h"
+#include <cstring>
+
+/** @brief First byte of a valid CV record. */
+static constexpr uint8_t RECORD_MARKER = 0x5A;
+/** @brief Magic bytes at the start of a sector header. */
+static constexpr uint8_t HEADER_MAGIC[4] = { 'C', 'V', 'J', 1 };
+
+/**
+ * @brief Constructs the journal.
+ * @param hardware A pointer to the flash hardware.
+ * @param store The CV store to persist.
+ * @param flushDelayMs Time to collect changes before writing a page.
+ */
+CvJournal::CvJournal(CvFlashHardware* hardware, CvStore& store, uint32_t flushDelayMs)
+    : _hardware(hardware), _store(store), _flush_delay_ms(flushDelayMs),
+      _state(CvJournalState::IDLE), _has_active(false), _active_sector(0), _sequence(0),
+      _write_slot(CV_JOURNAL_SLOTS), _target_sector(0), _copy_cursor(1), _copy_slot(1),
+      _pending(false), _pending_since(0) {
+}
+
+/**
+ * @brief Finds the newest valid sector and replays it into the store.
+ * @details Sequence numbers are compared with serial number arithmetic, so the
+ *          16-bit counter may wrap around.
+ */
+void CvJournal::begin() {
+    _state = CvJournalState::IDLE;
+    _has_active = false;
+    _write_slot = CV_JOURNAL_SLOTS;
+
+    for (uint8_t sector = 0; sector < _hardware->sectorCount(); ++sector) {
+        uint16_t sequence;
+        if (!readHeader(sector, sequence)) continue;
+        if (!_has_active || (int16_t)(sequence - _sequence) > 0) {
+            _has_active = true;
+            _active_sector = sector;
+            _sequence = sequence;
+        }
+    }
+
+    if (_has_active) {
+        replay();
+    }
+}
+
+/**
+ * @brief Reads and validates a sector header.
+ */
+bool CvJournal::readHeader(uint8_t sector, uint16_t& sequence) {
+    uint8_t header[CV_JOURNAL_RECORD_SIZE];
+    _hardware->read((uint32_t)sector * CV_FLASH_SECTOR_SIZE, header, sizeof(header));
+    if (memcmp(header, HEADER_MAGIC, sizeof(HEADER_MAGIC)) != 0) return false;
+    if (RailcomEncoding::crc8(header, CV_JOURNAL_RECORD_SIZE - 1) != header[CV_JOURNAL_RECORD_SIZE - 1]) return false;
+    sequence = header[4] | (header[5] << 8);
+    return true;
+}
+
+/**
+ * @brief Replays the active sector.
+ * @details Records are applied in order, so later records override earlier ones.
+ *          Records with a bad CRC (e.g. from an interrupted write) are skipped.
+ *          The first erased slot marks the end of the log.
+ */
+void CvJournal::replay() {
+    uint32_t base = (uint32_t)_active_sector * CV_FLASH_SECTOR_SIZE;
+    for (uint16_t slot = 0; slot < CV_JOURNAL_SLOTS; ++slot) {
+        uint8_t index = slot % CV_JOURNAL_SLOTS_PER_PAGE;
+        if (index == 0) {
+            _hardware->read(base + slot * CV_JOURNAL_RECORD_SIZE, _page, CV_FLASH_PAGE_SIZE);
+            if (slot == 0) continue; // Skip the header.
+        }
+        const uint8_t* record = &_page[index * CV_JOURNAL_RECORD_SIZE];
+
+        bool erased = true;
+        for (uint8_t i = 0; i < CV_JOURNAL_RECORD_SIZE; ++i) {
+            if (record[i] != 0xFF) {
+                erased = false;
+                break;
+            }
+        }
+        if (erased) {
+            _write_slot = slot;
+            return;
+        }
+
+        if (record[0] == RECORD_MARKER &&
+            RailcomEncoding::crc8(record, CV_JOURNAL_RECORD_SIZE - 1) == record[CV_JOURNAL_RECORD_SIZE - 1]) {
+            uint32_t cv = record[1] | (record[2] << 8) | ((uint32_t)record[3] << 16);
+            _store.restore(cv, record[4]);
+        }
+    }
+    _write_slot = CV_JOURNAL_SLOTS;
+}
+
+/**
+ * @brief Performs pending flash work.
+ * @param deferWrites True while flash must not be written.
+ * @param deferErase True while a sector must not be erased.
+ */
+void CvJournal::task(bool deferWrites, bool deferErase) {
+    if (deferWrites) return;
+    if (deferErase && _state == CvJournalState::ERASE) return;
+    step(false);
+}
+
+/**
+ * @brief Writes all pending changes immediately.
+ */
+void CvJournal::sync() {
+    while (step(true)) {
+    }
+}
+
+/**
+ * @brief Performs one step of pending work.
+ * @details Changes are collected until the flush delay has expired or a full
+ *          page's worth of CVs is dirty, so that bursts of POM writes end up in
+ *          a single page program.
+ */
+bool CvJournal::step(bool force) {
+    switch (_state) {
+        case CvJournalState::FULL:
+            return false;
+        case CvJournalState::ERASE:
+        case CvJournalState::COPY:
+        case CvJournalState::COMMIT:
+            compactStep();
+            return true;
+        case CvJournalState::IDLE:
+            break;
+    }
+
+    uint16_t dirty = _store.dirtyCount(CvDirtyFlag::PERSIST);
+    if (dirty == 0) {
+        _pending = false;
+        return false;
+    }
+    if (!_pending) {
+        _pending = true;
+        _pending_since = millis();
+    }
+    if (!force && dirty < CV_JOURNAL_SLOTS_PER_PAGE && (millis() - _pending_since) < _flush_delay_ms) {
+        return false;
+    }
+
+    if (!_has_active || _write_slot >= CV_JOURNAL_SLOTS) {
+        startCompaction();
+        return _state != CvJournalState::FULL;
+    }
+
+    appendPage();
+    if (_store.dirtyCount(CvDirtyFlag::PERSIST) == 0) {
+        _pending = false;
+    }
+    return true;
+}
+
+/**
+ * @brief Appends dirty CVs to the free slots of the current page.
+ * @details Slots that are already in use are left at 0xFF in the page buffer,
+ *          so programming the page again does not change them.
+ */
+void CvJournal::appendPage() {
+    uint16_t first = _write_slot;
+    uint16_t pageEnd = (first / CV_JOURNAL_SLOTS_PER_PAGE + 1) * CV_JOURNAL_SLOTS_PER_PAGE;
+    memset(_page, 0xFF, sizeof(_page));
+
+    uint32_t cv;
+    uint32_t from = 1;
+    while (_write_slot < pageEnd && _store.nextDirty(CvDirtyFlag::PERSIST, from, cv)) {
+        uint8_t value = 0;
+        _store.read(cv, value);
+        encodeRecord(_write_slot++, cv, value);
+        _store.clearDirty(CvDirtyFlag::PERSIST, cv);
+        from = cv + 1;
+    }
+    programSlotPage(_active_sector, first);
+}
+
+/**
+ * @brief Starts compacting the modified CVs into the next sector.
+ */
+void CvJournal::startCompaction() {
+    if (_store.dirtyCount(CvDirtyFlag::MODIFIED) > CV_JOURNAL_CAPACITY) {
+        _state = CvJournalState::FULL;
+        return;
+    }
+    _target_sector = _has_active ? (_active_sector + 1) % _hardware->sectorCount() : 0;
+    _copy_cursor = 1;
+    _copy_slot = 1;
+    _state = CvJournalState::ERASE;
+}
+
+/**
+ * @brief Performs one step of the compaction.
+ * @details The current value of each CV is copied, so its PERSIST flag is
+ *          cleared. If power is lost before the new header is written, the old
+ *          sector stays active; only changes that were not yet durable are lost,
+ *          exactly as without a compaction. CVs written after they were copied
+ *          are appended to the new sector once it is committed.
+ */
+void CvJournal::compactStep() {
+    switch (_state) {
+        case CvJournalState::ERASE:
+            _hardware->eraseSector(_target_sector);
+            _state = CvJournalState::COPY;
+            break;
+
+        case CvJournalState::COPY: {
+            uint16_t first = _copy_slot;
+            uint16_t pageEnd = (first / CV_JOURNAL_SLOTS_PER_PAGE + 1) * CV_JOURNAL_SLOTS_PER_PAGE;
+            if (pageEnd > CV_JOURNAL_SLOTS) pageEnd = CV_JOURNAL_SLOTS;
+            memset(_page, 0xFF, sizeof(_page));
+
+            uint32_t cv;
+            while (_copy_slot < pageEnd && _store.nextDirty(CvDirtyFlag::MODIFIED, _copy_cursor, cv)) {
+                uint8_t value = 0;
+                _store.read(cv, value);
+                encodeRecord(_copy_slot++, cv, value);
+                _store.clearDirty(CvDirtyFlag::PERSIST, cv);
+                _copy_cursor = cv + 1;
+            }
+            if (_copy_slot > first) {
+                programSlotPage(_target_sector, first);
+            }
+            if (!_store.nextDirty(CvDirtyFlag::MODIFIED, _copy_cursor, cv)) {
+                _state = CvJournalState::COMMIT;
+            } else if (_copy_slot >= CV_JOURNAL_SLOTS) {
+                // CVs were modified during the compaction and no longer fit.
+                _state = CvJournalState::FULL;
+            }
+            break;
+        }
+
+        case CvJournalState::COMMIT: {
+            uint16_t sequence = _has_active ? _sequence + 1 : 0;
+            memset(_page, 0xFF, sizeof(_page));
+            memcpy(_page, HEADER_MAGIC, sizeof(HEADER_MAGIC));
+            _page[4] = sequence & 0xFF;
+            _page[5] = (sequence >> 8) & 0xFF;
+            _page[6] = 0x00;
+            _page[7] = RailcomEncoding::crc8(_page, CV_JOURNAL_RECORD_SIZE - 1);
+            programSlotPage(_target_sector, 0);
+
+            _has_active = true;
+            _active_sector = _target_sector;
+            _sequence = sequence;
+            _write_slot = _copy_slot;
+            _state = CvJournalState::IDLE;
+            break;
+        }
+
+        default:
+            break;
+    }
+}
+
+/**
+ * @brief Encodes a CV record into the page buffer.
+ * @details Layout: marker, CV number (24-bit, little endian), value, two
+ *          reserved bytes left erased, CRC-8 over the first seven bytes.
+ */
+void CvJournal::encodeRecord(uint16_t slot, uint32_t cv, uint8_t value) {
+    uint8_t* record = &_page[(slot % CV_JOURNAL_SLOTS_PER_PAGE) * CV_JOURNAL_RECORD_SIZE];
+    record[0] = RECORD_MARKER;
+    record[1] = cv & 0xFF;
+    record[2] = (cv >> 8) & 0xFF;
+    record[3] = (cv >> 16) & 0xFF;
+    record[4] = value;
+    record[5] = 0xFF;
+    record[6] = 0xFF;
+    record[7] = RailcomEncoding::crc8(record, CV_JOURNAL_RECORD_SIZE - 1);
+}
+
+/**
+ * @brief Programs the page buffer to the page containing a slot.
+ */
+void CvJournal::programSlotPage(uint8_t sector, uint16_t slot) {
+    uint32_t offset = (uint32_t)sector * CV_FLASH_SECTOR_SIZE +
+                      (slot / CV_JOURNAL_SLOTS_PER_PAGE) * CV_FLASH_PAGE_SIZE;
+    _hardware->programPage(offset, _page);
+}
+
+/**
+ * @brief Returns the state of the background work.
+ */
+CvJournalState CvJournal::state() const {
+    return _state;
+}
+
+/**
+ * @brief Returns the number of records in the active sector.
+ */
+uint16_t CvJournal::recordCount() const {
+    if (!_has_active) return 0;
+    return _write_slot - 1;
+}
@@ -0,0 +1,166 @@
+/**
+ * @file CvJournal.h
+ * @brief Log-structured, wear-levelled persistence of CVs in flash.
+ * @details Every sector of the flash region holds a header followed by 8-byte
+ *          records, each carrying one CV number and value. Changed CVs are
+ *          appended in batches, one flash page per write. When the active sector
+ *          is full, the current value of every modified CV is copied into the next
+ *          sector, page by page, and the new sector's header is written last, so
+ *          an interrupted compaction leaves the previous sector in charge. The
+ *          sectors are used in rotation, which spreads the erase cycles evenly.
+ */
+#ifndef CV_JOURNAL_H
+#define CV_JOURNAL_H
+
+#include <Arduino.h>
+#include "CvStore.h"
+#include "CvFlashHardware.h"
+
+/** @brief Size in bytes of a header or CV record. */
+constexpr uint8_t CV_JOURNAL_RECORD_SIZE = 8;
+/** @brief Number of record slots per sector; slot 0 holds the sector header. */
+constexpr uint16_t CV_JOURNAL_SLOTS = CV_FLASH_SECTOR_SIZE / CV_JOURNAL_RECORD_SIZE;
+/** @brief Number of record slots per flash page. */
+constexpr uint8_t CV_JOURNAL_SLOTS_PER_PAGE = CV_FLASH_PAGE_SIZE / CV_JOURNAL_RECORD_SIZE;
+/** @brief Maximum number of modified CVs that can be persisted. */
+constexpr uint16_t CV_JOURNAL_CAPACITY = CV_JOURNAL_SLOTS - 1;
+/** @brief Default time in milliseconds that changes are collected before they are flushed. */
+constexpr uint32_t CV_JOURNAL_DEFAULT_FLUSH_DELAY_MS = 500;
+
+/**
+ * @enum CvJournalState
+ * @brief The state of the journal's background work.
+ */
+enum class CvJournalState : uint8_t {
+    IDLE,    ///< Appending changes to the active sector.
+    ERASE,   ///< Compaction: the next sector is about to be erased.
+    COPY,    ///< Compaction: modified CVs are being copied into the new sector.
+    COMMIT,  ///< Compaction: the header of the new sector is about to be written.
+    FULL     ///< More CVs were modified than fit into a sector; persistence has stopped.
+};
+
+/**
+ * @class CvJournal
+ * @brief Persists the changes made to a CvStore in flash.
+ * @details `begin()` replays the journal into the store. `task()` then picks up
+ *          CVs marked with `CvDirtyFlag::PERSIST` and performs at most one flash
+ *          operation (a page program or a sector erase) per call, so the time
+ *          both cores are stalled stays short and predictable.
+ */
+class CvJournal {
+public:
+    /**
+     * @brief Constructs a CvJournal object.
+     * @param hardware A pointer to the flash region holding the journal.
+     * @param store The CV store to persist.
+     * @param flushDelayMs Time in milliseconds that changes are collected before a
+     *                     page is written. A full page is written immediately.
+     */
+    CvJournal(CvFlashHardware* hardware, CvStore& store, uint32_t flushDelayMs = CV_JOURNAL_DEFAULT_FLUSH_DELAY_MS);
+
+    /**
+     * @brief Restores all persisted CVs into the store.
+     * @details Call this after the factory defaults have been defined. The replay
+     *          reads at most one sector and touches each record once.
+     */
+    void begin();
+
+    /**
+     * @brief Performs pending flash work, at most one flash operation per call.
+     * @param deferWrites True while flash must not be written, e.g. while a
+     *                    RailCom reply is waiting for the next cutout.
+     * @param deferErase True while a sector must not be erased. An erase stalls
+     *                   both cores for about 50 ms; page programs still proceed.
+     */
+    void task(bool deferWrites = false, bool deferErase = false);
+
+    /**
+     * @brief Writes all pending changes immediately, ignoring the flush delay.
+     * @details Blocks until the store is clean, e.g. before a planned power-down.
+     */
+    void sync();
+
+    /**
+     * @brief Returns the state of the background work.
+     * @return The current state.
+     */
+    CvJournalState state() const;
+
+    /**
+     * @brief Returns the number of records in the active sector.
+     * @return The number of used record slots, excluding the header.
+     */
+    uint16_t recordCount() const;
+
+private:
+    /**
+     * @brief Performs one step of pending work.
+     * @param force True to ignore the flush delay.
+     * @return True if flash was written and more work may be pending.
+     */
+    bool step(bool force);
+
+    /**
+     * @brief Appends dirty CVs to the active sector, filling at most one page.
+     */
+    void appendPage();
+
+    /**
+     * @brief Starts compacting into the next sector.
+     */
+    void startCompaction();
+
+    /**
+     * @brief Performs one step of the compaction.
+     */
+    void compactStep();
+
+    /**
+     * @brief Reads and validates the header of a sector.
+     * @param sector The sector index.
+     * @param[out] sequence The sector's sequence number.
+     * @return True if the sector has a valid header.
+     */
+    bool readHeader(uint8_t sector, uint16_t& sequence);
+
+    /**
+     * @brief Replays the records of the active sector into the store.
+     */
+    void replay();
+
+    /**
+     * @brief Encodes a CV record into the page buffer.
+     * @param slot The slot index within the sector.
+     * @param cv The CV number.
+     * @param value The CV value.
+     */
+    void encodeRecord(uint16_t slot, uint32_t cv, uint8_t value);
+
+    /**
+     * @brief Programs the page buffer to the page containing a slot.
+     * @param sector The sector index.
+     * @param slot A slot index within the page.
+     */
+    void programSlotPage(uint8_t sector, uint16_t slot);
+
+    CvFlashHardware* _hardware; ///< Pointer to the flash hardware abstraction layer.
+    CvStore& _store;            ///< The CV store being persisted.
+    uint32_t _flush_delay_ms;   ///< Time to collect changes before writing a page.
+
+    CvJournalState _state;      ///< State of the background work.
+    bool _has_active;           ///< True if a sector with a valid header exists.
+    uint8_t _active_sector;     ///< Index of the sector that receives new records.
+    uint16_t _sequence;         ///< Sequence number of the active sector.
+    uint16_t _write_slot;       ///< Index of the next free slot in the active sector.
+
+    uint8_t _target_sector;     ///< Sector being filled by the compaction.
+    uint32_t _copy_cursor;      ///< CV number at which the compaction continues.
+    uint16_t _copy_slot;        ///< Next free slot in the target sector.
+
+    bool _pending;              ///< True if dirty CVs are being collected.
+    uint32_t _pending_since;    ///< Time (millis) at which collection started.
+
+    uint8_t _page[CV_FLASH_PAGE_SIZE]; ///< Page buffer for reading and programming.
+};
+
+#endif // CV_JOURNAL_H
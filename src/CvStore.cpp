@@ -0,0 +1,276 @@
+/**
+ * @file CvStore.cpp
+ * @brief Implementation of the CvStore class.
+ */
+#include "CvStore.h"
+#include <cstring>
+
+/**
+ * @brief Constructs an empty CV store.
+ */
+CvStore::CvStore() {
+    clear();
+}
+
+/**
+ * @brief Removes all CVs and clears all dirty flags.
+ */
+void CvStore::clear() {
+    memset(_dense, 0, sizeof(_dense));
+    memset(_dense_defined, 0, sizeof(_dense_defined));
+    memset(_dense_dirty, 0, sizeof(_dense_dirty));
+    memset(_pages, 0, sizeof(_pages));
+    _page_count = 0;
+    memset(_dirty_count, 0, sizeof(_dirty_count));
+}
+
+/**
+ * @brief Binary search for a sparse page.
+ * @param base The page base address.
+ * @return The page index, or -1 if not present.
+ */
+int CvStore::findPage(uint32_t base) const {
+    int lo = 0;
+    int hi = (int)_page_count - 1;
+    while (lo <= hi) {
+        int mid = (lo + hi) / 2;
+        if (_pages[mid].base == base) return mid;
+        if (_pages[mid].base < base) {
+            lo = mid + 1;
+        } else {
+            hi = mid - 1;
+        }
+    }
+    return -1;
+}
+
+/**
+ * @brief Finds a sparse page or inserts an empty one at its sorted position.
+ * @param base The page base address.
+ * @return The page index, or -1 if all pages are in use.
+ */
+int CvStore::findOrInsertPage(uint32_t base) {
+    int index = findPage(base);
+    if (index >= 0) return index;
+    if (_page_count >= CV_STORE_MAX_PAGES) return -1;
+
+    int pos = 0;
+    while (pos < _page_count && _pages[pos].base < base) {
+        pos++;
+    }
+    memmove(&_pages[pos + 1], &_pages[pos], (_page_count - pos) * sizeof(Page));
+    memset(&_pages[pos], 0, sizeof(Page));
+    _pages[pos].base = base;
+    _page_count++;
+    return pos;
+}
+
+/**
+ * @brief Reads a CV.
+ * @param cv The CV number.
+ * @param[out] value The value of the CV.
+ * @return True if the CV is defined.
+ */
+bool CvStore::read(uint32_t cv, uint8_t& value) const {
+    if (cv == 0 || cv > CV_STORE_MAX_CV) return false;
+    if (cv <= CV_STORE_DENSE_SIZE) {
+        uint16_t i = cv - 1;
+        if ((_dense_defined[i >> 5] & (1UL << (i & 31))) == 0) return false;
+        value = _dense[i];
+        return true;
+    }
+    int page = findPage(cv & ~(uint32_t)(CV_STORE_PAGE_SIZE - 1));
+    if (page < 0) return false;
+    uint8_t offset = cv & (CV_STORE_PAGE_SIZE - 1);
+    if ((_pages[page].defined & (1UL << offset)) == 0) return false;
+    value = _pages[page].values[offset];
+    return true;
+}
+
+/**
+ * @brief Writes a CV and marks it dirty.
+ */
+bool CvStore::write(uint32_t cv, uint8_t value) {
+    return store(cv, value, (1 << CV_DIRTY_FLAG_COUNT) - 1);
+}
+
+/**
+ * @brief Sets a CV without marking it dirty.
+ */
+bool CvStore::define(uint32_t cv, uint8_t value) {
+    return store(cv, value, 0);
+}
+
+/**
+ * @brief Sets a CV restored from flash, marking it only as modified.
+ */
+bool CvStore::restore(uint32_t cv, uint8_t value) {
+    return store(cv, value, 1 << static_cast<uint8_t>(CvDirtyFlag::MODIFIED));
+}
+
+/**
+ * @brief Stores a CV value in the dense array or the matching sparse page.
+ * @param cv The CV number.
+ * @param value The value.
+ * @param dirtyMask Bit mask of the consumers whose dirty flag is set.
+ * @return True on success.
+ */
+bool CvStore::store(uint32_t cv, uint8_t value, uint8_t dirtyMask) {
+    if (cv == 0 || cv > CV_STORE_MAX_CV) return false;
+
+    uint32_t* defined;
+    uint32_t* dirty[CV_DIRTY_FLAG_COUNT];
+    uint32_t mask;
+    if (cv <= CV_STORE_DENSE_SIZE) {
+        uint16_t i = cv - 1;
+        _dense[i] = value;
+        defined = &_dense_defined[i >> 5];
+        for (uint8_t f = 0; f < CV_DIRTY_FLAG_COUNT; ++f) {
+            dirty[f] = &_dense_dirty[f][i >> 5];
+        }
+        mask = 1UL << (i & 31);
+    } else {
+        int page = findOrInsertPage(cv & ~(uint32_t)(CV_STORE_PAGE_SIZE - 1));
+        if (page < 0) return false;
+        uint8_t offset = cv & (CV_STORE_PAGE_SIZE - 1);
+        _pages[page].values[offset] = value;
+        defined = &_pages[page].defined;
+        for (uint8_t f = 0; f < CV_DIRTY_FLAG_COUNT; ++f) {
+            dirty[f] = &_pages[page].dirty[f];
+        }
+        mask = 1UL << offset;
+    }
+
+    *defined |= mask;
+    for (uint8_t f = 0; f < CV_DIRTY_FLAG_COUNT; ++f) {
+        if ((dirtyMask & (1 << f)) != 0 && (*dirty[f] & mask) == 0) {
+            *dirty[f] |= mask;
+            _dirty_count[f]++;
+        }
+    }
+    return true;
+}
+
+/**
+ * @brief Checks if a CV has a value.
+ */
+bool CvStore::isDefined(uint32_t cv) const {
+    uint8_t value;
+    return read(cv, value);
+}
+
+/**
+ * @brief Finds the first set bit at or after `from` in a dense-space bitmap.
+ * @details Skips empty 32-bit words, so a full scan touches at most 32 words.
+ */
+bool CvStore::nextDenseBit(const uint32_t* bitmap, uint16_t from, uint16_t& index) {
+    if (from >= CV_STORE_DENSE_SIZE) return false;
+    uint16_t word = from >> 5;
+    uint32_t bits = bitmap[word] & (0xFFFFFFFFUL << (from & 31));
+    while (true) {
+        if (bits != 0) {
+            index = (word << 5) + __builtin_ctz(bits);
+            return true;
+        }
+        if (++word >= CV_STORE_DENSE_SIZE / 32) return false;
+        bits = bitmap[word];
+    }
+}
+
+/**
+ * @brief Finds the first defined CV at or after `from`.
+ */
+bool CvStore::nextDefined(uint32_t from, uint32_t& cv) const {
+    if (from == 0) from = 1;
+    uint16_t index;
+    if (from <= CV_STORE_DENSE_SIZE && nextDenseBit(_dense_defined, from - 1, index)) {
+        cv = index + 1;
+        return true;
+    }
+    for (uint8_t p = 0; p < _page_count; ++p) {
+        const Page& page = _pages[p];
+        if (page.base + CV_STORE_PAGE_SIZE <= from) continue;
+        uint32_t bits = page.defined;
+        if (from > page.base) {
+            bits &= 0xFFFFFFFFUL << (from - page.base);
+        }
+        if (bits != 0) {
+            cv = page.base + __builtin_ctz(bits);
+            return true;
+        }
+    }
+    return false;
+}
+
+/**
+ * @brief Finds the first dirty CV at or after `from` for a consumer.
+ */
+bool CvStore::nextDirty(CvDirtyFlag flag, uint32_t from, uint32_t& cv) const {
+    uint8_t f = static_cast<uint8_t>(flag);
+    if (_dirty_count[f] == 0) return false;
+    if (from == 0) from = 1;
+    uint16_t index;
+    if (from <= CV_STORE_DENSE_SIZE && nextDenseBit(_dense_dirty[f], from - 1, index)) {
+        cv = index + 1;
+        return true;
+    }
+    for (uint8_t p = 0; p < _page_count; ++p) {
+        const Page& page = _pages[p];
+        if (page.base + CV_STORE_PAGE_SIZE <= from) continue;
+        uint32_t bits = page.dirty[f];
+        if (from > page.base) {
+            bits &= 0xFFFFFFFFUL << (from - page.base);
+        }
+        if (bits != 0) {
+            cv = page.base + __builtin_ctz(bits);
+            return true;
+        }
+    }
+    return false;
+}
+
+/**
+ * @brief Checks if a CV is dirty for a consumer.
+ */
+bool CvStore::isDirty(CvDirtyFlag flag, uint32_t cv) const {
+    uint8_t f = static_cast<uint8_t>(flag);
+    if (cv == 0 || cv > CV_STORE_MAX_CV) return false;
+    if (cv <= CV_STORE_DENSE_SIZE) {
+        uint16_t i = cv - 1;
+        return (_dense_dirty[f][i >> 5] & (1UL << (i & 31))) != 0;
+    }
+    int page = findPage(cv & ~(uint32_t)(CV_STORE_PAGE_SIZE - 1));
+    if (page < 0) return false;
+    return (_pages[page].dirty[f] & (1UL << (cv & (CV_STORE_PAGE_SIZE - 1)))) != 0;
+}
+
+/**
+ * @brief Clears the dirty flag of a CV for one consumer.
+ */
+void CvStore::clearDirty(CvDirtyFlag flag, uint32_t cv) {
+    uint8_t f = static_cast<uint8_t>(flag);
+    if (cv == 0 || cv > CV_STORE_MAX_CV) return;
+    uint32_t* word;
+    uint32_t mask;
+    if (cv <= CV_STORE_DENSE_SIZE) {
+        uint16_t i = cv - 1;
+        word = &_dense_dirty[f][i >> 5];
+        mask = 1UL << (i & 31);
+    } else {
+        int page = findPage(cv & ~(uint32_t)(CV_STORE_PAGE_SIZE - 1));
+        if (page < 0) return;
+        word = &_pages[page].dirty[f];
+        mask = 1UL << (cv & (CV_STORE_PAGE_SIZE - 1));
+    }
+    if (*word & mask) {
+        *word &= ~mask;
+        _dirty_count[f]--;
+    }
+}
+
+/**
+ * @brief Returns the number of dirty CVs for a consumer.
+ */
+uint16_t CvStore::dirtyCount(CvDirtyFlag flag) const {
+    return _dirty_count[static_cast<uint8_t>(flag)];
+}
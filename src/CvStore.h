@@ -0,0 +1,194 @@
+/**
+ * @file CvStore.h
+ * @brief Flat storage for the decoder's configuration variables (CVs).
+ * @details The CV space is split into a dense array for CV1-1024, which covers
+ *          everything reachable through a standard POM command, and a small,
+ *          sorted table of sparse pages for the extended/indexed CV space used
+ *          by XPOM and CV_AUTO (24-bit CV addresses). Every write is recorded in
+ *          per-consumer dirty bitmaps so that background work such as the
+ *          CV_AUTO broadcast or flash persistence can proceed incrementally.
+ */
+#ifndef CV_STORE_H
+#define CV_STORE_H
+
+#include <Arduino.h>
+
+/** @brief Number of CVs held in the dense array (CV1-1024). */
+constexpr uint16_t CV_STORE_DENSE_SIZE = 1024;
+/** @brief Number of CVs per sparse page (must be a power of two, at most 32). */
+constexpr uint8_t CV_STORE_PAGE_SIZE = 32;
+/** @brief Maximum number of sparse pages for the extended CV space. */
+constexpr uint8_t CV_STORE_MAX_PAGES = 8;
+/** @brief The highest CV address that can be stored (24-bit). @see RCN-217, 5.2.11 */
+constexpr uint32_t CV_STORE_MAX_CV = 0xFFFFFF;
+
+/**
+ * @enum CvDirtyFlag
+ * @brief Identifies an independent consumer of CV changes.
+ * @details Each consumer has its own dirty bitmap, so clearing a CV for one
+ *          consumer does not hide the change from the others.
+ */
+enum class CvDirtyFlag : uint8_t {
+    BROADCAST = 0, ///< The CV has changed since it was last sent as CV_AUTO.
+    PERSIST = 1,   ///< The CV has changed since it was last written to flash.
+    MODIFIED = 2   ///< The CV differs from its factory default (written or restored); used for journal compaction.
+};
+
+/** @brief The number of values in `CvDirtyFlag`. */
+constexpr uint8_t CV_DIRTY_FLAG_COUNT = 3;
+
+/**
+ * @class CvStore
+ * @brief A fixed-size, allocation-free CV storage engine.
+ * @details Reads and writes of CV1-1024 are O(1) array accesses. CVs above 1024
+ *          live in sparse pages that are kept sorted by base address and found
+ *          by binary search. Only CVs that have been defined (given a value)
+ *          are reported by the iteration functions.
+ */
+class CvStore {
+public:
+    /**
+     * @brief Constructs an empty CV store.
+     */
+    CvStore();
+
+    /**
+     * @brief Removes all CVs and clears all dirty flags.
+     */
+    void clear();
+
+    /**
+     * @brief Reads a CV.
+     * @param cv The CV number (1-based).
+     * @param[out] value Receives the value if the CV is defined.
+     * @return True if the CV is defined.
+     */
+    bool read(uint32_t cv, uint8_t& value) const;
+
+    /**
+     * @brief Writes a CV and marks it dirty for all consumers.
+     * @details Writing an undefined CV defines it.
+     * @param cv The CV number (1-based).
+     * @param value The new value.
+     * @return True on success, false if the CV number is invalid or no sparse page is left.
+     */
+    bool write(uint32_t cv, uint8_t value);
+
+    /**
+     * @brief Sets a CV without marking it dirty.
+     * @details Used for factory defaults and for restoring persisted values.
+     * @param cv The CV number (1-based).
+     * @param value The value.
+     * @return True on success, false if the CV number is invalid or no sparse page is left.
+     */
+    bool define(uint32_t cv, uint8_t value);
+
+    /**
+     * @brief Sets a CV that was read back from persistent storage.
+     * @details Only the `MODIFIED` flag is set, so the CV is neither broadcast
+     *          nor written to flash again, but is kept on journal compaction.
+     * @param cv The CV number (1-based).
+     * @param value The value.
+     * @return True on success, false if the CV number is invalid or no sparse page is left.
+     */
+    bool restore(uint32_t cv, uint8_t value);
+
+    /**
+     * @brief Checks if a CV has a value.
+     * @param cv The CV number (1-based).
+     * @return True if the CV is defined.
+     */
+    bool isDefined(uint32_t cv) const;
+
+    /**
+     * @brief Finds the first defined CV at or after a given CV number.
+     * @param from The CV number to start searching from.
+     * @param[out] cv Receives the CV number that was found.
+     * @return True if a defined CV was found.
+     */
+    bool nextDefined(uint32_t from, uint32_t& cv) const;
+
+    /**
+     * @brief Finds the first dirty CV at or after a given CV number.
+     * @param flag The consumer whose dirty bitmap is searched.
+     * @param from The CV number to start searching from.
+     * @param[out] cv Receives the CV number that was found.
+     * @return True if a dirty CV was found.
+     */
+    bool nextDirty(CvDirtyFlag flag, uint32_t from, uint32_t& cv) const;
+
+    /**
+     * @brief Checks if a CV is dirty for a consumer.
+     * @param flag The consumer.
+     * @param cv The CV number (1-based).
+     * @return True if the CV changed since the consumer last cleared it.
+     */
+    bool isDirty(CvDirtyFlag flag, uint32_t cv) const;
+
+    /**
+     * @brief Clears the dirty flag of a CV for one consumer.
+     * @param flag The consumer.
+     * @param cv The CV number (1-based).
+     */
+    void clearDirty(CvDirtyFlag flag, uint32_t cv);
+
+    /**
+     * @brief Returns the number of dirty CVs for a consumer.
+     * @param flag The consumer.
+     * @return The number of CVs whose dirty flag is set.
+     */
+    uint16_t dirtyCount(CvDirtyFlag flag) const;
+
+private:
+    /**
+     * @struct Page
+     * @brief A block of `CV_STORE_PAGE_SIZE` consecutive CVs in the extended space.
+     */
+    struct Page {
+        uint32_t base;                          ///< CV number of the first CV in the page.
+        uint32_t defined;                       ///< Bitmap of defined CVs.
+        uint32_t dirty[CV_DIRTY_FLAG_COUNT];    ///< Dirty bitmaps, one per consumer.
+        uint8_t values[CV_STORE_PAGE_SIZE];     ///< The CV values.
+    };
+
+    /**
+     * @brief Finds the page that holds a CV.
+     * @param base The page base address.
+     * @return The index of the page, or -1 if it does not exist.
+     */
+    int findPage(uint32_t base) const;
+
+    /**
+     * @brief Finds or inserts the page that holds a CV, keeping the table sorted.
+     * @param base The page base address.
+     * @return The index of the page, or -1 if the table is full.
+     */
+    int findOrInsertPage(uint32_t base);
+
+    /**
+     * @brief Common implementation of `write`, `define` and `restore`.
+     * @param cv The CV number.
+     * @param value The value.
+     * @param dirtyMask Bit mask of the `CvDirtyFlag` consumers to mark dirty.
+     * @return True on success.
+     */
+    bool store(uint32_t cv, uint8_t value, uint8_t dirtyMask);
+
+    /**
+     * @brief Searches a bitmap of the dense space for the first set bit at or after an index.
+     * @param bitmap The bitmap to search.
+     * @param from The index to start at.
+     * @param[out] index Receives the index of the set bit.
+     * @return True if a set bit was found.
+     */
+    static bool nextDenseBit(const uint32_t* bitmap, uint16_t from, uint16_t& index);
+
+    uint8_t _dense[CV_STORE_DENSE_SIZE];                                ///< Values of CV1-1024.
+    uint32_t _dense_defined[CV_STORE_DENSE_SIZE / 32];                  ///< Defined bitmap of the dense space.
+    uint32_t _dense_dirty[CV_DIRTY_FLAG_COUNT][CV_STORE_DENSE_SIZE / 32]; ///< Dirty bitmaps of the dense space.
+    Page _pages[CV_STORE_MAX_PAGES];                                    ///< Sparse pages, sorted by base.
+    uint8_t _page_count;                                                ///< Number of pages in use.
+    uint16_t _dirty_count[CV_DIRTY_FLAG_COUNT];                         ///< Number of dirty CVs per consumer.
+};
+
+#endif // CV_STORE_H
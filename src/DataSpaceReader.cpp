@@ -0,0 +1,233 @@
+/**
+ * @file DataSpaceReader.cpp
+ * @brief Implementation of the DataSpaceReader class.
+ */
+#include "DataSpaceReader.h"
+#include <cstring>
+
+/**
+ * @brief Constructs a DataSpaceReader.
+ * @param rx The receiver that reads the replies of the decoder.
+ */
+DataSpaceReader::DataSpaceReader(RailcomRx& rx)
+    : _rx(rx), _state(DataSpaceReadState::IDLE), _address(0), _data_space_num(0),
+      _buffer(nullptr), _capacity(0), _length(0), _end_known(false), _received(),
+      _start(0), _index(0), _reply_open(false), _restart(false), _progress(false),
+      _misses(0), _attempts(0), _pending(false), _requests(0), _retries(0) {
+}
+
+/**
+ * @brief Starts reading a data space.
+ * @param address The address of the decoder.
+ * @param dataSpaceNum The number of the data space.
+ * @param buffer The buffer that receives the data.
+ * @param capacity The size of `buffer`.
+ */
+void DataSpaceReader::start(uint16_t address, uint8_t dataSpaceNum, uint8_t* buffer, size_t capacity) {
+    _state = DataSpaceReadState::RUNNING;
+    _address = address;
+    _data_space_num = dataSpaceNum & 0x0F;
+    _buffer = buffer;
+    _capacity = capacity < DATA_SPACE_MAX_SIZE ? capacity : DATA_SPACE_MAX_SIZE;
+    _length = 0;
+    _end_known = false;
+    memset(_received, 0, sizeof(_received));
+    _start = 0;
+    _index = 0;
+    _reply_open = false;
+    _restart = true;
+    _progress = true; // The first read has nothing to make progress over.
+    _misses = 0;
+    _attempts = 0;
+    _pending = false;
+}
+
+/**
+ * @brief Returns the number of bytes the transfer has to read.
+ * @details Until the last block is known, the data space may fill the buffer.
+ */
+size_t DataSpaceReader::limit() const {
+    return _end_known && _length < _capacity ? _length : _capacity;
+}
+
+/**
+ * @brief Finds the first byte that has not been received.
+ * @return The byte offset, or `limit()` if there is none.
+ */
+size_t DataSpaceReader::firstMissing() const {
+    size_t end = limit();
+    for (size_t i = 0; i < end; ++i) {
+        if (!(_received[i / 8] & (1 << (i % 8)))) return i;
+    }
+    return end;
+}
+
+/**
+ * @brief Returns the index of a block in the current reply.
+ * @details The first block of a reply has the sequence number 0, so a 0 means
+ *          the decoder has started the reply again. The blocks behind it cycle
+ *          through 1 to `DATASPACE_SEQ_CYCLE`; the index is the first one at or
+ *          behind the expected block with that number.
+ * @param sequence The sequence number from the block header.
+ * @return The index.
+ */
+uint16_t DataSpaceReader::blockIndex(uint8_t sequence) const {
+    if (sequence == 0) return 0;
+    uint16_t expected = _index > 0 ? _index : 1;
+    uint8_t expected_sequence = (expected - 1) % DATASPACE_SEQ_CYCLE + 1;
+    return expected + (sequence + DATASPACE_SEQ_CYCLE - expected_sequence) % DATASPACE_SEQ_CYCLE;
+}
+
+/**
+ * @brief Builds the next Data Space read, if the transfer is running.
+ * @details Repeats the current read, so that the decoder sends the next block,
+ *          or starts a new read at the first missing byte.
+ * @param[out] packet The packet to send.
+ * @return True if `packet` should be sent.
+ */
+bool DataSpaceReader::nextPacket(DCCMessage& packet) {
+    if (_state != DataSpaceReadState::RUNNING) {
+        return false;
+    }
+
+    if (_restart) {
+        _attempts = _progress ? 0 : _attempts + 1;
+        if (_attempts >= DATA_SPACE_READ_ATTEMPTS) {
+            finish(DataSpaceReadState::FAILED);
+            return false;
+        }
+        size_t first = firstMissing();
+        uint8_t start = first < DATA_SPACE_MAX_START ? first : DATA_SPACE_MAX_START;
+        // The decoder continues a reply on the same read, so another start
+        // offset is needed to make it begin anew.
+        if (_reply_open && start == _start) {
+            start = start > 0 ? start - 1 : 1;
+        }
+        _start = start;
+        _index = 0;
+        _misses = 0;
+        _reply_open = true;
+        _restart = false;
+        _progress = false;
+    }
+    _requests++;
+    _pending = true;
+
+    // Data Space Read: [ADDR_H] ADDR_L 1110-1101 NNNN-SSSS (N = data space, S = start offset)
+    uint8_t data[5];
+    size_t len = 0;
+    if (_address > MAX_SHORT_ADDRESS) {
+        data[len++] = 0xC0 | ((_address >> 8) & 0x3F);
+    }
+    data[len++] = _address & 0xFF;
+    data[len++] = 0xED;
+    data[len++] = (_data_space_num << 4) | _start;
+
+    uint8_t checksum = 0;
+    for (size_t i = 0; i < len; ++i) {
+        checksum ^= data[i];
+    }
+    data[len++] = checksum;
+    packet = DCCMessage(data, len);
+    return true;
+}
+
+/**
+ * @brief Checks whether the cutout after the last packet carries a block.
+ * @return True if `processCutout()` should be called.
+ */
+bool DataSpaceReader::expectsReply() const {
+    return _pending;
+}
+
+/**
+ * @brief Reads and stores the block sent after the last packet.
+ * @details Blocks with a CRC error are discarded. The decoder has most likely
+ *          sent them anyway, so the next block is expected behind them.
+ * @return The message read from the receiver, or nullptr.
+ */
+RailcomMessage* DataSpaceReader::processCutout() {
+    if (!_pending) {
+        return nullptr;
+    }
+    _pending = false;
+
+    _rx.expectDataSpaceResponse(_data_space_num);
+    RailcomMessage* msg = _rx.read();
+    DataSpaceMessage* block = static_cast<DataSpaceMessage*>(msg);
+    if (block != nullptr && block->crc_ok && block->len <= DATA_SPACE_CHUNK_SIZE) {
+        uint16_t index = blockIndex(block->sequence);
+        size_t offset = _start + (size_t)index * DATA_SPACE_CHUNK_SIZE;
+        for (size_t i = 0; i < block->len && offset + i < _capacity; ++i) {
+            size_t pos = offset + i;
+            if (!(_received[pos / 8] & (1 << (pos % 8)))) {
+                _received[pos / 8] |= 1 << (pos % 8);
+                _buffer[pos] = block->data[i];
+                _progress = true;
+            }
+        }
+        _index = index + 1;
+        _misses = 0;
+
+        if (block->last) {
+            _end_known = true;
+            _length = offset + block->len;
+            _reply_open = false;
+            _restart = true;
+        }
+    } else {
+        _retries++;
+        _index++;
+        if (++_misses >= DATA_SPACE_READ_ATTEMPTS) {
+            _restart = true;
+        }
+    }
+
+    size_t end = limit();
+    if (firstMissing() == end && (_end_known || end == _capacity)) {
+        _length = end;
+        finish(DataSpaceReadState::COMPLETE);
+    }
+    return msg;
+}
+
+/**
+ * @brief Finishes the transfer and calls `onComplete`.
+ * @param state COMPLETE or FAILED.
+ */
+void DataSpaceReader::finish(DataSpaceReadState state) {
+    _state = state;
+    _pending = false;
+    if (onComplete) {
+        bool ok = state == DataSpaceReadState::COMPLETE;
+        onComplete(_data_space_num, ok ? _buffer : nullptr, ok ? _length : 0);
+    }
+}
+
+/**
+ * @brief Returns the state of the transfer.
+ */
+DataSpaceReadState DataSpaceReader::state() const {
+    return _state;
+}
+
+/**
+ * @brief Returns the size of the data space once the transfer is complete.
+ */
+size_t DataSpaceReader::length() const {
+    return _length;
+}
+
+/**
+ * @brief Returns the number of reads sent, including repeats.
+ */
+uint32_t DataSpaceReader::requestCount() const {
+    return _requests;
+}
+
+/**
+ * @brief Returns the number of reads that brought no valid block.
+ */
+uint32_t DataSpaceReader::retryCount() const {
+    return _retries;
+}
@@ -0,0 +1,173 @@
+/**
+ * @file DataSpaceReader.h
+ * @brief Command station side of the RCN-218 Data Space transfer.
+ * @details The DataSpaceReader reads a complete data space from a decoder. The
+ *          decoder answers a read with the data space from the requested byte
+ *          offset on, in blocks of `DATA_SPACE_CHUNK_SIZE` bytes that are each
+ *          protected by their own CRC, so a disturbed cutout only costs the
+ *          block it carried.
+ */
+#ifndef DATA_SPACE_READER_H
+#define DATA_SPACE_READER_H
+
+#include "Railcom.h"
+#include "RailcomProtocolDefs.h"
+#include "RailcomRx.h"
+#include <functional>
+
+/** @brief Number of reads in a row that bring no new bytes before the transfer is given up. */
+constexpr uint8_t DATA_SPACE_READ_ATTEMPTS = 4;
+
+/**
+ * @enum DataSpaceReadState
+ * @brief The state of a Data Space transfer.
+ */
+enum class DataSpaceReadState : uint8_t {
+    IDLE,     ///< No transfer has been started.
+    RUNNING,  ///< Blocks are being requested.
+    COMPLETE, ///< All blocks were received with a valid CRC.
+    FAILED    ///< `DATA_SPACE_READ_ATTEMPTS` reads in a row brought no new bytes.
+};
+
+/**
+ * @class DataSpaceReader
+ * @brief Reads a data space from a decoder with repeated Data Space reads.
+ * @details The command station offers the reader a slot before each DCC packet
+ *          with `nextPacket()` and calls `processCutout()` after the cutout that
+ *          followed it. Every packet is a Data Space read; the decoder sends the
+ *          next block of its reply in the cutout after each repeat of the same
+ *          read, so the reader never waits for a reply before the next packet:
+ *          - Each block is placed by its byte offset, the start offset of the
+ *            read plus `DATA_SPACE_CHUNK_SIZE` times its index in the reply. The
+ *            index follows from the sequence number in the block header, so
+ *            lost blocks and blocks sent after other packets to the decoder do
+ *            not shift the ones behind them.
+ *          - A block with a CRC error or without a reply is skipped. Once the
+ *            last block has been received, or `DATA_SPACE_READ_ATTEMPTS` blocks
+ *            in a row were lost, a new read starts at the first missing byte;
+ *            as the start field has 4 bits, at most at `DATA_SPACE_MAX_START`.
+ *          - The block flagged as the last one gives the size of the data space.
+ *          With every slot available, a data space of n bytes is read in
+ *          (n + `DATA_SPACE_CHUNK_SIZE` - 1) / `DATA_SPACE_CHUNK_SIZE` packets.
+ * @see RCN-218, 4.3
+ */
+class DataSpaceReader {
+public:
+    /**
+     * @brief Constructs a DataSpaceReader.
+     * @param rx The receiver that reads the replies of the decoder.
+     */
+    explicit DataSpaceReader(RailcomRx& rx);
+
+    /**
+     * @brief Starts reading a data space.
+     * @details A running transfer is abandoned.
+     * @param address The address of the decoder.
+     * @param dataSpaceNum The number of the data space (0-15).
+     * @param buffer The buffer that receives the data.
+     * @param capacity The size of `buffer`; at most `DATA_SPACE_MAX_SIZE` bytes
+     *        are read.
+     */
+    void start(uint16_t address, uint8_t dataSpaceNum, uint8_t* buffer, size_t capacity);
+
+    /**
+     * @brief Builds the next Data Space read, if the transfer is running.
+     * @param[out] packet The packet to send, including its checksum.
+     * @return True if `packet` should be sent.
+     */
+    bool nextPacket(DCCMessage& packet);
+
+    /**
+     * @brief Checks whether the cutout after the last packet carries a block.
+     * @return True if `processCutout()` should be called for the next cutout.
+     */
+    bool expectsReply() const;
+
+    /**
+     * @brief Reads and stores the block sent after the last packet.
+     * @return The message read from the receiver, or nullptr. It stays valid
+     *         until the next call to `RailcomRx::read()`.
+     */
+    RailcomMessage* processCutout();
+
+    /**
+     * @brief Returns the state of the transfer.
+     * @return The state.
+     */
+    DataSpaceReadState state() const;
+
+    /**
+     * @brief Returns the size of the data space once the transfer is complete.
+     * @return The number of valid bytes in the buffer.
+     */
+    size_t length() const;
+
+    /**
+     * @brief Returns the number of reads sent, including repeats.
+     * @return The request count.
+     */
+    uint32_t requestCount() const;
+
+    /**
+     * @brief Returns the number of reads that brought no valid block.
+     * @return The retry count.
+     */
+    uint32_t retryCount() const;
+
+    /**
+     * @brief Called when a transfer has completed or failed.
+     * @param dataSpaceNum The number of the data space.
+     * @param data The data read (nullptr if the transfer failed).
+     * @param len The number of bytes read.
+     */
+    std::function<void(uint8_t dataSpaceNum, const uint8_t* data, size_t len)> onComplete;
+
+private:
+    /**
+     * @brief Returns the index of a block in the current reply.
+     * @param sequence The sequence number from the block header.
+     * @return The first index at or behind the expected one with that sequence number.
+     */
+    uint16_t blockIndex(uint8_t sequence) const;
+
+    /**
+     * @brief Returns the number of bytes the transfer has to read.
+     */
+    size_t limit() const;
+
+    /**
+     * @brief Finds the first byte that has not been received.
+     * @return The byte offset, or `limit()` if every byte has been received.
+     */
+    size_t firstMissing() const;
+
+    /**
+     * @brief Finishes the transfer and calls `onComplete`.
+     * @param state COMPLETE or FAILED.
+     */
+    void finish(DataSpaceReadState state);
+
+    RailcomRx& _rx;                ///< The receiver for the decoder replies.
+    DataSpaceReadState _state;     ///< The state of the transfer.
+    uint16_t _address;             ///< Address of the decoder.
+    uint8_t _data_space_num;       ///< Number of the data space.
+    uint8_t* _buffer;              ///< Receives the data.
+    size_t _capacity;              ///< Size of `_buffer`, at most `DATA_SPACE_MAX_SIZE`.
+    size_t _length;                ///< Size of the data space, once known.
+    bool _end_known;               ///< The last block has been received.
+
+    uint8_t _received[DATA_SPACE_MAX_SIZE / 8]; ///< Bitmap of the bytes received.
+    uint8_t _start;                ///< Start offset of the current read.
+    uint16_t _index;               ///< Index of the next block of the current reply.
+    bool _reply_open;              ///< The decoder may still be sending the current reply.
+    bool _restart;                 ///< The next packet starts a new read.
+    bool _progress;                ///< The current read has brought new bytes.
+    uint8_t _misses;               ///< Blocks lost in a row.
+    uint8_t _attempts;             ///< Reads in a row without new bytes.
+    bool _pending;                 ///< A block is expected in the next cutout.
+
+    uint32_t _requests;            ///< Reads sent.
+    uint32_t _retries;             ///< Reads without a valid block.
+};
+
+#endif // DATA_SPACE_READER_H
@@ -0,0 +1,166 @@
+/**
+ * @file DecoderRuntime.cpp
+ * @brief Implementation of the DecoderRuntime class.
+ */
+#include "DecoderRuntime.h"
+#include "pico/time.h"
+
+/**
+ * @brief Constructs a DecoderRuntime.
+ * @param decoder The decoder.
+ * @param tx The transmitter of the decoder.
+ */
+DecoderRuntime::DecoderRuntime(DecoderStateMachine& decoder, RailcomTx& tx)
+    : _decoder(decoder), _tx(tx), _packet_end_us(0), _packet_end_marked(false), _packet_pending(false),
+      _worst_latency_us(0), _cutouts(0), _dropped_events(0), _dropped_frames(0) {
+}
+
+/**
+ * @brief Marks the end of a DCC packet, from the interrupt of the DCC receiver.
+ * @param now_us The time of the edge that ends the packet.
+ */
+void DecoderRuntime::onPacketEnd(uint32_t now_us) {
+    _packet_end_us = now_us;
+    _packet_end_marked = true;
+}
+
+/**
+ * @brief Handles a received DCC packet on core 1.
+ * @details The packet is handled first, so the reply is ready for the cutout;
+ *          the events are queued afterwards.
+ * @param packet The packet.
+ */
+void DecoderRuntime::onPacket(const DCCMessage& packet) {
+    if (!_packet_end_marked) {
+        _packet_end_us = time_us_32();
+    }
+    _packet_end_marked = false;
+    _packet_pending = true;
+
+    uint16_t address = _decoder.address();
+    LogonState state = _decoder.logonState();
+    _decoder.handleDccPacket(packet);
+
+    raise(DecoderEventType::PACKET, packet);
+    if (_decoder.address() != address) {
+        raise(DecoderEventType::ADDRESS, packet);
+    }
+    if (_decoder.logonState() != state) {
+        raise(DecoderEventType::LOGON_STATE, packet);
+    }
+}
+
+/**
+ * @brief Transmits the reply in the cutout on core 1.
+ * @details The latency is taken from the time the transmitter started
+ *          `send_frame()`, so it ends where the reply starts on the wire.
+ * @param elapsed_us The time in microseconds since the cutout started.
+ */
+void DecoderRuntime::onCutout(uint32_t elapsed_us) {
+    _tx.on_cutout_start(elapsed_us);
+    if (_packet_pending) {
+        uint32_t latency = _tx.frameStartUs() - _packet_end_us;
+        if (latency > _worst_latency_us.load(std::memory_order_relaxed)) {
+            _worst_latency_us.store(latency, std::memory_order_relaxed);
+        }
+        _packet_pending = false;
+    }
+    _cutouts.store(_cutouts.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+}
+
+/**
+ * @brief Moves the messages of the application to the transmitter and runs the decoder task.
+ */
+void DecoderRuntime::task() {
+    Outgoing outgoing;
+    while (_outgoing.pop(outgoing)) {
+        if (!_tx.queueFrame(outgoing.frame, outgoing.priority, outgoing.slot)) {
+            _dropped_frames.store(_dropped_frames.load(std::memory_order_relaxed) + 1,
+                                  std::memory_order_relaxed);
+        }
+    }
+    _decoder.task();
+}
+
+/**
+ * @brief Queues an event for the application.
+ * @param type The kind of event.
+ * @param packet The packet that caused it.
+ */
+void DecoderRuntime::raise(DecoderEventType type, const DCCMessage& packet) {
+    DecoderEvent event;
+    event.type = type;
+    event.timestamp_us = _packet_end_us;
+    event.packet = packet;
+    event.address = _decoder.address();
+    event.logonState = _decoder.logonState();
+    if (!_events.push(event)) {
+        _dropped_events.store(_dropped_events.load(std::memory_order_relaxed) + 1,
+                              std::memory_order_relaxed);
+    }
+}
+
+/**
+ * @brief Fetches the next event on core 0.
+ * @param[out] event Receives the event.
+ * @return False if no event is waiting.
+ */
+bool DecoderRuntime::pollEvent(DecoderEvent& event) {
+    return _events.pop(event);
+}
+
+/**
+ * @brief Encodes a message on core 0 and hands it to core 1.
+ * @param id The RailcomID of the message.
+ * @param payload The payload.
+ * @param payloadBits The number of payload bits.
+ * @return False if the queue is full.
+ */
+bool DecoderRuntime::send(RailcomID id, uint64_t payload, uint8_t payloadBits) {
+    RailcomFrame frame;
+    RailcomEncoding::encodeFrame(id, payload, payloadBits, frame);
+    return sendFrame(frame, RailcomTx::priorityFor(id), RailcomTx::slotFor(id, payload, payloadBits));
+}
+
+/**
+ * @brief Hands a pre-encoded frame to core 1.
+ * @param frame The frame.
+ * @param priority The scheduling priority.
+ * @param slot The latest-value-wins slot.
+ * @return False if the queue is full.
+ */
+bool DecoderRuntime::sendFrame(const RailcomFrame& frame, RailcomPriority priority, uint16_t slot) {
+    Outgoing outgoing;
+    outgoing.frame = frame;
+    outgoing.priority = priority;
+    outgoing.slot = slot;
+    return _outgoing.push(outgoing);
+}
+
+/**
+ * @brief Returns the largest cutout latency measured so far.
+ */
+uint32_t DecoderRuntime::worstCutoutLatencyUs() const {
+    return _worst_latency_us.load(std::memory_order_relaxed);
+}
+
+/**
+ * @brief Returns the number of cutouts handled.
+ */
+uint32_t DecoderRuntime::cutoutCount() const {
+    return _cutouts.load(std::memory_order_relaxed);
+}
+
+/**
+ * @brief Returns the number of events lost to a full queue.
+ */
+uint32_t DecoderRuntime::droppedEvents() const {
+    return _dropped_events.load(std::memory_order_relaxed);
+}
+
+/**
+ * @brief Returns the number of messages the Channel 2 scheduler rejected.
+ */
+uint32_t DecoderRuntime::droppedFrames() const {
+    return _dropped_frames.load(std::memory_order_relaxed);
+}
@@ -0,0 +1,205 @@
+/**
+ * @file DecoderRuntime.h
+ * @brief Runs the time-critical part of a decoder on its own core.
+ * @details On the RP2040, a slow application `loop()` (e.g. one that prints to
+ *          `Serial`) delays the DCC packet handling and with it the RailCom
+ *          cutout. The DecoderRuntime moves the DecoderStateMachine and the
+ *          RailcomTx to the second core and lets the application talk to them
+ *          through two lock-free queues only:
+ *          - core 1 reports received packets and state changes as events,
+ *          - core 0 hands over RailCom messages, encoded on core 0, which core 1
+ *            copies into the Channel 2 scheduler.
+ *          With the arduino-pico core, DCC reception and the runtime go into
+ *          `setup1()`/`loop1()`, the application into `setup()`/`loop()`.
+ */
+#ifndef DECODER_RUNTIME_H
+#define DECODER_RUNTIME_H
+
+#include "DecoderStateMachine.h"
+#include "RailcomEncoding.h"
+#include "RailcomTx.h"
+#include "SpscQueue.h"
+#include <atomic>
+
+/** @brief Number of slots in the event queue from the runtime to the application. */
+constexpr uint16_t DECODER_EVENT_QUEUE_SIZE = 32;
+/** @brief Number of slots in the queue of messages from the application to the runtime. */
+constexpr uint16_t DECODER_TX_QUEUE_SIZE = 16;
+
+/**
+ * @enum DecoderEventType
+ * @brief The kind of a DecoderEvent.
+ */
+enum class DecoderEventType : uint8_t {
+    PACKET,      ///< A DCC packet was received; see `DecoderEvent::packet`.
+    ADDRESS,     ///< The command station assigned a new address; see `DecoderEvent::address`.
+    LOGON_STATE  ///< The RCN-218 logon state changed; see `DecoderEvent::logonState`.
+};
+
+/**
+ * @struct DecoderEvent
+ * @brief A notification from the runtime to the application.
+ */
+struct DecoderEvent {
+    DecoderEventType type;   ///< The kind of event.
+    uint32_t timestamp_us;   ///< `time_us_32()` at the end of the packet that caused the event.
+    DCCMessage packet;       ///< The received packet (all types).
+    uint16_t address;        ///< The decoder's address after the packet.
+    LogonState logonState;   ///< The logon state after the packet.
+};
+
+/**
+ * @class DecoderRuntime
+ * @brief Couples a decoder running on core 1 with an application on core 0.
+ * @details The methods are split by core. `onPacket()`, `onCutout()` and
+ *          `task()` belong to the core that receives DCC, `pollEvent()`,
+ *          `send()` and `sendFrame()` to the application core. Each queue has
+ *          exactly one producer and one consumer, so no locks are taken and
+ *          neither core ever waits for the other. Full queues drop the newest
+ *          entry and count it.
+ *
+ *          The runtime measures the cutout latency: the time from the end of
+ *          the DCC packet, as reported by `onPacketEnd()`, to the start of the
+ *          `send_frame()` call that transmits Channel 1. It covers the delay of
+ *          the DCC receiver, the packet handling and the encoding that the
+ *          cutout has to wait for.
+ */
+class DecoderRuntime {
+public:
+    /**
+     * @brief Constructs a DecoderRuntime.
+     * @param decoder The decoder; only used from core 1 afterwards.
+     * @param tx The transmitter of the decoder; only used from core 1 afterwards.
+     */
+    DecoderRuntime(DecoderStateMachine& decoder, RailcomTx& tx);
+
+    // --- Core 1 (DCC and cutout) ---
+
+    /**
+     * @brief Marks the end of a DCC packet.
+     * @details Call it from the interrupt of the DCC receiver, at the edge that
+     *          ends the end bit of the packet; it only stores the time. If a
+     *          receiver cannot report this edge, `onPacket()` takes the time
+     *          itself, and the latency then leaves out the receiver's delay.
+     * @param now_us The time of the edge (`time_us_32()`).
+     */
+    void onPacketEnd(uint32_t now_us);
+
+    /**
+     * @brief Handles a received DCC packet.
+     * @details Passes the packet to the DecoderStateMachine and reports it, and
+     *          any change of address or logon state, to the application.
+     * @param packet The packet.
+     */
+    void onPacket(const DCCMessage& packet);
+
+    /**
+     * @brief Transmits the RailCom reply in the cutout that follows a packet.
+     * @param elapsed_us The time in microseconds since the cutout started.
+     */
+    void onCutout(uint32_t elapsed_us = 0);
+
+    /**
+     * @brief Periodic work of core 1.
+     * @details Moves the messages of the application into the Channel 2
+     *          scheduler and runs `DecoderStateMachine::task()`. Call it from
+     *          `loop1()` between packets. An attached CV journal is driven from
+     *          here; a sector erase stops both cores anyway, so it only runs
+     *          when the decoder has not been addressed for a while (see
+     *          `DecoderStateMachine::attachJournal()`).
+     */
+    void task();
+
+    // --- Core 0 (application) ---
+
+    /**
+     * @brief Fetches the next event.
+     * @param[out] event Receives the event.
+     * @return False if no event is waiting.
+     */
+    bool pollEvent(DecoderEvent& event);
+
+    /**
+     * @brief Sends a RailCom message on Channel 2 with its default priority.
+     * @details The datagram is encoded by the calling core. Like the `send*`
+     *          methods of `RailcomTx`, a value message replaces a pending one
+     *          of the same slot (see `RailcomTx::slotFor`).
+     * @param id The RailcomID of the message.
+     * @param payload The payload.
+     * @param payloadBits The number of payload bits.
+     * @return False if the queue to core 1 is full.
+     */
+    bool send(RailcomID id, uint64_t payload, uint8_t payloadBits);
+
+    /**
+     * @brief Sends a pre-encoded frame on Channel 2.
+     * @param frame The frame; it is copied.
+     * @param priority The scheduling priority.
+     * @param slot The latest-value-wins slot, or `RAILCOM_NO_SLOT`.
+     * @return False if the queue to core 1 is full.
+     */
+    bool sendFrame(const RailcomFrame& frame, RailcomPriority priority, uint16_t slot = RAILCOM_NO_SLOT);
+
+    // --- Statistics (any core) ---
+
+    /**
+     * @brief Returns the largest cutout latency measured so far.
+     * @details The time from the end of a packet to the start of
+     *          `RailcomTxHardware::send_frame()` in the following cutout.
+     * @return The latency in microseconds.
+     */
+    uint32_t worstCutoutLatencyUs() const;
+
+    /**
+     * @brief Returns the number of cutouts handled.
+     * @return The cutout count.
+     */
+    uint32_t cutoutCount() const;
+
+    /**
+     * @brief Returns the number of events lost because the application did not poll in time.
+     * @return The number of dropped events.
+     */
+    uint32_t droppedEvents() const;
+
+    /**
+     * @brief Returns the number of messages the Channel 2 scheduler did not accept.
+     * @return The number of dropped messages.
+     */
+    uint32_t droppedFrames() const;
+
+private:
+    /**
+     * @struct Outgoing
+     * @brief A message on its way from the application to the transmitter.
+     */
+    struct Outgoing {
+        RailcomFrame frame;       ///< The encoded message.
+        RailcomPriority priority; ///< Its Channel 2 priority.
+        uint16_t slot;            ///< Its latest-value-wins slot in the transmitter.
+    };
+
+    /**
+     * @brief Queues an event for the application.
+     * @param type The kind of event.
+     * @param packet The packet that caused it.
+     */
+    void raise(DecoderEventType type, const DCCMessage& packet);
+
+    DecoderStateMachine& _decoder; ///< The decoder (core 1).
+    RailcomTx& _tx;                ///< The transmitter (core 1).
+
+    SpscQueue<DecoderEvent, DECODER_EVENT_QUEUE_SIZE> _events; ///< Core 1 to core 0.
+    SpscQueue<Outgoing, DECODER_TX_QUEUE_SIZE> _outgoing;      ///< Core 0 to core 1.
+
+    volatile uint32_t _packet_end_us; ///< End of the last packet, set by `onPacketEnd()` or `onPacket()`.
+    volatile bool _packet_end_marked; ///< `onPacketEnd()` was called for the packet not yet handled.
+    bool _packet_pending;             ///< A packet was handled since the last cutout.
+
+    std::atomic<uint32_t> _worst_latency_us; ///< Largest cutout latency.
+    std::atomic<uint32_t> _cutouts;          ///< Cutouts handled.
+    std::atomic<uint32_t> _dropped_events;   ///< Events lost to a full queue.
+    std::atomic<uint32_t> _dropped_frames;   ///< Messages the scheduler rejected.
+};
+
+#endif // DECODER_RUNTIME_H
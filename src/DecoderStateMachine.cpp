@@ -3,13 +3,37 @@
  * @brief Implementation of the DecoderStateMachine class.
  */
 #include "DecoderStateMachine.h"
+#include "LatencyTrace.h"
+#include "RailcomEncoding.h"
+#include "RailcomProtocolDefs.h"
 
 #include <Arduino.h>
+#include <cstring>
+
+/**
+ * @brief Derives the seed of the logon backoff generator from the unique ID.
+ * @details Decoders have no source of entropy at power-up, but their unique IDs
+ *          differ. The bits are mixed (MurmurHash3 finalizer) so that IDs that
+ *          differ only in a few bits still give unrelated sequences.
+ * @param manufacturerId The 12-bit manufacturer ID.
+ * @param productId The 32-bit product ID.
+ * @return A non-zero seed.
+ */
+static uint32_t seedFromUniqueId(uint16_t manufacturerId, uint32_t productId) {
+    uint32_t h = productId ^ ((uint32_t)(manufacturerId & 0x0FFF) * 0x9E3779B9UL);
+    h ^= h >> 16;
+    h *= 0x85EBCA6BUL;
+    h ^= h >> 13;
+    h *= 0xC2B2AE35UL;
+    h ^= h >> 16;
+    return h != 0 ? h : 1;
+}
 
 /**
  * @brief Constructs the DecoderStateMachine.
- * @details Initializes member variables, sets up dummy data for testing purposes
- *          (CVs and Data Spaces), and registers the callbacks for the DCC parser.
+ * @details Initializes member variables, stores CV28/CV29 in the CV store, sets up
+ *          dummy data for testing purposes (CVs and Data Spaces), and registers the
+ *          callbacks for the DCC parser.
  * @param txManager Reference to the RailcomTx object.
  * @param type The type of the decoder.
  * @param address The primary address.
@@ -19,90 +43,333 @@
  * @param productId Product ID for RCN-218.
  */
 DecoderStateMachine::DecoderStateMachine(RailcomTx& txManager, DecoderType type, uint16_t address, uint8_t cv28, uint8_t cv29, uint16_t manufacturerId, uint32_t productId)
-    : _txManager(txManager), _type(type), _address(address), _cv28(cv28), _cv29(cv29),
+    : _txManager(txManager), _type(type), _address(address),
       _manufacturerId(manufacturerId), _productId(productId), _logonState(LogonState::IDLE), _accessory_state(0), _channel1_broadcast_enabled(true),
-      _backoff_counter(0), _backoff_value(1), _cv_auto_broadcast_active(false) {
+      _stat_frame_state(0), _pom_cache(),
+      _backoff_strategy(LogonBackoff::RANDOM), _backoff_counter(0), _backoff_value(LOGON_BACKOFF_MIN_WINDOW),
+      _rng_state(seedFromUniqueId(manufacturerId, productId)), _cv_auto_cursor(1), _cv_auto_broadcast_active(false),
+      _cv_auto_rate(CV_AUTO_DEFAULT_RATE), _cv_auto_credit(CV_AUTO_BURST * 1000UL), _cv_auto_last_ms(0), _journal(nullptr), _last_addressed_ms(0),
+      _data_spaces(), _data_space_count(0), _ds_reply_num(0), _ds_reply_start(0) {
+
+    // RailCom configuration lives in the CV store so that POM writes take effect.
+    _cvs.define(28, cv28);
+    _cvs.define(29, cv29);
 
     // Populate the dummy CV list for testing
-    _cvs[1] = 10;
-    _cvs[8] = 155;
-    _cvs[29] = 34;
-    _cv_auto_iterator = _cvs.begin();
+    _cvs.define(1, 10);
+    _cvs.define(8, 155);
 
     // --- RCN-218 Data Space Initialization ---
     // Use Case #7: Displaying Locomotive's Long Name (Data Space 5)
-    _data_spaces[5] = { 'D', 'B', ' ', 'C', 'l', 'a', 's', 's', ' ', '2', '1', '8' };
+    const uint8_t longName[] = { 'D', 'B', ' ', 'C', 'l', 'a', 's', 's', ' ', '2', '1', '8' };
+    setDataSpace(5, longName, sizeof(longName));
 
     // Use Case #8: Automatic Function Icon Mapping (Data Space 4)
     // Format: [F-Num], [Icon-Num], [F-Num], [Icon-Num], ...
-    _data_spaces[4] = { 1, 10, 2, 20 }; // F1=Horn, F2=Bell
+    const uint8_t iconMap[] = { 1, 10, 2, 20 }; // F1=Horn, F2=Bell
+    setDataSpace(4, iconMap, sizeof(iconMap));
 
     // Use Case #21: Displaying Manufacturer Info (Data Space 6)
     // Format: [Manuf. ID High], [Manuf. ID Low], [Article Num ASCII...]
-    _data_spaces[6] = {
+    const uint8_t manufacturerInfo[] = {
         (uint8_t)((_manufacturerId >> 8) & 0xFF),
         (uint8_t)(_manufacturerId & 0xFF),
         '1', '2', '3', '4', '5'
     };
+    setDataSpace(6, manufacturerInfo, sizeof(manufacturerInfo));
 
+    rebuildStatusFrame();
     setupCallbacks();
 }
 
+/**
+ * @brief Returns the decoder's CV store.
+ * @return A reference to the CV store.
+ */
+CvStore& DecoderStateMachine::cvs() {
+    return _cvs;
+}
+
+/**
+ * @brief Attaches a flash journal that persists CV writes.
+ * @param journal The journal, or nullptr to detach.
+ */
+void DecoderStateMachine::attachJournal(CvJournal* journal) {
+    _journal = journal;
+}
+
+/**
+ * @brief Returns the decoder's current address.
+ * @return The primary address.
+ */
+uint16_t DecoderStateMachine::address() const {
+    return _address;
+}
+
+/**
+ * @brief Returns the state of the RCN-218 logon procedure.
+ * @return The current logon state.
+ */
+LogonState DecoderStateMachine::logonState() const {
+    return _logonState;
+}
+
+/**
+ * @brief Selects the backoff strategy of the RCN-218 logon.
+ * @param strategy The backoff strategy.
+ */
+void DecoderStateMachine::setLogonBackoff(LogonBackoff strategy) {
+    _backoff_strategy = strategy;
+    resetBackoff();
+}
+
+/**
+ * @brief Restarts the logon backoff with the smallest delay.
+ */
+void DecoderStateMachine::resetBackoff() {
+    _backoff_counter = 0;
+    _backoff_value = (_backoff_strategy == LogonBackoff::LINEAR) ? 1 : LOGON_BACKOFF_MIN_WINDOW;
+}
+
+/**
+ * @brief Chooses the number of LOGON_ENABLE commands to skip after an announcement.
+ * @details LINEAR skips one command more after every attempt. RANDOM picks a
+ *          number from [0, window) and doubles the window up to
+ *          `LOGON_BACKOFF_MAX_WINDOW`, so that colliding decoders spread out
+ *          quickly and the expected number of collisions stays low even with
+ *          many decoders.
+ * @return The number of commands to skip.
+ */
+uint16_t DecoderStateMachine::nextBackoff() {
+    if (_backoff_strategy == LogonBackoff::LINEAR) {
+        return _backoff_value++;
+    }
+    uint16_t count = nextRandom() % _backoff_value;
+    if (_backoff_value < LOGON_BACKOFF_MAX_WINDOW) {
+        _backoff_value *= 2;
+    }
+    return count;
+}
+
+/**
+ * @brief Returns the next number of the decoder's pseudo-random generator.
+ * @return A 32-bit pseudo-random number.
+ */
+uint32_t DecoderStateMachine::nextRandom() {
+    uint32_t x = _rng_state;
+    x ^= x << 13;
+    x ^= x >> 17;
+    x ^= x << 5;
+    _rng_state = x;
+    return x;
+}
+
+/**
+ * @brief Reads a CV from the store.
+ * @param cv The CV number.
+ * @return The CV value, or 0 if the CV is not defined.
+ */
+uint8_t DecoderStateMachine::cvValue(uint32_t cv) const {
+    uint8_t value = 0;
+    _cvs.read(cv, value);
+    return value;
+}
+
+/**
+ * @brief Stores the contents of a data space in the fixed table.
+ * @details An existing data space with the same number is replaced.
+ * @param num The data space number.
+ * @param data The contents.
+ * @param len The number of bytes.
+ * @return False if the data space is too large or the table is full.
+ */
+bool DecoderStateMachine::setDataSpace(uint8_t num, const uint8_t* data, size_t len) {
+    if (len > MAX_DATA_SPACE_SIZE) return false;
+    DataSpace* entry = const_cast<DataSpace*>(findDataSpace(num));
+    if (entry == nullptr) {
+        if (_data_space_count >= MAX_DATA_SPACES) return false;
+        entry = &_data_spaces[_data_space_count++];
+        entry->num = num;
+    }
+    entry->len = len;
+    memcpy(entry->data, data, len);
+    return true;
+}
+
+/**
+ * @brief Looks up a data space by number.
+ * @param num The data space number.
+ * @return A pointer to the data space, or nullptr if it does not exist.
+ */
+const DecoderStateMachine::DataSpace* DecoderStateMachine::findDataSpace(uint8_t num) const {
+    for (uint8_t i = 0; i < _data_space_count; ++i) {
+        if (_data_spaces[i].num == num) return &_data_spaces[i];
+    }
+    return nullptr;
+}
+
+/**
+ * @brief Pre-encodes the status reply for the current accessory state.
+ * @details Extended accessory decoders report STAT1, all others STAT4.
+ */
+void DecoderStateMachine::rebuildStatusFrame() {
+    RailcomID id = (_type == DecoderType::ACCESSORY_EXTENDED) ? RailcomID::STAT1 : RailcomID::STAT4;
+    RailcomEncoding::encodeFrame(id, _accessory_state, 8, _stat_frame);
+    _stat_frame_state = _accessory_state;
+}
+
+/**
+ * @brief Looks up or builds the pre-encoded POM reply for a CV value.
+ * @param cv The CV number.
+ * @param value The CV value.
+ * @return A pointer to the cached frame.
+ */
+const RailcomFrame* DecoderStateMachine::pomReplyFrame(uint16_t cv, uint8_t value) {
+    PomReplyCacheEntry& entry = _pom_cache[cv & (POM_REPLY_CACHE_SIZE - 1)];
+    if (!entry.valid || entry.cv != cv || entry.value != value) {
+        RailcomEncoding::encodeMessage<RailcomSchema::Pom>(entry.frame, value);
+        entry.cv = cv;
+        entry.value = value;
+        entry.valid = true;
+    }
+    return &entry.frame;
+}
+
 /**
  * @brief Processes an incoming DCC packet.
  * @details First, it checks CV29 to ensure RailCom is enabled. Then, it passes
  *          the message to the internal DCC parser, which triggers the appropriate
  *          callbacks. It also manages the Channel 1 address broadcast, disabling
  *          it once the decoder is directly addressed to reduce network congestion.
+ *          Replies for the common cases (address broadcast, POM, accessory status)
+ *          are pre-encoded and only handed over to the transmitter as pointers.
  * @param msg The DCCMessage to process.
  */
 void DecoderStateMachine::handleDccPacket(const DCCMessage& msg) {
+    RAILCOM_TRACE_PACKET_END();
     // According to NMRA S-9.2.2, CV29, Bit 3 enables/disables RailCom.
     // If RailCom is not enabled, do not process any packets.
-    if ((_cv29 & 0b00001000) == 0) {
+    if ((cvValue(29) & 0b00001000) == 0) {
         return;
     }
 
     bool response_sent = false;
     _dccParser.parse(msg, &response_sent);
-
-    // Also send address as a default response for locomotives
-    const uint8_t* data = msg.getData();
-    size_t len = msg.getLength();
-    bool is_addressed_to_me = (len >= 2 && ((data[0] << 8) | data[1]) == _address);
+    RAILCOM_TRACE(DECISION);
+
+    // The parser fires its callbacks for every address, so a packet for another
+    // decoder does not count as answered here.
+    uint16_t address;
+    size_t instruction;
+    bool is_addressed_to_me = false;
+    bool is_addressed_to_other = false;
+    bool is_channel_bundled = false;
+    if (RailcomDccParser::decodeAddress(msg, address, instruction)) {
+        is_addressed_to_me = address == _address;
+        is_addressed_to_other = !is_addressed_to_me && address != 0;
+        is_channel_bundled = RailcomDccParser::isDataSpaceRead(msg, instruction);
+    } else if (RailcomDccParser::decodeAccessoryAddress(msg, address)) {
+        is_addressed_to_me = _type != DecoderType::LOCOMOTIVE && address == _address;
+        is_addressed_to_other = !is_addressed_to_me;
+    }
 
     if (is_addressed_to_me) {
+        _last_addressed_ms = millis();
         // Once we are addressed directly, we should stop broadcasting on Ch1
         // to reduce channel congestion.
         _channel1_broadcast_enabled = false;
+    } else if (is_addressed_to_other || !response_sent) {
+        // The Channel 2 window after this packet belongs to another decoder.
+        response_sent = false;
+        _txManager.holdChannel2();
     }
 
-    if (!response_sent && _type == DecoderType::LOCOMOTIVE && _channel1_broadcast_enabled) {
+    // Also send address as a default response for locomotives. The reply to
+    // a Data Space read for another decoder fills Channel 1 as well.
+
+    if (!response_sent && !is_channel_bundled && _type == DecoderType::LOCOMOTIVE && _channel1_broadcast_enabled) {
+        // The transmitter keeps the encoded ADR_HIGH/ADR_LOW/INFO1 rotation.
         _txManager.sendAddress(_address);
     }
+    RAILCOM_TRACE(ENCODE_DONE);
 }
 
 /**
  * @brief Handles periodic background tasks.
- * @details This function is responsible for the automatic CV broadcast feature.
- *          When active, it iterates through a map of CVs and sends one
- *          CV_AUTO message per call.
+ * @details This function drives the attached CV journal, holding back sector
+ *          erases until the decoder has not been addressed for
+ *          `JOURNAL_ERASE_QUIET_MS`, and schedules the
+ *          automatic CV broadcast. A CV_AUTO message is only queued when Channel 2
+ *          is free, so replies to addressed commands are never held up, and when
+ *          the rate budget allows it. CVs changed since their last broadcast are
+ *          sent first; otherwise the defined CVs are sent round-robin.
  */
 void DecoderStateMachine::task() {
-    if (!_cv_auto_broadcast_active) {
+    if (_journal != nullptr) {
+        _journal->task(!_txManager.isIdle(), millis() - _last_addressed_ms < JOURNAL_ERASE_QUIET_MS);
+    }
+
+    if (!_cv_auto_broadcast_active || !_txManager.isChannel2Free()) {
+        return;
+    }
+
+    // Pick a changed CV first, else the next defined CV, wrapping around at the end.
+    uint32_t cv;
+    bool changed = _cvs.nextDirty(CvDirtyFlag::BROADCAST, 1, cv);
+    if (!changed && !_cvs.nextDefined(_cv_auto_cursor, cv) && !_cvs.nextDefined(1, cv)) {
         return;
     }
 
-    // If the iterator is at the end, reset it to the beginning.
-    if (_cv_auto_iterator == _cvs.end()) {
-        _cv_auto_iterator = _cvs.begin();
+    if (!takeCvAutoToken()) {
+        return;
     }
 
-    // Send the CV-Auto message for the current CV.
-    _txManager.sendCvAuto(_cv_auto_iterator->first, _cv_auto_iterator->second);
+    // Send the CV-Auto message for the selected CV.
+    _txManager.sendCvAuto(cv, cvValue(cv));
+    _cvs.clearDirty(CvDirtyFlag::BROADCAST, cv);
+
+    // Changed CVs do not disturb the position of the round-robin cycle.
+    if (!changed) {
+        _cv_auto_cursor = cv + 1;
+    }
+}
 
-    // Move to the next CV for the next call.
-    _cv_auto_iterator++;
+/**
+ * @brief Sets the budget of the automatic CV broadcast.
+ * @param messagesPerSecond The broadcast budget, or 0 for no limit.
+ */
+void DecoderStateMachine::setCvAutoRate(uint16_t messagesPerSecond) {
+    _cv_auto_rate = messagesPerSecond;
+}
+
+/**
+ * @brief Refills the CV_AUTO token bucket and takes one token if available.
+ * @details The bucket holds up to `CV_AUTO_BURST` tokens. Working in units of
+ *          1/1000 message keeps the arithmetic in integers.
+ * @return True if a CV_AUTO message may be sent now.
+ */
+bool DecoderStateMachine::takeCvAutoToken() {
+    if (_cv_auto_rate == 0) {
+        return true;
+    }
+
+    const uint32_t capacity = CV_AUTO_BURST * 1000UL;
+    uint32_t now = millis();
+    uint32_t elapsed = now - _cv_auto_last_ms;
+    _cv_auto_last_ms = now;
+    if (elapsed > capacity) {
+        elapsed = capacity; // Enough to fill the bucket at any rate of at least 1/s.
+    }
+    _cv_auto_credit += elapsed * _cv_auto_rate;
+    if (_cv_auto_credit > capacity) {
+        _cv_auto_credit = capacity;
+    }
+
+    if (_cv_auto_credit < 1000) {
+        return false;
+    }
+    _cv_auto_credit -= 1000;
+    return true;
 }
 
 /**
@@ -115,11 +382,14 @@ void DecoderStateMachine::setupCallbacks() {
     /**
      * @brief Callback for RCN-218 Logon Enable command.
      * @details Initiates the logon process and sends the decoder's unique ID.
-     *          Implements a simple collision avoidance backoff mechanism.
-     * @see RCN-218, Chapter 3
+     *          If the previous announcement was not followed by a SELECT, it was
+     *          lost (usually in a collision with another decoder); the decoder
+     *          then stays silent for the number of LOGON_ENABLE commands chosen
+     *          by the backoff strategy before it announces itself again.
+     * @see RCN-218, Chapter 3 and 7.2
      */
     _dccParser.onLogonEnable = [this](uint8_t group, uint16_t zid, uint8_t sessionId) {
-        if (_logonState == LogonState::IDLE) {
+        if (_logonState == LogonState::IDLE || _logonState == LogonState::IN_SINGULATION) {
             _logonState = LogonState::WAITING_FOR_LOGON;
         }
 
@@ -130,9 +400,7 @@ void DecoderStateMachine::setupCallbacks() {
             }
             _txManager.sendDecoderUnique(_manufacturerId, _productId);
             _logonState = LogonState::IN_SINGULATION;
-            // Progressively increase backoff time to avoid collisions
-            _backoff_counter = _backoff_value;
-            _backoff_value++;
+            _backoff_counter = nextBackoff();
         }
     };
 
@@ -154,15 +422,18 @@ void DecoderStateMachine::setupCallbacks() {
     /**
      * @brief Callback for RCN-218 Logon Assign command.
      * @details Finalizes the logon process by accepting the new address and sending the decoder state.
+     *          The command station may assign the address right after the unique ID
+     *          was received, without a SELECT in between. A repeated assignment
+     *          (because the DECODER_STATE reply was lost) is answered again.
      * @see RCN-218, Chapter 3
      */
     _dccParser.onLogonAssign = [this](uint16_t manufacturerId, uint32_t productId, uint16_t address) {
         if (manufacturerId == _manufacturerId && productId == _productId) {
-            if (_logonState == LogonState::ANNOUNCED) {
+            if (_logonState == LogonState::IN_SINGULATION || _logonState == LogonState::ANNOUNCED ||
+                _logonState == LogonState::REGISTERED) {
                 _address = address;
                 _logonState = LogonState::REGISTERED;
-                _backoff_counter = 0;
-                _backoff_value = 1;
+                resetBackoff();
                 _txManager.sendDecoderState(0, 0, 0); // Dummy values
             }
         }
@@ -172,53 +443,58 @@ void DecoderStateMachine::setupCallbacks() {
 
     /**
      * @brief Handles a POM Read CV command.
-     * @details Sends a POM response with the (dummy) value of the requested CV.
+     * @details Sends a POM response with the stored value of the requested CV.
+     *          Undefined CVs are not answered.
      * @see RCN-217, 5.1.1 & 5.2.4
      */
     _dccParser.onPomReadCv = [this](uint16_t cv, uint16_t address) {
         // RCN-217, 5.2.4: Handle decoder registration via programming address 0.
         if (address == 0 && cv == 29) {
             // Only respond if bit 4 of CV28 is set.
-            if ((_cv28 & 0b00010000) != 0) {
+            if ((cvValue(28) & 0b00010000) != 0) {
                 // The response is the content of CV29.
-                _txManager.sendPomResponse(_cv29);
+                _txManager.sendFrame(2, pomReplyFrame(cv, cvValue(29)));
             }
             return; // Explicitly return to avoid processing as a standard POM.
         }
 
         if (address == _address) {
-            uint8_t value = 42; // Dummy value for the requested CV
-            _txManager.sendPomResponse(value);
+            uint8_t value;
+            if (_cvs.read(cv, value)) {
+                _txManager.sendFrame(2, pomReplyFrame(cv, value));
+            }
         }
     };
 
     /**
      * @brief Handles a POM Write CV command.
-     * @details Sends a POM response echoing the value that was written.
+     * @details Stores the value and sends a POM response echoing it.
      * @see RCN-217, 5.1.2
      */
     _dccParser.onPomWriteCv = [this](uint16_t cv, uint8_t value, uint16_t address) {
         if (address == _address) {
-            // Here you would typically write the CV value to memory
-            _txManager.sendPomResponse(value);
+            if (_cvs.write(cv, value)) {
+                _txManager.sendFrame(2, pomReplyFrame(cv, value));
+            }
         }
     };
 
     /**
      * @brief Handles a POM Write Bit command.
-     * @details Sends a POM response with the new, modified value of the CV.
+     * @details Modifies the stored CV and sends a POM response with the new value.
      * @see RCN-217, 5.1.3
      */
     _dccParser.onPomWriteBit = [this](uint16_t cv, uint8_t bit, uint8_t value, uint16_t address) {
         if (address == _address) {
-            // Here you would typically write the CV bit to memory
-            uint8_t currentValue = 42; // Dummy value
+            uint8_t currentValue = cvValue(cv);
             if (value) {
                 currentValue |= (1 << bit);
             } else {
                 currentValue &= ~(1 << bit);
             }
-            _txManager.sendPomResponse(currentValue);
+            if (_cvs.write(cv, currentValue)) {
+                _txManager.sendFrame(2, pomReplyFrame(cv, currentValue));
+            }
         }
     };
 
@@ -236,11 +512,11 @@ void DecoderStateMachine::setupCallbacks() {
                 _accessory_state &= ~(1 << output);
             }
 
-            if (_type == DecoderType::ACCESSORY_EXTENDED) {
-                _txManager.sendStatus1(_accessory_state);
-            } else {
-                _txManager.sendStatus4(_accessory_state);
+            // Repeated accessory packets leave the state unchanged and reuse the frame.
+            if (_accessory_state != _stat_frame_state) {
+                rebuildStatusFrame();
             }
+            _txManager.sendFrame(2, &_stat_frame);
         }
     };
 
@@ -285,9 +561,11 @@ void DecoderStateMachine::setupCallbacks() {
             // See RCN-217 Section 5.7
             else if (command == 0x03) {
                 _cv_auto_broadcast_active = !_cv_auto_broadcast_active;
-                // Reset iterator to the beginning when starting the broadcast
+                // Restart from the first CV with a full budget when starting the broadcast
                 if (_cv_auto_broadcast_active) {
-                    _cv_auto_iterator = _cvs.begin();
+                    _cv_auto_cursor = 1;
+                    _cv_auto_credit = CV_AUTO_BURST * 1000UL;
+                    _cv_auto_last_ms = millis();
                 }
             }
         }
@@ -295,23 +573,26 @@ void DecoderStateMachine::setupCallbacks() {
 
     /**
      * @brief Handles a Data Space Read command.
-     * @details Retrieves the requested data from the internal data space map
-     *          and sends it in a Data Space response message.
+     * @details Sends the data space from the start offset to its end, as blocks
+     *          of `DATA_SPACE_CHUNK_SIZE` bytes in consecutive cutouts. A start
+     *          offset equal to the length is answered with an empty last block.
+     *          Command stations repeat packets, so the same read while its reply
+     *          is still being sent continues that reply; any other read replaces
+     *          it.
      * @see RCN-218, 4.3
      */
     _dccParser.onDataSpaceRead = [this](uint16_t address, uint8_t dataSpaceNum, uint8_t startAddr) {
         if (address == _address) {
-            // Check if the requested data space exists in our map.
-            if (_data_spaces.count(dataSpaceNum)) {
-                const auto& full_data = _data_spaces.at(dataSpaceNum);
-
-                // Ensure the start address is within the bounds of the data.
-                if (startAddr < full_data.size()) {
-                    // Create a sub-vector starting from the startAddr.
-                    // The spec implies the central knows the max length, so we send the rest.
-                    std::vector<uint8_t> partial_data(full_data.begin() + startAddr, full_data.end());
-                    _txManager.sendDataSpace(partial_data.data(), partial_data.size(), dataSpaceNum);
-                }
+            if (_txManager.isSendingDataSpace()) {
+                if (dataSpaceNum == _ds_reply_num && startAddr == _ds_reply_start) return;
+                _txManager.cancelDataSpace();
+            }
+            const DataSpace* dataSpace = findDataSpace(dataSpaceNum);
+            // Ensure the start address is within the bounds of the data.
+            if (dataSpace != nullptr && startAddr <= dataSpace->len) {
+                _txManager.sendDataSpace(dataSpace->data + startAddr, dataSpace->len - startAddr, dataSpaceNum);
+                _ds_reply_num = dataSpaceNum;
+                _ds_reply_start = startAddr;
             }
         }
     };
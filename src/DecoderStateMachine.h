@@ -15,9 +15,8 @@
 #include "RailcomRx.h"
 
 #include "RailcomDccParser.h"
-#include <map>
-#include <vector>
-#include <iterator>
+#include "CvStore.h"
+#include "CvJournal.h"
 
 /**
  * @enum DecoderType
@@ -43,6 +42,35 @@ enum class LogonState {
     REGISTERED          ///< The command station has assigned a slot to the decoder.
 };
 
+/**
+ * @enum LogonBackoff
+ * @brief Strategies for choosing how many LOGON_ENABLE commands a decoder skips
+ *        after an announcement that was not answered.
+ * @see RCN-218, 7.2
+ */
+enum class LogonBackoff : uint8_t {
+    LINEAR, ///< Skip 1, 2, 3, ... commands. Decoders that collided once stay in lockstep.
+    RANDOM  ///< Skip a random number of commands from a window that doubles after every failure.
+};
+
+/** @brief Initial backoff window of the RANDOM strategy, in LOGON_ENABLE commands. */
+constexpr uint16_t LOGON_BACKOFF_MIN_WINDOW = 8;
+/** @brief Largest backoff window of the RANDOM strategy, in LOGON_ENABLE commands. */
+constexpr uint16_t LOGON_BACKOFF_MAX_WINDOW = 128;
+
+/** @brief Number of entries in the pre-encoded POM reply cache (must be a power of two). */
+constexpr uint8_t POM_REPLY_CACHE_SIZE = 4;
+/** @brief Default CV_AUTO broadcast budget in messages per second. */
+constexpr uint16_t CV_AUTO_DEFAULT_RATE = 10;
+/** @brief Number of CV_AUTO messages that may be sent back to back after an idle period. */
+constexpr uint8_t CV_AUTO_BURST = 2;
+/** @brief Time in milliseconds without a packet for the decoder before the CV journal may erase a sector. */
+constexpr uint32_t JOURNAL_ERASE_QUIET_MS = 250;
+/** @brief Maximum number of RCN-218 data spaces held by a decoder. */
+constexpr uint8_t MAX_DATA_SPACES = 4;
+/** @brief Maximum size in bytes of a single data space, the most a Data Space reply can carry. */
+constexpr uint16_t MAX_DATA_SPACE_SIZE = DATA_SPACE_MAX_SIZE;
+
 /**
  * @class DecoderStateMachine
  * @brief Encapsulates the complete logic for a RailCom-enabled decoder.
@@ -79,21 +107,133 @@ public:
      * @brief Periodic task function.
      * @details This should be called periodically in the main application loop
      *          to handle ongoing background tasks, such as broadcasting the
-     *          next CV in the automatic CV broadcast cycle.
+     *          next CV in the automatic CV broadcast cycle. The broadcast rate
+     *          is limited by `setCvAutoRate` and not by how often this is called.
      */
     void task();
 
+    /**
+     * @brief Sets the budget of the automatic CV broadcast.
+     * @details CV_AUTO messages are only queued while Channel 2 has nothing else
+     *          to send, and at most `messagesPerSecond` on average, with bursts of
+     *          up to `CV_AUTO_BURST` messages.
+     * @param messagesPerSecond The broadcast budget, or 0 for no limit.
+     * @see RCN-217, 5.7
+     */
+    void setCvAutoRate(uint16_t messagesPerSecond);
+
+    /**
+     * @brief Gives access to the decoder's CV storage.
+     * @details Applications can use this to load factory defaults or to read
+     *          values written through POM.
+     * @return A reference to the CV store.
+     */
+    CvStore& cvs();
+
+    /**
+     * @brief Attaches a flash journal that persists CV writes.
+     * @details The journal is driven from `task()`. Flash writes are deferred
+     *          while a RailCom reply is waiting for the next cutout. A sector
+     *          erase, which stops both cores for about 50 ms, waits until no
+     *          packet has been addressed to the decoder for
+     *          `JOURNAL_ERASE_QUIET_MS`; packets and cutouts during the erase are
+     *          missed. `begin()` must be called on the journal by the application.
+     * @param journal The journal, or nullptr to detach.
+     */
+    void attachJournal(CvJournal* journal);
+
+    /**
+     * @brief Returns the decoder's current address.
+     * @details This changes when the command station assigns an address with
+     *          LOGON_ASSIGN.
+     * @return The primary address.
+     */
+    uint16_t address() const;
+
+    /**
+     * @brief Returns the state of the RCN-218 logon procedure.
+     * @return The current logon state.
+     */
+    LogonState logonState() const;
+
+    /**
+     * @brief Selects the backoff strategy of the RCN-218 logon.
+     * @details The default is `LogonBackoff::RANDOM`. The random numbers come from
+     *          a generator seeded with the decoder's unique ID, so decoders that
+     *          were powered up at the same time still choose different delays.
+     * @param strategy The backoff strategy.
+     * @see RCN-218, 7.2
+     */
+    void setLogonBackoff(LogonBackoff strategy);
+
+    /**
+     * @brief Stores the contents of a data space.
+     * @details A Data Space Read is answered with the bytes from its start
+     *          offset to the end, in blocks of `DATA_SPACE_CHUNK_SIZE` bytes
+     *          (see `DataSpaceReader`).
+     * @param num The data space number.
+     * @param data The contents.
+     * @param len The number of bytes, at most `MAX_DATA_SPACE_SIZE`.
+     * @return False if the data space is too large or the table is full;
+     *         nothing is stored then.
+     */
+    bool setDataSpace(uint8_t num, const uint8_t* data, size_t len);
+
 private:
     /**
      * @brief Sets up the callbacks for the internal RailcomDccParser.
      */
     void setupCallbacks();
 
+    /**
+     * @brief Pre-encodes the STAT1/STAT4 reply for the current accessory state.
+     */
+    void rebuildStatusFrame();
+
+    /**
+     * @brief Returns a pre-encoded POM reply for a CV value.
+     * @details Repeated POM commands for the same CV (command stations repeat
+     *          them until answered) are served from a small direct-mapped cache.
+     *          The returned frame stays valid until the same cache line is reused.
+     * @param cv The CV number the reply belongs to.
+     * @param value The CV value to report.
+     * @return A pointer to the cached frame.
+     */
+    const RailcomFrame* pomReplyFrame(uint16_t cv, uint8_t value);
+
+    /**
+     * @brief Reads a CV, returning 0 if it is not defined.
+     * @param cv The CV number.
+     * @return The CV value.
+     */
+    uint8_t cvValue(uint32_t cv) const;
+
+    /**
+     * @brief Refills the CV_AUTO token bucket and takes one token if available.
+     * @return True if a CV_AUTO message may be sent now.
+     */
+    bool takeCvAutoToken();
+
+    /**
+     * @brief Restarts the logon backoff with the smallest delay.
+     */
+    void resetBackoff();
+
+    /**
+     * @brief Chooses the number of LOGON_ENABLE commands to skip after an announcement.
+     * @return The number of commands to skip if the announcement is not answered.
+     */
+    uint16_t nextBackoff();
+
+    /**
+     * @brief Returns the next number of the decoder's pseudo-random generator.
+     * @return A 32-bit pseudo-random number (xorshift32).
+     */
+    uint32_t nextRandom();
+
     RailcomTx& _txManager;      ///< Reference to the transmitter.
     DecoderType _type;          ///< The type of this decoder.
     uint16_t _address;          ///< The primary address.
-    uint8_t _cv28;              ///< CV28 value.
-    uint8_t _cv29;              ///< CV29 value.
     uint16_t _manufacturerId;   ///< Manufacturer ID for RCN-218.
     uint32_t _productId;        ///< Product ID for RCN-218.
 
@@ -104,17 +244,59 @@ private:
     uint8_t _accessory_state;           ///< The current state of the accessory decoder's outputs.
     bool _channel1_broadcast_enabled;   ///< Flag to control the address broadcast on Channel 1.
 
+    // --- Pre-computed Replies ---
+    /**
+     * @struct PomReplyCacheEntry
+     * @brief A pre-encoded POM reply for one CV value.
+     */
+    struct PomReplyCacheEntry {
+        bool valid;         ///< True if the entry holds a frame.
+        uint16_t cv;        ///< The CV number of the cached reply.
+        uint8_t value;      ///< The value encoded in the frame.
+        RailcomFrame frame; ///< The encoded POM reply.
+    };
+    RailcomFrame _stat_frame;                            ///< Pre-encoded STAT1/STAT4 reply for `_stat_frame_state`.
+    uint8_t _stat_frame_state;                           ///< The accessory state encoded in `_stat_frame`.
+    PomReplyCacheEntry _pom_cache[POM_REPLY_CACHE_SIZE]; ///< Cache of pre-encoded POM replies.
+
     // --- RCN-218 Backoff State ---
-    uint8_t _backoff_counter;   ///< The counter for the backoff algorithm.
-    uint8_t _backoff_value;     ///< The current value to count down from in the backoff algorithm.
+    LogonBackoff _backoff_strategy; ///< The backoff strategy.
+    uint16_t _backoff_counter;      ///< LOGON_ENABLE commands still to be skipped.
+    uint16_t _backoff_value;        ///< Next delay (LINEAR) or current window size (RANDOM).
+    uint32_t _rng_state;            ///< State of the pseudo-random generator, seeded from the unique ID.
 
-    // --- CV-Auto Broadcast State ---
-    std::map<uint32_t, uint8_t> _cvs;                                ///< Map to store CVs for the automatic broadcast.
-    std::map<uint32_t, uint8_t>::iterator _cv_auto_iterator;         ///< Iterator to track the next CV to send.
-    bool _cv_auto_broadcast_active;                                 ///< Flag indicating if the broadcast is active.
+    // --- CV Storage and CV-Auto Broadcast State ---
+    CvStore _cvs;                   ///< The decoder's CVs, including CV28 and CV29.
+    uint32_t _cv_auto_cursor;       ///< The CV number at which the next broadcast search starts.
+    bool _cv_auto_broadcast_active; ///< Flag indicating if the broadcast is active.
+    uint16_t _cv_auto_rate;         ///< Broadcast budget in messages per second (0 = unlimited).
+    uint32_t _cv_auto_credit;       ///< Token bucket; one message costs 1000 units, `_cv_auto_rate` units accrue per ms.
+    uint32_t _cv_auto_last_ms;      ///< Time (millis) at which the token bucket was last refilled.
+    CvJournal* _journal;            ///< Optional flash journal for CV persistence.
+    uint32_t _last_addressed_ms;    ///< Time (millis) of the last packet addressed to the decoder.
 
     // --- RCN-218 Data Space Storage ---
-    std::map<uint8_t, std::vector<uint8_t>> _data_spaces; ///< Map to store data for various data spaces.
+    /**
+     * @struct DataSpace
+     * @brief The contents of one RCN-218 data space.
+     */
+    struct DataSpace {
+        uint8_t num;                       ///< The data space number.
+        uint16_t len;                      ///< The number of valid bytes in `data`.
+        uint8_t data[MAX_DATA_SPACE_SIZE]; ///< The data space contents.
+    };
+
+    /**
+     * @brief Looks up a data space by number.
+     * @param num The data space number.
+     * @return A pointer to the data space, or nullptr if it does not exist.
+     */
+    const DataSpace* findDataSpace(uint8_t num) const;
+
+    DataSpace _data_spaces[MAX_DATA_SPACES]; ///< Fixed table of data spaces.
+    uint8_t _data_space_count;               ///< Number of entries in use in `_data_spaces`.
+    uint8_t _ds_reply_num;                   ///< Data space of the reply being sent.
+    uint8_t _ds_reply_start;                 ///< Start offset of the reply being sent.
 };
 
 #endif // DECODER_STATE_MACHINE_H
@@ -0,0 +1,152 @@
+/**
+ * @file DynPublisher.cpp
+ * @brief Implementation of the DynPublisher class.
+ */
+#include "DynPublisher.h"
+#include <cstring>
+
+/**
+ * @brief Constructs a DynPublisher without sources.
+ * @param tx The transmitter the messages are queued on.
+ */
+DynPublisher::DynPublisher(RailcomTx& tx) : _tx(tx), _registered(0), _sent(0) {
+    memset(_sources, 0, sizeof(_sources));
+}
+
+/**
+ * @brief Registers a source or changes its settings.
+ * @details The value and send history of a registered source are kept.
+ * @param subIndex The DYN sub-index.
+ * @param minIntervalMs The shortest time between two messages.
+ * @param maxIntervalMs The refresh interval, or 0.
+ * @param deadband The change that makes a value due early.
+ * @param priority The rank of the source.
+ * @return False if the sub-index is out of range.
+ */
+bool DynPublisher::add(uint8_t subIndex, uint16_t minIntervalMs, uint16_t maxIntervalMs,
+                       uint8_t deadband, RailcomPriority priority) {
+    if (subIndex >= DYN_PUBLISHER_SOURCES) return false;
+    uint64_t bit = 1ULL << subIndex;
+    Source& source = _sources[subIndex];
+    if (!(_registered & bit)) {
+        memset(&source, 0, sizeof(source));
+        _registered |= bit;
+    }
+    source.min_interval_ms = minIntervalMs;
+    source.max_interval_ms = maxIntervalMs;
+    source.deadband = deadband;
+    source.priority = priority;
+    return true;
+}
+
+/**
+ * @brief Unregisters a source.
+ * @param subIndex The DYN sub-index.
+ */
+void DynPublisher::remove(uint8_t subIndex) {
+    if (subIndex >= DYN_PUBLISHER_SOURCES) return;
+    _registered &= ~(1ULL << subIndex);
+}
+
+/**
+ * @brief Reports the current value of a source.
+ * @details Values of unregistered sub-indices are ignored.
+ * @param subIndex The DYN sub-index.
+ * @param value The current value.
+ */
+void DynPublisher::update(uint8_t subIndex, uint8_t value) {
+    if (subIndex >= DYN_PUBLISHER_SOURCES || !(_registered & (1ULL << subIndex))) return;
+    _sources[subIndex].value = value;
+    _sources[subIndex].has_value = true;
+}
+
+/**
+ * @brief Checks whether a source is due.
+ * @param source The source.
+ * @param now_ms The current time.
+ * @param[out] changed True if the value is due because it changed.
+ * @return True if a message should be sent.
+ */
+bool DynPublisher::isDue(const Source& source, uint32_t now_ms, bool& changed) {
+    changed = false;
+    if (!source.has_value) return false;
+    if (!source.sent) {
+        changed = true;
+        return true;
+    }
+    uint32_t age = now_ms - source.sent_ms;
+    if (age < source.min_interval_ms) return false;
+    int delta = (int)source.value - (int)source.sent_value;
+    if ((delta < 0 ? -delta : delta) > source.deadband) {
+        changed = true;
+        return true;
+    }
+    return source.max_interval_ms != 0 && age >= source.max_interval_ms;
+}
+
+/**
+ * @brief Queues the DYN messages that are due.
+ * @details Each message is chosen by a pass over the registered sources; the
+ *          best one is the highest priority, then a changed value, then the
+ *          largest age. Nothing is queued while Channel 2 carries a reply or
+ *          other pending message.
+ * @param now_ms The current time.
+ * @return The number of messages queued.
+ */
+uint8_t DynPublisher::task(uint32_t now_ms) {
+    if (_registered == 0 || !_tx.isChannel2Free()) return 0;
+
+    uint64_t taken = 0;
+    uint8_t queued = 0;
+    while (queued < DYN_PUBLISHER_PER_CUTOUT) {
+        int best = -1;
+        bool best_changed = false;
+        uint32_t best_age = 0;
+        for (uint8_t i = 0; i < DYN_PUBLISHER_SOURCES; ++i) {
+            uint64_t bit = 1ULL << i;
+            if (!(_registered & bit) || (taken & bit)) continue;
+            const Source& source = _sources[i];
+            bool changed;
+            if (!isDue(source, now_ms, changed)) continue;
+            uint32_t age = source.sent ? now_ms - source.sent_ms : UINT32_MAX;
+            if (best >= 0) {
+                const Source& other = _sources[best];
+                if (source.priority != other.priority) {
+                    if (source.priority < other.priority) continue;
+                } else if (changed != best_changed) {
+                    if (!changed) continue;
+                } else if (age <= best_age) {
+                    continue;
+                }
+            }
+            best = i;
+            best_changed = changed;
+            best_age = age;
+        }
+        if (best < 0) break;
+
+        Source& source = _sources[best];
+        _tx.sendDynamicData(best, source.value);
+        source.sent_value = source.value;
+        source.sent_ms = now_ms;
+        source.sent = true;
+        taken |= 1ULL << best;
+        queued++;
+    }
+    _sent += queued;
+    return queued;
+}
+
+/**
+ * @brief Returns the number of registered sources.
+ */
+uint8_t DynPublisher::sourceCount() const {
+    return __builtin_popcountll(_registered);
+}
+
+/**
+ * @brief Returns the number of DYN messages queued so far.
+ */
+uint32_t DynPublisher::sentCount() const {
+    return _sent;
+}
@@ -0,0 +1,129 @@
+/**
+ * @file DynPublisher.h
+ * @brief Periodic publication of dynamic variables (DYN) on Channel 2.
+ * @details A vehicle decoder reports many measured values with DYN messages,
+ *          e.g. speed, fuel level, temperature or signal quality, and each of
+ *          them changes at its own rate. The DynPublisher keeps the current
+ *          value of every registered sub-index and decides which ones are
+ *          worth a message in the next cutout.
+ */
+#ifndef DYN_PUBLISHER_H
+#define DYN_PUBLISHER_H
+
+#include "RailcomTx.h"
+
+/** @brief Number of DYN sub-indices (6 bits), and so of sources the publisher can hold. */
+constexpr uint8_t DYN_PUBLISHER_SOURCES = 64;
+/** @brief Number of DYN messages (3 bytes each) that fill one Channel 2 window. */
+constexpr uint8_t DYN_PUBLISHER_PER_CUTOUT = RAILCOM_CH2_BYTES / 3;
+
+/**
+ * @class DynPublisher
+ * @brief Schedules the DYN messages of up to 64 sources into free Channel 2 capacity.
+ * @details The application registers a source per sub-index and reports new
+ *          values with `update()`. `task()` queues DYN messages only when
+ *          Channel 2 has nothing else to send, so replies to addressed commands
+ *          are never held up, and then fills the window with the sources that
+ *          are due:
+ *          - A value that moved by more than the source's deadband since it was
+ *            last sent is due once its minimum interval has passed.
+ *          - Any value is due again after its maximum interval, as a refresh.
+ *          Among the due sources, higher priority goes first, then changed
+ *          values before refreshes, then the one sent longest ago. Values that
+ *          change faster than cutouts come are coalesced by `RailcomTx`, so
+ *          only the latest is sent.
+ *
+ *          All methods must be called from the core that drives the `RailcomTx`.
+ * @see RCN-217, 5.2.8
+ */
+class DynPublisher {
+public:
+    /**
+     * @brief Constructs a DynPublisher without sources.
+     * @param tx The transmitter the messages are queued on.
+     */
+    explicit DynPublisher(RailcomTx& tx);
+
+    /**
+     * @brief Registers a source, or changes the settings of a registered one.
+     * @param subIndex The DYN sub-index (0-63).
+     * @param minIntervalMs The shortest time between two messages of the source.
+     * @param maxIntervalMs The time after which an unchanged value is sent
+     *        again, or 0 to send it only when it changes.
+     * @param deadband The change a value must exceed to be sent before
+     *        `maxIntervalMs` (0 = any change).
+     * @param priority The rank of the source against the other sources.
+     * @return False if the sub-index is out of range.
+     */
+    bool add(uint8_t subIndex, uint16_t minIntervalMs, uint16_t maxIntervalMs,
+             uint8_t deadband = 0, RailcomPriority priority = RailcomPriority::NORMAL);
+
+    /**
+     * @brief Unregisters a source.
+     * @param subIndex The DYN sub-index.
+     */
+    void remove(uint8_t subIndex);
+
+    /**
+     * @brief Reports the current value of a source.
+     * @details Nothing is sent for a source before its first value.
+     * @param subIndex The DYN sub-index.
+     * @param value The current value.
+     */
+    void update(uint8_t subIndex, uint8_t value);
+
+    /**
+     * @brief Queues the DYN messages that are due, if Channel 2 is free.
+     * @details Call it between cutouts, e.g. from `loop1()` after
+     *          `DecoderRuntime::task()`. At most `DYN_PUBLISHER_PER_CUTOUT`
+     *          messages are queued per call.
+     * @param now_ms The current time (`millis()`).
+     * @return The number of messages queued.
+     */
+    uint8_t task(uint32_t now_ms);
+
+    /**
+     * @brief Returns the number of registered sources.
+     * @return The source count.
+     */
+    uint8_t sourceCount() const;
+
+    /**
+     * @brief Returns the number of DYN messages queued so far.
+     * @return The message count.
+     */
+    uint32_t sentCount() const;
+
+private:
+    /**
+     * @struct Source
+     * @brief The settings and state of one sub-index.
+     */
+    struct Source {
+        uint16_t min_interval_ms; ///< Shortest time between two messages.
+        uint16_t max_interval_ms; ///< Refresh interval, or 0 for none.
+        uint32_t sent_ms;         ///< Time (millis) of the last message.
+        uint8_t deadband;         ///< Change that makes a value due early.
+        RailcomPriority priority; ///< Rank among the sources.
+        uint8_t value;            ///< The current value.
+        uint8_t sent_value;       ///< The value of the last message.
+        bool has_value;           ///< True once `update()` was called.
+        bool sent;                ///< True once a message was queued.
+    };
+
+    /**
+     * @brief Checks whether a source is due.
+     * @param source The source.
+     * @param now_ms The current time.
+     * @param[out] changed True if the value is due because it changed.
+     * @return True if a message should be sent for the source.
+     */
+    static bool isDue(const Source& source, uint32_t now_ms, bool& changed);
+
+    RailcomTx& _tx;                          ///< The transmitter.
+    Source _sources[DYN_PUBLISHER_SOURCES];  ///< One entry per sub-index.
+    uint64_t _registered;                    ///< Bitmap of the registered sub-indices.
+    uint32_t _sent;                          ///< Messages queued so far.
+};
+
+#endif // DYN_PUBLISHER_H
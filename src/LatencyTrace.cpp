@@ -0,0 +1,100 @@
+/**
+ * @file LatencyTrace.cpp
+ * @brief Implementation of the LatencyTrace class.
+ */
+#include "LatencyTrace.h"
+#include <cstring>
+
+/** @brief Printable names of the stages, indexed by `LatencyStage`. */
+static const char* const STAGE_NAMES[] = { "DECISION", "ENCODE_DONE", "CH1_START", "CH2_START" };
+
+/** @brief Bitmap with one bit per stage. */
+static const uint8_t ALL_STAGES = (1 << static_cast<uint8_t>(LatencyStage::COUNT)) - 1;
+
+/**
+ * @brief Constructs an empty trace.
+ */
+LatencyTrace::LatencyTrace() : _packet_end_us(0), _pending(0) {
+    reset();
+}
+
+/**
+ * @brief Returns the trace the library's instrumentation writes to.
+ * @details Only referenced by the trace macros, so it takes no RAM unless
+ *          `RAILCOM_LATENCY_TRACE` is set or the application uses it.
+ */
+LatencyTrace& LatencyTrace::global() {
+    static LatencyTrace trace;
+    return trace;
+}
+
+/**
+ * @brief Starts a trace cycle.
+ * @param now_us The time the DCC packet ended.
+ */
+void LatencyTrace::packetEnd(uint32_t now_us) {
+    _packet_end_us = now_us;
+    _pending = ALL_STAGES;
+}
+
+/**
+ * @brief Records a stage of the current cycle, unless it was recorded already.
+ * @param stage The stage.
+ * @param now_us The time the stage was reached.
+ */
+void LatencyTrace::mark(LatencyStage stage, uint32_t now_us) {
+    uint8_t bit = 1 << static_cast<uint8_t>(stage);
+    if (!(_pending & bit)) return;
+    _pending &= ~bit;
+    record(stage, now_us - _packet_end_us);
+}
+
+/**
+ * @brief Adds a sample to a histogram.
+ * @param stage The stage.
+ * @param latency_us The time since the end of the packet.
+ */
+void LatencyTrace::record(LatencyStage stage, uint32_t latency_us) {
+    LatencyHistogram& h = _histograms[static_cast<uint8_t>(stage)];
+    uint32_t bucket = latency_us / LATENCY_BUCKET_US;
+    h.buckets[bucket < LATENCY_BUCKETS ? bucket : LATENCY_BUCKETS - 1]++;
+    if (h.count == 0 || latency_us < h.min_us) h.min_us = latency_us;
+    if (latency_us > h.max_us) h.max_us = latency_us;
+    h.sum_us += latency_us;
+    h.count++;
+}
+
+/**
+ * @brief Returns the histogram of a stage.
+ * @param stage The stage.
+ */
+const LatencyHistogram& LatencyTrace::histogram(LatencyStage stage) const {
+    return _histograms[static_cast<uint8_t>(stage)];
+}
+
+/**
+ * @brief Clears all histograms and ends the current cycle.
+ */
+void LatencyTrace::reset() {
+    memset(_histograms, 0, sizeof(_histograms));
+    _pending = 0;
+}
+
+/**
+ * @brief Prints one line per stage.
+ * @param stream The output.
+ */
+void LatencyTrace::dump(Print& stream) const {
+    for (uint8_t s = 0; s < static_cast<uint8_t>(LatencyStage::COUNT); ++s) {
+        const LatencyHistogram& h = _histograms[s];
+        stream.printf("%s n=%lu min=%lu avg=%lu max=%lu |", STAGE_NAMES[s],
+                      (unsigned long)h.count, (unsigned long)h.min_us,
+                      (unsigned long)(h.count ? h.sum_us / h.count : 0), (unsigned long)h.max_us);
+        for (uint8_t b = 0; b < LATENCY_BUCKETS; ++b) {
+            if (h.buckets[b] != 0) {
+                stream.printf(" %u:%lu", b, (unsigned long)h.buckets[b]);
+            }
+        }
+        stream.println();
+    }
+}
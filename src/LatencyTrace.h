@@ -0,0 +1,133 @@
+/**
+ * @file LatencyTrace.h
+ * @brief Optional timing instrumentation of the path from a DCC packet to its RailCom reply.
+ * @details RCN-217 gives a decoder a fixed window after the end of a DCC packet:
+ *          Channel 1 has to start within the cutout, Channel 2 at 193 us. With
+ *          `RAILCOM_LATENCY_TRACE` set to 1, `DecoderStateMachine` and `RailcomTx`
+ *          time-stamp each stage of a reply with the microsecond timer and add
+ *          the time since the end of the packet to a fixed-bucket histogram in
+ *          RAM. Without it (the default), the trace macros expand to nothing
+ *          and the hot path is unchanged.
+ *
+ *          The flag has to be the same for the whole library, e.g.
+ *          `-DRAILCOM_LATENCY_TRACE=1` in the build flags.
+ */
+#ifndef LATENCY_TRACE_H
+#define LATENCY_TRACE_H
+
+#include <Arduino.h>
+#include <cstdint>
+#include "pico/time.h"
+
+#ifndef RAILCOM_LATENCY_TRACE
+/** @brief Set to 1 to compile the latency instrumentation into the library. */
+#define RAILCOM_LATENCY_TRACE 0
+#endif
+
+/** @brief Width of a histogram bucket in microseconds. */
+constexpr uint32_t LATENCY_BUCKET_US = 16;
+/** @brief Number of histogram buckets; the last one collects everything from `(LATENCY_BUCKETS - 1) * LATENCY_BUCKET_US` on. */
+constexpr uint8_t LATENCY_BUCKETS = 32;
+
+/**
+ * @enum LatencyStage
+ * @brief The stages of a reply, each measured from the end of the DCC packet.
+ */
+enum class LatencyStage : uint8_t {
+    DECISION,    ///< The packet has been parsed; replies to it are queued.
+    ENCODE_DONE, ///< Everything for the cutout is queued, including the Channel 1 broadcast.
+    CH1_START,   ///< Channel 1 is handed to the transmitter HAL.
+    CH2_START,   ///< Channel 2 starts (as scheduled with the HAL).
+    COUNT        ///< Number of stages.
+};
+
+/**
+ * @struct LatencyHistogram
+ * @brief The distribution of one stage's latency.
+ */
+struct LatencyHistogram {
+    uint32_t buckets[LATENCY_BUCKETS]; ///< Samples per `LATENCY_BUCKET_US` interval.
+    uint32_t count;                    ///< Number of samples.
+    uint32_t min_us;                   ///< Smallest sample.
+    uint32_t max_us;                   ///< Largest sample.
+    uint64_t sum_us;                   ///< Sum of all samples, for the mean.
+};
+
+/**
+ * @class LatencyTrace
+ * @brief Collects the latency histograms of all reply stages.
+ * @details A trace cycle starts with `packetEnd()`; every stage is then recorded
+ *          at most once until the next packet. Cutouts without a preceding
+ *          packet are not counted. The trace is meant to be used from the core
+ *          that handles DCC; it takes no locks.
+ */
+class LatencyTrace {
+public:
+    LatencyTrace();
+
+    /**
+     * @brief Returns the trace the library's instrumentation writes to.
+     * @return The global trace.
+     */
+    static LatencyTrace& global();
+
+    /**
+     * @brief Starts a trace cycle.
+     * @param now_us The time the DCC packet ended (`time_us_32()`).
+     */
+    void packetEnd(uint32_t now_us);
+
+    /**
+     * @brief Records a stage of the current cycle.
+     * @param stage The stage.
+     * @param now_us The time the stage was reached (`time_us_32()`).
+     */
+    void mark(LatencyStage stage, uint32_t now_us);
+
+    /**
+     * @brief Adds a sample to a histogram directly.
+     * @param stage The stage.
+     * @param latency_us The time since the end of the packet.
+     */
+    void record(LatencyStage stage, uint32_t latency_us);
+
+    /**
+     * @brief Returns the histogram of a stage.
+     * @param stage The stage.
+     * @return The histogram.
+     */
+    const LatencyHistogram& histogram(LatencyStage stage) const;
+
+    /**
+     * @brief Clears all histograms.
+     */
+    void reset();
+
+    /**
+     * @brief Prints one line per stage: count, min, mean, max and the non-empty buckets.
+     * @details Format: `CH1_START n=812 min=41 avg=47 max=133 | 2:790 3:20 8:2`,
+     *          where `b:c` means `c` samples from `b * LATENCY_BUCKET_US` us on.
+     * @param stream The output, e.g. `Serial`.
+     */
+    void dump(Print& stream) const;
+
+private:
+    LatencyHistogram _histograms[static_cast<uint8_t>(LatencyStage::COUNT)]; ///< One per stage.
+    uint32_t _packet_end_us; ///< Start of the current cycle.
+    uint8_t _pending;        ///< Bitmap of the stages still open in the current cycle.
+};
+
+#if RAILCOM_LATENCY_TRACE
+/** @brief Starts a trace cycle at the current time. */
+#define RAILCOM_TRACE_PACKET_END() LatencyTrace::global().packetEnd(time_us_32())
+/** @brief Records a stage at the current time. */
+#define RAILCOM_TRACE(stage) LatencyTrace::global().mark(LatencyStage::stage, time_us_32())
+/** @brief Records a stage that is reached `delay_us` from now. */
+#define RAILCOM_TRACE_DELAYED(stage, delay_us) LatencyTrace::global().mark(LatencyStage::stage, time_us_32() + (delay_us))
+#else
+#define RAILCOM_TRACE_PACKET_END() ((void)0)
+#define RAILCOM_TRACE(stage) ((void)0)
+#define RAILCOM_TRACE_DELAYED(stage, delay_us) ((void)0)
+#endif
+
+#endif // LATENCY_TRACE_H
@@ -0,0 +1,204 @@
+/**
+ * @file LogonManager.cpp
+ * @brief Implementation of the LogonManager class.
+ */
+#include "LogonManager.h"
+#include <cstring>
+
+/**
+ * @brief Hashes a unique ID to a table index.
+ * @details Product IDs are often serial numbers that differ only in the low
+ *          bits, so the bits are mixed before the index is taken.
+ */
+static uint16_t hashUniqueId(uint16_t manufacturerId, uint32_t productId) {
+    uint32_t h = productId ^ ((uint32_t)manufacturerId << 20);
+    h ^= h >> 16;
+    h *= 0x7FEB352DUL;
+    h ^= h >> 15;
+    h *= 0x846CA68BUL;
+    h ^= h >> 16;
+    return h & (LOGON_TABLE_SIZE - 1);
+}
+
+/**
+ * @brief Constructs a LogonManager.
+ * @param rx The receiver that reads the replies of the decoders.
+ * @param zid The ID of the command station.
+ * @param sessionId The ID of the current operating session.
+ * @param firstAddress The first address handed out to a new decoder.
+ */
+LogonManager::LogonManager(RailcomRx& rx, uint16_t zid, uint8_t sessionId, uint16_t firstAddress)
+    : _rx(rx), _zid(zid), _session_id(sessionId), _next_address(firstAddress),
+      _expect(Expect::NOTHING), _assign_pending(false), _assign_attempts(0),
+      _candidate_mfr(0), _candidate_pid(0), _candidate_address(0),
+      _count(0), _collisions(0) {
+    memset(_table, 0, sizeof(_table));
+}
+
+/**
+ * @brief Builds the next logon packet, if there is one.
+ * @param[out] packet The packet to send.
+ * @param discovery True if the slot may be used to look for new decoders.
+ * @return True if `packet` should be sent.
+ */
+bool LogonManager::nextPacket(DCCMessage& packet, bool discovery) {
+    uint8_t data[11];
+    size_t len = 0;
+
+    if (_assign_pending) {
+        // LOGON_ASSIGN: 1110-HHHH HHHH-HHHH UUUU-UUUU x4 AAAA-AAAA AAAA-AAAA (RCN-218, 3.4)
+        data[len++] = RCN218::DCC_A_ADDRESS;
+        data[len++] = RCN218::CMD_LOGON_ASSIGN | ((_candidate_mfr >> 8) & 0x0F);
+        data[len++] = _candidate_mfr & 0xFF;
+        data[len++] = (_candidate_pid >> 24) & 0xFF;
+        data[len++] = (_candidate_pid >> 16) & 0xFF;
+        data[len++] = (_candidate_pid >> 8) & 0xFF;
+        data[len++] = _candidate_pid & 0xFF;
+        data[len++] = (_candidate_address >> 8) & 0xFF;
+        data[len++] = _candidate_address & 0xFF;
+        _assign_attempts++;
+        _expect = Expect::STATE;
+    } else if (discovery) {
+        // LOGON_ENABLE: 1111-11GG ZZZZ-ZZZZ ZZZZ-ZZZZ SSSS-SSSS (RCN-218, 3.2), group ALL (GG = 00).
+        data[len++] = RCN218::DCC_A_ADDRESS;
+        data[len++] = RCN218::CMD_LOGON_ENABLE;
+        data[len++] = (_zid >> 8) & 0xFF;
+        data[len++] = _zid & 0xFF;
+        data[len++] = _session_id;
+        _expect = Expect::UNIQUE_ID;
+    } else {
+        _expect = Expect::NOTHING;
+        return false;
+    }
+
+    uint8_t checksum = 0;
+    for (size_t i = 0; i < len; ++i) {
+        checksum ^= data[i];
+    }
+    data[len++] = checksum;
+    packet = DCCMessage(data, len);
+    return true;
+}
+
+/**
+ * @brief Checks whether the cutout after the last packet carries a logon reply.
+ * @return True if `processCutout()` should be called.
+ */
+bool LogonManager::expectsReply() const {
+    return _expect != Expect::NOTHING;
+}
+
+/**
+ * @brief Reads and evaluates the reply to the last logon packet.
+ * @details A LOGON_ASSIGN without a valid DECODER_STATE reply is repeated up to
+ *          `LOGON_ASSIGN_ATTEMPTS` times; after that the candidate is dropped,
+ *          e.g. because its unique ID was read from an undetected collision.
+ *          A new decoder is ignored once the address pool is exhausted.
+ * @return The message read from the receiver, or nullptr.
+ */
+RailcomMessage* LogonManager::processCutout() {
+    if (_expect == Expect::NOTHING) {
+        return nullptr;
+    }
+    Expect expect = _expect;
+    _expect = Expect::NOTHING;
+
+    RailcomMessage* msg = _rx.read();
+    bool collision = _rx.collisionDetected();
+
+    if (expect == Expect::UNIQUE_ID) {
+        if (collision) {
+            _collisions++;
+        } else if (msg != nullptr && msg->id == RailcomID::DECODER_UNIQUE) {
+            DecoderUniqueMessage* unique = static_cast<DecoderUniqueMessage*>(msg);
+            const Entry* slot = findSlot(unique->manufacturerId, unique->productId);
+            if (slot != nullptr && (slot->used || !addressPoolExhausted())) {
+                _candidate_mfr = unique->manufacturerId;
+                _candidate_pid = unique->productId;
+                _candidate_address = slot->used ? slot->address : _next_address;
+                _assign_attempts = 0;
+                _assign_pending = true;
+            }
+        }
+    } else {
+        if (!collision && msg != nullptr && msg->id == RailcomID::DECODER_STATE) {
+            registerCandidate();
+        } else if (_assign_attempts >= LOGON_ASSIGN_ATTEMPTS) {
+            _assign_pending = false;
+        }
+    }
+    return msg;
+}
+
+/**
+ * @brief Stores the registration of the candidate in the table.
+ */
+void LogonManager::registerCandidate() {
+    _assign_pending = false;
+    Entry* slot = const_cast<Entry*>(findSlot(_candidate_mfr, _candidate_pid));
+    if (slot == nullptr) return;
+
+    if (!slot->used) {
+        slot->used = true;
+        slot->manufacturerId = _candidate_mfr;
+        slot->productId = _candidate_pid;
+        slot->address = _candidate_address;
+        _count++;
+        if (_candidate_address == _next_address) {
+            _next_address++;
+        }
+    }
+    if (onRegistered) {
+        onRegistered(_candidate_mfr, _candidate_pid, _candidate_address);
+    }
+}
+
+/**
+ * @brief Finds the table slot of a unique ID.
+ * @return The entry of the ID, the free slot for it, or nullptr if the table is full.
+ */
+const LogonManager::Entry* LogonManager::findSlot(uint16_t manufacturerId, uint32_t productId) const {
+    uint16_t index = hashUniqueId(manufacturerId, productId);
+    for (uint16_t probe = 0; probe < LOGON_TABLE_SIZE; ++probe) {
+        const Entry& entry = _table[(index + probe) & (LOGON_TABLE_SIZE - 1)];
+        if (!entry.used || (entry.manufacturerId == manufacturerId && entry.productId == productId)) {
+            return &entry;
+        }
+    }
+    return nullptr;
+}
+
+/**
+ * @brief Looks up the address assigned to a decoder.
+ * @param manufacturerId The manufacturer ID.
+ * @param productId The product ID.
+ * @param[out] address The assigned address.
+ * @return True if the decoder has logged on before.
+ */
+bool LogonManager::lookup(uint16_t manufacturerId, uint32_t productId, uint16_t& address) const {
+    const Entry* slot = findSlot(manufacturerId, productId);
+    if (slot == nullptr || !slot->used) return false;
+    address = slot->address;
+    return true;
+}
+
+/**
+ * @brief Returns the number of decoders in the logon table.
+ */
+uint16_t LogonManager::registeredCount() const {
+    return _count;
+}
+
+/**
+ * @brief Returns the number of LOGON_ENABLE replies lost in collisions.
+ */
+uint32_t LogonManager::collisionCount() const {
+    return _collisions;
+}
+
+/**
+ * @brief Checks whether all addresses for new decoders have been handed out.
+ */
+bool LogonManager::addressPoolExhausted() const {
+    return _next_address > MAX_LONG_ADDRESS;
+}
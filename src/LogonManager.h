@@ -0,0 +1,161 @@
+/**
+ * @file LogonManager.h
+ * @brief Command station side of the RCN-218 automatic logon.
+ * @details The LogonManager generates the DCC-A packets of the logon procedure
+ *          and evaluates the RailCom replies received by a RailcomRx. It keeps
+ *          a table of all unique IDs that have logged on, so a decoder that
+ *          logs on again (e.g. after being put back on the track) gets its
+ *          previous address.
+ */
+#ifndef LOGON_MANAGER_H
+#define LOGON_MANAGER_H
+
+#include "Railcom.h"
+#include "RailcomProtocolDefs.h"
+#include "RailcomRx.h"
+#include <functional>
+
+/** @brief Number of unique IDs the logon table can hold (must be a power of two). */
+constexpr uint16_t LOGON_TABLE_SIZE = 256;
+/** @brief Number of LOGON_ASSIGN commands sent to a decoder before it is given up. */
+constexpr uint8_t LOGON_ASSIGN_ATTEMPTS = 3;
+/** @brief Default first address handed out by the LogonManager. */
+constexpr uint16_t LOGON_DEFAULT_FIRST_ADDRESS = 1000;
+
+/**
+ * @class LogonManager
+ * @brief Drives the RCN-218 discovery and registration of decoders.
+ * @details The command station offers the manager a slot before each DCC
+ *          packet with `nextPacket()` and calls `processCutout()` after the
+ *          cutout that followed a logon packet. Every reply is evaluated in the
+ *          cutout directly after its command, so no slot is spent waiting:
+ *          - LOGON_ENABLE is answered by all decoders that want to log on. A
+ *            single clean DECODER_UNIQUE reply makes the decoder a candidate;
+ *            invalid 4-of-8 codes or a NACK count as a collision, which the
+ *            decoders resolve with their backoff.
+ *          - The candidate is assigned its address with LOGON_ASSIGN in the
+ *            very next slot, without a SELECT round trip, and the DECODER_STATE
+ *            reply completes the registration. Other packets may be sent in
+ *            between; only the next LOGON_ENABLE must wait for the assignment.
+ *          With every slot available for the logon, a decoder is registered
+ *          in two packets. New decoders are given consecutive addresses up to
+ *          `MAX_LONG_ADDRESS`; after that only decoders already in the table
+ *          get an address.
+ * @see RCN-218, Chapter 2 and 3
+ */
+class LogonManager {
+public:
+    /**
+     * @brief Constructs a LogonManager.
+     * @param rx The receiver that reads the replies of the decoders.
+     * @param zid The 16-bit ID of the command station (ZID).
+     * @param sessionId The ID of the current operating session.
+     * @param firstAddress The first address handed out to a new decoder.
+     */
+    LogonManager(RailcomRx& rx, uint16_t zid, uint8_t sessionId, uint16_t firstAddress = LOGON_DEFAULT_FIRST_ADDRESS);
+
+    /**
+     * @brief Builds the next logon packet, if there is one.
+     * @details A pending LOGON_ASSIGN is always returned. Otherwise a LOGON_ENABLE
+     *          is returned if `discovery` is true.
+     * @param[out] packet The packet to send, including its checksum.
+     * @param discovery True if the slot may be used to look for new decoders.
+     * @return True if `packet` should be sent.
+     */
+    bool nextPacket(DCCMessage& packet, bool discovery = true);
+
+    /**
+     * @brief Checks whether the cutout after the last packet carries a logon reply.
+     * @return True if `processCutout()` should be called for the next cutout.
+     */
+    bool expectsReply() const;
+
+    /**
+     * @brief Reads and evaluates the reply to the last logon packet.
+     * @details Call this after the cutout that followed a packet returned by
+     *          `nextPacket()`.
+     * @return The message read from the receiver, or nullptr. It stays valid
+     *         until the next call to `RailcomRx::read()`.
+     */
+    RailcomMessage* processCutout();
+
+    /**
+     * @brief Looks up the address assigned to a decoder.
+     * @param manufacturerId The 12-bit manufacturer ID.
+     * @param productId The 32-bit product ID.
+     * @param[out] address The assigned address.
+     * @return True if the decoder has logged on before.
+     */
+    bool lookup(uint16_t manufacturerId, uint32_t productId, uint16_t& address) const;
+
+    /**
+     * @brief Returns the number of decoders in the logon table.
+     * @return The number of registered unique IDs.
+     */
+    uint16_t registeredCount() const;
+
+    /**
+     * @brief Returns the number of LOGON_ENABLE replies lost in collisions.
+     * @return The collision count.
+     */
+    uint32_t collisionCount() const;
+
+    /**
+     * @brief Checks whether all addresses for new decoders have been handed out.
+     * @details New decoders are then not assigned an address; decoders in the
+     *          table still get theirs.
+     * @return True if the next address would be above `MAX_LONG_ADDRESS`.
+     */
+    bool addressPoolExhausted() const;
+
+    /**
+     * @brief Called when a decoder has been registered.
+     * @param manufacturerId The manufacturer ID of the decoder.
+     * @param productId The product ID of the decoder.
+     * @param address The address assigned to the decoder.
+     */
+    std::function<void(uint16_t manufacturerId, uint32_t productId, uint16_t address)> onRegistered;
+
+private:
+    /** @brief The reply expected in the next cutout. */
+    enum class Expect : uint8_t { NOTHING, UNIQUE_ID, STATE };
+
+    /** @brief An entry of the logon table. */
+    struct Entry {
+        bool used;               ///< True if the entry holds a decoder.
+        uint16_t manufacturerId; ///< The manufacturer ID.
+        uint32_t productId;      ///< The product ID.
+        uint16_t address;        ///< The assigned address.
+    };
+
+    /**
+     * @brief Finds the table slot of a unique ID.
+     * @details Open addressing with linear probing; the slot is either the entry
+     *          of the ID or the free slot where it would be inserted.
+     * @return The slot, or nullptr if the ID is unknown and the table is full.
+     */
+    const Entry* findSlot(uint16_t manufacturerId, uint32_t productId) const;
+
+    /**
+     * @brief Stores a registration in the table.
+     */
+    void registerCandidate();
+
+    RailcomRx& _rx;              ///< The receiver for the decoder replies.
+    uint16_t _zid;               ///< ID of the command station.
+    uint8_t _session_id;         ///< ID of the operating session.
+    uint16_t _next_address;      ///< Next address for a new decoder.
+
+    Expect _expect;              ///< The reply expected in the next cutout.
+    bool _assign_pending;        ///< A candidate is waiting for LOGON_ASSIGN.
+    uint8_t _assign_attempts;    ///< LOGON_ASSIGN commands sent to the candidate.
+    uint16_t _candidate_mfr;     ///< Manufacturer ID of the candidate.
+    uint32_t _candidate_pid;     ///< Product ID of the candidate.
+    uint16_t _candidate_address; ///< Address for the candidate.
+
+    uint16_t _count;             ///< Number of entries in the table.
+    uint32_t _collisions;        ///< LOGON_ENABLE replies lost in collisions.
+    Entry _table[LOGON_TABLE_SIZE]; ///< Unique ID to address table.
+};
+
+#endif // LOGON_MANAGER_H
@@ -0,0 +1,106 @@
+/**
+ * @file RP2040CvFlashHardware.cpp
+ * @brief Implementation of the RP2040CvFlashHardware class.
+ */
+#include "RP2040CvFlashHardware.h"
+#include <Arduino.h>
+#include "hardware/flash.h"
+#include "pico/platform.h"
+#include <cstring>
+
+extern "C" uint8_t __flash_binary_end; ///< End of the sketch image, defined by the linker script.
+extern "C" uint8_t _FS_start;          ///< Start of the filesystem region, defined by the arduino-pico linker script.
+extern "C" uint8_t _FS_end;            ///< End of the filesystem region, defined by the arduino-pico linker script.
+extern "C" uint8_t _EEPROM_start;      ///< Start of the EEPROM sector, defined by the arduino-pico linker script.
+
+/**
+ * @brief Returns true if the ranges [start, end) and [otherStart, otherEnd) overlap.
+ */
+static bool overlaps(uint32_t start, uint32_t end, uint32_t otherStart, uint32_t otherEnd) {
+    return start < otherEnd && otherStart < end;
+}
+
+/**
+ * @brief Constructs the hardware object.
+ * @details Stops the program with `panic()` if the region is not sector aligned,
+ *          starts inside the sketch image or overlaps the filesystem or the
+ *          EEPROM sector, because erasing it would destroy them.
+ * @param sectorCount The number of sectors in the region.
+ * @param flashOffset The offset of the region from the start of flash, or 0 for the default location.
+ */
+RP2040CvFlashHardware::RP2040CvFlashHardware(uint8_t sectorCount, uint32_t flashOffset)
+    : _sector_count(sectorCount < 2 ? 2 : sectorCount), _flash_offset(flashOffset) {
+    const uint32_t size = (uint32_t)_sector_count * CV_FLASH_SECTOR_SIZE;
+    const uint32_t fsStart = (uint32_t)&_FS_start - XIP_BASE;
+    const uint32_t fsEnd = (uint32_t)&_FS_end - XIP_BASE;
+    const uint32_t eepromStart = (uint32_t)&_EEPROM_start - XIP_BASE;
+    // The sketch ends within a sector; the rest of that sector is not free.
+    const uint32_t sketchEnd = ((uint32_t)&__flash_binary_end - XIP_BASE + CV_FLASH_SECTOR_SIZE - 1) &
+                               ~(uint32_t)(CV_FLASH_SECTOR_SIZE - 1);
+
+    if (_flash_offset == 0) {
+        if (fsStart < sketchEnd + size) {
+            panic("CV flash: no room for %u sectors between sketch and filesystem", (unsigned)_sector_count);
+        }
+        _flash_offset = fsStart - size;
+    }
+
+    const uint32_t end = _flash_offset + size;
+    if (_flash_offset % CV_FLASH_SECTOR_SIZE != 0) {
+        panic("CV flash: offset 0x%lx is not sector aligned", (unsigned long)_flash_offset);
+    }
+    if (_flash_offset < sketchEnd) {
+        panic("CV flash: region at 0x%lx overlaps the sketch", (unsigned long)_flash_offset);
+    }
+    if (overlaps(_flash_offset, end, fsStart, fsEnd) ||
+        overlaps(_flash_offset, end, eepromStart, eepromStart + CV_FLASH_SECTOR_SIZE) ||
+        end > PICO_FLASH_SIZE_BYTES) {
+        panic("CV flash: region at 0x%lx overlaps the filesystem or EEPROM", (unsigned long)_flash_offset);
+    }
+}
+
+/**
+ * @brief Returns the number of sectors in the region.
+ */
+uint8_t RP2040CvFlashHardware::sectorCount() const {
+    return _sector_count;
+}
+
+/**
+ * @brief Reads from the region through the XIP window.
+ * @param offset The offset from the start of the region.
+ * @param dst The destination buffer.
+ * @param len The number of bytes to read.
+ */
+void RP2040CvFlashHardware::read(uint32_t offset, uint8_t* dst, size_t len) {
+    memcpy(dst, (const void*)(XIP_BASE + _flash_offset + offset), len);
+}
+
+/**
+ * @brief Erases one sector.
+ * @details Takes roughly 50 ms during which neither core executes from flash.
+ * @param sector The index of the sector within the region.
+ */
+void RP2040CvFlashHardware::eraseSector(uint8_t sector) {
+    if (sector >= _sector_count) return;
+    noInterrupts();
+    rp2040.idleOtherCore();
+    flash_range_erase(_flash_offset + sector * CV_FLASH_SECTOR_SIZE, CV_FLASH_SECTOR_SIZE);
+    rp2040.resumeOtherCore();
+    interrupts();
+}
+
+/**
+ * @brief Programs one page.
+ * @details Takes well below 1 ms during which neither core executes from flash.
+ * @param offset The page-aligned offset from the start of the region.
+ * @param data The page contents.
+ */
+void RP2040CvFlashHardware::programPage(uint32_t offset, const uint8_t* data) {
+    if (offset + CV_FLASH_PAGE_SIZE > (uint32_t)_sector_count * CV_FLASH_SECTOR_SIZE) return;
+    noInterrupts();
+    rp2040.idleOtherCore();
+    flash_range_program(_flash_offset + offset, data, CV_FLASH_PAGE_SIZE);
+    rp2040.resumeOtherCore();
+    interrupts();
+}
@@ -0,0 +1,52 @@
+/**
+ * @file RP2040CvFlashHardware.h
+ * @brief A concrete implementation of the CvFlashHardware interface for the Raspberry Pi RP2040.
+ */
+#ifndef RP2040_CV_FLASH_HARDWARE_H
+#define RP2040_CV_FLASH_HARDWARE_H
+
+#include "CvFlashHardware.h"
+
+/**
+ * @class RP2040CvFlashHardware
+ * @brief Implements the CvFlashHardware interface on the RP2040's external QSPI flash.
+ * @details Reads go through the XIP window. Erasing and programming disable
+ *          interrupts and park the other core, because no code can run from
+ *          flash while it is being written.
+ */
+class RP2040CvFlashHardware : public CvFlashHardware {
+public:
+    /**
+     * @brief Constructs an RP2040CvFlashHardware object.
+     * @param sectorCount The number of 4 KB sectors to use (at least 2).
+     * @param flashOffset The offset of the region from the start of flash. If 0,
+     *                    the region is placed directly below the filesystem
+     *                    region (`_FS_start`), at the end of the space left free
+     *                    by the sketch. An explicit offset must be sector aligned.
+     * @details The region is checked against the linker symbols of arduino-pico:
+     *          it must start behind the sketch image (`__flash_binary_end`) and
+     *          must not reach into the filesystem (`_FS_start`..`_FS_end`) or the
+     *          EEPROM sector (`_EEPROM_start`). A region that violates this
+     *          stops the program with `panic()`, before anything is erased.
+     *          The free space shrinks as the sketch grows, so a sketch that is
+     *          close to the limit should reserve the region with an explicit
+     *          offset and a matching filesystem size instead.
+     */
+    RP2040CvFlashHardware(uint8_t sectorCount = 2, uint32_t flashOffset = 0);
+
+    /**
+     * @brief Default destructor.
+     */
+    ~RP2040CvFlashHardware() override = default;
+
+    uint8_t sectorCount() const override;
+    void read(uint32_t offset, uint8_t* dst, size_t len) override;
+    void eraseSector(uint8_t sector) override;
+    void programPage(uint32_t offset, const uint8_t* data) override;
+
+private:
+    uint8_t _sector_count;  ///< Number of sectors in the region.
+    uint32_t _flash_offset; ///< Offset of the region from the start of flash.
+};
+
+#endif // RP2040_CV_FLASH_HARDWARE_H
@@ -4,6 +4,7 @@
  */
 #include "RP2040RailcomRxHardware.h"
 #include "pico/stdlib.h"
+#include "hardware/structs/uart.h"
 #include "RailcomProtocolDefs.h"
 
 /**
@@ -53,3 +54,53 @@ int RP2040RailcomRxHardware::read() {
     }
     return -1;
 }
+
+/**
+ * @brief Reads the bytes waiting in the UART receive FIFO.
+ * @param[out] dst Receives the bytes.
+ * @param max The size of `dst`.
+ * @param[out] timestamps_us Receives the time each byte was taken from the FIFO, or nullptr.
+ * @return The number of bytes read.
+ */
+size_t RP2040RailcomRxHardware::readBlock(uint8_t* dst, size_t max, uint32_t* timestamps_us) {
+    uart_hw_t* hw = uart_get_hw(_uart);
+    size_t count = 0;
+    while (count < max && !(hw->fr & UART_UARTFR_RXFE_BITS)) {
+        if (timestamps_us != nullptr) {
+            timestamps_us[count] = time_us_32();
+        }
+        dst[count++] = (uint8_t)hw->dr;
+    }
+    hw->icr = UART_UARTICR_RTIC_BITS;
+    return count;
+}
+
+/**
+ * @brief Waits for the first byte and then for the receive timeout.
+ * @param timeout_ms The maximum time to wait for the first byte.
+ * @return True if bytes are available.
+ */
+bool RP2040RailcomRxHardware::waitForFrame(uint32_t timeout_ms) {
+    if (!uart_is_readable_within_us(_uart, timeout_ms * 1000)) {
+        return false;
+    }
+    uart_hw_t* hw = uart_get_hw(_uart);
+    // A full FIFO does not wait for the timeout; the caller has to make room.
+    while (!(hw->ris & UART_UARTRIS_RTRIS_BITS) && !(hw->fr & UART_UARTFR_RXFF_BITS)) {
+        tight_loop_contents();
+    }
+    return true;
+}
+
+/**
+ * @brief Reads and clears the overrun bit of the receive status register.
+ * @return True if the receive FIFO overflowed.
+ */
+bool RP2040RailcomRxHardware::overrunOccurred() {
+    uart_hw_t* hw = uart_get_hw(_uart);
+    bool overrun = hw->rsr & UART_UARTRSR_OE_BITS;
+    if (overrun) {
+        hw->rsr = UART_UARTRSR_OE_BITS; // Any write clears the error bits.
+    }
+    return overrun;
+}
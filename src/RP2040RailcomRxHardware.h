@@ -7,7 +7,6 @@
 
 #include "RailcomRxHardware.h"
 #include "hardware/uart.h"
-#include <vector>
 
 /**
  * @class RP2040RailcomRxHardware
@@ -33,6 +32,30 @@ public:
     int available() override;
     int read() override;
 
+    /**
+     * @brief Drains the UART receive FIFO.
+     * @details The timestamps are taken while draining, so they are only as
+     *          accurate as the call follows the reception.
+     */
+    size_t readBlock(uint8_t* dst, size_t max, uint32_t* timestamps_us = nullptr) override;
+
+    /**
+     * @brief Waits for the reply of a cutout using the UART receive timeout.
+     * @details The PL011 raises its receive timeout once the FIFO holds data and
+     *          the line has been idle for 32 bit times, which is
+     *          `RAILCOM_RX_IDLE_US` at 250 kBaud; no byte has to be read to
+     *          detect the end of the reply.
+     */
+    bool waitForFrame(uint32_t timeout_ms) override;
+
+    /**
+     * @brief Reports and clears the overrun flag of the UART.
+     * @details The flag is set when a byte arrives while the 32-byte receive
+     *          FIFO is full; that byte is lost.
+     * @return True if the receive FIFO overflowed.
+     */
+    bool overrunOccurred() override;
+
 private:
     uart_inst_t* _uart; ///< Pointer to the RP2040 UART instance.
     uint _rx_pin;       ///< The GPIO pin for UART RX.
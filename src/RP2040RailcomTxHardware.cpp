@@ -39,8 +39,34 @@ void RP2040RailcomTxHardware::task() {
 
 /**
  * @brief Sends a block of bytes over the UART.
+ * @param bytes The encoded bytes.
+ * @param len The number of bytes.
  */
-void RP2040RailcomTxHardware::send_bytes(const std::vector<uint8_t>& bytes) {
-    uart_write_blocking(_uart, bytes.data(), bytes.size());
+void RP2040RailcomTxHardware::send(const uint8_t* bytes, size_t len) {
+    uart_write_blocking(_uart, bytes, len);
+    uart_tx_wait_blocking(_uart);
+}
+
+/**
+ * @brief Sends the Channel 1 and Channel 2 bytes of a cutout.
+ * @details Both parts fit into the 32-byte TX FIFO, so writing them does not
+ *          block; only the wait for the Channel 2 start and the final drain do.
+ * @param ch1 The Channel 1 bytes.
+ * @param ch1_len The number of Channel 1 bytes.
+ * @param ch2 The Channel 2 bytes.
+ * @param ch2_len The number of Channel 2 bytes.
+ * @param ch2_offset_us The time in microseconds from the call to the start of Channel 2.
+ */
+void RP2040RailcomTxHardware::send_frame(const uint8_t* ch1, size_t ch1_len,
+                                         const uint8_t* ch2, size_t ch2_len, uint32_t ch2_offset_us) {
+    absolute_time_t ch2_start = make_timeout_time_us(ch2_offset_us);
+    if (ch1_len > 0) {
+        uart_write_blocking(_uart, ch1, ch1_len);
+    }
+    if (ch2_len > 0) {
+        // Channel 1 (at most 2 bytes, 80 us) has left the FIFO long before Channel 2 starts.
+        busy_wait_until(ch2_start);
+        uart_write_blocking(_uart, ch2, ch2_len);
+    }
     uart_tx_wait_blocking(_uart);
 }
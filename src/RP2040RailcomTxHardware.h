@@ -7,7 +7,6 @@
 
 #include "RailcomTxHardware.h"
 #include "hardware/uart.h"
-#include <vector>
 
 /**
  * @class RP2040RailcomTxHardware
@@ -30,7 +29,17 @@ public:
     void begin() override;
     void end() override;
     void task() override;
-    void send_bytes(const std::vector<uint8_t>& bytes) override;
+    void send(const uint8_t* bytes, size_t len) override;
+
+    /**
+     * @brief Sends both channels of a cutout.
+     * @details Channel 1 is written to the UART FIFO without waiting for the
+     *          transmission. Channel 2 is written once `ch2_offset_us` have passed
+     *          since the call, measured with the hardware timer, so the time
+     *          Channel 1 takes on the wire does not delay Channel 2.
+     */
+    void send_frame(const uint8_t* ch1, size_t ch1_len,
+                    const uint8_t* ch2, size_t ch2_len, uint32_t ch2_offset_us) override;
 
 private:
     uart_inst_t* _uart; ///< Pointer to the RP2040 UART instance.
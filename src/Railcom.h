@@ -90,7 +90,7 @@ enum class RailcomID {
  */
 namespace RCN218 {
     const uint8_t DCC_A_ADDRESS = 254;          ///< The special broadcast address for DCC-A commands.
-    const uint8_t CMD_LOGON_ENABLE = 0xF0;      ///< Base command for enabling logon (GG bits to be added).
+    const uint8_t CMD_LOGON_ENABLE = 0xFC;      ///< Base command for enabling logon, 1111-11GG (GG bits to be added).
     const uint8_t CMD_SELECT = 0xD0;            ///< Base command for selecting a decoder (HHHH bits to be added).
     const uint8_t CMD_LOGON_ASSIGN = 0xE0;      ///< Base command for assigning a slot (HHHH bits to be added).
     const uint8_t CMD_GET_DATA_START = 0x00;    ///< Command to start reading data from a decoder.
@@ -210,6 +210,8 @@ struct DataSpaceMessage : public RailcomMessage {
     uint8_t crc;
     uint8_t dataSpaceNum; ///< From the DCC command, not the RailCom message itself.
     bool crc_ok;          ///< True if the received CRC matches the calculated one.
+    uint8_t sequence;     ///< Sequence number of the block; 0 for the first block of a reply.
+    bool last;            ///< True for the last block of a reply.
 };
 
 // --- Constants ---
@@ -0,0 +1,104 @@
+/**
+ * @file RailcomArena.h
+ * @brief Fixed-size memory for the buffers the library creates at run time.
+ * @details The transmitter, the decoder state machine and the Data Space
+ *          buffers use fixed arrays sized at compile time. The only objects the
+ *          library creates while running are the messages `RailcomRx::read()`
+ *          returns; they are placed in a `RailcomArena` owned by the receiver
+ *          instead of the heap, so no allocation takes place after `begin()`
+ *          and the heap cannot fragment over a long uptime.
+ *
+ *          With `RAILCOM_NO_HEAP` set to 1, the convenience functions that
+ *          return a `std::vector` are left out as well, so application code
+ *          cannot allocate through the library by accident. The flag has to be
+ *          the same for the whole library, e.g. `-DRAILCOM_NO_HEAP=1`.
+ */
+#ifndef RAILCOM_ARENA_H
+#define RAILCOM_ARENA_H
+
+#include <cstddef>
+#include <cstdint>
+#include <new>
+#include <type_traits>
+
+#ifndef RAILCOM_NO_HEAP
+/** @brief Set to 1 to remove the library functions that allocate from the heap. */
+#define RAILCOM_NO_HEAP 0
+#endif
+
+#ifndef RAILCOM_RX_ARENA_BYTES
+/** @brief Size of the arena of a `RailcomRx`; it must hold the largest message (a DataSpaceMessage). */
+#define RAILCOM_RX_ARENA_BYTES 32
+#endif
+
+/**
+ * @class RailcomArena
+ * @brief A bump allocator over a fixed buffer.
+ * @details Objects are placed one after the other and released all at once
+ *          with `reset()`, which makes allocation a pointer increment and rules
+ *          out fragmentation. Only trivially destructible types may be created,
+ *          as no destructors are run. When the buffer is exhausted, `create()`
+ *          returns nullptr and the failure is counted; it never falls back to
+ *          the heap. The arena takes no locks.
+ * @tparam N The size of the buffer in bytes.
+ */
+template <size_t N>
+class RailcomArena {
+public:
+    RailcomArena() : _used(0), _peak(0), _failures(0) {}
+
+    /**
+     * @brief Reserves memory.
+     * @param size The number of bytes.
+     * @param align The alignment, a power of two.
+     * @return The memory, or nullptr if the arena is exhausted.
+     */
+    void* allocate(size_t size, size_t align) {
+        size_t offset = (_used + align - 1) & ~(align - 1);
+        if (offset > N || size > N - offset) {
+            _failures++;
+            return nullptr;
+        }
+        _used = offset + size;
+        if (_used > _peak) _peak = _used;
+        return _buffer + offset;
+    }
+
+    /**
+     * @brief Creates a value-initialised object in the arena.
+     * @tparam T A trivially destructible type.
+     * @return The object, or nullptr if the arena is exhausted.
+     */
+    template <typename T>
+    T* create() {
+        static_assert(std::is_trivially_destructible<T>::value, "RailcomArena runs no destructors");
+        static_assert(sizeof(T) <= N, "Type does not fit into the arena");
+        void* memory = allocate(sizeof(T), alignof(T));
+        return memory != nullptr ? new (memory) T() : nullptr;
+    }
+
+    /**
+     * @brief Releases all objects.
+     */
+    void reset() { _used = 0; }
+
+    /** @brief Returns the size of the buffer in bytes. */
+    static constexpr size_t capacity() { return N; }
+
+    /** @brief Returns the number of bytes in use. */
+    size_t used() const { return _used; }
+
+    /** @brief Returns the largest number of bytes that were in use at once. */
+    size_t peak() const { return _peak; }
+
+    /** @brief Returns the number of allocations that did not fit. */
+    uint32_t failures() const { return _failures; }
+
+private:
+    alignas(std::max_align_t) uint8_t _buffer[N]; ///< The memory handed out.
+    size_t _used;                                 ///< Bytes in use.
+    size_t _peak;                                 ///< Largest `_used` so far.
+    uint32_t _failures;                           ///< Allocations that did not fit.
+};
+
+#endif // RAILCOM_ARENA_H
@@ -25,9 +25,11 @@ void RailcomDccParser::parse(const DCCMessage& msg, bool* response_sent) {
     // RCN-218 DCC-A Protocol
     // See RCN-218, Chapter 3 for command structures
     if (data[0] == RCN218::DCC_A_ADDRESS) {
+        // DCC-A commands are answered in the following cutout.
+        if (response_sent) *response_sent = true;
         uint8_t cmd = data[1];
-        if (cmd >= RCN218::CMD_LOGON_ENABLE && cmd < 0xF4) {
-            if (onLogonEnable && len >= 4) {
+        if (cmd >= RCN218::CMD_LOGON_ENABLE) {
+            if (onLogonEnable && len >= 5) {
                 uint8_t group = cmd & 0x03;
                 uint16_t zid = (data[2] << 8) | data[3];
                 uint8_t sessionId = data[4];
@@ -41,7 +43,7 @@ void RailcomDccParser::parse(const DCCMessage& msg, bool* response_sent) {
                 onSelect(manufacturerId, productId, subCmd, data + 8, len - 8);
             }
         } else if (cmd >= RCN218::CMD_LOGON_ASSIGN && cmd < 0xF0) {
-            if (onLogonAssign && len >= 8) {
+            if (onLogonAssign && len >= 9) {
                 uint16_t manufacturerId = ((cmd & 0x0F) << 8) | data[2];
                 uint32_t productId = (data[3] << 24) | (data[4] << 16) | (data[5] << 8) | data[6];
                 uint16_t address = (data[7] << 8) | data[8];
@@ -70,80 +72,114 @@ void RailcomDccParser::parse(const DCCMessage& msg, bool* response_sent) {
     }
 
     // --- RCN-217 and NMRA S-9.2.1 Parsing ---
-    uint16_t address = (data[0] << 8) | data[1];
+    uint16_t address;
+    size_t cmd;
 
-    if (len >= 3) {
-        uint8_t byte3 = data[2];
-        // Check for POM command pattern: 111xxxxx (NMRA S-9.2.1)
-        if ((byte3 & 0b11100000) == 0b11100000) {
+    // Check for Accessory Decoder Command pattern (NMRA S-9.2.1)
+    if (decodeAccessoryAddress(msg, address)) {
+        if (onAccessory) {
             if (response_sent) *response_sent = true;
-            uint16_t cv = (byte3 & 0x1F) << 8 | data[3];
-            // Check for Read CV sub-command: 111001xx
-            if ((byte3 & 0b00011100) == 0b00000100 && onPomReadCv) {
-                 onPomReadCv(cv, address);
-            // Check for Write CV sub-command: 111111xx
-            } else if ((byte3 & 0b00011100) == 0b00011100 && onPomWriteCv) {
-                 onPomWriteCv(cv, data[4], address);
-            // Check for Write Bit sub-command: 111110xx
-            } else if ((byte3 & 0b00011100) == 0b00011000 && onPomWriteBit) {
-                uint8_t bit = data[4] & 0x07;
-                uint8_t value = (data[4] >> 3) & 1;
-                onPomWriteBit(cv, bit, value, address);
-            }
+            bool activate = (data[1] >> 3) & 1;
+            uint8_t output = data[1] & 0x07;
+            onAccessory(address, activate, output);
         }
-    // Check for Accessory Decoder Command pattern (NMRA S-9.2.1)
-    } else if ((data[0] & 0b11000000) == 0b10000000 && len >= 2 && onAccessory) {
+        return;
+    }
+
+    // Everything else is addressed to a multi-function decoder; the instruction
+    // follows the short or long address.
+    if (!decodeAddress(msg, address, cmd)) return;
+    uint8_t instruction = data[cmd];
+
+    // RCN-218 Data Space Read, Command 0xED: ADDR 0xED NNNN-SSSS, optionally followed
+    // by the XOR byte. POM "write CV" shares the instruction byte but is longer, so
+    // the short Data Space packet is recognised first.
+    if (isDataSpaceRead(msg, cmd) && onDataSpaceRead) {
+        if (response_sent) *response_sent = true;
+        onDataSpaceRead(address, (data[cmd + 1] >> 4) & 0x0F, data[cmd + 1] & 0x0F);
+    // Check for POM command pattern: 111xxxxx (NMRA S-9.2.1)
+    // The CV byte follows the instruction, the value or bit byte follows the CV.
+    } else if ((instruction & 0b11100000) == 0b11100000 && len >= cmd + 2) {
         if (response_sent) *response_sent = true;
-        address = 1 + (((~data[0]) & 0x3F) << 2) | ((data[1] >> 1) & 0x03);
-        bool activate = (data[1] >> 3) & 1;
-        uint8_t output = data[1] & 0x03;
-        onAccessory(address, activate, output);
+        // The two low bits of the instruction byte are the high bits of the CV number.
+        uint16_t cv = (instruction & 0x03) << 8 | data[cmd + 1];
+        // Check for Read CV sub-command: 111001xx
+        if ((instruction & 0b00011100) == 0b00000100 && onPomReadCv) {
+            onPomReadCv(cv, address);
+        // Check for Write CV sub-command: 111011xx
+        } else if ((instruction & 0b00011100) == 0b00001100 && len >= cmd + 3 && onPomWriteCv) {
+            onPomWriteCv(cv, data[cmd + 2], address);
+        // Check for Write Bit sub-command: 111010xx
+        } else if ((instruction & 0b00011100) == 0b00001000 && len >= cmd + 3 && onPomWriteBit) {
+            uint8_t bit = data[cmd + 2] & 0x07;
+            uint8_t value = (data[cmd + 2] >> 3) & 1;
+            onPomWriteBit(cv, bit, value, address);
+        }
+    // RCN-217 Extended Function (XF), Command 0xDE, optionally followed by the XOR byte.
+    // It matches the function group pattern below, so it is recognised first.
+    } else if (instruction == 0xDE && (len == cmd + 2 || len == cmd + 3) && onExtendedFunction) {
+        if (response_sent) *response_sent = true;
+        onExtendedFunction(address, data[cmd + 1]);
     // Check for Function Group Command pattern (NMRA S-9.2)
-    } else if ((data[1] & 0b11010000) == 0b11010000 && onFunction) {
+    } else if ((instruction & 0b11010000) == 0b11010000 && len >= cmd + 2 && onFunction) {
         if (response_sent) *response_sent = true;
-        uint8_t function = data[1] & 0x1F;
-        bool state = (data[2] >> 5) & 1;
+        uint8_t function = instruction & 0x1F;
+        bool state = (data[cmd + 1] >> 5) & 1;
         onFunction(address, function, state);
-    // Check for various extended commands (XF, Data Space)
-    } else if (onExtendedFunction) {
-        bool handled = false;
-        uint16_t address = 0;
-        uint8_t command = 0;
+    }
+}
 
-        // Long address format: ADDR_H, ADDR_L, CMD_BYTE, PAYLOAD
-        if (len == 4 && (data[0] & 0xC0) == 0xC0) {
-            address = ((data[0] & 0x3F) << 8) | data[1];
-            // RCN-217 Extended Function (XF), Command 0xDE
-            if (data[2] == 0xDE && onExtendedFunction) {
-                command = data[3];
-                handled = true;
-                onExtendedFunction(address, command);
-            // RCN-218 Data Space Read, Command 0xED
-            } else if (data[2] == 0xED && onDataSpaceRead) {
-                uint8_t dataSpaceNum = (data[3] >> 4) & 0x0F;
-                uint8_t startAddr = data[3] & 0x0F;
-                handled = true;
-                onDataSpaceRead(address, dataSpaceNum, startAddr);
-            }
-        // Short address format: ADDR, CMD_BYTE, PAYLOAD
-        } else if (len == 3 && (data[0] & 0x80) == 0) {
-            address = data[0];
-            // RCN-217 Extended Function (XF), Command 0xDE
-            if (data[1] == 0xDE && onExtendedFunction) {
-                command = data[2];
-                handled = true;
-                onExtendedFunction(address, command);
-            // RCN-218 Data Space Read, Command 0xED
-            } else if (data[1] == 0xED && onDataSpaceRead) {
-                uint8_t dataSpaceNum = (data[2] >> 4) & 0x0F;
-                uint8_t startAddr = data[2] & 0x0F;
-                handled = true;
-                onDataSpaceRead(address, dataSpaceNum, startAddr);
-            }
-        }
+/**
+ * @brief Decodes the address of a packet for multi-function decoders.
+ * @details The first byte selects the address range (RCN-211, Section 3):
+ *          0 is the broadcast address, 1-127 short addresses, 128-191
+ *          accessory decoders, 192-231 the high byte of a long address, and
+ *          232-255 reserved, DCC-A and idle packets. A long address needs the
+ *          second address byte and an instruction byte.
+ * @param msg The DCC packet.
+ * @param[out] address The address of the packet.
+ * @param[out] instruction The index of the first instruction byte.
+ * @return True if the packet is addressed to multi-function decoders.
+ */
+bool RailcomDccParser::decodeAddress(const DCCMessage& msg, uint16_t& address, size_t& instruction) {
+    const uint8_t* data = msg.getData();
+    size_t len = msg.getLength();
 
-        if (handled) {
-            if (response_sent) *response_sent = true;
-        }
+    if (len >= 2 && (data[0] & 0x80) == 0) {
+        address = data[0];
+        instruction = 1;
+        return true;
+    }
+    if (len >= 3 && data[0] >= 0xC0 && data[0] <= 0xE7) {
+        address = ((data[0] & 0x3F) << 8) | data[1];
+        instruction = 2;
+        return true;
     }
+    return false;
+}
+
+/**
+ * @brief Decodes the address of a packet for accessory decoders.
+ * @param msg The DCC packet.
+ * @param[out] address The accessory address of the packet.
+ * @return True if the packet is addressed to accessory decoders.
+ */
+bool RailcomDccParser::decodeAccessoryAddress(const DCCMessage& msg, uint16_t& address) {
+    const uint8_t* data = msg.getData();
+    if (msg.getLength() < 2 || (data[0] & 0b11000000) != 0b10000000) return false;
+    // 10AAAAAA 1AAADAAR: the three high address bits are sent inverted.
+    address = (data[0] & 0x3F) | ((uint16_t)(~data[1] & 0x70) << 2);
+    return true;
+}
+
+/**
+ * @brief Checks for the short 0xED packet, which POM "write CV" is longer than.
+ * @param msg The DCC packet.
+ * @param instruction The index of the instruction byte.
+ * @return True if the packet is a Data Space read.
+ */
+bool RailcomDccParser::isDataSpaceRead(const DCCMessage& msg, size_t instruction) {
+    size_t len = msg.getLength();
+    return len > instruction && msg.getData()[instruction] == 0xED &&
+           (len == instruction + 2 || len == instruction + 3);
 }
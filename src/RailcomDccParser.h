@@ -94,10 +94,11 @@ public:
 
     /**
      * @brief Called when an accessory decoder command is received.
-     * @param address The address of the accessory.
+     * @param address The decoder address of the accessory (0-511).
      * @param activate True to activate the output, false to deactivate.
-     * @param output The specific output on the accessory to control.
-     * @see NMRA S-9.2.1
+     * @param output The output of the decoder, 0-7: the pair in bits 1-2 and
+     *        the output of the pair in bit 0.
+     * @see RCN-213, 2.1
      */
     std::function<void(uint16_t address, bool activate, uint8_t output)> onAccessory;
 
@@ -121,7 +122,8 @@ public:
      * @brief Called when a Data Space Read command is received.
      * @param address The address of the target decoder.
      * @param dataSpaceNum The number of the data space to read from.
-     * @param startAddr The starting address within the data space.
+     * @param startAddr The byte offset within the data space (0-15) at which
+     *        the reply starts.
      * @see RCN-218, 4.3
      */
     std::function<void(uint16_t address, uint8_t dataSpaceNum, uint8_t startAddr)> onDataSpaceRead;
@@ -132,10 +134,47 @@ public:
      *          appropriate registered callback, if any.
      * @param msg The DCCMessage to parse.
      * @param[out] response_sent A pointer to a boolean that will be set to true
-     *             if a callback was invoked. This allows the caller to know if a
-     *             specific RailCom response was triggered by this DCC packet.
+     *             if a callback was invoked. The callbacks get every address, so
+     *             the caller has to check with `decodeAddress` or
+     *             `decodeAccessoryAddress` whether the packet was its own.
      */
     void parse(const DCCMessage& msg, bool* response_sent = nullptr);
+
+    /**
+     * @brief Decodes the address of a packet for multi-function decoders.
+     * @details A short address (1-127) is the first byte. A long address is
+     *          marked by the prefix 11 in the first byte, whose six low bits are
+     *          the high part of the address; the second byte is the low part.
+     *          The broadcast address is returned as 0.
+     * @param msg The DCC packet.
+     * @param[out] address The address of the packet.
+     * @param[out] instruction The index of the first instruction byte: 1 after
+     *             a short address, 2 after a long one.
+     * @return True if the packet is addressed to multi-function decoders, false
+     *         for accessory, DCC-A, idle and reserved packets.
+     * @see RCN-211, Section 3
+     */
+    static bool decodeAddress(const DCCMessage& msg, uint16_t& address, size_t& instruction);
+
+    /**
+     * @brief Decodes the address of a packet for accessory decoders.
+     * @param msg The DCC packet.
+     * @param[out] address The decoder address, as passed to `onAccessory`.
+     * @return True if the first byte is in the accessory range (128-191).
+     * @see RCN-213, 2.1
+     */
+    static bool decodeAccessoryAddress(const DCCMessage& msg, uint16_t& address);
+
+    /**
+     * @brief Checks whether a multi-function packet is an RCN-218 Data Space read.
+     * @details The reply to a Data Space read is channel-bundled, so it occupies
+     *          Channel 1 as well as Channel 2.
+     * @param msg The DCC packet.
+     * @param instruction The index of the instruction byte, from `decodeAddress`.
+     * @return True for `ADDR 0xED NNNN-SSSS`, with or without the XOR byte.
+     * @see RCN-218, 4.3
+     */
+    static bool isDataSpaceRead(const DCCMessage& msg, size_t instruction);
 };
 
 #endif // RAILCOM_DCC_PARSER_H
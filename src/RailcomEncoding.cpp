@@ -3,7 +3,6 @@
  * @brief Implementation of RailCom encoding, decoding, and CRC functions.
  */
 #include "RailcomEncoding.h"
-#include <map>
 
 namespace RailcomEncoding {
 
@@ -13,7 +12,7 @@ namespace RailcomEncoding {
  *          corresponding 8-bit encoded output value.
  * @see RCN-217, Table 2
  */
-const uint8_t ENCODE_TABLE[] = {
+constexpr uint8_t ENCODE_TABLE[] = {
     0x0F, 0x17, 0x1B, 0x1D, 0x1E, 0x27, 0x2B, 0x2D, 0x2E, 0x33, 0x35, 0x36,
     0x39, 0x3A, 0x3C, 0x47, 0x4B, 0x4D, 0x4E, 0x53, 0x55, 0x56, 0x59, 0x5A,
     0x5C, 0x63, 0x65, 0x66, 0x69, 0x6A, 0x6C, 0x71, 0x72, 0x74, 0x78, 0x87,
@@ -33,24 +32,19 @@ uint8_t encode4of8(uint8_t value) {
 }
 
 /**
- * @brief A reverse lookup table for decoding, generated at runtime.
+ * @brief A reverse lookup table for decoding, indexed by the received byte.
+ * @details Generated from ENCODE_TABLE at compile time, so it lives in flash
+ *          and needs neither initialisation nor memory at run time.
  */
-static std::map<uint8_t, int16_t> DECODE_TABLE;
-/**
- * @brief Flag to ensure the decode table is only initialized once.
- */
-static bool DECODE_TABLE_INITIALIZED = false;
+struct DecodeTable {
+    int8_t values[256]; ///< The 6-bit value (or ACK/NACK index) of each byte, -1 if invalid.
 
-/**
- * @brief Initializes the DECODE_TABLE by reversing the ENCODE_TABLE.
- */
-void initializeDecodeTable() {
-    if (DECODE_TABLE_INITIALIZED) return;
-    for (int i = 0; i < sizeof(ENCODE_TABLE); ++i) {
-        DECODE_TABLE[ENCODE_TABLE[i]] = i;
+    constexpr DecodeTable() : values() {
+        for (int i = 0; i < 256; ++i) values[i] = -1;
+        for (int i = 0; i < (int)sizeof(ENCODE_TABLE); ++i) values[ENCODE_TABLE[i]] = i;
     }
-    DECODE_TABLE_INITIALIZED = true;
-}
+};
+static constexpr DecodeTable DECODE_TABLE;
 
 /**
  * @brief Decodes an 8-bit value to a 6-bit value using the reverse lookup table.
@@ -58,14 +52,36 @@ void initializeDecodeTable() {
  * @return The 6-bit decoded value, or -1 if the input is invalid.
  */
 int16_t decode4of8(uint8_t value) {
-    if (!DECODE_TABLE_INITIALIZED) {
-        initializeDecodeTable();
+    return DECODE_TABLE.values[value];
+}
+
+/**
+ * @brief Lists the 6-bit values a received byte may have been sent as.
+ * @param value The received byte.
+ * @param[out] candidates Receives the candidates.
+ * @return The number of candidates.
+ */
+size_t softDecode4of8(uint8_t value, SymbolCandidate* candidates) {
+    int16_t decoded = decode4of8(value);
+    if (decoded >= 0) {
+        if (decoded > 0x3F) return 0; // ACK or NACK, not data.
+        candidates[0].value = decoded;
+        candidates[0].confidence = 100;
+        return 1;
     }
-    auto it = DECODE_TABLE.find(value);
-    if (it != DECODE_TABLE.end()) {
-        return it->second;
+
+    size_t count = 0;
+    for (uint8_t bit = 0; bit < 8; ++bit) {
+        // Only bytes of weight 3 or 5 have valid codes one bit away.
+        decoded = decode4of8(value ^ (1 << bit));
+        if (decoded >= 0 && decoded <= 0x3F) {
+            candidates[count++].value = decoded;
+        }
     }
-    return -1; // Not found
+    for (size_t i = 0; i < count; ++i) {
+        candidates[i].confidence = 100 / count;
+    }
+    return count;
 }
 
 /**
@@ -99,7 +115,23 @@ uint8_t crc8(const uint8_t* data, size_t len, uint8_t init) {
  * @param payloadBits The number of bits in the payload.
  * @return A vector of encoded bytes.
  */
+#if !RAILCOM_NO_HEAP
 std::vector<uint8_t> encodeDatagram(RailcomID id, uint64_t payload, uint8_t payloadBits) {
+    RailcomFrame frame;
+    encodeFrame(id, payload, payloadBits, frame);
+    return std::vector<uint8_t>(frame.bytes, frame.bytes + frame.len);
+}
+#endif
+
+/**
+ * @brief Encodes a full RailCom datagram into a fixed-size frame.
+ * @details Structure of the bitstream: [ID 4] [Payload] [Padding to a multiple of 6 bits].
+ * @param id The message's RailcomID.
+ * @param payload The message payload.
+ * @param payloadBits The number of bits in the payload.
+ * @param[out] frame The frame that receives the encoded bytes.
+ */
+void encodeFrame(RailcomID id, uint64_t payload, uint8_t payloadBits, RailcomFrame& frame) {
     uint8_t totalBits = 4 + payloadBits;
     // The total length of the datagram (ID + payload) must be a multiple of 6.
     // If not, it needs to be padded with zeros.
@@ -108,35 +140,108 @@ std::vector<uint8_t> encodeDatagram(RailcomID id, uint64_t payload, uint8_t payl
     }
     uint8_t paddingBits = totalBits - (4 + payloadBits);
     uint8_t numBytes = totalBits / 6;
+    if (numBytes > RAILCOM_MAX_DATAGRAM_BYTES) {
+        frame.len = 0;
+        return;
+    }
 
     // Combine the ID and payload into a single 64-bit integer.
     // Then shift left to add padding at the LSB (end of message).
-    // Structure: [ID] [Payload] [Padding]
     uint64_t data = ((uint64_t)static_cast<uint8_t>(id) << payloadBits) | payload;
     data <<= paddingBits;
 
-    std::vector<uint8_t> encodedBytes;
     int currentBit = totalBits - 6;
     for (int i = 0; i < numBytes; ++i) {
         // Extract the next 6-bit chunk from the combined data.
         uint8_t chunk = (data >> currentBit) & 0x3F;
-        encodedBytes.push_back(encode4of8(chunk));
+        frame.bytes[i] = encode4of8(chunk);
         currentBit -= 6;
     }
-    return encodedBytes;
+    frame.len = numBytes;
+}
+
+/**
+ * @brief Returns the number of 4-of-8 symbols needed for a byte stream.
+ * @param len The number of bytes.
+ * @return The number of symbols.
+ */
+size_t packedLength(size_t len) {
+    return (len * 8 + 5) / 6;
+}
+
+/**
+ * @brief Encodes a byte stream as a sequence of 4-of-8 symbols.
+ * @param data The bytes to encode.
+ * @param len The number of bytes.
+ * @param[out] out The encoded symbols.
+ * @return The number of symbols written.
+ */
+size_t encodeBytes(const uint8_t* data, size_t len, uint8_t* out) {
+    size_t count = 0;
+    uint16_t bits = 0;
+    uint8_t pending = 0; // Number of valid bits in `bits`.
+    for (size_t i = 0; i < len; ++i) {
+        bits = (bits << 8) | data[i];
+        pending += 8;
+        while (pending >= 6) {
+            pending -= 6;
+            out[count++] = encode4of8((bits >> pending) & 0x3F);
+        }
+    }
+    if (pending > 0) {
+        out[count++] = encode4of8((bits << (6 - pending)) & 0x3F);
+    }
+    return count;
+}
+
+/**
+ * @brief Decodes a sequence of 4-of-8 symbols back into bytes.
+ * @param symbols The received symbols.
+ * @param count The number of symbols.
+ * @param[out] out The decoded bytes.
+ * @return The number of complete bytes, or -1 if a symbol is invalid.
+ */
+int decodeBytes(const uint8_t* symbols, size_t count, uint8_t* out) {
+    int len = 0;
+    uint16_t bits = 0;
+    uint8_t pending = 0;
+    for (size_t i = 0; i < count; ++i) {
+        int16_t value = decode4of8(symbols[i]);
+        if (value < 0 || value > 0x3F) return -1; // Invalid code, ACK or NACK.
+        bits = (bits << 6) | value;
+        pending += 6;
+        if (pending >= 8) {
+            pending -= 8;
+            out[len++] = (bits >> pending) & 0xFF;
+        }
+    }
+    return len;
 }
 
 /**
  * @brief Encodes a Service Request (SRQ) message.
- * @details This is a helper function that constructs the 12-bit SRQ payload
- *          from the address and extended flag, then calls the main encodeDatagram function.
+ * @details This is a helper function that packs the 12-bit SRQ payload
+ *          from the address and extended flag as per `RailcomSchema::Srq`.
  * @param accessoryAddress The address of the accessory.
  * @param isExtended True if the address is an extended accessory address.
  * @return A vector of encoded bytes for the SRQ message.
  */
+#if !RAILCOM_NO_HEAP
 std::vector<uint8_t> encodeServiceRequest(uint16_t accessoryAddress, bool isExtended) {
-    uint16_t payload = (accessoryAddress & 0x7FF) | (isExtended ? 0x800 : 0x000);
-    return encodeDatagram(RailcomID::SRQ, payload, 12);
+    RailcomFrame frame;
+    encodeServiceRequest(accessoryAddress, isExtended, frame);
+    return std::vector<uint8_t>(frame.bytes, frame.bytes + frame.len);
+}
+#endif
+
+/**
+ * @brief Encodes a Service Request (SRQ) message into a frame.
+ * @param accessoryAddress The address of the accessory.
+ * @param isExtended True if the address is an extended accessory address.
+ * @param[out] frame The frame to fill.
+ */
+void encodeServiceRequest(uint16_t accessoryAddress, bool isExtended, RailcomFrame& frame) {
+    encodeMessage<RailcomSchema::Srq>(frame, isExtended, accessoryAddress);
 }
 
 }
@@ -10,8 +10,36 @@
 #define RAILCOM_ENCODING_H
 
 #include <Arduino.h>
-#include <vector>
 #include "Railcom.h"
+#include "RailcomArena.h"
+#include "RailcomProtocolDefs.h"
+#include "RailcomSchema.h"
+#if !RAILCOM_NO_HEAP
+#include <vector>
+#endif
+
+/**
+ * @struct RailcomFrame
+ * @brief A single datagram that has already been 4-of-8 encoded.
+ * @details Frames are built ahead of time (e.g., when a value changes) so that
+ *          the transmitter only has to copy bytes during the cutout.
+ */
+struct RailcomFrame {
+    uint8_t len = 0;                                ///< The number of valid encoded bytes.
+    uint8_t bytes[RAILCOM_MAX_DATAGRAM_BYTES] = {}; ///< The encoded bytes, ready for transmission.
+};
+
+/** @brief Maximum number of valid codes one bit away from a received byte. */
+constexpr uint8_t RAILCOM_SOFT_CANDIDATES = 5;
+
+/**
+ * @struct SymbolCandidate
+ * @brief A value a received 4-of-8 symbol may have been sent as.
+ */
+struct SymbolCandidate {
+    uint8_t value;      ///< The 6-bit value.
+    uint8_t confidence; ///< The probability of this value in percent.
+};
 
 /**
  * @namespace RailcomEncoding
@@ -37,6 +65,21 @@ namespace RailcomEncoding {
      */
     int16_t decode4of8(uint8_t value);
 
+    /**
+     * @brief Decodes a 4-of-8 symbol that may contain a single bit error.
+     * @details A valid code has exactly one candidate. A byte with three or five
+     *          bits set is one bit away from up to `RAILCOM_SOFT_CANDIDATES`
+     *          valid codes; as every bit is equally likely to flip, each gets the
+     *          same confidence. ACK, NACK and bytes two or more bits away from
+     *          any code have no candidates. The caller has to pick one using what
+     *          else it knows about the datagram.
+     * @param value The received byte.
+     * @param[out] candidates Receives the candidates; must hold `RAILCOM_SOFT_CANDIDATES` entries.
+     * @return The number of candidates.
+     * @see RCN-217, Chapter 3.3
+     */
+    size_t softDecode4of8(uint8_t value, SymbolCandidate* candidates);
+
     /**
      * @brief Calculates the CRC-8 checksum for a block of data.
      * @details This is used for error checking in RCN-218 Data Space messages.
@@ -59,8 +102,62 @@ namespace RailcomEncoding {
      * @param payload The message payload.
      * @param payloadBits The number of bits in the payload.
      * @return A vector of encoded bytes ready for transmission.
+     * @note Not available with `RAILCOM_NO_HEAP`; use `encodeFrame`.
      */
+#if !RAILCOM_NO_HEAP
     std::vector<uint8_t> encodeDatagram(RailcomID id, uint64_t payload, uint8_t payloadBits);
+#endif
+
+    /**
+     * @brief Encodes a datagram into a fixed-size frame without allocating.
+     * @details Produces the same bytes as `encodeDatagram`, but writes them into
+     *          a caller-owned `RailcomFrame` so the result can be cached.
+     * @param id The RailcomID of the message.
+     * @param payload The message payload.
+     * @param payloadBits The number of bits in the payload (at most 44).
+     * @param[out] frame The frame that receives the encoded bytes.
+     */
+    void encodeFrame(RailcomID id, uint64_t payload, uint8_t payloadBits, RailcomFrame& frame);
+
+    /**
+     * @brief Packs the fields of a message with its schema and encodes it into a frame.
+     * @tparam M The schema from RailcomSchema.h, e.g. `RailcomSchema::Info`.
+     * @param[out] frame The frame that receives the encoded bytes.
+     * @param values One value per field, in the order of `M::FIELDS`.
+     */
+    template <typename M, typename... V>
+    void encodeMessage(RailcomFrame& frame, V... values) {
+        encodeFrame(M::ID, RailcomSchema::pack<M>(values...), M::BITS, frame);
+    }
+
+    /**
+     * @brief Returns the number of 4-of-8 symbols needed for a byte stream.
+     * @param len The number of bytes.
+     * @return The number of symbols, i.e. `len * 8` bits rounded up to a multiple of 6.
+     */
+    size_t packedLength(size_t len);
+
+    /**
+     * @brief Encodes a byte stream as a sequence of 4-of-8 symbols.
+     * @details The bytes are concatenated MSB first, split into 6-bit chunks and
+     *          padded with zero bits, the same way `encodeFrame` packs a datagram.
+     *          This is used for Data Space blocks, whose bytes use all 8 bits.
+     * @param data The bytes to encode.
+     * @param len The number of bytes.
+     * @param[out] out The encoded symbols; must hold `packedLength(len)` bytes.
+     * @return The number of symbols written.
+     * @see RCN-218, 4.3
+     */
+    size_t encodeBytes(const uint8_t* data, size_t len, uint8_t* out);
+
+    /**
+     * @brief Decodes a sequence of 4-of-8 symbols back into bytes.
+     * @param symbols The received symbols.
+     * @param count The number of symbols.
+     * @param[out] out The decoded bytes; must hold `count * 6 / 8` bytes.
+     * @return The number of complete bytes, or -1 if a symbol is not a valid 4-of-8 code.
+     */
+    int decodeBytes(const uint8_t* symbols, size_t count, uint8_t* out);
 
     /**
      * @brief Constructs a specially formatted Service Request (SRQ) message.
@@ -69,9 +166,22 @@ namespace RailcomEncoding {
      * @param accessoryAddress The address of the accessory requesting service.
      * @param isExtended True if the address is an extended accessory address.
      * @return A vector of encoded bytes for the SRQ message.
+     * @note Not available with `RAILCOM_NO_HEAP`; use the `RailcomFrame` overload.
      * @see RCN-217, 5.2.12
      */
+#if !RAILCOM_NO_HEAP
     std::vector<uint8_t> encodeServiceRequest(uint16_t accessoryAddress, bool isExtended);
+#endif
+
+    /**
+     * @brief Encodes a Service Request (SRQ) message into a RailcomFrame.
+     * @details Produces the same bytes as `encodeServiceRequest`, without allocating.
+     * @param accessoryAddress The address of the accessory requesting service.
+     * @param isExtended True if the address is an extended accessory address.
+     * @param[out] frame The frame to fill.
+     * @see RCN-217, 5.2.12
+     */
+    void encodeServiceRequest(uint16_t accessoryAddress, bool isExtended, RailcomFrame& frame);
 }
 
 #endif // RAILCOM_ENCODING_H
@@ -27,6 +27,18 @@ constexpr uint32_t UART_RAILCOM_BAUDRATE = 250000;
 ///@{
 /** @brief The mandatory delay between the end of Channel 1 and the start of Channel 2. @see RCN-217, 4.2 */
 constexpr uint32_t RAILCOM_CH2_DELAY_US = 193;
+/** @brief Idle time on the line after which the reply of a cutout is complete (32 bit times at 250 kBaud). */
+constexpr uint32_t RAILCOM_RX_IDLE_US = 128;
+///@}
+
+/** @name Datagrams */
+///@{
+/** @brief The maximum number of 4-of-8 encoded bytes in a single datagram (4-bit ID + 44-bit payload). @see RCN-218, 4.3 */
+constexpr uint8_t RAILCOM_MAX_DATAGRAM_BYTES = 8;
+/** @brief The number of encoded bytes that fit into the Channel 1 window. @see RCN-217, 4.2 */
+constexpr uint8_t RAILCOM_CH1_BYTES = 2;
+/** @brief The number of encoded bytes that fit into the Channel 2 window. @see RCN-217, 4.2 */
+constexpr uint8_t RAILCOM_CH2_BYTES = 6;
 ///@}
 
 /** @name Address Ranges */
@@ -35,6 +47,8 @@ constexpr uint32_t RAILCOM_CH2_DELAY_US = 193;
 constexpr uint16_t MIN_SHORT_ADDRESS = 1;
 /** @brief The maximum valid short address for a DCC decoder. */
 constexpr uint16_t MAX_SHORT_ADDRESS = 127;
+/** @brief The maximum valid long address for a DCC decoder. */
+constexpr uint16_t MAX_LONG_ADDRESS = 10239;
 /** @brief The maximum valid address for an accessory decoder. */
 constexpr uint16_t MAX_ACCESSORY_ADDRESS = 2047;
 ///@}
@@ -53,8 +67,24 @@ constexpr uint8_t MAX_RERAIL_SECONDS = 255;
 
 /** @name Data Space */
 ///@{
-/** @brief The bitmask to extract the length from the header of a Data Space message. @see RCN-218, 5.2 */
-constexpr uint8_t DATASPACE_LEN_MASK = 0x1F;
+/** @brief The bitmask to extract the number of data bytes from the header of a Data Space block. @see RCN-218, 5.2 */
+constexpr uint8_t DATASPACE_LEN_MASK = 0x07;
+/** @brief Header bit that marks the last block of a Data Space reply. */
+constexpr uint8_t DATASPACE_LAST_BLOCK = 0x08;
+/** @brief Position of the block sequence number in the header of a Data Space block. */
+constexpr uint8_t DATASPACE_SEQ_SHIFT = 4;
+/**
+ * @brief Number of sequence numbers the blocks after the first one cycle through.
+ * @details The first block of a reply has the sequence number 0, the following
+ *          blocks 1 to `DATASPACE_SEQ_CYCLE`, over and over.
+ */
+constexpr uint8_t DATASPACE_SEQ_CYCLE = 15;
+/** @brief Data bytes per Data Space block; with header and CRC it fills the 8 bytes of a cutout. @see RCN-218, 4.3 */
+constexpr uint8_t DATA_SPACE_CHUNK_SIZE = 4;
+/** @brief Largest byte offset the 4-bit start field of a Data Space read can select. @see RCN-218, 4.3 */
+constexpr uint8_t DATA_SPACE_MAX_START = 15;
+/** @brief Largest number of bytes a Data Space reply can carry. */
+constexpr uint16_t DATA_SPACE_MAX_SIZE = 512;
 ///@}
 
 #endif // RAILCOM_PROTOCOL_DEFS_H
@@ -4,6 +4,8 @@
  */
 #include "RailcomRx.h"
 #include "RailcomEncoding.h"
+#include "RailcomProtocolDefs.h"
+#include "RailcomSchema.h"
 #include <cstring>
 #include "pico/stdlib.h"
 
@@ -12,7 +14,9 @@
  * @param hardware A pointer to a RailcomHardware implementation.
  */
 RailcomRx::RailcomRx(RailcomRxHardware* hardware)
-    : _hardware(hardware) {}
+    : _hardware(hardware) {
+    _lastRawBytes.reserve(RAILCOM_RX_MAX_BYTES);
+}
 
 /**
  * @brief Initializes the hardware for reception.
@@ -30,23 +34,22 @@ void RailcomRx::task() {
 }
 
 /**
- * @brief Reads a sequence of raw bytes from the hardware.
- * @details This is a private helper function that reads all available bytes from
- *          the hardware buffer until it's empty, or until the timeout is reached.
+ * @brief Reads the raw bytes of one cutout from the hardware.
+ * @details This is a private helper function that waits for the hardware to
+ *          report a complete reply and then fetches it with a single
+ *          `readBlock()` call. The buffer keeps the capacity reserved in the
+ *          constructor, so no memory is allocated.
  * @param[out] buffer The vector to store the read bytes.
  * @param timeout_ms The maximum time to wait for data.
  * @return True if at least one byte was read, false otherwise.
  */
 bool RailcomRx::read_raw_bytes(std::vector<uint8_t>& buffer, uint timeout_ms) {
     buffer.clear();
-    uint32_t start = millis();
-    while (millis() - start < timeout_ms) {
-        if (_hardware->available()) {
-            buffer.push_back(_hardware->read());
-        } else if (!buffer.empty()) {
-            return true;
-        }
+    if (!_hardware->waitForFrame(timeout_ms)) {
+        return false;
     }
+    buffer.resize(RAILCOM_RX_MAX_BYTES);
+    buffer.resize(_hardware->readBlock(buffer.data(), buffer.size()));
     return !buffer.empty();
 }
 
@@ -63,6 +66,8 @@ void RailcomRx::setContext(DecoderContext context) {
  * @param dataSpaceNum The expected data space number, used for CRC validation.
  */
 void RailcomRx::expectDataSpaceResponse(uint8_t dataSpaceNum) {
+    // The reply comes with the next cutout.
+    _datagramCount = 0;
     _is_data_space_expected = true;
     _expected_data_space_num = dataSpaceNum;
 }
@@ -73,62 +78,426 @@ void RailcomRx::expectDataSpaceResponse(uint8_t dataSpaceNum) {
  *          cases:
  *          1. If `expectDataSpaceResponse` was called, it uses a special parsing
  *             logic for RCN-218 Data Space messages.
- *          2. Otherwise, it uses the general `parseMessage` function for all
- *             standard RCN-217 and RCN-218 messages.
- *          The returned pointer is managed internally and will be deleted on the
- *          next call to `read()`.
+ *          2. Otherwise, it splits the bytes into datagrams and parses the
+ *             first with `parseMessage`. The others are returned by the
+ *             following calls, as long as no new bytes have arrived.
+ *          Every cutout with data is counted in the statistics, whether it
+ *          yields a message or not.
+ *          The returned message lives in the receiver's arena and is
+ *          overwritten by the next call to `read()`; nothing is allocated.
  * @return A pointer to a parsed RailcomMessage, or nullptr if no valid message is received.
  */
 RailcomMessage* RailcomRx::read() {
     // Clear previous message
-    if (_lastMessage != nullptr) {
-        delete _lastMessage;
-        _lastMessage = nullptr;
+    _lastMessage = nullptr;
+    _arena.reset();
+
+    // The further datagrams of the last cutout, unless the next one has arrived.
+    if (_nextDatagram < _datagramCount && _hardware->available() <= 0) {
+        uint32_t sequence = _statsSequence.load(std::memory_order_relaxed);
+        _statsSequence.store(sequence + 1, std::memory_order_relaxed);
+        std::atomic_thread_fence(std::memory_order_release);
+        _lastMessage = parseNextDatagram();
+        if (_lastMessage != nullptr) _stats.messages++;
+        _statsSequence.store(sequence + 2, std::memory_order_release);
+        return _lastMessage;
     }
+    _datagramCount = 0;
+    _nextDatagram = 0;
     _lastRawBytes.clear();
+    _lastClass = RailcomCutoutClass::EMPTY;
+    // The expectation only applies to this cutout, even if it stays empty.
+    bool data_space_expected = _is_data_space_expected;
+    _is_data_space_expected = false;
 
-    if (read_raw_bytes(_lastRawBytes, 50)) {
-        if (_is_data_space_expected) {
-            _is_data_space_expected = false; // Consume the expectation
-            // Data Space messages have no ID, they are raw byte streams.
-            // The first byte is the length.
-            if (_lastRawBytes.empty()) return nullptr;
+    if (!read_raw_bytes(_lastRawBytes, 50)) {
+        return nullptr;
+    }
 
-            std::vector<uint8_t> decoded_payload;
-            for (uint8_t byte : _lastRawBytes) {
-                decoded_payload.push_back(RailcomEncoding::decode4of8(byte));
-            }
+    // Mark the counters as being updated, see snapshotStats().
+    uint32_t sequence = _statsSequence.load(std::memory_order_relaxed);
+    _statsSequence.store(sequence + 1, std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_release);
+
+    _stats.frames++;
+    _stats.bytes += _lastRawBytes.size();
+    for (uint8_t byte : _lastRawBytes) {
+        if (RailcomEncoding::decode4of8(byte) < 0) _stats.invalidCodes++;
+    }
+    _lastClass = classify(_lastRawBytes.data(), _lastRawBytes.size());
+    switch (_lastClass) {
+        case RailcomCutoutClass::COLLISION: _stats.collisions++; break;
+        case RailcomCutoutClass::NOISE:     _stats.noise++; break;
+        case RailcomCutoutClass::TRUNCATED: _stats.truncated++; break;
+        default: break;
+    }
+    updateScores(_lastClass);
+    if (_softDecoding &&
+        (_lastClass == RailcomCutoutClass::NOISE || _lastClass == RailcomCutoutClass::TRUNCATED) &&
+        correctSymbol(data_space_expected)) {
+        _stats.corrected++;
+    }
+    if (ackReceived()) _stats.acks++;
+    if (_lastRawBytes.size() >= 2 && _lastRawBytes[0] == RAILCOM_NACK && _lastRawBytes[1] == RAILCOM_NACK) {
+        _stats.nacks++;
+    }
+    if (_hardware->overrunOccurred() ||
+        (_lastRawBytes.size() == RAILCOM_RX_MAX_BYTES && _hardware->available() > 0)) {
+        _stats.overruns++;
+    }
 
-            if (decoded_payload.empty()) return nullptr;
+    if (data_space_expected) {
+        _lastMessage = parseDataSpace();
+    } else {
+        _datagramCount = splitDatagrams(_lastRawBytes.data(), _lastRawBytes.size(), _datagramEnds);
+        // Bytes that cannot be split are parsed as one datagram, which counts the error.
+        _lastMessage = _datagramCount > 0 ? parseNextDatagram()
+                                          : parseMessage(_lastRawBytes.data(), _lastRawBytes.size());
+    }
+    if (_lastMessage != nullptr) _stats.messages++;
+
+    _statsSequence.store(sequence + 2, std::memory_order_release);
+    return _lastMessage;
+}
 
-            uint8_t len = decoded_payload[0];
-            if (len > MAX_DATA_SPACE_PAYLOAD || decoded_payload.size() != (size_t)len + 2) {
-                // Invalid length or size mismatch
-                return nullptr;
+/**
+ * @brief Parses the last raw bytes as a Data Space message.
+ * @details Data Space messages have no ID, they are a packed byte stream whose
+ *          first byte is the block header (length, sequence number and
+ *          last-block flag) and whose last byte is the CRC. A message
+ *          with a wrong CRC is returned with `crc_ok` cleared.
+ * @return A pointer to a new DataSpaceMessage, or nullptr if the bytes are no Data Space message.
+ */
+RailcomMessage* RailcomRx::parseDataSpace() {
+    uint8_t decoded_payload[MAX_DATA_SPACE_PAYLOAD + 3];
+    if (RailcomEncoding::packedLength(sizeof(decoded_payload)) < _lastRawBytes.size()) {
+        _stats.lengthErrors++;
+        return nullptr;
+    }
+    int decoded = RailcomEncoding::decodeBytes(_lastRawBytes.data(), _lastRawBytes.size(), decoded_payload);
+    if (decoded < 0) return nullptr; // Invalid codes, counted by read().
+    if (decoded < 2) {
+        _stats.lengthErrors++;
+        return nullptr;
+    }
+
+    uint8_t header = decoded_payload[0];
+    uint8_t len = header & DATASPACE_LEN_MASK;
+    if (len > MAX_DATA_SPACE_PAYLOAD || _lastRawBytes.size() != RailcomEncoding::packedLength(len + 2)) {
+        // Invalid length or size mismatch
+        _stats.lengthErrors++;
+        return nullptr;
+    }
+
+    DataSpaceMessage* msg = newMessage<DataSpaceMessage>();
+    msg->id = (RailcomID) -1; // Special ID for data space
+    msg->len = len;
+    memcpy(msg->data, decoded_payload + 1, len);
+    msg->crc = decoded_payload[len + 1];
+    msg->dataSpaceNum = _expected_data_space_num;
+    msg->sequence = header >> DATASPACE_SEQ_SHIFT;
+    msg->last = (header & DATASPACE_LAST_BLOCK) != 0;
+
+    // Verify CRC over the header and the data
+    uint8_t calculated_crc = RailcomEncoding::crc8(decoded_payload, len + 1, msg->dataSpaceNum);
+    msg->crc_ok = (calculated_crc == msg->crc);
+
+    _stats.dataSpace++;
+    if (!msg->crc_ok) _stats.crcFailures++;
+    return msg;
+}
+
+/**
+ * @brief Enables or disables the correction of single bit errors.
+ * @param enabled True to enable soft decoding.
+ */
+void RailcomRx::setSoftDecoding(bool enabled) {
+    _softDecoding = enabled;
+}
+
+/**
+ * @brief The datagram lengths each ID is sent with, as a bitmap of symbol counts.
+ * @details Bit n is set if a datagram with the ID can consist of n 4-of-8 symbols.
+ * @see RCN-217, 5.2 and RCN-218, 4
+ */
+static const uint16_t DATAGRAM_SYMBOLS[16] = {
+    1 << 2,          // POM
+    1 << 2,          // ADR_HIGH
+    1 << 2,          // ADR_LOW
+    1 << 2 | 1 << 3, // STAT4 and INFO1, EXT
+    1 << 2 | 1 << 6, // STAT1, INFO
+    1 << 2,          // TIME
+    1 << 2,          // ERROR
+    1 << 3,          // DYN
+    1 << 2 | 1 << 6, // STAT2, XPOM_0
+    1 << 6,          // XPOM_1
+    1 << 6,          // XPOM_2
+    1 << 6,          // XPOM_3
+    1 << 6,          // CV_AUTO
+    1 << 6 | 1 << 8, // BLOCK, DECODER_STATE
+    1 << 2 | 1 << 3, // RERAIL, SRQ
+    1 << 8           // DECODER_UNIQUE
+};
+
+/**
+ * @brief Splits the bytes of one cutout into datagrams.
+ * @details `splittable[p]` tells whether the bytes from p on can be split into
+ *          datagrams; it is filled from the end, so each choice below is
+ *          checked in constant time.
+ * @param bytes The raw bytes, Channel 1 first.
+ * @param len The number of bytes.
+ * @param[out] ends Receives the end offset of each datagram.
+ * @return The number of datagrams, or 0 if the bytes cannot be split.
+ */
+size_t RailcomRx::splitDatagrams(const uint8_t* bytes, size_t len, uint8_t* ends) {
+    if (len == 0 || len > RAILCOM_RX_MAX_BYTES) return 0;
+
+    uint16_t lengths[RAILCOM_RX_MAX_BYTES]; // The DATAGRAM_SYMBOLS of a datagram starting here.
+    for (size_t p = 0; p < len; ++p) {
+        int16_t symbol = RailcomEncoding::decode4of8(bytes[p]);
+        // Invalid codes and ACK or NACK carry no data bits.
+        if (symbol < 0 || symbol > 0x3F) return 0;
+        lengths[p] = DATAGRAM_SYMBOLS[symbol >> 2];
+    }
+
+    bool splittable[RAILCOM_RX_MAX_BYTES + 1];
+    splittable[len] = true;
+    for (size_t p = len; p-- > 0;) {
+        splittable[p] = false;
+        for (size_t n = 2; n <= RAILCOM_MAX_DATAGRAM_BYTES && p + n <= len; ++n) {
+            if ((lengths[p] & (1 << n)) && splittable[p + n]) {
+                splittable[p] = true;
+                break;
             }
+        }
+    }
+    if (!splittable[0]) return 0;
 
-            DataSpaceMessage* msg = new DataSpaceMessage();
-            msg->id = (RailcomID) -1; // Special ID for data space
-            msg->len = len;
-            memcpy(msg->data, decoded_payload.data() + 1, len);
-            msg->crc = decoded_payload.back();
-            msg->dataSpaceNum = _expected_data_space_num;
-
-            // Verify CRC
-            uint8_t crc_buffer[MAX_DATA_SPACE_PAYLOAD + 1];
-            crc_buffer[0] = len;
-            memcpy(crc_buffer + 1, msg->data, len);
-            uint8_t calculated_crc = RailcomEncoding::crc8(crc_buffer, len + 1, msg->dataSpaceNum);
-            msg->crc_ok = (calculated_crc == msg->crc);
-
-            _lastMessage = msg;
-            return msg;
+    size_t count = 0;
+    size_t p = 0;
+    while (p < len) {
+        size_t n;
+        if (p == 0 && len <= RAILCOM_MAX_DATAGRAM_BYTES && (lengths[0] & (1 << len))) {
+            n = len; // A single datagram, possibly across both channels.
+        } else if (p == 0 && (lengths[0] & (1 << RAILCOM_CH1_BYTES)) && splittable[RAILCOM_CH1_BYTES]) {
+            n = RAILCOM_CH1_BYTES; // The Channel 1 datagram.
         } else {
-            _lastMessage = parseMessage(_lastRawBytes);
-            return _lastMessage;
+            n = RAILCOM_MAX_DATAGRAM_BYTES;
+            while (p + n > len || !(lengths[p] & (1 << n)) || !splittable[p + n]) n--;
+        }
+        p += n;
+        ends[count++] = (uint8_t)p;
+    }
+    return count;
+}
+
+/**
+ * @brief Parses the next datagram of the last cutout.
+ * @return A pointer to the message, or nullptr.
+ */
+RailcomMessage* RailcomRx::parseNextDatagram() {
+    size_t start = _nextDatagram > 0 ? _datagramEnds[_nextDatagram - 1] : 0;
+    size_t end = _datagramEnds[_nextDatagram++];
+    return parseMessage(_lastRawBytes.data() + start, end - start);
+}
+
+/**
+ * @brief Corrects the only invalid code of the last cutout if the correction is unique.
+ * @details Tries every candidate of `RailcomEncoding::softDecode4of8()` in
+ *          place and keeps the one that makes the bytes plausible. The bytes are
+ *          left unchanged if there is more than one invalid code, or no or more
+ *          than one plausible candidate.
+ * @param dataSpace True if the cutout is expected to hold a Data Space message.
+ * @return True if the raw bytes were corrected.
+ */
+bool RailcomRx::correctSymbol(bool dataSpace) {
+    size_t position = _lastRawBytes.size();
+    for (size_t i = 0; i < _lastRawBytes.size(); ++i) {
+        if (RailcomEncoding::decode4of8(_lastRawBytes[i]) < 0) {
+            if (position != _lastRawBytes.size()) return false; // More than one error.
+            position = i;
         }
     }
-    return nullptr;
+    if (position == _lastRawBytes.size()) return false;
+
+    SymbolCandidate candidates[RAILCOM_SOFT_CANDIDATES];
+    size_t count = RailcomEncoding::softDecode4of8(_lastRawBytes[position], candidates);
+    uint8_t received = _lastRawBytes[position];
+    uint8_t accepted = received;
+    for (size_t i = 0; i < count; ++i) {
+        _lastRawBytes[position] = RailcomEncoding::encode4of8(candidates[i].value);
+        if (!isPlausible(dataSpace)) continue;
+        if (accepted != received) {
+            // Ambiguous: the datagram gives no way to choose.
+            _lastRawBytes[position] = received;
+            return false;
+        }
+        accepted = _lastRawBytes[position];
+    }
+    _lastRawBytes[position] = accepted;
+    return accepted != received;
+}
+
+/**
+ * @brief Checks the last raw bytes against what the datagrams of a cutout can look like.
+ * @param dataSpace True if the cutout is expected to hold a Data Space message.
+ * @return True if the bytes are plausible.
+ */
+bool RailcomRx::isPlausible(bool dataSpace) const {
+    size_t count = _lastRawBytes.size();
+    if (dataSpace) {
+        uint8_t decoded[MAX_DATA_SPACE_PAYLOAD + 3];
+        if (RailcomEncoding::packedLength(sizeof(decoded)) < count) return false;
+        int len = RailcomEncoding::decodeBytes(_lastRawBytes.data(), count, decoded);
+        if (len < 2) return false;
+        uint8_t dataLen = decoded[0] & DATASPACE_LEN_MASK;
+        if (count != RailcomEncoding::packedLength(dataLen + 2)) return false;
+        return RailcomEncoding::crc8(decoded, dataLen + 1, _expected_data_space_num) == decoded[dataLen + 1];
+    }
+
+    uint8_t ends[RAILCOM_RX_MAX_DATAGRAMS];
+    return splitDatagrams(_lastRawBytes.data(), count, ends) > 0;
+}
+
+/**
+ * @brief Copies the reception statistics since the last reset.
+ * @param[out] stats Receives the counters.
+ * @return False if no consistent copy could be made.
+ */
+bool RailcomRx::snapshotStats(RailcomRxStats& stats) const {
+    RailcomRxStats current;
+    if (!copyStats(current)) return false;
+
+    const uint32_t* now = reinterpret_cast<const uint32_t*>(&current);
+    const uint32_t* base = reinterpret_cast<const uint32_t*>(&_statsBaseline);
+    uint32_t* out = reinterpret_cast<uint32_t*>(&stats);
+    for (size_t i = 0; i < sizeof(RailcomRxStats) / sizeof(uint32_t); ++i) {
+        out[i] = now[i] - base[i];
+    }
+    return true;
+}
+
+/**
+ * @brief Restarts the statistics by taking the current counters as the baseline.
+ */
+void RailcomRx::resetStats() {
+    RailcomRxStats current;
+    if (copyStats(current)) {
+        _statsBaseline = current;
+    }
+}
+
+/**
+ * @brief Copies the counters while no update is in progress.
+ * @details A sequence lock: the copy is valid if the sequence number was even
+ *          before and unchanged after it. A few attempts suffice, as `read()`
+ *          updates the counters once per cutout.
+ * @param[out] stats Receives the counters.
+ * @return False if every attempt overlapped an update.
+ */
+bool RailcomRx::copyStats(RailcomRxStats& stats) const {
+    for (uint8_t attempt = 0; attempt < 4; ++attempt) {
+        uint32_t before = _statsSequence.load(std::memory_order_acquire);
+        if (before & 1) continue;
+        memcpy(&stats, &_stats, sizeof(stats));
+        std::atomic_thread_fence(std::memory_order_acquire);
+        if (_statsSequence.load(std::memory_order_relaxed) == before) {
+            return true;
+        }
+    }
+    return false;
+}
+
+/**
+ * @brief Checks whether the last read shows that several decoders answered at once.
+ * @return True if the last read contained an invalid 4-of-8 code or a NACK.
+ */
+bool RailcomRx::collisionDetected() const {
+    if (_lastRawBytes.size() >= 2 && _lastRawBytes[0] == RAILCOM_NACK && _lastRawBytes[1] == RAILCOM_NACK) {
+        return true;
+    }
+    for (uint8_t byte : _lastRawBytes) {
+        if (RailcomEncoding::decode4of8(byte) < 0) return true;
+    }
+    return false;
+}
+
+/**
+ * @brief Returns the classification of the last read.
+ */
+RailcomCutoutClass RailcomRx::cutoutClass() const {
+    return _lastClass;
+}
+
+/**
+ * @brief Classifies the bytes of one cutout by the invalid codes in it.
+ * @param bytes The raw bytes, Channel 1 first.
+ * @param len The number of bytes.
+ * @return The class of the cutout.
+ */
+RailcomCutoutClass RailcomRx::classify(const uint8_t* bytes, size_t len) {
+    if (len == 0) return RailcomCutoutClass::EMPTY;
+
+    bool collision = false;
+    bool noise = false;
+    bool truncated = (len == 1); // A datagram has at least two symbols.
+    for (size_t i = 0; i < len; ++i) {
+        int weight = __builtin_popcount(bytes[i]);
+        if (weight == 4) continue; // All 70 bytes of weight 4 are valid codes.
+        if (weight <= 2 || (weight == 3 && i < RAILCOM_CH1_BYTES)) {
+            // Two lost bits are unlikely to be noise; in Channel 1 all
+            // decoders answer, so even one lost bit is most likely an overlap.
+            collision = true;
+        } else if (weight > 4 && i == len - 1) {
+            truncated = true;
+        } else {
+            noise = true;
+        }
+    }
+    if (collision) return RailcomCutoutClass::COLLISION;
+    if (noise) return RailcomCutoutClass::NOISE;
+    if (truncated) return RailcomCutoutClass::TRUNCATED;
+    return RailcomCutoutClass::CLEAN;
+}
+
+/**
+ * @brief Returns the signal quality of this section.
+ */
+uint8_t RailcomRx::quality() const {
+    return (_quality.load(std::memory_order_relaxed) + 128) >> 8;
+}
+
+/**
+ * @brief Returns how often several decoders answer at once in this section.
+ */
+uint8_t RailcomRx::collisionLevel() const {
+    return (_collisionLevel.load(std::memory_order_relaxed) + 128) >> 8;
+}
+
+/**
+ * @brief Moves the quality scores towards the result of a cutout.
+ * @details Exponential moving averages in 1/256 percent. The collision level
+ *          follows every cutout with data; the quality only those without a
+ *          collision.
+ * @param cutout The class of the cutout.
+ */
+void RailcomRx::updateScores(RailcomCutoutClass cutout) {
+    int32_t level = _collisionLevel.load(std::memory_order_relaxed);
+    int32_t target = (cutout == RailcomCutoutClass::COLLISION) ? (100 << 8) : 0;
+    _collisionLevel.store(level + ((target - level) >> RAILCOM_RX_QUALITY_SHIFT), std::memory_order_relaxed);
+    if (cutout == RailcomCutoutClass::COLLISION) return;
+
+    int32_t quality = _quality.load(std::memory_order_relaxed);
+    target = (cutout == RailcomCutoutClass::CLEAN) ? (100 << 8) : 0;
+    _quality.store(quality + ((target - quality) >> RAILCOM_RX_QUALITY_SHIFT), std::memory_order_relaxed);
+}
+
+/**
+ * @brief Checks whether the last read received an ACK.
+ * @return True if the last read started with the ACK signal.
+ */
+bool RailcomRx::ackReceived() const {
+    return _lastRawBytes.size() >= 2 && _lastRawBytes[0] == RAILCOM_ACK1 && _lastRawBytes[1] == RAILCOM_ACK2;
 }
 
 /**
@@ -281,60 +650,78 @@ void RailcomRx::print(Print& stream) {
 }
 
 /**
- * @brief Parses a vector of raw bytes into a specific RailcomMessage struct.
+ * @brief Parses the raw bytes of one datagram into a specific RailcomMessage struct.
  * @details This is the core parsing logic. It performs the following steps:
  *          1. Decodes the 4-of-8 encoded bytes into a single 64-bit integer.
  *          2. Extracts the 4-bit message ID from the start of the data.
  *          3. Extracts the payload.
- *          4. Uses a switch statement on the ID to create the appropriate message
- *             struct and populate it with the payload data.
- *          It handles messages with variable lengths and ambiguous IDs by checking
- *          the total bit count and the current decoder context.
- * @param buffer A constant reference to the vector of raw bytes to parse.
- * @return A pointer to a newly allocated message struct, or nullptr if parsing fails.
+ *          4. Hands ID and payload to `parsePayload()`, which creates the
+ *             appropriate message struct.
+ * @param bytes The raw bytes to parse.
+ * @param len The number of bytes.
+ * @return A pointer to a message in the arena, or nullptr if parsing fails.
  */
-RailcomMessage* RailcomRx::parseMessage(const std::vector<uint8_t>& buffer) {
+RailcomMessage* RailcomRx::parseMessage(const uint8_t* bytes, size_t len) {
     uint64_t decodedData = 0;
     int bitCount = 0;
-    for (uint8_t byte : buffer) {
-        int16_t decodedChunk = RailcomEncoding::decode4of8(byte);
-        if (decodedChunk == -1) return nullptr; // Invalid encoding
+    for (size_t i = 0; i < len; ++i) {
+        int16_t decodedChunk = RailcomEncoding::decode4of8(bytes[i]);
+        // Invalid codes and ACK or NACK carry no data bits.
+        if (decodedChunk < 0 || decodedChunk > 0x3F) return nullptr;
         decodedData = (decodedData << 6) | decodedChunk;
         bitCount += 6;
     }
 
-    if (bitCount < 4) return nullptr;
+    if (bitCount < 4 || bitCount > 64) {
+        _stats.lengthErrors++;
+        return nullptr;
+    }
 
     RailcomID id = static_cast<RailcomID>((decodedData >> (bitCount - 4)) & 0x0F);
     uint64_t payload = decodedData & ((1ULL << (bitCount - 4)) - 1);
+    RailcomMessage* msg = parsePayload(id, payload, bitCount);
+    if (msg != nullptr) _stats.perId[static_cast<uint8_t>(id)]++;
+    return msg;
+}
 
+/**
+ * @brief Creates the message struct for a decoded datagram.
+ * @details Uses a switch statement on the ID to create the appropriate message
+ *          struct and populate it with the payload data. Ambiguous IDs are
+ *          resolved by the total bit count and the current decoder context.
+ * @param id The 4-bit ID of the datagram.
+ * @param payload The bits following the ID.
+ * @param bitCount The number of bits in the datagram, including the ID.
+ * @return A pointer to a message in the arena, or nullptr if the datagram is not understood.
+ */
+RailcomMessage* RailcomRx::parsePayload(RailcomID id, uint64_t payload, int bitCount) {
+    using namespace RailcomSchema;
+    int payloadBits = bitCount - 4;
     switch (id) {
         case RailcomID::POM: { // RCN-217, 5.2.1
-            PomMessage* msg = new PomMessage();
+            PomMessage* msg = newMessage<PomMessage>();
             msg->id = id;
-            msg->cvValue = payload;
+            msg->cvValue = get<Pom, Pom::CV_VALUE>(unpad<Pom>(payload, payloadBits));
             return msg;
         }
         case RailcomID::ADR_HIGH: { // RCN-217, 5.2.2
-            AdrMessage* msg = new AdrMessage();
+            AdrMessage* msg = newMessage<AdrMessage>();
             msg->id = id;
-            // Per RCN-217 for long addresses, the address is in the lower 6 bits.
-            // LSB Padding means we have [Payload 6] [Pad 2]. Shift out padding.
-            msg->address = (payload >> 2) & 0x3F;
+            msg->address = get<AdrHigh, AdrHigh::ADDRESS>(unpad<AdrHigh>(payload, payloadBits));
             return msg;
         }
         case RailcomID::ADR_LOW: { // RCN-217, 5.2.3
-            AdrMessage* msg = new AdrMessage();
+            AdrMessage* msg = newMessage<AdrMessage>();
             msg->id = id;
-            // The low part of a long address is the full 8-bit payload.
-            msg->address = payload;
+            msg->address = get<AdrLow, AdrLow::ADDRESS>(unpad<AdrLow>(payload, payloadBits));
             return msg;
         }
         case RailcomID::DYN: { // RCN-217, 5.2.8
-            DynMessage* msg = new DynMessage();
+            DynMessage* msg = newMessage<DynMessage>();
             msg->id = id;
-            msg->subIndex = payload & 0x3F;
-            msg->value = (payload >> 6) & 0xFF;
+            uint64_t fields = unpad<Dyn>(payload, payloadBits);
+            msg->subIndex = get<Dyn, Dyn::SUB_INDEX>(fields);
+            msg->value = get<Dyn, Dyn::VALUE>(fields);
             return msg;
         }
         case RailcomID::XPOM_0: // RCN-217, 5.2.9
@@ -342,124 +729,132 @@ RailcomMessage* RailcomRx::parseMessage(const std::vector<uint8_t>& buffer) {
         case RailcomID::XPOM_2:
         case RailcomID::XPOM_3: {
             if (bitCount == 36) { // XPOM message has 32 payload bits
-                XpomMessage* msg = new XpomMessage();
+                XpomMessage* msg = newMessage<XpomMessage>();
                 msg->id = id;
                 msg->sequence = static_cast<uint8_t>(id) - static_cast<uint8_t>(RailcomID::XPOM_0);
-                msg->cvValues[0] = (payload >> 24) & 0xFF;
-                msg->cvValues[1] = (payload >> 16) & 0xFF;
-                msg->cvValues[2] = (payload >> 8) & 0xFF;
-                msg->cvValues[3] = payload & 0xFF;
+                msg->cvValues[0] = get<Xpom, Xpom::CV_VALUE_0>(payload);
+                msg->cvValues[1] = get<Xpom, Xpom::CV_VALUE_1>(payload);
+                msg->cvValues[2] = get<Xpom, Xpom::CV_VALUE_2>(payload);
+                msg->cvValues[3] = get<Xpom, Xpom::CV_VALUE_3>(payload);
                 return msg;
             } else { // STAT2 message (RCN-217, 5.2.9) has 8 payload bits
-                Stat2Message* msg = new Stat2Message();
+                Stat2Message* msg = newMessage<Stat2Message>();
                 msg->id = RailcomID::STAT2;
-                msg->status = payload;
+                msg->status = get<Stat2, Stat2::STATUS>(unpad<Stat2>(payload, payloadBits));
                 return msg;
             }
         }
         case RailcomID::INFO: { // RCN-217, 5.2.5
             if (bitCount == 36 && _context == DecoderContext::MOBILE) { // INFO message has 32 payload bits
-                InfoMessage* msg = new InfoMessage();
+                InfoMessage* msg = newMessage<InfoMessage>();
                 msg->id = RailcomID::INFO;
-                msg->speed = (payload >> 16) & 0xFFFF;
-                msg->motorLoad = (payload >> 8) & 0xFF;
-                msg->statusFlags = payload & 0xFF;
+                msg->speed = get<Info, Info::SPEED>(payload);
+                msg->motorLoad = get<Info, Info::MOTOR_LOAD>(payload);
+                msg->statusFlags = get<Info, Info::STATUS_FLAGS>(payload);
                 return msg;
             } else { // STAT1 message has 8 payload bits
-                Stat1Message* msg = new Stat1Message();
+                Stat1Message* msg = newMessage<Stat1Message>();
                 msg->id = RailcomID::STAT1;
-                msg->status = payload;
+                msg->status = get<Stat1, Stat1::STATUS>(unpad<Stat1>(payload, payloadBits));
                 return msg;
             }
         }
         case RailcomID::EXT: { // RCN-217, 5.2.4
             if (bitCount == 18) { // EXT Message has 14 payload bits
-                ExtMessage* msg = new ExtMessage();
-                msg->id = RailcomID::EXT;
-                uint8_t type = (payload >> 8) & 0x0F;
+                uint8_t type = get<Ext, Ext::TYPE>(payload);
                 // The type must be in the range 0-7.
-                if (type > 7) return nullptr;
+                if (type > 7) {
+                    _stats.unknownIds++;
+                    return nullptr;
+                }
+                ExtMessage* msg = newMessage<ExtMessage>();
+                msg->id = RailcomID::EXT;
                 msg->type = type;
-                msg->position = payload & 0xFF;
+                msg->position = get<Ext, Ext::POSITION>(payload);
                 return msg;
             } else { // INFO1 or STAT4 Message (8 payload bits)
                 if (_context == DecoderContext::MOBILE) { // INFO1
-                    Info1Message* msg = new Info1Message();
+                    uint64_t fields = unpad<Info1>(payload, payloadBits);
+                    Info1Message* msg = newMessage<Info1Message>();
                     msg->id = RailcomID::INFO1;
-                    msg->on_track_direction_is_positive = (payload >> 0) & 1;
-                    msg->travel_direction_is_positive = (payload >> 1) & 1;
-                    msg->is_moving = (payload >> 2) & 1;
-                    msg->is_in_consist = (payload >> 3) & 1;
-                    msg->request_addressing = (payload >> 4) & 1;
+                    msg->on_track_direction_is_positive = get<Info1, Info1::ON_TRACK_DIRECTION>(fields);
+                    msg->travel_direction_is_positive = get<Info1, Info1::TRAVEL_DIRECTION>(fields);
+                    msg->is_moving = get<Info1, Info1::MOVING>(fields);
+                    msg->is_in_consist = get<Info1, Info1::IN_CONSIST>(fields);
+                    msg->request_addressing = get<Info1, Info1::REQUEST_ADDRESSING>(fields);
                     return msg;
                 } else { // STAT4 (Default for STATIONARY or UNKNOWN)
-                    Stat4Message* msg = new Stat4Message();
+                    Stat4Message* msg = newMessage<Stat4Message>();
                     msg->id = RailcomID::STAT4;
-                    msg->status = payload;
+                    msg->status = get<Stat4, Stat4::STATUS>(unpad<Stat4>(payload, payloadBits));
                     return msg;
                 }
             }
         }
         case RailcomID::ERROR: { // RCN-217, 5.2.7
-            ErrorMessage* msg = new ErrorMessage();
+            ErrorMessage* msg = newMessage<ErrorMessage>();
             msg->id = id;
-            msg->errorCode = payload;
+            msg->errorCode = get<Error, Error::ERROR_CODE>(unpad<Error>(payload, payloadBits));
             return msg;
         }
         case RailcomID::TIME: { // RCN-217, 5.2.6
-            TimeMessage* msg = new TimeMessage();
+            uint64_t fields = unpad<Time>(payload, payloadBits);
+            TimeMessage* msg = newMessage<TimeMessage>();
             msg->id = id;
-            msg->unit_is_second = (payload >> 7) & 0x01;
-            msg->timeValue = payload & 0x7F;
+            msg->unit_is_second = get<Time, Time::UNIT_IS_SECOND>(fields);
+            msg->timeValue = get<Time, Time::VALUE>(fields);
             return msg;
         }
         case RailcomID::CV_AUTO: { // RCN-217, 5.2.11
-            CvAutoMessage* msg = new CvAutoMessage();
+            uint64_t fields = unpad<CvAuto>(payload, payloadBits);
+            CvAutoMessage* msg = newMessage<CvAutoMessage>();
             msg->id = id;
-            msg->cvAddress = (payload >> 8) & 0xFFFFFF;
-            msg->cvValue = payload & 0xFF;
+            msg->cvAddress = get<CvAuto, CvAuto::CV_ADDRESS>(fields);
+            msg->cvValue = get<CvAuto, CvAuto::CV_VALUE>(fields);
             return msg;
         }
         case RailcomID::DECODER_STATE: { // Also BLOCK
-            if (bitCount - 4 == 44) { // DECODER_STATE (RCN-218, 4.2)
-                DecoderStateMessage* msg = new DecoderStateMessage();
+            if (payloadBits == DecoderState::BITS) { // DECODER_STATE (RCN-218, 4.2)
+                DecoderStateMessage* msg = newMessage<DecoderStateMessage>();
                 msg->id = id;
-                msg->protocolCaps = (payload >> 8) & 0xFFFF;
-                msg->changeCount = (payload >> 24) & 0x0FFF;
-                msg->changeFlags = (payload >> 36) & 0xFF;
+                msg->protocolCaps = get<DecoderState, DecoderState::PROTOCOL_CAPS>(payload);
+                msg->changeCount = get<DecoderState, DecoderState::CHANGE_COUNT>(payload);
+                msg->changeFlags = get<DecoderState, DecoderState::CHANGE_FLAGS>(payload);
                 return msg;
-            } else if (bitCount - 4 == 32) { // BLOCK (RCN-218, 4.1)
-                BlockMessage* msg = new BlockMessage();
+            } else if (payloadBits == Block::BITS) { // BLOCK (RCN-218, 4.1)
+                BlockMessage* msg = newMessage<BlockMessage>();
                 msg->id = RailcomID::BLOCK;
-                msg->data = payload;
+                msg->data = get<Block, Block::DATA>(payload);
                 return msg;
             }
+            _stats.lengthErrors++;
             return nullptr;
         }
         case RailcomID::RERAIL: { // RCN-217, 5.2.12
             if (bitCount == 18) { // SRQ (12 payload + 2 pad + 4 ID = 18 bits)
-                SrqMessage* msg = new SrqMessage();
+                uint64_t fields = unpad<Srq>(payload, payloadBits);
+                SrqMessage* msg = newMessage<SrqMessage>();
                 msg->id = RailcomID::SRQ;
-                // Shift out 2 bits of padding
-                uint64_t realPayload = payload >> 2;
-                msg->isExtended = (realPayload >> 11) & 0x01;
-                msg->accessoryAddress = realPayload & 0x7FF;
+                msg->isExtended = get<Srq, Srq::IS_EXTENDED>(fields);
+                msg->accessoryAddress = get<Srq, Srq::ACCESSORY_ADDRESS>(fields);
                 return msg;
             } else { // RERAIL (8 payload + 4 ID = 12 bits)
-                RerailMessage* msg = new RerailMessage();
+                RerailMessage* msg = newMessage<RerailMessage>();
                 msg->id = RailcomID::RERAIL;
-                msg->counter = payload;
+                msg->counter = get<Rerail, Rerail::COUNTER>(unpad<Rerail>(payload, payloadBits));
                 return msg;
             }
         }
         case RailcomID::DECODER_UNIQUE: { // RCN-218, 4.3
-            DecoderUniqueMessage* msg = new DecoderUniqueMessage();
+            uint64_t fields = unpad<DecoderUnique>(payload, payloadBits);
+            DecoderUniqueMessage* msg = newMessage<DecoderUniqueMessage>();
             msg->id = id;
-            msg->productId = payload & 0xFFFFFFFF;
-            msg->manufacturerId = (payload >> 32) & 0x0FFF;
+            msg->productId = get<DecoderUnique, DecoderUnique::PRODUCT_ID>(fields);
+            msg->manufacturerId = get<DecoderUnique, DecoderUnique::MANUFACTURER_ID>(fields);
             return msg;
         }
         default:
+            _stats.unknownIds++;
             return nullptr;
     }
 }
@@ -10,8 +10,63 @@
 
 #include "Railcom.h"
 #include "RailcomRxHardware.h"
+#include "RailcomArena.h"
+#include <atomic>
 #include <vector>
 
+/** @brief Maximum number of bytes read from the hardware per cutout (the RP2040 UART FIFO depth). */
+constexpr uint8_t RAILCOM_RX_MAX_BYTES = 32;
+
+/** @brief Maximum number of datagrams in the bytes of one cutout. */
+constexpr uint8_t RAILCOM_RX_MAX_DATAGRAMS = RAILCOM_RX_MAX_BYTES / 2;
+
+/**
+ * @brief Weight of a new cutout in the quality scores, as a power of two.
+ * @details With 4, a score follows roughly the last 16 cutouts.
+ */
+constexpr uint8_t RAILCOM_RX_QUALITY_SHIFT = 4;
+
+/**
+ * @enum RailcomCutoutClass
+ * @brief What the bytes of one cutout look like.
+ * @details Every valid 4-of-8 code has four bits set. Overlapping transmissions
+ *          of several decoders combine like a logical AND, since any of them
+ *          drawing current pulls the line to 0; they only clear bits. Noise can
+ *          set and clear bits, and a cutout that ends in the middle of a byte
+ *          reads the rest of it as idle, i.e. set bits.
+ */
+enum class RailcomCutoutClass : uint8_t {
+    EMPTY,     ///< Nothing was received.
+    CLEAN,     ///< All bytes are valid codes.
+    COLLISION, ///< A byte lost two or more bits, or a Channel 1 byte lost one: several decoders answered.
+    NOISE,     ///< Bits were set or a single bit was lost in Channel 2.
+    TRUNCATED  ///< Only the last byte gained bits, or a single byte was received: the reply was cut off.
+};
+
+/**
+ * @struct RailcomRxStats
+ * @brief Counters of everything `RailcomRx::read()` received, including what it discarded.
+ * @details All counters start at zero and wrap around at 2^32.
+ */
+struct RailcomRxStats {
+    uint32_t frames;        ///< Cutouts in which at least one byte was received.
+    uint32_t bytes;         ///< Bytes received.
+    uint32_t messages;      ///< Messages parsed successfully, including Data Space messages.
+    uint32_t perId[16];     ///< Parsed datagrams, indexed by the 4-bit ID they were sent with.
+    uint32_t dataSpace;     ///< Data Space messages (RCN-218) received, with or without a valid CRC.
+    uint32_t invalidCodes;  ///< Bytes that are no valid 4-of-8 code.
+    uint32_t acks;          ///< Cutouts that started with the ACK signal.
+    uint32_t nacks;         ///< Cutouts that started with the NACK signal.
+    uint32_t crcFailures;   ///< Data Space messages with a wrong CRC.
+    uint32_t lengthErrors;  ///< Cutouts whose length fits no message.
+    uint32_t unknownIds;    ///< Datagrams with an ID or type the parser does not know.
+    uint32_t collisions;    ///< Cutouts classified as `RailcomCutoutClass::COLLISION`.
+    uint32_t noise;         ///< Cutouts classified as `RailcomCutoutClass::NOISE`.
+    uint32_t truncated;     ///< Cutouts classified as `RailcomCutoutClass::TRUNCATED`.
+    uint32_t overruns;      ///< Cutouts in which received bytes were lost.
+    uint32_t corrected;     ///< Cutouts recovered by soft decoding, see `RailcomRx::setSoftDecoding()`.
+};
+
 /**
  * @class RailcomRx
  * @brief Handles the reception, decoding, and parsing of RailCom messages.
@@ -47,11 +102,84 @@ public:
      *          bytes from the hardware, attempts to parse them into a message,
      *          and returns a pointer to a RailcomMessage struct if successful.
      *          The caller is responsible for casting the base pointer to the
-     *          appropriate message type based on the message ID.
+     *          appropriate message type based on the message ID. The message
+     *          stays valid until the next call to `read()`.
+     *
+     *          The bytes of a cutout are read at once, so they hold the Channel 1
+     *          datagram and every Channel 2 datagram. They are split into
+     *          datagrams (see `splitDatagrams()`); the first is returned, and the
+     *          following calls return the others without waiting, until the bytes
+     *          of the next cutout arrive. Only a Data Space reply, see
+     *          `expectDataSpaceResponse()`, is parsed across both channels.
      * @return A pointer to a parsed RailcomMessage, or nullptr if no valid message was received.
      */
     RailcomMessage* read();
 
+    /**
+     * @brief Checks whether the last `read()` shows that several decoders answered at once.
+     * @details Overlapping transmissions turn valid 4-of-8 codes into invalid ones.
+     *          A NACK is also reported, because the reply cannot be used either.
+     * @return True if the bytes of the last read contained an invalid code or a NACK.
+     */
+    bool collisionDetected() const;
+
+    /**
+     * @brief Returns the classification of the last `read()`.
+     * @return The class of the bytes of the last cutout.
+     */
+    RailcomCutoutClass cutoutClass() const;
+
+    /**
+     * @brief Classifies the bytes of one cutout.
+     * @details Looks at the Hamming weight and the position of each invalid
+     *          code, see RailcomCutoutClass. Evidence of a collision wins over
+     *          noise, noise over truncation.
+     * @param bytes The raw bytes of the cutout, Channel 1 first.
+     * @param len The number of bytes.
+     * @return The class of the cutout.
+     */
+    static RailcomCutoutClass classify(const uint8_t* bytes, size_t len);
+
+    /**
+     * @brief Splits the bytes of one cutout into datagrams.
+     * @details Every byte has to be a valid 4-of-8 data code, and every datagram
+     *          a length its ID is sent with. The bytes are one datagram if the
+     *          first ID allows their length, which covers channel bundling and a
+     *          single Channel 2 reply. Otherwise a first datagram of
+     *          `RAILCOM_CH1_BYTES` is taken as Channel 1, and the rest is split
+     *          into the longest datagrams that still leave a valid split.
+     * @param bytes The raw bytes of the cutout, Channel 1 first.
+     * @param len The number of bytes, at most `RAILCOM_RX_MAX_BYTES`.
+     * @param[out] ends Receives the end offset of each datagram; must hold
+     *        `RAILCOM_RX_MAX_DATAGRAMS` entries.
+     * @return The number of datagrams, or 0 if the bytes cannot be split.
+     */
+    static size_t splitDatagrams(const uint8_t* bytes, size_t len, uint8_t* ends);
+
+    /**
+     * @brief Returns the signal quality of this detector section.
+     * @details The smoothed share of cutouts with data that were neither noisy
+     *          nor truncated. Collisions do not count: they show too many
+     *          decoders, not a bad signal. Starts at 100.
+     * @return The score in percent.
+     */
+    uint8_t quality() const;
+
+    /**
+     * @brief Returns how often several decoders answer at once in this section.
+     * @details The smoothed share of cutouts with data that were classified as
+     *          collision. A detector can use it to ask the command station to
+     *          switch off the Channel 1 broadcast (RCN-217). Starts at 0.
+     * @return The level in percent.
+     */
+    uint8_t collisionLevel() const;
+
+    /**
+     * @brief Checks whether the last `read()` received an ACK.
+     * @return True if the bytes of the last read started with the ACK signal.
+     */
+    bool ackReceived() const;
+
     /**
      * @brief Sets the decoder context to disambiguate messages with shared IDs.
      * @details Some message IDs (e.g., 3 and 4) have different meanings depending
@@ -76,14 +204,70 @@ public:
      * @details Data Space messages (RCN-218) do not have a standard RailCom ID and
      *          are sent as a direct response to a specific DCC command. This method
      *          flags the receiver to use a special parsing logic for the next
-     *          incoming message.
+     *          call to `read()`, whether or not that call receives anything.
+     *          Datagrams of the last cutout that were not read yet are dropped.
      * @param dataSpaceNum The data space number that is expected, used for CRC calculation.
      */
     void expectDataSpaceResponse(uint8_t dataSpaceNum);
 
+    /**
+     * @brief Enables the correction of single bit errors.
+     * @details If a noisy or truncated cutout contains exactly one invalid
+     *          code, `read()` tries every valid code one bit away from it (see
+     *          `RailcomEncoding::softDecode4of8()`). A correction is accepted
+     *          only if exactly one candidate yields a plausible datagram: one
+     *          whose ID can be sent with the received number of symbols, or,
+     *          for a Data Space message, one with a valid CRC. Cutouts
+     *          classified as collision are never corrected. Off by default.
+     * @param enabled True to enable soft decoding.
+     */
+    void setSoftDecoding(bool enabled);
+
+    /**
+     * @brief Copies the reception statistics.
+     * @details `read()` updates the counters with plain increments and marks
+     *          each update with a sequence number; the copy is retried if an
+     *          update was in progress. Neither side waits for the other, so the
+     *          statistics can be polled from another core or a management loop
+     *          while `read()` runs. Only one context may poll them.
+     * @param[out] stats Receives the counters since the last `resetStats()`.
+     * @return False if no consistent copy could be made because `read()` kept
+     *         updating the counters; `stats` is then unchanged.
+     */
+    bool snapshotStats(RailcomRxStats& stats) const;
+
+    /**
+     * @brief Restarts the statistics from zero.
+     * @details The counters themselves are never written by this call; it takes
+     *          a snapshot as the new baseline, so reception is not disturbed.
+     *          Must be called from the context that calls `snapshotStats()`.
+     */
+    void resetStats();
+
+    /**
+     * @brief Returns the arena the messages of `read()` are created in.
+     * @details The arena is reset by every `read()`, so it holds at most one
+     *          message; its `peak()` shows how much of `RAILCOM_RX_ARENA_BYTES`
+     *          the received messages needed.
+     * @return The arena.
+     */
+    const RailcomArena<RAILCOM_RX_ARENA_BYTES>& arena() const { return _arena; }
+
 private:
     /**
-     * @brief Reads raw bytes from the hardware buffer.
+     * @brief Creates a message in the arena.
+     * @details The arena is sized for the largest message, checked at compile
+     *          time, and holds one message per `read()`, so this cannot fail.
+     * @tparam T The message struct.
+     * @return The value-initialised message.
+     */
+    template <typename T>
+    T* newMessage() {
+        return _arena.template create<T>();
+    }
+
+    /**
+     * @brief Reads the raw bytes of one cutout from the hardware buffer.
      * @param buffer A reference to a vector where the read bytes will be stored.
      * @param timeout_ms The timeout in milliseconds to wait for data.
      * @return True if bytes were read, false otherwise.
@@ -91,19 +275,82 @@ private:
     bool read_raw_bytes(std::vector<uint8_t>& buffer, uint timeout_ms);
 
     /**
-     * @brief Parses a buffer of raw, decoded bytes into a RailcomMessage struct.
-     * @param buffer A const reference to the vector containing the decoded datagram.
-     * @return A pointer to a newly allocated RailcomMessage struct, or nullptr on failure.
+     * @brief Parses the raw bytes of one datagram into a RailcomMessage struct.
+     * @param bytes The 4-of-8 encoded datagram.
+     * @param len The number of bytes.
+     * @return A pointer to a RailcomMessage struct in the arena, or nullptr on failure.
+     */
+    RailcomMessage* parseMessage(const uint8_t* bytes, size_t len);
+
+    /**
+     * @brief Parses the next datagram of the last cutout.
+     * @return A pointer to a RailcomMessage struct in the arena, or nullptr on failure.
+     */
+    RailcomMessage* parseNextDatagram();
+
+    /**
+     * @brief Creates the message struct for a decoded datagram.
+     * @param id The 4-bit ID of the datagram.
+     * @param payload The bits following the ID.
+     * @param bitCount The number of bits in the datagram, including the ID.
+     * @return A pointer to a RailcomMessage struct in the arena, or nullptr if the datagram is not understood.
+     */
+    RailcomMessage* parsePayload(RailcomID id, uint64_t payload, int bitCount);
+
+    /**
+     * @brief Parses the last raw bytes as a Data Space message (RCN-218).
+     * @return A pointer to a DataSpaceMessage in the arena, or nullptr on failure.
+     */
+    RailcomMessage* parseDataSpace();
+
+    /**
+     * @brief Replaces the only invalid code of the last cutout by its unique plausible correction.
+     * @param dataSpace True if the cutout is expected to hold a Data Space message.
+     * @return True if the raw bytes were corrected.
+     */
+    bool correctSymbol(bool dataSpace);
+
+    /**
+     * @brief Checks whether the last raw bytes can be a datagram at all.
+     * @param dataSpace True if the cutout is expected to hold a Data Space message.
+     * @return True if the bytes split into datagrams whose lengths fit their
+     *         IDs, or the Data Space CRC is valid.
      */
-    RailcomMessage* parseMessage(const std::vector<uint8_t>& buffer);
+    bool isPlausible(bool dataSpace) const;
+
+    /**
+     * @brief Moves the quality scores towards the result of a cutout.
+     * @param cutout The class of the cutout.
+     */
+    void updateScores(RailcomCutoutClass cutout);
+
+    /**
+     * @brief Copies the counters without the baseline of `resetStats()`.
+     * @param[out] stats Receives the counters.
+     * @return False if `read()` kept updating the counters.
+     */
+    bool copyStats(RailcomRxStats& stats) const;
 
     RailcomRxHardware* _hardware; ///< Pointer to the hardware abstraction layer.
-    std::vector<uint8_t> _lastRawBytes; ///< Stores the raw bytes of the last received message.
-    RailcomMessage* _lastMessage = nullptr; ///< Pointer to the last successfully parsed message.
+    std::vector<uint8_t> _lastRawBytes; ///< Stores the raw bytes of the last received message; its capacity is reserved in the constructor.
+    RailcomArena<RAILCOM_RX_ARENA_BYTES> _arena; ///< Holds the message returned by `read()`.
+    RailcomMessage* _lastMessage = nullptr; ///< Pointer to the last successfully parsed message, in `_arena`.
+    uint8_t _datagramEnds[RAILCOM_RX_MAX_DATAGRAMS]; ///< End offsets of the datagrams in `_lastRawBytes`.
+    uint8_t _datagramCount = 0; ///< Number of datagrams in `_lastRawBytes`.
+    uint8_t _nextDatagram = 0;  ///< Index of the datagram the next `read()` returns.
     uint8_t _lastAdrHigh = 0; ///< Stores the high byte of a long address for stateful address calculation.
     DecoderContext _context = DecoderContext::UNKNOWN; ///< The current context for parsing ambiguous messages.
     bool _is_data_space_expected = false; ///< Flag indicating that the next message should be a Data Space response.
     uint8_t _expected_data_space_num = 0; ///< The expected data space number for CRC calculation.
+
+    bool _softDecoding = false; ///< Correct single bit errors, see `setSoftDecoding()`.
+    RailcomCutoutClass _lastClass = RailcomCutoutClass::EMPTY; ///< Class of the last cutout.
+    std::atomic<uint16_t> _quality{100 << 8};  ///< `quality()` in 1/256 percent.
+    std::atomic<uint16_t> _collisionLevel{0};  ///< `collisionLevel()` in 1/256 percent.
+
+    RailcomRxStats _stats = {};              ///< The counters, written by `read()` only.
+    RailcomRxStats _statsBaseline = {};      ///< The counters at the last `resetStats()`.
+    std::atomic<uint32_t> _statsSequence{0}; ///< Odd while `read()` updates `_stats`.
 };
 
 #endif // RAILCOM_RX_H
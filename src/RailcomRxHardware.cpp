@@ -0,0 +1,61 @@
+/**
+ * @file RailcomRxHardware.cpp
+ * @brief Default implementations of the RailcomRxHardware interface.
+ */
+#include "RailcomRxHardware.h"
+#include "RailcomProtocolDefs.h"
+#include "pico/time.h"
+
+/**
+ * @brief Reads the available bytes one by one with `read()`.
+ * @param[out] dst Receives the bytes.
+ * @param max The size of `dst`.
+ * @param[out] timestamps_us Receives the time each byte was read, or nullptr.
+ * @return The number of bytes read.
+ */
+size_t RailcomRxHardware::readBlock(uint8_t* dst, size_t max, uint32_t* timestamps_us) {
+    size_t count = 0;
+    while (count < max && available() > 0) {
+        int byte = read();
+        if (byte < 0) break;
+        if (timestamps_us != nullptr) {
+            timestamps_us[count] = time_us_32();
+        }
+        dst[count++] = (uint8_t)byte;
+    }
+    return count;
+}
+
+/**
+ * @brief Polls `available()` until a reply has been received.
+ * @param timeout_ms The maximum time to wait for the first byte.
+ * @return True if bytes are available.
+ */
+bool RailcomRxHardware::waitForFrame(uint32_t timeout_ms) {
+    uint64_t start = time_us_64();
+    int count;
+    while ((count = available()) <= 0) {
+        if (time_us_64() - start >= (uint64_t)timeout_ms * 1000) {
+            return false;
+        }
+    }
+
+    // The reply is complete once no further byte arrives within the idle time.
+    uint64_t last = time_us_64();
+    while (time_us_64() - last < RAILCOM_RX_IDLE_US) {
+        int now = available();
+        if (now != count) {
+            count = now;
+            last = time_us_64();
+        }
+    }
+    return true;
+}
+
+/**
+ * @brief Reports no overruns.
+ * @return Always false.
+ */
+bool RailcomRxHardware::overrunOccurred() {
+    return false;
+}
@@ -47,6 +47,38 @@ public:
      * @return The byte that was read, or -1 if no data is available.
      */
     virtual int read() = 0;
+
+    /**
+     * @brief Reads all received bytes, up to `max`, in one call.
+     * @details Returns at once; bytes that arrive later are left for the next
+     *          call. The default implementation uses `available()` and `read()`.
+     * @param[out] dst Receives the bytes.
+     * @param max The size of `dst`.
+     * @param[out] timestamps_us Receives the reception time (`time_us_32()`) of
+     *        each byte, or nullptr. Implementations without a receive timestamp
+     *        report the time the byte was read.
+     * @return The number of bytes read.
+     */
+    virtual size_t readBlock(uint8_t* dst, size_t max, uint32_t* timestamps_us = nullptr);
+
+    /**
+     * @brief Waits until the reply of a cutout has been received.
+     * @details Returns once at least one byte has arrived and the line has then
+     *          been idle for `RAILCOM_RX_IDLE_US`, so a following `readBlock()`
+     *          gets Channel 1 and Channel 2 together. The default implementation
+     *          polls `available()`; implementations should wait in hardware.
+     * @param timeout_ms The maximum time to wait for the first byte.
+     * @return True if bytes are available, false if the timeout expired.
+     */
+    virtual bool waitForFrame(uint32_t timeout_ms);
+
+    /**
+     * @brief Reports whether received bytes were lost since the last call.
+     * @details The flag is cleared by the call. The default implementation has
+     *          no overrun detection and always returns false.
+     * @return True if the receive buffer overflowed.
+     */
+    virtual bool overrunOccurred();
 };
 
 #endif // RAILCOM_RX_HARDWARE_H
@@ -0,0 +1,366 @@
+/**
+ * @file RailcomSchema.h
+ * @brief The field layout of every RailCom datagram, shared by the transmitter and the receiver.
+ * @details Each message is described once, as a `constexpr` table of fields
+ *          (name, offset, width) within its payload. `RailcomSchema::pack()`
+ *          and `RailcomSchema::get()` are generated from that table at compile
+ *          time and reduce to the same shifts and masks that would be written
+ *          by hand, so `RailcomTx` and `RailcomRx` cannot disagree about a
+ *          layout. The tables of the web encoder (`tools/railcom_schema.js`)
+ *          are exported from here as well, see `tests/host/schema_export.cpp`.
+ *
+ *          Offsets count from the least significant bit of the payload, not
+ *          including the padding that fills a datagram up to whole 4-of-8
+ *          symbols.
+ */
+#ifndef RAILCOM_SCHEMA_H
+#define RAILCOM_SCHEMA_H
+
+#include <cstddef>
+#include <cstdint>
+#include <type_traits>
+#include <utility>
+#include "Railcom.h"
+
+/**
+ * @struct RailcomField
+ * @brief One field of a datagram's payload.
+ */
+struct RailcomField {
+    const char* name; ///< The name, as used by the web encoder.
+    uint8_t offset;   ///< Position of the least significant bit in the payload.
+    uint8_t width;    ///< Number of bits.
+};
+
+/**
+ * @namespace RailcomSchema
+ * @brief The message layouts and the codec generated from them.
+ * @details A schema is a struct with the members
+ *          - `NAME`: the message name,
+ *          - `ID`: the RailcomID it is sent with,
+ *          - `BITS`: the number of payload bits,
+ *          - `FIELDS`: the fields, most significant first,
+ *          - an unnamed enum with one index per field, in the order of `FIELDS`.
+ */
+namespace RailcomSchema {
+
+    /** @brief POM response. @see RCN-217, 5.2.1 */
+    struct Pom {
+        static constexpr const char* NAME = "POM";
+        static constexpr RailcomID ID = RailcomID::POM;
+        static constexpr uint8_t BITS = 8;
+        enum : uint8_t { CV_VALUE };
+        static constexpr RailcomField FIELDS[] = { { "cvValue", 0, 8 } };
+    };
+
+    /** @brief Upper 6 bits of the address; 0 for a short address. @see RCN-217, 5.2.2 */
+    struct AdrHigh {
+        static constexpr const char* NAME = "ADR_HIGH";
+        static constexpr RailcomID ID = RailcomID::ADR_HIGH;
+        static constexpr uint8_t BITS = 6;
+        enum : uint8_t { ADDRESS };
+        static constexpr RailcomField FIELDS[] = { { "address", 0, 6 } };
+    };
+
+    /** @brief Lower 8 bits of the address. @see RCN-217, 5.2.3 */
+    struct AdrLow {
+        static constexpr const char* NAME = "ADR_LOW";
+        static constexpr RailcomID ID = RailcomID::ADR_LOW;
+        static constexpr uint8_t BITS = 8;
+        enum : uint8_t { ADDRESS };
+        static constexpr RailcomField FIELDS[] = { { "address", 0, 8 } };
+    };
+
+    /** @brief Location information. @see RCN-217, 5.2.4 */
+    struct Ext {
+        static constexpr const char* NAME = "EXT";
+        static constexpr RailcomID ID = RailcomID::EXT;
+        static constexpr uint8_t BITS = 14;
+        enum : uint8_t { TYPE, POSITION };
+        static constexpr RailcomField FIELDS[] = { { "type", 8, 6 }, { "position", 0, 8 } };
+    };
+
+    /** @brief Basic information of a mobile decoder, sent in the Channel 1 broadcast. @see RCN-217, 5.2.4 */
+    struct Info1 {
+        static constexpr const char* NAME = "INFO1";
+        static constexpr RailcomID ID = RailcomID::INFO1;
+        static constexpr uint8_t BITS = 8;
+        enum : uint8_t { REQUEST_ADDRESSING, IN_CONSIST, MOVING, TRAVEL_DIRECTION, ON_TRACK_DIRECTION };
+        static constexpr RailcomField FIELDS[] = {
+            { "requestAddressing", 4, 1 }, { "isInConsist", 3, 1 }, { "isMoving", 2, 1 },
+            { "travelDirectionIsPositive", 1, 1 }, { "onTrackDirectionIsPositive", 0, 1 }
+        };
+    };
+
+    /** @brief Status of 4 turnouts. @see RCN-217, 5.2.4 */
+    struct Stat4 {
+        static constexpr const char* NAME = "STAT4";
+        static constexpr RailcomID ID = RailcomID::STAT4;
+        static constexpr uint8_t BITS = 8;
+        enum : uint8_t { STATUS };
+        static constexpr RailcomField FIELDS[] = { { "status", 0, 8 } };
+    };
+
+    /** @brief Driving information. @see RCN-217, 5.2.5 */
+    struct Info {
+        static constexpr const char* NAME = "INFO";
+        static constexpr RailcomID ID = RailcomID::INFO;
+        static constexpr uint8_t BITS = 32;
+        enum : uint8_t { SPEED, MOTOR_LOAD, STATUS_FLAGS };
+        static constexpr RailcomField FIELDS[] = { { "speed", 16, 16 }, { "motorLoad", 8, 8 }, { "statusFlags", 0, 8 } };
+    };
+
+    /** @brief Status of 1 turnout. @see RCN-217, 5.2.5 */
+    struct Stat1 {
+        static constexpr const char* NAME = "STAT1";
+        static constexpr RailcomID ID = RailcomID::STAT1;
+        static constexpr uint8_t BITS = 8;
+        enum : uint8_t { STATUS };
+        static constexpr RailcomField FIELDS[] = { { "status", 0, 8 } };
+    };
+
+    /** @brief Remaining time of an action. @see RCN-217, 5.2.6 */
+    struct Time {
+        static constexpr const char* NAME = "TIME";
+        static constexpr RailcomID ID = RailcomID::TIME;
+        static constexpr uint8_t BITS = 8;
+        enum : uint8_t { UNIT_IS_SECOND, VALUE };
+        static constexpr RailcomField FIELDS[] = { { "unitIsSecond", 7, 1 }, { "timeValue", 0, 7 } };
+    };
+
+    /** @brief Error message. @see RCN-217, 5.2.7 */
+    struct Error {
+        static constexpr const char* NAME = "ERROR";
+        static constexpr RailcomID ID = RailcomID::ERROR;
+        static constexpr uint8_t BITS = 8;
+        enum : uint8_t { ERROR_CODE };
+        static constexpr RailcomField FIELDS[] = { { "errorCode", 0, 8 } };
+    };
+
+    /** @brief Dynamic data. @see RCN-217, 5.2.8 */
+    struct Dyn {
+        static constexpr const char* NAME = "DYN";
+        static constexpr RailcomID ID = RailcomID::DYN;
+        static constexpr uint8_t BITS = 14;
+        enum : uint8_t { VALUE, SUB_INDEX };
+        static constexpr RailcomField FIELDS[] = { { "value", 6, 8 }, { "subIndex", 0, 6 } };
+    };
+
+    /** @brief Extended POM response; sent with the IDs XPOM_0 to XPOM_3. @see RCN-217, 5.2.9 */
+    struct Xpom {
+        static constexpr const char* NAME = "XPOM";
+        static constexpr RailcomID ID = RailcomID::XPOM_0;
+        static constexpr uint8_t BITS = 32;
+        enum : uint8_t { CV_VALUE_0, CV_VALUE_1, CV_VALUE_2, CV_VALUE_3 };
+        static constexpr RailcomField FIELDS[] = {
+            { "cvValue0", 24, 8 }, { "cvValue1", 16, 8 }, { "cvValue2", 8, 8 }, { "cvValue3", 0, 8 }
+        };
+    };
+
+    /** @brief Status of 2 turnouts. @see RCN-217, 5.2.9 */
+    struct Stat2 {
+        static constexpr const char* NAME = "STAT2";
+        static constexpr RailcomID ID = RailcomID::STAT2;
+        static constexpr uint8_t BITS = 8;
+        enum : uint8_t { STATUS };
+        static constexpr RailcomField FIELDS[] = { { "status", 0, 8 } };
+    };
+
+    /** @brief Automatic CV broadcast. @see RCN-217, 5.2.11 */
+    struct CvAuto {
+        static constexpr const char* NAME = "CV_AUTO";
+        static constexpr RailcomID ID = RailcomID::CV_AUTO;
+        static constexpr uint8_t BITS = 32;
+        enum : uint8_t { CV_ADDRESS, CV_VALUE };
+        static constexpr RailcomField FIELDS[] = { { "cvAddress", 8, 24 }, { "cvValue", 0, 8 } };
+    };
+
+    /** @brief Rerailing message. @see RCN-217, 5.2.12 */
+    struct Rerail {
+        static constexpr const char* NAME = "RERAIL";
+        static constexpr RailcomID ID = RailcomID::RERAIL;
+        static constexpr uint8_t BITS = 8;
+        enum : uint8_t { COUNTER };
+        static constexpr RailcomField FIELDS[] = { { "counter", 0, 8 } };
+    };
+
+    /** @brief Service request of an accessory decoder. @see RCN-217, 5.2.12 */
+    struct Srq {
+        static constexpr const char* NAME = "SRQ";
+        static constexpr RailcomID ID = RailcomID::SRQ;
+        static constexpr uint8_t BITS = 12;
+        enum : uint8_t { IS_EXTENDED, ACCESSORY_ADDRESS };
+        static constexpr RailcomField FIELDS[] = { { "isExtended", 11, 1 }, { "accessoryAddress", 0, 11 } };
+    };
+
+    /** @brief Block of a logon answer. @see RCN-218, 4.1 */
+    struct Block {
+        static constexpr const char* NAME = "BLOCK";
+        static constexpr RailcomID ID = RailcomID::BLOCK;
+        static constexpr uint8_t BITS = 32;
+        enum : uint8_t { DATA };
+        static constexpr RailcomField FIELDS[] = { { "data", 0, 32 } };
+    };
+
+    /** @brief Decoder state; the lowest 8 bits are reserved. @see RCN-218, 4.2 */
+    struct DecoderState {
+        static constexpr const char* NAME = "DECODER_STATE";
+        static constexpr RailcomID ID = RailcomID::DECODER_STATE;
+        static constexpr uint8_t BITS = 44;
+        enum : uint8_t { CHANGE_FLAGS, CHANGE_COUNT, PROTOCOL_CAPS };
+        static constexpr RailcomField FIELDS[] = {
+            { "changeFlags", 36, 8 }, { "changeCount", 24, 12 }, { "protocolCaps", 8, 16 }
+        };
+    };
+
+    /** @brief Unique ID of a decoder. @see RCN-218, 4.3 */
+    struct DecoderUnique {
+        static constexpr const char* NAME = "DECODER_UNIQUE";
+        static constexpr RailcomID ID = RailcomID::DECODER_UNIQUE;
+        static constexpr uint8_t BITS = 44;
+        enum : uint8_t { MANUFACTURER_ID, PRODUCT_ID };
+        static constexpr RailcomField FIELDS[] = { { "manufacturerId", 32, 12 }, { "productId", 0, 32 } };
+    };
+
+    /**
+     * @brief Returns a mask of the lowest `width` bits.
+     * @param width The number of bits (0-64).
+     * @return The mask.
+     */
+    constexpr uint64_t mask(uint8_t width) {
+        return width >= 64 ? ~0ULL : (1ULL << width) - 1;
+    }
+
+    /**
+     * @brief Returns the number of fields of a schema.
+     * @tparam M The schema.
+     */
+    template <typename M>
+    constexpr size_t fieldCount() {
+        return sizeof(M::FIELDS) / sizeof(M::FIELDS[0]);
+    }
+
+    /**
+     * @brief Returns the number of consecutive IDs a schema is sent with.
+     * @details XPOM uses one ID per part, from XPOM_0 to XPOM_3; all others one.
+     * @tparam M The schema.
+     */
+    template <typename M>
+    constexpr uint8_t idCount() {
+        return std::is_same<M, Xpom>::value ? 4 : 1;
+    }
+
+    /**
+     * @brief Extracts a field from a payload.
+     * @tparam M The schema.
+     * @tparam F The index of the field, e.g. `Info::SPEED`.
+     * @param payload The payload without padding.
+     * @return The value of the field.
+     */
+    template <typename M, uint8_t F>
+    constexpr uint64_t get(uint64_t payload) {
+        static_assert(F < fieldCount<M>(), "No such field");
+        return (payload >> M::FIELDS[F].offset) & mask(M::FIELDS[F].width);
+    }
+
+    /**
+     * @brief Places the value of one field; bits beyond its width are dropped.
+     * @tparam M The schema.
+     * @tparam F The index of the field.
+     * @param value The value.
+     * @return The value at its position in the payload.
+     */
+    template <typename M, size_t F>
+    constexpr uint64_t put(uint64_t value) {
+        return (value & mask(M::FIELDS[F].width)) << M::FIELDS[F].offset;
+    }
+
+    /**
+     * @brief Places the values of all fields.
+     * @tparam M The schema.
+     * @tparam F The field indices.
+     * @param values The values, in the order of `M::FIELDS`.
+     */
+    template <typename M, size_t... F, typename... V>
+    constexpr uint64_t packFields(std::index_sequence<F...>, V... values) {
+        return (put<M, F>(static_cast<uint64_t>(values)) | ... | 0ULL);
+    }
+
+    /**
+     * @brief Builds a payload from the values of all fields.
+     * @tparam M The schema.
+     * @param values One value per field, in the order of `M::FIELDS`.
+     * @return The payload of `M::BITS` bits, to be sent with `M::ID`.
+     */
+    template <typename M, typename... V>
+    constexpr uint64_t pack(V... values) {
+        static_assert(sizeof...(V) == fieldCount<M>(), "One value per field is required");
+        return packFields<M>(std::index_sequence_for<V...>{}, values...);
+    }
+
+    /**
+     * @brief Removes the padding from a received payload.
+     * @tparam M The schema.
+     * @param payload The bits following the ID.
+     * @param payloadBits The number of bits following the ID, including the padding.
+     * @return The payload as `get()` expects it.
+     */
+    template <typename M>
+    constexpr uint64_t unpad(uint64_t payload, int payloadBits) {
+        return payloadBits > M::BITS ? payload >> (payloadBits - M::BITS) : payload;
+    }
+
+    /**
+     * @brief Checks that the fields of a schema fit into its payload and do not overlap.
+     * @tparam M The schema.
+     */
+    template <typename M>
+    constexpr bool isValid() {
+        uint64_t used = 0;
+        for (size_t i = 0; i < fieldCount<M>(); ++i) {
+            const RailcomField& f = M::FIELDS[i];
+            if (f.width == 0 || f.offset + f.width > M::BITS) return false;
+            uint64_t bits = mask(f.width) << f.offset;
+            if (used & bits) return false;
+            used |= bits;
+        }
+        return M::BITS <= 44; // The most a datagram of 8 symbols can carry.
+    }
+
+    /**
+     * @brief Calls `visitor.template visit<M>()` for every schema.
+     * @details Used to export the tables, e.g. for the web encoder.
+     * @param visitor The visitor.
+     */
+    template <typename Visitor>
+    void forEach(Visitor& visitor) {
+        visitor.template visit<Pom>();
+        visitor.template visit<AdrHigh>();
+        visitor.template visit<AdrLow>();
+        visitor.template visit<Ext>();
+        visitor.template visit<Info1>();
+        visitor.template visit<Stat4>();
+        visitor.template visit<Info>();
+        visitor.template visit<Stat1>();
+        visitor.template visit<Time>();
+        visitor.template visit<Error>();
+        visitor.template visit<Dyn>();
+        visitor.template visit<Xpom>();
+        visitor.template visit<Stat2>();
+        visitor.template visit<CvAuto>();
+        visitor.template visit<Block>();
+        visitor.template visit<DecoderState>();
+        visitor.template visit<Rerail>();
+        visitor.template visit<Srq>();
+        visitor.template visit<DecoderUnique>();
+    }
+
+    static_assert(isValid<Pom>() && isValid<AdrHigh>() && isValid<AdrLow>() && isValid<Ext>() &&
+                  isValid<Info1>() && isValid<Stat4>() && isValid<Info>() && isValid<Stat1>() &&
+                  isValid<Time>() && isValid<Error>() && isValid<Dyn>() && isValid<Xpom>() &&
+                  isValid<Stat2>() && isValid<CvAuto>() && isValid<Block>() && isValid<DecoderState>() &&
+                  isValid<Rerail>() && isValid<Srq>() && isValid<DecoderUnique>(),
+                  "A message layout has overlapping or oversized fields");
+}
+
+#endif // RAILCOM_SCHEMA_H
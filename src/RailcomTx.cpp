@@ -4,16 +4,39 @@
  */
 #include "RailcomTx.h"
 #include "RailcomEncoding.h"
+#include "LatencyTrace.h"
 #include "RailcomProtocolDefs.h"
-#include "pico/time.h"
+#include <Arduino.h>
 #include <cstring>
 
+/** @brief Lifetime in milliseconds of a Channel 2 entry, indexed by `RailcomPriority`. */
+static const uint32_t CH2_LIFETIME_MS[] = { 500, 1000, 1000 };
+
+/**
+ * @brief The message types with a latest-value-wins slot.
+ * @details Several types share a RailcomID (EXT/STAT4, INFO/STAT1), so the
+ *          slot is keyed by the type and not by the ID.
+ */
+enum SlotType : uint8_t { SLOT_INFO = 1, SLOT_STAT1, SLOT_EXT, SLOT_STAT4, SLOT_STAT2, SLOT_TIME, SLOT_DYN };
+
+/**
+ * @brief Builds a slot key from a message type and a sub-index.
+ * @details The top bit keeps every key apart from `RAILCOM_NO_SLOT`.
+ */
+static constexpr uint16_t makeSlot(SlotType type, uint8_t subIndex = 0) {
+    return 0x8000 | (static_cast<uint16_t>(type) << 8) | subIndex;
+}
+
 /**
  * @brief Constructs a RailcomTx object.
  * @param hardware A pointer to a RailcomHardware implementation.
  */
 RailcomTx::RailcomTx(RailcomTxHardware* hardware)
-    : _hardware(hardware), _address_alternator(0), _info1_enabled(false), _info1_payload(0) {
+    : _hardware(hardware), _info1_enabled(false), _info1_payload(0),
+      _adr_rotation_len(0), _adr_rotation_index(0), _adr_rotation_address(0), _adr_rotation_valid(false),
+      _ch1_head(0), _ch1_count(0),
+      _ch2_count(0), _ch2_order(0), _ch2_hold(false), _ds_head(0), _ds_count(0),
+      _in_cutout(false), _frame_start_us(0), _ch1_frame(nullptr), _ch2_frame(nullptr) {
 }
 
 /**
@@ -32,41 +55,327 @@ void RailcomTx::end() {
 
 /**
  * @brief Triggers the transmission of queued messages at the start of a DCC cutout.
- * @details This function sends one message from the Channel 1 queue, waits for the
- *          appropriate Channel 2 delay, and then sends all messages from the Channel 2 queue.
+ * @details If a Data Space block is waiting and Channel 2 is open, the block
+ *          takes the whole cutout. Otherwise Channel 1 carries one message from
+ *          the Channel 1 queue if there is one, otherwise the pre-encoded
+ *          Channel 1 frame (usually the next frame of the address broadcast) if
+ *          one was handed over, and the Channel 2 window is filled unless
+ *          `holdChannel2()` was called for this cutout. Both parts go to the
+ *          hardware in a single `send_frame()` call, which starts Channel 2 at
+ *          the Channel 2 delay; no bytes are copied except into the Channel 2
+ *          window.
  * @param elapsed_us The time in microseconds since the last cutout started.
  */
 void RailcomTx::on_cutout_start(uint32_t elapsed_us) {
-    if (!_ch1_queue.empty()) {
-        const auto& msg = _ch1_queue.front();
-        _hardware->send_bytes(msg);
-        _ch1_queue.pop();
+    _in_cutout = true;
+    bool ch2_open = !_ch2_hold;
+    _ch2_hold = false;
+    // A block is only sent as a whole, so it waits for a cutout with an open Channel 2.
+    bool ds_block = ch2_open && _ds_count > 0;
+    bool ch1_queued = false;
+
+    const uint8_t* ch1 = nullptr;
+    uint8_t ch1_len = 0;
+    const uint8_t* ch2 = _ch2_window;
+    uint8_t ch2_len = 0;
+
+    if (ds_block) {
+        const RailcomFrame& block = _ds_blocks[_ds_head];
+        ch1_len = block.len < RAILCOM_CH1_BYTES ? block.len : RAILCOM_CH1_BYTES;
+        ch1 = block.bytes;
+        ch2 = block.bytes + ch1_len;
+        ch2_len = block.len - ch1_len;
+    } else {
+        if (_ch1_count > 0) {
+            // Queued Channel 1 parts of replies (ACK/NACK, SRQ) replace the broadcast.
+            ch1 = _ch1_queue[_ch1_head].bytes;
+            ch1_len = _ch1_queue[_ch1_head].len;
+            ch1_queued = true;
+        } else if (_ch1_frame != nullptr) {
+            ch1 = _ch1_frame->bytes;
+            ch1_len = _ch1_frame->len;
+        }
+        if (ch2_open) {
+            ch2_len = fillChannel2(_ch2_window);
+        }
+    }
+
+    uint32_t ch2_offset_us = elapsed_us < RAILCOM_CH2_DELAY_US ? RAILCOM_CH2_DELAY_US - elapsed_us : 0;
+    _frame_start_us = time_us_32();
+    RAILCOM_TRACE(CH1_START);
+    if (ch2_len > 0) {
+        RAILCOM_TRACE_DELAYED(CH2_START, ch2_offset_us);
+    }
+    _hardware->send_frame(ch1, ch1_len, ch2, ch2_len, ch2_offset_us);
+
+    if (ds_block) {
+        _ds_head = (_ds_head + 1) % RAILCOM_DATA_SPACE_BLOCKS;
+        _ds_count--;
+    } else if (ch1_queued) {
+        _ch1_head = (_ch1_head + 1) % RAILCOM_CH1_QUEUE_SIZE;
+        _ch1_count--;
+    }
+    _ch1_frame = nullptr;
+    _in_cutout = false;
+}
+
+/**
+ * @brief Keeps Channel 2 silent in the next cutout.
+ */
+void RailcomTx::holdChannel2() {
+    _ch2_hold = true;
+}
+
+/**
+ * @brief Fills the Channel 2 window.
+ * @details Entries are taken highest priority first, oldest first within a
+ *          priority, as long as they fit into the remaining window. An entry
+ *          longer than the window (a DECODER_UNIQUE or DECODER_STATE message,
+ *          which extend over the whole cutout per RCN-218) is only sent on its
+ *          own, so the window never exceeds `RAILCOM_MAX_DATAGRAM_BYTES`.
+ * @param[out] window Receives the bytes.
+ * @return The number of bytes in `window`.
+ */
+uint8_t RailcomTx::fillChannel2(uint8_t* window) {
+    expireChannel2(millis());
+    uint8_t used = 0;
+
+    if (_ch2_frame != nullptr) {
+        memcpy(window, _ch2_frame->bytes, _ch2_frame->len);
+        used = _ch2_frame->len;
+        _ch2_frame = nullptr;
+    }
+
+    while (_ch2_count > 0) {
+        int best = -1;
+        for (uint8_t i = 0; i < _ch2_count; ++i) {
+            const Ch2Entry& entry = _ch2_entries[i];
+            bool fits = (used == 0) || (used + entry.len <= RAILCOM_CH2_BYTES);
+            if (!fits) continue;
+            if (best < 0 || entry.priority > _ch2_entries[best].priority ||
+                (entry.priority == _ch2_entries[best].priority &&
+                 (int16_t)(entry.order - _ch2_entries[best].order) < 0)) {
+                best = i;
+            }
+        }
+        if (best < 0) break;
+
+        const Ch2Entry& entry = _ch2_entries[best];
+        memcpy(window + used, entry.bytes, entry.len);
+        used += entry.len;
+        bool oversized = entry.len > RAILCOM_CH2_BYTES;
+        _ch2_entries[best] = _ch2_entries[--_ch2_count];
+        if (oversized) break;
+    }
+    return used;
+}
+
+/**
+ * @brief Adds a frame to the Channel 1 queue.
+ * @param frame The encoded frame.
+ * @return False if the queue is full.
+ */
+bool RailcomTx::enqueueChannel1(const RailcomFrame& frame) {
+    if (_ch1_count >= RAILCOM_CH1_QUEUE_SIZE) return false;
+    _ch1_queue[(_ch1_head + _ch1_count) % RAILCOM_CH1_QUEUE_SIZE] = frame;
+    _ch1_count++;
+    return true;
+}
+
+/**
+ * @brief Adds encoded bytes to the Channel 2 scheduler.
+ * @details A pending entry with the same slot takes the new bytes and a fresh
+ *          lifetime but keeps its place in the order, so a value that is
+ *          updated faster than cutouts come is still sent in its turn.
+ * @param bytes The encoded bytes.
+ * @param len The number of bytes.
+ * @param priority The priority of the entry.
+ * @param slot The latest-value-wins slot, or `RAILCOM_NO_SLOT`.
+ * @return True if the entry was queued.
+ */
+bool RailcomTx::enqueueChannel2(const uint8_t* bytes, uint8_t len, RailcomPriority priority, uint16_t slot) {
+    if (len == 0 || len > RAILCOM_CH2_MAX_ENTRY_BYTES) return false;
+
+    if (slot != RAILCOM_NO_SLOT) {
+        for (uint8_t i = 0; i < _ch2_count; ++i) {
+            Ch2Entry& entry = _ch2_entries[i];
+            if (entry.slot != slot) continue;
+            entry.len = len;
+            if (priority > entry.priority) entry.priority = priority;
+            entry.expires_ms = millis() + CH2_LIFETIME_MS[static_cast<uint8_t>(entry.priority)];
+            memcpy(entry.bytes, bytes, len);
+            return true;
+        }
     }
 
-    if (elapsed_us < RAILCOM_CH2_DELAY_US) {
-        sleep_us(RAILCOM_CH2_DELAY_US - elapsed_us);
+    uint8_t index = _ch2_count;
+    if (_ch2_count >= RAILCOM_CH2_QUEUE_SIZE) {
+        // Replace the oldest entry of the lowest priority, if it ranks below the new one.
+        uint8_t victim = 0;
+        for (uint8_t i = 1; i < _ch2_count; ++i) {
+            const Ch2Entry& entry = _ch2_entries[i];
+            if (entry.priority < _ch2_entries[victim].priority ||
+                (entry.priority == _ch2_entries[victim].priority &&
+                 (int16_t)(entry.order - _ch2_entries[victim].order) < 0)) {
+                victim = i;
+            }
+        }
+        if (_ch2_entries[victim].priority >= priority) return false;
+        index = victim;
+    } else {
+        _ch2_count++;
+    }
+
+    Ch2Entry& entry = _ch2_entries[index];
+    entry.len = len;
+    entry.priority = priority;
+    entry.order = _ch2_order++;
+    entry.slot = slot;
+    entry.expires_ms = millis() + CH2_LIFETIME_MS[static_cast<uint8_t>(priority)];
+    memcpy(entry.bytes, bytes, len);
+    return true;
+}
+
+/**
+ * @brief Removes entries whose lifetime has passed.
+ * @param now_ms The current time in milliseconds.
+ */
+void RailcomTx::expireChannel2(uint32_t now_ms) {
+    uint8_t i = 0;
+    while (i < _ch2_count) {
+        if ((int32_t)(now_ms - _ch2_entries[i].expires_ms) > 0) {
+            _ch2_entries[i] = _ch2_entries[--_ch2_count];
+        } else {
+            ++i;
+        }
     }
+}
 
-    while (!_ch2_queue.empty()) {
-        const auto& msg = _ch2_queue.front();
-        _hardware->send_bytes(msg);
-        _ch2_queue.pop();
+/**
+ * @brief Returns the default Channel 2 priority of a message type.
+ * @param id The RailcomID of the message.
+ * @return The priority.
+ */
+RailcomPriority RailcomTx::priorityFor(RailcomID id) {
+    switch (id) {
+        case RailcomID::POM:
+        case RailcomID::XPOM_0:
+        case RailcomID::XPOM_1:
+        case RailcomID::XPOM_2:
+        case RailcomID::XPOM_3:
+        case RailcomID::DECODER_UNIQUE:
+        case RailcomID::DECODER_STATE:
+            return RailcomPriority::HIGH;
+        case RailcomID::CV_AUTO:
+        case RailcomID::TIME:
+            return RailcomPriority::LOW;
+        default:
+            return RailcomPriority::NORMAL;
     }
 }
 
+/**
+ * @brief Returns the latest-value-wins slot of a message.
+ * @param id The RailcomID of the message.
+ * @param payload The payload, for the EXT type and the DYN sub-index.
+ * @param payloadBits The number of payload bits, which tells apart the types of a shared ID.
+ * @return The slot, or `RAILCOM_NO_SLOT`.
+ */
+uint16_t RailcomTx::slotFor(RailcomID id, uint64_t payload, uint8_t payloadBits) {
+    using namespace RailcomSchema;
+    switch (id) {
+        case Info::ID:
+            if (payloadBits == Info::BITS) return makeSlot(SLOT_INFO);
+            if (payloadBits == Stat1::BITS) return makeSlot(SLOT_STAT1);
+            break;
+        case Ext::ID:
+            if (payloadBits == Ext::BITS) return makeSlot(SLOT_EXT, get<Ext, Ext::TYPE>(payload));
+            if (payloadBits == Stat4::BITS) return makeSlot(SLOT_STAT4);
+            break;
+        case Stat2::ID:
+            // XPOM_0 replies share the ID but carry 32 bits and are all sent.
+            if (payloadBits == Stat2::BITS) return makeSlot(SLOT_STAT2);
+            break;
+        case Time::ID:
+            if (payloadBits == Time::BITS) return makeSlot(SLOT_TIME);
+            break;
+        case Dyn::ID:
+            if (payloadBits == Dyn::BITS) return makeSlot(SLOT_DYN, get<Dyn, Dyn::SUB_INDEX>(payload));
+            break;
+        default:
+            break;
+    }
+    return RAILCOM_NO_SLOT;
+}
+
+/**
+ * @brief Checks whether the transmitter is idle.
+ * @return True if no cutout is in progress and nothing is waiting to be sent.
+ */
+bool RailcomTx::isIdle() const {
+    return !_in_cutout && _ch1_frame == nullptr && _ch2_frame == nullptr &&
+           _ch1_count == 0 && _ch2_count == 0 && _ds_count == 0;
+}
+
+/**
+ * @brief Returns when the last cutout transmission started.
+ */
+uint32_t RailcomTx::frameStartUs() const {
+    return _frame_start_us;
+}
+
+/**
+ * @brief Checks whether nothing is waiting to be sent on Channel 2.
+ * @return True if no Channel 2 frame or message is pending.
+ */
+bool RailcomTx::isChannel2Free() const {
+    return _ch2_frame == nullptr && _ch2_count == 0 && _ds_count == 0;
+}
+
+/**
+ * @brief Stores a pre-encoded frame for the next cutout.
+ * @param channel The channel (1 or 2) to send the frame on.
+ * @param frame The pre-encoded frame. Must remain valid until the cutout.
+ */
+void RailcomTx::sendFrame(uint8_t channel, const RailcomFrame* frame) {
+    if (frame == nullptr || frame->len == 0) return;
+    if (channel == 1) {
+        _ch1_frame = frame;
+    } else {
+        if (_ch2_frame != nullptr) {
+            // Only one frame can be handed over; further replies go through the scheduler.
+            enqueueChannel2(frame->bytes, frame->len, RailcomPriority::HIGH);
+            return;
+        }
+        _ch2_frame = frame;
+    }
+}
+
+/**
+ * @brief Copies a pre-encoded frame into the Channel 2 scheduler.
+ * @param frame The pre-encoded frame.
+ * @param priority The scheduling priority.
+ * @return True if the frame was queued.
+ */
+bool RailcomTx::queueFrame(const RailcomFrame& frame, RailcomPriority priority, uint16_t slot) {
+    return enqueueChannel2(frame.bytes, frame.len, priority, slot);
+}
+
 /**
  * @brief Encodes a message and adds it to the appropriate transmission queue.
  * @param channel The channel (1 or 2) to queue the message for.
  * @param id The RailcomID of the message.
  * @param payload The raw payload data.
  * @param payloadBits The number of bits in the payload.
+ * @param slot The latest-value-wins slot of a Channel 2 message.
  */
-void RailcomTx::sendDatagram(uint8_t channel, RailcomID id, uint64_t payload, uint8_t payloadBits) {
-    auto encodedMsg = RailcomEncoding::encodeDatagram(id, payload, payloadBits);
+void RailcomTx::sendDatagram(uint8_t channel, RailcomID id, uint64_t payload, uint8_t payloadBits, uint16_t slot) {
+    RailcomFrame frame;
+    RailcomEncoding::encodeFrame(id, payload, payloadBits, frame);
     if (channel == 1) {
-        _ch1_queue.push(encodedMsg);
+        enqueueChannel1(frame);
     } else {
-        _ch2_queue.push(encodedMsg);
+        enqueueChannel2(frame.bytes, frame.len, priorityFor(id), slot);
     }
 }
 
@@ -75,7 +384,7 @@ void RailcomTx::sendDatagram(uint8_t channel, RailcomID id, uint64_t payload, ui
  * @param cvValue The 8-bit value of the CV.
  */
 void RailcomTx::sendPomResponse(uint8_t cvValue) {
-    sendDatagram(2, RailcomID::POM, cvValue, 8);
+    sendMessage<RailcomSchema::Pom>(cvValue);
 }
 
 /**
@@ -85,11 +394,7 @@ void RailcomTx::sendPomResponse(uint8_t cvValue) {
  * @param statusFlags Additional status flags.
  */
 void RailcomTx::sendInfo(uint16_t speed, uint8_t motorLoad, uint8_t statusFlags) {
-    uint32_t payload = 0;
-    payload |= (uint32_t)speed << 16;
-    payload |= (uint32_t)motorLoad << 8;
-    payload |= (uint32_t)statusFlags;
-    sendDatagram(2, RailcomID::INFO, payload, 32);
+    sendMessage<RailcomSchema::Info>(speed, motorLoad, statusFlags);
 }
 
 /**
@@ -98,42 +403,51 @@ void RailcomTx::sendInfo(uint16_t speed, uint8_t motorLoad, uint8_t statusFlags)
  * @param position The position value.
  */
 void RailcomTx::sendExt(uint8_t type, uint8_t position) {
-    uint16_t payload = ((type & 0x07) << 8) | position;
-    sendDatagram(2, RailcomID::EXT, payload, 14);
+    sendMessage<RailcomSchema::Ext>(type & 0x07, position);
 }
 
 /**
- * @brief Queues an address broadcast message on Channel 1.
- * @details This function implements a state machine to alternate between sending
- *          ADR_HIGH, ADR_LOW, and optionally INFO1 messages. It correctly handles
- *          both short and long DCC addresses.
+ * @brief Hands the next frame of the Channel 1 address broadcast to the transmitter.
+ * @details The rotation ADR_HIGH, ADR_LOW (and INFO1) is encoded once by
+ *          `rebuildAddressRotation`. Each call only stores a pointer to the next
+ *          frame and advances the index.
  * @param address The decoder's address.
  */
 void RailcomTx::sendAddress(uint16_t address) {
-    uint8_t max_alternator = _info1_enabled ? 3 : 2;
-
-    switch (_address_alternator) {
-        case 0: // ADR_HIGH
-            if (address >= MIN_SHORT_ADDRESS && address <= MAX_SHORT_ADDRESS) {
-                sendDatagram(1, RailcomID::ADR_HIGH, 0, 8);
-            } else {
-                sendDatagram(1, RailcomID::ADR_HIGH, (address >> 8) & 0x3F, 6);
-            }
-            break;
-        case 1: // ADR_LOW
-            if (address >= MIN_SHORT_ADDRESS && address <= MAX_SHORT_ADDRESS) {
-                sendDatagram(1, RailcomID::ADR_LOW, address & 0x7F, 8);
-            } else {
-                sendDatagram(1, RailcomID::ADR_LOW, address & 0xFF, 8);
-            }
-            break;
-        case 2: // INFO1
-            if (_info1_enabled) {
-                sendDatagram(1, RailcomID::INFO1, _info1_payload, 8);
-            }
-            break;
+    if (!_adr_rotation_valid || address != _adr_rotation_address) {
+        rebuildAddressRotation(address);
+    }
+    _ch1_frame = &_adr_rotation[_adr_rotation_index];
+    if (++_adr_rotation_index >= _adr_rotation_len) {
+        _adr_rotation_index = 0;
     }
-    _address_alternator = (_address_alternator + 1) % max_alternator;
+}
+
+/**
+ * @brief Encodes the Channel 1 rotation.
+ * @details Short addresses are sent as ADR_HIGH=0 / ADR_LOW=address, long
+ *          addresses as the upper 6 and lower 8 bits. The position in the
+ *          rotation is kept unless it falls outside the new rotation.
+ * @param address The decoder's address.
+ */
+void RailcomTx::rebuildAddressRotation(uint16_t address) {
+    if (address >= MIN_SHORT_ADDRESS && address <= MAX_SHORT_ADDRESS) {
+        RailcomEncoding::encodeMessage<RailcomSchema::AdrHigh>(_adr_rotation[0], 0);
+        RailcomEncoding::encodeMessage<RailcomSchema::AdrLow>(_adr_rotation[1], address & 0x7F);
+    } else {
+        RailcomEncoding::encodeMessage<RailcomSchema::AdrHigh>(_adr_rotation[0], address >> 8);
+        RailcomEncoding::encodeMessage<RailcomSchema::AdrLow>(_adr_rotation[1], address);
+    }
+    _adr_rotation_len = 2;
+    if (_info1_enabled) {
+        RailcomEncoding::encodeFrame(RailcomSchema::Info1::ID, _info1_payload, RailcomSchema::Info1::BITS, _adr_rotation[2]);
+        _adr_rotation_len = 3;
+    }
+    if (_adr_rotation_index >= _adr_rotation_len) {
+        _adr_rotation_index = 0;
+    }
+    _adr_rotation_address = address;
+    _adr_rotation_valid = true;
 }
 
 /**
@@ -142,13 +456,9 @@ void RailcomTx::sendAddress(uint16_t address) {
  * @return The calculated 8-bit payload.
  */
 uint8_t RailcomTx::buildInfo1Payload(const Info1Message& info1) {
-    uint8_t payload = 0;
-    payload |= (info1.on_track_direction_is_positive ? 1 : 0) << 0;
-    payload |= (info1.travel_direction_is_positive ? 1 : 0) << 1;
-    payload |= (info1.is_moving ? 1 : 0) << 2;
-    payload |= (info1.is_in_consist ? 1 : 0) << 3;
-    payload |= (info1.request_addressing ? 1 : 0) << 4;
-    return payload;
+    return RailcomSchema::pack<RailcomSchema::Info1>(
+        info1.request_addressing, info1.is_in_consist, info1.is_moving,
+        info1.travel_direction_is_positive, info1.on_track_direction_is_positive);
 }
 
 /**
@@ -156,7 +466,11 @@ uint8_t RailcomTx::buildInfo1Payload(const Info1Message& info1) {
  * @param info1 The Info1Message data to be sent.
  */
 void RailcomTx::enableInfo1(const Info1Message& info1) {
-    _info1_payload = buildInfo1Payload(info1);
+    uint8_t payload = buildInfo1Payload(info1);
+    if (!_info1_enabled || payload != _info1_payload) {
+        _adr_rotation_valid = false;
+    }
+    _info1_payload = payload;
     _info1_enabled = true;
 }
 
@@ -164,20 +478,30 @@ void RailcomTx::enableInfo1(const Info1Message& info1) {
  * @brief Disables the INFO1 message in the Channel 1 address broadcast cycle.
  */
 void RailcomTx::disableInfo1() {
+    if (_info1_enabled) {
+        _adr_rotation_valid = false;
+    }
     _info1_enabled = false;
-    if (_address_alternator > 1) {
-        _address_alternator = 0;
+    if (_adr_rotation_index > 1) {
+        _adr_rotation_index = 0;
     }
 }
 
+/**
+ * @brief Checks whether INFO1 is part of the Channel 1 broadcast cycle.
+ * @return True if INFO1 is enabled.
+ */
+bool RailcomTx::isInfo1Enabled() const {
+    return _info1_enabled;
+}
+
 /**
  * @brief Queues a dynamic data (DYN) message on Channel 2.
  * @param subIndex The sub-index of the data.
  * @param value The value of the data.
  */
 void RailcomTx::sendDynamicData(uint8_t subIndex, uint8_t value) {
-    uint16_t payload = (value << 6) | (subIndex & 0x3F);
-    sendDatagram(2, RailcomID::DYN, payload, 14);
+    sendMessage<RailcomSchema::Dyn>(value, subIndex);
 }
 
 /**
@@ -186,8 +510,7 @@ void RailcomTx::sendDynamicData(uint8_t subIndex, uint8_t value) {
  * @param cvValue The value of the CV.
  */
 void RailcomTx::sendCvAuto(uint32_t cvAddress, uint8_t cvValue) {
-    uint32_t payload = ((cvAddress & 0xFFFFFF) << 8) | cvValue;
-    sendDatagram(2, RailcomID::CV_AUTO, payload, 32);
+    sendMessage<RailcomSchema::CvAuto>(cvAddress, cvValue);
 }
 
 /**
@@ -198,8 +521,8 @@ void RailcomTx::sendCvAuto(uint32_t cvAddress, uint8_t cvValue) {
 void RailcomTx::sendXpomResponse(uint8_t sequence, const uint8_t cvValues[4]) {
     if (sequence > MAX_XPOM_SEQUENCE) return;
     RailcomID id = static_cast<RailcomID>(static_cast<uint8_t>(RailcomID::XPOM_0) + sequence);
-    uint32_t payload = (uint32_t)cvValues[0] << 24 | (uint32_t)cvValues[1] << 16 | (uint32_t)cvValues[2] << 8 | cvValues[3];
-    sendDatagram(2, id, payload, 32);
+    uint64_t payload = RailcomSchema::pack<RailcomSchema::Xpom>(cvValues[0], cvValues[1], cvValues[2], cvValues[3]);
+    sendDatagram(2, id, payload, RailcomSchema::Xpom::BITS);
 }
 
 /**
@@ -208,9 +531,9 @@ void RailcomTx::sendXpomResponse(uint8_t sequence, const uint8_t cvValues[4]) {
  * @param secondsSincePowerOn The time since power on, capped at 255.
  */
 void RailcomTx::handleRerailingSearch(uint16_t address, uint32_t secondsSincePowerOn) {
-    sendDatagram(2, RailcomID::ADR_HIGH, (address >> 8) & 0x3F, 6);
-    sendDatagram(2, RailcomID::ADR_LOW, address & 0xFF, 8);
-    sendDatagram(2, RailcomID::RERAIL, secondsSincePowerOn > MAX_RERAIL_SECONDS ? MAX_RERAIL_SECONDS : secondsSincePowerOn, 8);
+    sendMessage<RailcomSchema::AdrHigh>(address >> 8);
+    sendMessage<RailcomSchema::AdrLow>(address);
+    sendMessage<RailcomSchema::Rerail>(secondsSincePowerOn > MAX_RERAIL_SECONDS ? MAX_RERAIL_SECONDS : secondsSincePowerOn);
 }
 
 /**
@@ -218,7 +541,7 @@ void RailcomTx::handleRerailingSearch(uint16_t address, uint32_t secondsSincePow
  * @param data The 32-bit data payload.
  */
 void RailcomTx::sendBlock(uint32_t data) {
-    sendDatagram(2, RailcomID::BLOCK, data, 32);
+    sendMessage<RailcomSchema::Block>(data);
 }
 
 /**
@@ -229,7 +552,9 @@ void RailcomTx::sendBlock(uint32_t data) {
  */
 void RailcomTx::sendServiceRequest(uint16_t accessoryAddress, bool isExtended) {
     if (accessoryAddress > MAX_ACCESSORY_ADDRESS) return;
-    _ch1_queue.push(RailcomEncoding::encodeServiceRequest(accessoryAddress, isExtended));
+    RailcomFrame frame;
+    RailcomEncoding::encodeServiceRequest(accessoryAddress, isExtended, frame);
+    enqueueChannel1(frame);
 }
 
 /**
@@ -237,7 +562,7 @@ void RailcomTx::sendServiceRequest(uint16_t accessoryAddress, bool isExtended) {
  * @param status The 8-bit status payload.
  */
 void RailcomTx::sendStatus1(uint8_t status) {
-    sendDatagram(2, RailcomID::STAT1, status, 8);
+    sendMessage<RailcomSchema::Stat1>(status);
 }
 
 /**
@@ -245,7 +570,7 @@ void RailcomTx::sendStatus1(uint8_t status) {
  * @param status The 8-bit status payload.
  */
 void RailcomTx::sendStatus4(uint8_t status) {
-    sendDatagram(2, RailcomID::STAT4, status, 8);
+    sendMessage<RailcomSchema::Stat4>(status);
 }
 
 /**
@@ -253,7 +578,7 @@ void RailcomTx::sendStatus4(uint8_t status) {
  * @param status The 8-bit status payload.
  */
 void RailcomTx::sendStatus2(uint8_t status) {
-    sendDatagram(2, RailcomID::STAT2, status, 8);
+    sendMessage<RailcomSchema::Stat2>(status);
 }
 
 /**
@@ -263,8 +588,7 @@ void RailcomTx::sendStatus2(uint8_t status) {
  */
 void RailcomTx::sendTime(uint8_t timeValue, bool unit_is_second) {
     if (timeValue > 127) timeValue = 127;
-    uint8_t payload = (unit_is_second ? 0x80 : 0x00) | timeValue;
-    sendDatagram(2, RailcomID::TIME, payload, 8);
+    sendMessage<RailcomSchema::Time>(unit_is_second, timeValue);
 }
 
 /**
@@ -272,17 +596,16 @@ void RailcomTx::sendTime(uint8_t timeValue, bool unit_is_second) {
  * @param errorCode The 8-bit error code.
  */
 void RailcomTx::sendError(uint8_t errorCode) {
-    sendDatagram(2, RailcomID::ERROR, errorCode, 8);
+    sendMessage<RailcomSchema::Error>(errorCode);
 }
 
 /**
  * @brief Queues a decoder unique ID (DECODER_UNIQUE) message on Channel 2.
- * @param manufacturerId The 16-bit manufacturer ID.
+ * @param manufacturerId The 12-bit manufacturer ID.
  * @param productId The 32-bit product ID.
  */
 void RailcomTx::sendDecoderUnique(uint16_t manufacturerId, uint32_t productId) {
-    uint64_t payload = ((uint64_t)(manufacturerId & 0x0FFF) << 32) | (productId & 0xFFFFFFFF);
-    sendDatagram(2, RailcomID::DECODER_UNIQUE, payload, 44);
+    sendMessage<RailcomSchema::DecoderUnique>(manufacturerId, productId);
 }
 
 /**
@@ -292,68 +615,85 @@ void RailcomTx::sendDecoderUnique(uint16_t manufacturerId, uint32_t productId) {
  * @param protocolCaps Flags indicating protocol capabilities.
  */
 void RailcomTx::sendDecoderState(uint8_t changeFlags, uint16_t changeCount, uint16_t protocolCaps) {
-    uint64_t payload = 0;
-    payload |= (uint64_t)(changeFlags & 0xFF) << 36;
-    payload |= (uint64_t)(changeCount & 0x0FFF) << 24;
-    payload |= (uint64_t)(protocolCaps & 0xFFFF) << 8;
-    // 8 bits reserved
-    sendDatagram(2, RailcomID::DECODER_STATE, payload, 44);
+    // The lowest 8 bits are reserved.
+    sendMessage<RailcomSchema::DecoderState>(changeFlags, changeCount, protocolCaps);
 }
 
 /**
- * @brief Queues a Data Space message.
+ * @brief Queues a Data Space message as a sequence of blocks.
  * @details This is a special message type that doesn't use the standard datagram
- *          format. It performs a 4-of-8 encoding on the raw data and its CRC, then
- *          splits the result across Channel 1 and Channel 2 as per RCN-218.
+ *          format. Each block consists of a header with its length, sequence
+ *          number and last-block flag, up to
+ *          `DATA_SPACE_CHUNK_SIZE` data bytes and a CRC seeded with the data
+ *          space number. The block is packed into at most 8 4-of-8 symbols,
+ *          which are split across Channel 1 and Channel 2 as per RCN-218.
+ *          The encoded blocks are kept in a fixed ring, so no memory is
+ *          allocated, whatever the length of the payload.
  * @param data Pointer to the data payload.
  * @param len The length of the data.
  * @param dataSpaceNum The data space number, used to seed the CRC.
+ * @return False if the arena has no room for all blocks.
  */
-void RailcomTx::sendDataSpace(const uint8_t* data, size_t len, uint8_t dataSpaceNum) {
-    uint8_t header = (len & DATASPACE_LEN_MASK);
-    uint8_t buffer[33];
-    buffer[0] = header;
-    memcpy(buffer + 1, data, len);
-    uint8_t crc = RailcomEncoding::crc8(buffer, len + 1, dataSpaceNum);
-    std::vector<uint8_t> encodedBytes;
-    encodedBytes.reserve(len + 2);
-
-    // Encode header, data, and CRC using 4-of-8 encoding
-    encodedBytes.push_back(RailcomEncoding::encode4of8(header));
-    for (size_t i = 0; i < len; ++i) {
-        encodedBytes.push_back(RailcomEncoding::encode4of8(data[i]));
+bool RailcomTx::sendDataSpace(const uint8_t* data, size_t len, uint8_t dataSpaceNum) {
+    size_t blocks = len == 0 ? 1 : (len + DATA_SPACE_CHUNK_SIZE - 1) / DATA_SPACE_CHUNK_SIZE;
+    if (blocks > (size_t)(RAILCOM_DATA_SPACE_BLOCKS - _ds_count)) {
+        return false;
     }
-    encodedBytes.push_back(RailcomEncoding::encode4of8(crc));
-
-    // Per RCN-218, Data Space messages are split across channels.
-    // The first two bytes go to Channel 1, the rest to Channel 2.
-    if (encodedBytes.size() >= 2) {
-        _ch1_queue.push(std::vector<uint8_t>(encodedBytes.begin(), encodedBytes.begin() + 2));
-        if (encodedBytes.size() > 2) {
-            _ch2_queue.push(std::vector<uint8_t>(encodedBytes.begin() + 2, encodedBytes.end()));
-        }
-    } else if (!encodedBytes.empty()) {
-        // Handle cases with less than 2 bytes, though unlikely for this message type.
-        _ch1_queue.push(encodedBytes);
+
+    uint8_t block[DATA_SPACE_CHUNK_SIZE + 2];
+    uint8_t seq = 0;
+    for (size_t offset = 0; blocks > 0; --blocks, offset += DATA_SPACE_CHUNK_SIZE) {
+        uint8_t chunk = len - offset < DATA_SPACE_CHUNK_SIZE ? len - offset : DATA_SPACE_CHUNK_SIZE;
+        block[0] = (chunk & DATASPACE_LEN_MASK) | (seq << DATASPACE_SEQ_SHIFT) | (blocks == 1 ? DATASPACE_LAST_BLOCK : 0);
+        seq = seq % DATASPACE_SEQ_CYCLE + 1;
+        memcpy(block + 1, data + offset, chunk);
+        block[chunk + 1] = RailcomEncoding::crc8(block, chunk + 1, dataSpaceNum);
+
+        RailcomFrame& frame = _ds_blocks[(_ds_head + _ds_count) % RAILCOM_DATA_SPACE_BLOCKS];
+        frame.len = RailcomEncoding::encodeBytes(block, chunk + 2, frame.bytes);
+        _ds_count++;
     }
+    return true;
+}
+
+/**
+ * @brief Checks whether Data Space blocks are waiting to be sent.
+ * @return True if the block arena is not empty.
+ */
+bool RailcomTx::isSendingDataSpace() const {
+    return _ds_count > 0;
+}
+
+/**
+ * @brief Drops the Data Space blocks that have not been sent yet.
+ */
+void RailcomTx::cancelDataSpace() {
+    _ds_head = (_ds_head + _ds_count) % RAILCOM_DATA_SPACE_BLOCKS;
+    _ds_count = 0;
 }
 
 /**
  * @brief Queues the ACK signal bytes on both channels.
  */
 void RailcomTx::sendAck() {
-    std::vector<uint8_t> ackBytes = { RAILCOM_ACK1, RAILCOM_ACK2 };
-    _ch1_queue.push(ackBytes);
-    ackBytes = { RAILCOM_ACK1, RAILCOM_ACK2, RAILCOM_ACK1, RAILCOM_ACK2 };
-    _ch2_queue.push(ackBytes);
+    RailcomFrame ch1;
+    ch1.bytes[0] = RAILCOM_ACK1;
+    ch1.bytes[1] = RAILCOM_ACK2;
+    ch1.len = 2;
+    enqueueChannel1(ch1);
+    const uint8_t ch2Bytes[] = { RAILCOM_ACK1, RAILCOM_ACK2, RAILCOM_ACK1, RAILCOM_ACK2 };
+    enqueueChannel2(ch2Bytes, sizeof(ch2Bytes), RailcomPriority::HIGH);
 }
 
 /**
  * @brief Queues the NACK signal bytes on both channels.
  */
 void RailcomTx::sendNack() {
-    std::vector<uint8_t> nackBytes = { RAILCOM_NACK, RAILCOM_NACK };
-    _ch1_queue.push(nackBytes);
-    nackBytes = { RAILCOM_NACK, RAILCOM_NACK, RAILCOM_NACK, RAILCOM_NACK };
-    _ch2_queue.push(nackBytes);
+    RailcomFrame ch1;
+    ch1.bytes[0] = RAILCOM_NACK;
+    ch1.bytes[1] = RAILCOM_NACK;
+    ch1.len = 2;
+    enqueueChannel1(ch1);
+    const uint8_t ch2Bytes[] = { RAILCOM_NACK, RAILCOM_NACK, RAILCOM_NACK, RAILCOM_NACK };
+    enqueueChannel2(ch2Bytes, sizeof(ch2Bytes), RailcomPriority::HIGH);
 }
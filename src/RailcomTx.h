@@ -11,8 +11,35 @@
 
 #include "Railcom.h"
 #include "RailcomTxHardware.h"
-#include <vector>
-#include <queue>
+#include "RailcomEncoding.h"
+#include "RailcomSchema.h"
+
+/** @brief Number of Channel 1 replies (ACK/NACK, SRQ) that can wait for a cutout. */
+constexpr uint8_t RAILCOM_CH1_QUEUE_SIZE = 4;
+/** @brief Number of entries in the Channel 2 scheduler. */
+constexpr uint8_t RAILCOM_CH2_QUEUE_SIZE = 8;
+/** @brief Maximum number of encoded bytes in a Channel 2 entry (a DECODER_UNIQUE or DECODER_STATE message). */
+constexpr uint8_t RAILCOM_CH2_MAX_ENTRY_BYTES = RAILCOM_MAX_DATAGRAM_BYTES;
+/**
+ * @brief Number of Data Space blocks the transmitter can hold.
+ * @details Each block carries `DATA_SPACE_CHUNK_SIZE` bytes, so 128 blocks hold a
+ *          512-byte data space.
+ */
+constexpr uint8_t RAILCOM_DATA_SPACE_BLOCKS = DATA_SPACE_MAX_SIZE / DATA_SPACE_CHUNK_SIZE;
+/** @brief Slot key of a Channel 2 entry that is never replaced by a newer message. */
+constexpr uint16_t RAILCOM_NO_SLOT = 0;
+
+/**
+ * @enum RailcomPriority
+ * @brief The priority of a Channel 2 message.
+ * @details Higher priorities are sent first. Each priority also has a lifetime
+ *          after which an unsent message is dropped as stale.
+ */
+enum class RailcomPriority : uint8_t {
+    LOW = 0,    ///< Background information, e.g. CV_AUTO or TIME (500 ms lifetime).
+    NORMAL = 1, ///< Status and information messages (1 s lifetime).
+    HIGH = 2    ///< Replies to addressed commands, e.g. POM, ACK/NACK, logon (1 s lifetime).
+};
 
 /**
  * @class RailcomTx
@@ -20,7 +47,14 @@
  * @details This class is responsible for sending all types of RailCom messages.
  *          It queues messages for Channel 1 (address broadcast) and Channel 2
  *          (data), and sends them when the `on_cutout_start` method is called,
- *          simulating the DCC cutout period.
+ *          simulating the DCC cutout period. Channel 2 messages are scheduled by
+ *          priority and packed into the 6-byte window; whatever does not fit is
+ *          kept for a later cutout until it expires. Messages that report a
+ *          current value (INFO, EXT, STAT1/2/4, TIME and DYN per sub-index)
+ *          have a slot: a newer value replaces a pending one in place, so
+ *          repeated calls between two cutouts occupy one entry and only the
+ *          latest value is sent. Data Space blocks fill a whole cutout and are
+ *          sent one per cutout, ahead of everything else.
  */
 class RailcomTx {
 public:
@@ -43,12 +77,21 @@ public:
     /**
      * @brief Called by the application to signal the start of a DCC cutout.
      * @details This method triggers the transmission of any queued messages.
-     *          It sends a Channel 1 message, followed by a Channel 2 message
-     *          if one is available in the queue.
+     *          It selects a Channel 1 message and as many Channel 2 messages as
+     *          fit into the Channel 2 window, highest priority first, and hands
+     *          both to the hardware in one `send_frame()` call.
      * @param elapsed_us The time in microseconds since the last cutout, used for timing.
      */
     void on_cutout_start(uint32_t elapsed_us = 0);
 
+    /**
+     * @brief Keeps Channel 2 silent in the next cutout.
+     * @details Call this when the DCC packet preceding the cutout was addressed to
+     *          another decoder; its Channel 2 window belongs to that decoder. The
+     *          queued messages are kept for the next cutout.
+     */
+    void holdChannel2();
+
     // --- Vehicle Decoder (MOB) Functions ---
 
     /**
@@ -78,9 +121,11 @@ public:
 
     /**
      * @brief Sends the decoder's address on Channel 1.
-     * @details This method handles both short and long addresses. For long addresses,
-     *          it alternates between sending ADR_HIGH and ADR_LOW messages.
-     *          It can also be configured to send INFO1 messages in the broadcast cycle.
+     * @details This method handles both short and long addresses. It alternates
+     *          between sending ADR_HIGH and ADR_LOW messages, and INFO1 if enabled.
+     *          The encoded frames of the rotation are cached and only rebuilt when
+     *          the address or the INFO1 payload changes, so each call just hands
+     *          over a pointer for the next cutout.
      * @param address The decoder's 14-bit address.
      * @see RCN-217, 5.2.2 & 5.2.3
      */
@@ -98,6 +143,80 @@ public:
      */
     void disableInfo1();
 
+    /**
+     * @brief Checks whether INFO1 is part of the Channel 1 broadcast cycle.
+     * @return True if `enableInfo1` is in effect.
+     */
+    bool isInfo1Enabled() const;
+
+    /**
+     * @brief Checks whether the transmitter is neither sending nor holding data for the next cutout.
+     * @details Used to schedule work that stalls the CPU, such as flash writes,
+     *          so that it does not delay a pending reply.
+     * @return True if no cutout is in progress and all queues are empty.
+     */
+    bool isIdle() const;
+
+    /**
+     * @brief Returns when the last cutout transmission started.
+     * @details Taken right before `RailcomTxHardware::send_frame()` is called,
+     *          i.e. when Channel 1 starts.
+     * @return The `time_us_32()` of the last `on_cutout_start()`.
+     */
+    uint32_t frameStartUs() const;
+
+    /**
+     * @brief Checks whether nothing is waiting to be sent on Channel 2.
+     * @details Lets low-priority senders such as the CV_AUTO broadcast use only
+     *          Channel 2 slots that no reply needs.
+     * @return True if no Channel 2 frame or message is pending.
+     */
+    bool isChannel2Free() const;
+
+    /**
+     * @brief Hands a pre-encoded frame to the transmitter for the next cutout.
+     * @details Only the pointer is stored; no encoding or copying takes place
+     *          until the cutout starts. The frame must stay valid until then.
+     *          A Channel 2 frame is sent before any scheduled message. If one is
+     *          already pending, the new frame is copied into the scheduler with
+     *          high priority so that it is not lost.
+     * @param channel The channel (1 or 2) to send the frame on.
+     * @param frame The pre-encoded frame.
+     */
+    void sendFrame(uint8_t channel, const RailcomFrame* frame);
+
+    /**
+     * @brief Copies a pre-encoded frame into the Channel 2 scheduler.
+     * @details Unlike `sendFrame`, the frame is copied, so it may be encoded
+     *          elsewhere (e.g. on the other core) and discarded afterwards.
+     * @param frame The pre-encoded frame.
+     * @param priority The scheduling priority.
+     * @param slot The latest-value-wins slot of the message (see `slotFor`),
+     *        or `RAILCOM_NO_SLOT`.
+     * @return True if the frame was queued.
+     */
+    bool queueFrame(const RailcomFrame& frame, RailcomPriority priority, uint16_t slot = RAILCOM_NO_SLOT);
+
+    /**
+     * @brief Returns the default Channel 2 priority of a message type.
+     * @param id The RailcomID of the message.
+     * @return The priority.
+     */
+    static RailcomPriority priorityFor(RailcomID id);
+
+    /**
+     * @brief Returns the latest-value-wins slot of a message.
+     * @details The slot is keyed by the message type: INFO, STAT1, STAT4,
+     *          STAT2 and TIME have one slot each, EXT one per type field and
+     *          DYN one per sub-index. Types sharing an ID (EXT/STAT4,
+     *          INFO/STAT1, STAT2/XPOM_0) are told apart by their payload size.
+     * @param id The RailcomID of the message.
+     * @param payload The payload, for the EXT type and the DYN sub-index.
+     * @param payloadBits The number of payload bits.
+     * @return The slot, or `RAILCOM_NO_SLOT` for messages that are all sent.
+     */
+    static uint16_t slotFor(RailcomID id, uint64_t payload, uint8_t payloadBits);
+
     /**
      * @brief Sends a dynamic data message (ID 7) on Channel 2.
      * @param subIndex The sub-index of the data.
@@ -187,7 +306,7 @@ public:
 
     /**
      * @brief Sends the decoder's unique ID (ID 15) on Channel 2.
-     * @param manufacturerId The 16-bit manufacturer ID.
+     * @param manufacturerId The 12-bit manufacturer ID.
      * @param productId The 32-bit unique product ID.
      * @see RCN-218, 4.3
      */
@@ -203,14 +322,37 @@ public:
     virtual void sendDecoderState(uint8_t changeFlags, uint16_t changeCount, uint16_t protocolCaps);
 
     /**
-     * @brief Sends a Data Space message on Channel 2.
+     * @brief Sends a Data Space message, split into cutout-sized blocks.
      * @details This is a special message format without a standard RailCom ID.
+     *          The payload is split into blocks of `DATA_SPACE_CHUNK_SIZE` bytes.
+     *          Each block has its own header and CRC and fills Channel 1 and
+     *          Channel 2 of one cutout; the blocks are sent in consecutive open
+     *          cutouts. The header holds the number of data bytes, the sequence
+     *          number of the block (0 for the first, then cycling through 1 to
+     *          `DATASPACE_SEQ_CYCLE`) and `DATASPACE_LAST_BLOCK` in the last one,
+     *          so the receiver can place each block even if others are lost. An
+     *          empty payload is sent as one empty block.
      * @param data A pointer to the data payload.
      * @param len The length of the data payload.
      * @param dataSpaceNum The data space number this message belongs to.
-     * @see RCN-218, 5.2
+     * @return False if the blocks do not fit into the free part of the
+     *         `RAILCOM_DATA_SPACE_BLOCKS` arena; nothing is queued then.
+     * @see RCN-218, 4.3
+     */
+    bool sendDataSpace(const uint8_t* data, size_t len, uint8_t dataSpaceNum);
+
+    /**
+     * @brief Checks whether Data Space blocks are waiting to be sent.
+     * @return True if a reply queued by `sendDataSpace()` is not complete yet.
      */
-    void sendDataSpace(const uint8_t* data, size_t len, uint8_t dataSpaceNum);
+    bool isSendingDataSpace() const;
+
+    /**
+     * @brief Drops the Data Space blocks that have not been sent yet.
+     * @details Used when the command station asks for another part of a data
+     *          space before the current reply is complete.
+     */
+    void cancelDataSpace();
 
     /**
      * @brief Sends an ACK (Acknowledge) signal on Channel 2.
@@ -231,8 +373,69 @@ private:
      * @param id The RailcomID of the message.
      * @param payload The message payload data.
      * @param payloadBits The number of bits in the payload.
+     * @param slot The latest-value-wins slot of a Channel 2 message, or `RAILCOM_NO_SLOT`.
+     */
+    void sendDatagram(uint8_t channel, RailcomID id, uint64_t payload, uint8_t payloadBits,
+                      uint16_t slot = RAILCOM_NO_SLOT);
+
+    /**
+     * @brief Packs the fields of a message with its schema and queues it on Channel 2.
+     * @tparam M The schema from RailcomSchema.h.
+     * @param values One value per field, in the order of `M::FIELDS`.
+     */
+    template <typename M, typename... V>
+    void sendMessage(V... values) {
+        uint64_t payload = RailcomSchema::pack<M>(values...);
+        sendDatagram(2, M::ID, payload, M::BITS, slotFor(M::ID, payload, M::BITS));
+    }
+
+    /**
+     * @brief Adds a frame to the Channel 1 queue.
+     * @param frame The encoded frame.
+     * @return False if the queue is full; the frame is dropped then.
+     */
+    bool enqueueChannel1(const RailcomFrame& frame);
+
+    /**
+     * @brief Adds encoded bytes to the Channel 2 scheduler.
+     * @details An entry with the same slot is overwritten in place. Otherwise,
+     *          if the scheduler is full, the oldest entry of the lowest priority
+     *          is replaced, provided its priority is below the new entry's.
+     * @param bytes The encoded bytes.
+     * @param len The number of bytes (at most `RAILCOM_CH2_MAX_ENTRY_BYTES`).
+     * @param priority The priority of the entry.
+     * @param slot The latest-value-wins slot, or `RAILCOM_NO_SLOT`.
+     * @return True if the entry was queued.
      */
-    void sendDatagram(uint8_t channel, RailcomID id, uint64_t payload, uint8_t payloadBits);
+    bool enqueueChannel2(const uint8_t* bytes, uint8_t len, RailcomPriority priority,
+                         uint16_t slot = RAILCOM_NO_SLOT);
+
+    /**
+     * @brief Removes entries whose lifetime has passed.
+     * @param now_ms The current time in milliseconds.
+     */
+    void expireChannel2(uint32_t now_ms);
+
+    /**
+     * @brief Fills the Channel 2 window: the handed-over frame, then the
+     *        highest-priority entries that fit.
+     * @param[out] window Receives the bytes; must hold `RAILCOM_MAX_DATAGRAM_BYTES`.
+     * @return The number of bytes in `window`.
+     */
+    uint8_t fillChannel2(uint8_t* window);
+
+    /**
+     * @struct Ch2Entry
+     * @brief A message waiting in the Channel 2 scheduler.
+     */
+    struct Ch2Entry {
+        uint8_t len;                                ///< Number of encoded bytes.
+        RailcomPriority priority;                   ///< Scheduling priority.
+        uint16_t order;                             ///< Enqueue order, for FIFO within a priority.
+        uint16_t slot;                              ///< Latest-value-wins slot, or `RAILCOM_NO_SLOT`.
+        uint32_t expires_ms;                        ///< Time (millis) after which the entry is dropped.
+        uint8_t bytes[RAILCOM_CH2_MAX_ENTRY_BYTES]; ///< The encoded bytes.
+    };
 
     /**
      * @brief Builds the 8-bit payload for an INFO1 message from its struct.
@@ -241,13 +444,41 @@ private:
      */
     uint8_t buildInfo1Payload(const Info1Message& info1);
 
+    /**
+     * @brief Encodes the Channel 1 rotation for an address and the current INFO1 settings.
+     * @param address The decoder's address.
+     */
+    void rebuildAddressRotation(uint16_t address);
+
     RailcomTxHardware* _hardware; ///< Pointer to the hardware abstraction layer.
-    uint8_t _address_alternator; ///< State machine for alternating ADR_HIGH, ADR_LOW, INFO1.
     bool _info1_enabled;         ///< Flag to enable/disable INFO1 broadcast.
     uint8_t _info1_payload;      ///< Cached payload for INFO1 messages.
 
-    std::queue<std::vector<uint8_t>> _ch1_queue; ///< Queue for Channel 1 messages.
-    std::queue<std::vector<uint8_t>> _ch2_queue; ///< Queue for Channel 2 messages.
+    RailcomFrame _adr_rotation[3];   ///< Encoded ADR_HIGH, ADR_LOW and INFO1 frames.
+    uint8_t _adr_rotation_len;       ///< Number of frames in the rotation (2, or 3 with INFO1).
+    uint8_t _adr_rotation_index;     ///< Index of the next frame to broadcast.
+    uint16_t _adr_rotation_address;  ///< The address encoded in `_adr_rotation`.
+    bool _adr_rotation_valid;        ///< False if the rotation must be rebuilt.
+
+    RailcomFrame _ch1_queue[RAILCOM_CH1_QUEUE_SIZE]; ///< Ring of queued Channel 1 messages.
+    uint8_t _ch1_head;                               ///< Index of the oldest Channel 1 message.
+    uint8_t _ch1_count;                              ///< Number of Channel 1 messages waiting.
+
+    Ch2Entry _ch2_entries[RAILCOM_CH2_QUEUE_SIZE]; ///< Channel 2 scheduler entries (unordered).
+    uint8_t _ch2_count;                            ///< Number of entries in use.
+    uint16_t _ch2_order;                           ///< Order stamp for the next entry.
+    bool _ch2_hold;                                ///< True if Channel 2 stays silent in the next cutout.
+
+    RailcomFrame _ds_blocks[RAILCOM_DATA_SPACE_BLOCKS]; ///< Ring of encoded Data Space blocks.
+    uint8_t _ds_head;                                  ///< Index of the oldest block.
+    uint8_t _ds_count;                                 ///< Number of blocks waiting.
+
+    volatile bool _in_cutout;   ///< True while `on_cutout_start` is transmitting.
+    uint32_t _frame_start_us;   ///< `time_us_32()` when the last `send_frame()` started.
+
+    const RailcomFrame* _ch1_frame; ///< Pre-encoded frame handed over for the next Channel 1 slot.
+    const RailcomFrame* _ch2_frame; ///< Pre-encoded frame handed over for the next Channel 2 slot.
+    uint8_t _ch2_window[RAILCOM_MAX_DATAGRAM_BYTES]; ///< The Channel 2 bytes of the current cutout.
 };
 
 #endif // RAILCOM_TX_H
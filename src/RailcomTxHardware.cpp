@@ -0,0 +1,32 @@
+/**
+ * @file RailcomTxHardware.cpp
+ * @brief Default implementations of the RailcomTxHardware interface.
+ */
+#include "RailcomTxHardware.h"
+#include "pico/time.h"
+
+/**
+ * @brief Sends both channels of a cutout with `send()`.
+ * @details The time spent sending Channel 1 counts towards the Channel 2 offset,
+ *          so Channel 2 starts at the same point whatever Channel 1 carried.
+ * @param ch1 The Channel 1 bytes.
+ * @param ch1_len The number of Channel 1 bytes.
+ * @param ch2 The Channel 2 bytes.
+ * @param ch2_len The number of Channel 2 bytes.
+ * @param ch2_offset_us The time in microseconds from the call to the start of Channel 2.
+ */
+void RailcomTxHardware::send_frame(const uint8_t* ch1, size_t ch1_len,
+                                   const uint8_t* ch2, size_t ch2_len, uint32_t ch2_offset_us) {
+    uint64_t start = time_us_64();
+    if (ch1_len > 0) {
+        send(ch1, ch1_len);
+    }
+    if (ch2_len == 0) {
+        return;
+    }
+    uint64_t elapsed = time_us_64() - start;
+    if (elapsed < ch2_offset_us) {
+        sleep_us(ch2_offset_us - elapsed);
+    }
+    send(ch2, ch2_len);
+}
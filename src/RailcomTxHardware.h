@@ -7,8 +7,11 @@
 
 #include <cstdint>
 #include <cstddef>
-#include <vector>
 #include "Railcom.h"
+#include "RailcomArena.h"
+#if !RAILCOM_NO_HEAP
+#include <vector>
+#endif
 
 /**
  * @class RailcomTxHardware
@@ -37,10 +40,43 @@ public:
     virtual void task() = 0;
 
     /**
-     * @brief Sends a vector of raw, 4-of-8 encoded RailCom bytes over the hardware interface.
+     * @brief Sends raw, 4-of-8 encoded RailCom bytes over the hardware interface.
+     * @details The bytes are transmitted immediately; the call returns once they
+     *          have been handed to the hardware or sent.
+     * @param bytes The encoded bytes.
+     * @param len The number of bytes.
+     */
+    virtual void send(const uint8_t* bytes, size_t len) = 0;
+
+    /**
+     * @brief Sends the Channel 1 and Channel 2 part of one cutout.
+     * @details The Channel 1 bytes are sent at once, the Channel 2 bytes
+     *          `ch2_offset_us` after the call, so an implementation can time both
+     *          channels itself (e.g. with DMA or a PIO program) instead of having
+     *          the caller wait in between. An empty part is skipped; without
+     *          Channel 2 bytes the call does not wait. The default implementation
+     *          uses `send()` and waits with `sleep_us()`.
+     * @param ch1 The Channel 1 bytes.
+     * @param ch1_len The number of Channel 1 bytes (0 if Channel 1 stays silent).
+     * @param ch2 The Channel 2 bytes.
+     * @param ch2_len The number of Channel 2 bytes (0 if Channel 2 stays silent).
+     * @param ch2_offset_us The time in microseconds from the call to the start of Channel 2.
+     * @see RCN-217, 4.2
+     */
+    virtual void send_frame(const uint8_t* ch1, size_t ch1_len,
+                            const uint8_t* ch2, size_t ch2_len, uint32_t ch2_offset_us);
+
+    /**
+     * @brief Sends a vector of raw, 4-of-8 encoded RailCom bytes.
+     * @details Convenience wrapper around `send()` for callers that already hold a vector.
      * @param bytes The raw bytes to be sent. These are expected to be already encoded.
+     * @note Not available with `RAILCOM_NO_HEAP`.
      */
-    virtual void send_bytes(const std::vector<uint8_t>& bytes) = 0;
+#if !RAILCOM_NO_HEAP
+    void send_bytes(const std::vector<uint8_t>& bytes) {
+        send(bytes.data(), bytes.size());
+    }
+#endif
 };
 
 #endif // RAILCOM_TX_HARDWARE_H
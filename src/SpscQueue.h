@@ -0,0 +1,83 @@
+/**
+ * @file SpscQueue.h
+ * @brief A lock-free queue between one producer and one consumer.
+ * @details The queue is used to pass data between the two cores of the RP2040
+ *          (see DecoderRuntime). It needs neither a lock nor the hardware
+ *          spinlocks: each index is written by one side only, and the release
+ *          store of an index publishes the element written before it.
+ */
+#ifndef SPSC_QUEUE_H
+#define SPSC_QUEUE_H
+
+#include <atomic>
+#include <cstdint>
+
+/**
+ * @class SpscQueue
+ * @brief A fixed-size ring buffer for one producer and one consumer.
+ * @details `push()` may only be called from one core (or interrupt context)
+ *          and `pop()` only from one other; neither ever blocks. One slot is
+ *          kept free to tell a full ring from an empty one, so the queue holds
+ *          `N - 1` elements.
+ * @tparam T The element type; it is copied in and out.
+ * @tparam N The number of slots (a power of two).
+ */
+template <typename T, uint16_t N>
+class SpscQueue {
+    static_assert(N >= 2 && (N & (N - 1)) == 0, "SpscQueue size must be a power of two");
+
+public:
+    SpscQueue() : _head(0), _tail(0) {}
+
+    /**
+     * @brief Appends an element (producer side).
+     * @param item The element.
+     * @return False if the queue is full; the element is not stored then.
+     */
+    bool push(const T& item) {
+        uint16_t tail = _tail.load(std::memory_order_relaxed);
+        uint16_t next = (tail + 1) & (N - 1);
+        if (next == _head.load(std::memory_order_acquire)) {
+            return false;
+        }
+        _items[tail] = item;
+        _tail.store(next, std::memory_order_release);
+        return true;
+    }
+
+    /**
+     * @brief Removes the oldest element (consumer side).
+     * @param[out] item Receives the element.
+     * @return False if the queue is empty.
+     */
+    bool pop(T& item) {
+        uint16_t head = _head.load(std::memory_order_relaxed);
+        if (head == _tail.load(std::memory_order_acquire)) {
+            return false;
+        }
+        item = _items[head];
+        _head.store((head + 1) & (N - 1), std::memory_order_release);
+        return true;
+    }
+
+    /**
+     * @brief Checks whether the queue is empty.
+     * @details The answer may be outdated as soon as the other side runs.
+     * @return True if no element is waiting.
+     */
+    bool empty() const {
+        return _head.load(std::memory_order_acquire) == _tail.load(std::memory_order_acquire);
+    }
+
+    /**
+     * @brief Returns the number of elements the queue can hold.
+     */
+    static constexpr uint16_t capacity() { return N - 1; }
+
+private:
+    T _items[N];                 ///< The slots.
+    std::atomic<uint16_t> _head; ///< Next slot to read; written by the consumer.
+    std::atomic<uint16_t> _tail; ///< Next slot to write; written by the producer.
+};
+
+#endif // SPSC_QUEUE_H
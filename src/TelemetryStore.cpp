@@ -0,0 +1,197 @@
+/**
+ * @file TelemetryStore.cpp
+ * @brief Implementation of the TelemetryStore class.
+ */
+#include "TelemetryStore.h"
+#include <cstring>
+
+/** @brief Window length in milliseconds, indexed by `TelemetryResolution`. */
+static const uint32_t WINDOW_MS[] = { 1000, 10000, 60000 };
+
+/**
+ * @brief Constructs an empty store.
+ */
+TelemetryStore::TelemetryStore() : _dyn_sub_index{0, 1} {
+    clear();
+}
+
+/**
+ * @brief Assigns a DYN sub-index to a DYN metric.
+ * @param metric The DYN metric.
+ * @param subIndex The DYN sub-index.
+ * @return False if `metric` is not a DYN metric.
+ */
+bool TelemetryStore::trackDyn(TelemetryMetric metric, uint8_t subIndex) {
+    if (metric != TelemetryMetric::DYN_0 && metric != TelemetryMetric::DYN_1) return false;
+    uint8_t m = static_cast<uint8_t>(metric);
+    _dyn_sub_index[m - static_cast<uint8_t>(TelemetryMetric::DYN_0)] = subIndex & 0x3F;
+    for (Vehicle& vehicle : _vehicles) {
+        vehicle.has_latest &= ~(1 << m);
+        memset(vehicle.buckets[m], 0, sizeof(vehicle.buckets[m]));
+    }
+    return true;
+}
+
+/**
+ * @brief Adds the values of a received message.
+ * @param address The address of the vehicle.
+ * @param msg The message, or nullptr.
+ * @param now_ms The current time.
+ * @return True if the message was recorded.
+ */
+bool TelemetryStore::record(uint16_t address, const RailcomMessage* msg, uint32_t now_ms) {
+    if (msg == nullptr) return false;
+    switch (msg->id) {
+        case RailcomID::INFO: {
+            const InfoMessage* info = static_cast<const InfoMessage*>(msg);
+            addSample(address, TelemetryMetric::SPEED, info->speed, now_ms);
+            addSample(address, TelemetryMetric::MOTOR_LOAD, info->motorLoad, now_ms);
+            return true;
+        }
+        case RailcomID::DYN: {
+            const DynMessage* dyn = static_cast<const DynMessage*>(msg);
+            bool recorded = false;
+            for (uint8_t slot = 0; slot < TELEMETRY_DYN_SLOTS; ++slot) {
+                if (_dyn_sub_index[slot] != dyn->subIndex) continue;
+                TelemetryMetric metric = static_cast<TelemetryMetric>(static_cast<uint8_t>(TelemetryMetric::DYN_0) + slot);
+                addSample(address, metric, dyn->value, now_ms);
+                recorded = true;
+            }
+            return recorded;
+        }
+        default:
+            return false;
+    }
+}
+
+/**
+ * @brief Adds a sample to the running window of every resolution.
+ * @details A window whose slot still holds an older period is cleared first.
+ * @param address The address of the vehicle.
+ * @param metric The metric.
+ * @param value The sample.
+ * @param now_ms The current time.
+ */
+void TelemetryStore::addSample(uint16_t address, TelemetryMetric metric, uint16_t value, uint32_t now_ms) {
+    uint8_t m = static_cast<uint8_t>(metric);
+    if (m >= METRICS) return;
+    Vehicle& vehicle = acquire(address, now_ms);
+    vehicle.heard_ms = now_ms;
+    vehicle.latest[m] = value;
+    vehicle.has_latest |= 1 << m;
+
+    for (uint8_t r = 0; r < RESOLUTIONS; ++r) {
+        uint32_t period = now_ms / WINDOW_MS[r];
+        Bucket& bucket = vehicle.buckets[m][r][period % TELEMETRY_RING_WINDOWS];
+        if (bucket.count == 0 || bucket.period != period) {
+            bucket.period = period;
+            bucket.sum = 0;
+            bucket.min = value;
+            bucket.max = value;
+            bucket.count = 0;
+        }
+        // Once the count saturates, the mean stays that of the samples counted.
+        if (bucket.count < UINT16_MAX) {
+            bucket.sum += value;
+            bucket.count++;
+        }
+        if (value < bucket.min) bucket.min = value;
+        if (value > bucket.max) bucket.max = value;
+    }
+}
+
+/**
+ * @brief Returns the last sample of a metric.
+ * @param address The address of the vehicle.
+ * @param metric The metric.
+ * @param[out] value Receives the sample.
+ * @return False if no sample is stored.
+ */
+bool TelemetryStore::latest(uint16_t address, TelemetryMetric metric, uint16_t& value) const {
+    uint8_t m = static_cast<uint8_t>(metric);
+    const Vehicle* vehicle = find(address);
+    if (vehicle == nullptr || m >= METRICS || !(vehicle->has_latest & (1 << m))) return false;
+    value = vehicle->latest[m];
+    return true;
+}
+
+/**
+ * @brief Returns the statistics of a window.
+ * @param address The address of the vehicle.
+ * @param metric The metric.
+ * @param resolution The window length.
+ * @param now_ms The current time.
+ * @param[out] stats Receives the statistics.
+ * @param age The number of windows back from the running one.
+ * @return False if the window holds no samples.
+ */
+bool TelemetryStore::window(uint16_t address, TelemetryMetric metric, TelemetryResolution resolution,
+                            uint32_t now_ms, TelemetryWindow& stats, uint8_t age) const {
+    uint8_t m = static_cast<uint8_t>(metric);
+    uint8_t r = static_cast<uint8_t>(resolution);
+    const Vehicle* vehicle = find(address);
+    if (vehicle == nullptr || m >= METRICS || r >= RESOLUTIONS || age >= TELEMETRY_RING_WINDOWS) return false;
+
+    uint32_t period = now_ms / WINDOW_MS[r];
+    if (period < age) return false;
+    period -= age;
+    const Bucket& bucket = vehicle->buckets[m][r][period % TELEMETRY_RING_WINDOWS];
+    if (bucket.count == 0 || bucket.period != period) return false;
+
+    stats.min = bucket.min;
+    stats.max = bucket.max;
+    stats.avg = bucket.sum / bucket.count;
+    stats.count = bucket.count;
+    return true;
+}
+
+/**
+ * @brief Returns the number of vehicles in the store.
+ */
+uint8_t TelemetryStore::vehicleCount() const {
+    uint8_t count = 0;
+    for (const Vehicle& vehicle : _vehicles) {
+        if (vehicle.used) count++;
+    }
+    return count;
+}
+
+/**
+ * @brief Removes all vehicles.
+ */
+void TelemetryStore::clear() {
+    memset(_vehicles, 0, sizeof(_vehicles));
+}
+
+/**
+ * @brief Finds the entry of a vehicle.
+ * @param address The address of the vehicle.
+ * @return The entry, or nullptr.
+ */
+const TelemetryStore::Vehicle* TelemetryStore::find(uint16_t address) const {
+    for (const Vehicle& vehicle : _vehicles) {
+        if (vehicle.used && vehicle.address == address) return &vehicle;
+    }
+    return nullptr;
+}
+
+/**
+ * @brief Finds or creates the entry of a vehicle.
+ * @param address The address of the vehicle.
+ * @param now_ms The current time.
+ * @return The entry.
+ */
+TelemetryStore::Vehicle& TelemetryStore::acquire(uint16_t address, uint32_t now_ms) {
+    Vehicle* victim = &_vehicles[0];
+    for (Vehicle& vehicle : _vehicles) {
+        if (vehicle.used && vehicle.address == address) return vehicle;
+        if (!victim->used) continue;
+        if (!vehicle.used || now_ms - vehicle.heard_ms > now_ms - victim->heard_ms) {
+            victim = &vehicle;
+        }
+    }
+    memset(victim, 0, sizeof(*victim));
+    victim->used = true;
+    victim->address = address;
+    return *victim;
+}
@@ -0,0 +1,179 @@
+/**
+ * @file TelemetryStore.h
+ * @brief Command station side time series of the driving information of vehicles.
+ * @details The TelemetryStore keeps the speed and motor load (INFO) and up to
+ *          two DYN variables of each vehicle as min/avg/max statistics over
+ *          windows of 1 s, 10 s and 60 s. It is fed message by message, takes
+ *          a fixed amount of RAM and answers every query in constant time, so
+ *          a detector can report e.g. the current load of a vehicle without
+ *          keeping the message stream.
+ */
+#ifndef TELEMETRY_STORE_H
+#define TELEMETRY_STORE_H
+
+#include "Railcom.h"
+
+/** @brief Number of vehicles the store can hold; the least recently heard one is replaced. */
+constexpr uint8_t TELEMETRY_VEHICLES = 8;
+/** @brief Number of windows kept per resolution, including the current one. */
+constexpr uint8_t TELEMETRY_RING_WINDOWS = 6;
+/** @brief Number of DYN sub-indices that can be tracked. */
+constexpr uint8_t TELEMETRY_DYN_SLOTS = 2;
+
+/**
+ * @enum TelemetryMetric
+ * @brief A value that is tracked per vehicle.
+ */
+enum class TelemetryMetric : uint8_t {
+    SPEED,      ///< INFO speed.
+    MOTOR_LOAD, ///< INFO motor load.
+    DYN_0,      ///< The DYN sub-index assigned to slot 0 with `trackDyn()`.
+    DYN_1,      ///< The DYN sub-index assigned to slot 1 with `trackDyn()`.
+    COUNT       ///< Number of metrics.
+};
+
+/**
+ * @enum TelemetryResolution
+ * @brief The length of a statistics window.
+ */
+enum class TelemetryResolution : uint8_t {
+    SECOND,      ///< 1 s windows.
+    TEN_SECONDS, ///< 10 s windows.
+    MINUTE,      ///< 60 s windows.
+    COUNT        ///< Number of resolutions.
+};
+
+/**
+ * @struct TelemetryWindow
+ * @brief The statistics of one window.
+ */
+struct TelemetryWindow {
+    uint16_t min;   ///< Smallest sample.
+    uint16_t max;   ///< Largest sample.
+    uint16_t avg;   ///< Mean of the samples counted, rounded down.
+    uint16_t count; ///< Number of samples, saturating at UINT16_MAX.
+};
+
+/**
+ * @class TelemetryStore
+ * @brief Aggregates INFO and DYN messages per vehicle address.
+ * @details A RailCom message carries no address; the command station knows it
+ *          from the packet the cutout followed and passes it to `record()`
+ *          together with the message read by `RailcomRx`. The receiver has to
+ *          be in the `MOBILE` context, so that ID 4 is parsed as INFO.
+ *
+ *          Each metric has a ring of `TELEMETRY_RING_WINDOWS` windows per
+ *          resolution. A window is identified by its period number (time /
+ *          window length), so old windows are recognised and recycled when a
+ *          sample falls into them again; no periodic task is needed.
+ */
+class TelemetryStore {
+public:
+    /**
+     * @brief Constructs an empty store. The DYN slots track sub-indices 0 and 1.
+     */
+    TelemetryStore();
+
+    /**
+     * @brief Assigns a DYN sub-index to a DYN metric.
+     * @details The samples collected for the slot so far are discarded.
+     * @param metric `TelemetryMetric::DYN_0` or `DYN_1`.
+     * @param subIndex The DYN sub-index (0-63).
+     * @return False if `metric` is not a DYN metric.
+     */
+    bool trackDyn(TelemetryMetric metric, uint8_t subIndex);
+
+    /**
+     * @brief Adds the values of a received message.
+     * @details INFO and tracked DYN messages are recorded; everything else,
+     *          including nullptr, is ignored.
+     * @param address The address of the vehicle the cutout belonged to.
+     * @param msg The message from `RailcomRx::read()`.
+     * @param now_ms The current time (`millis()`).
+     * @return True if the message was recorded.
+     */
+    bool record(uint16_t address, const RailcomMessage* msg, uint32_t now_ms);
+
+    /**
+     * @brief Adds a sample directly.
+     * @param address The address of the vehicle.
+     * @param metric The metric.
+     * @param value The sample.
+     * @param now_ms The current time.
+     */
+    void addSample(uint16_t address, TelemetryMetric metric, uint16_t value, uint32_t now_ms);
+
+    /**
+     * @brief Returns the last sample of a metric.
+     * @param address The address of the vehicle.
+     * @param metric The metric.
+     * @param[out] value Receives the sample.
+     * @return False if no sample of the vehicle and metric is stored.
+     */
+    bool latest(uint16_t address, TelemetryMetric metric, uint16_t& value) const;
+
+    /**
+     * @brief Returns the statistics of a window.
+     * @param address The address of the vehicle.
+     * @param metric The metric.
+     * @param resolution The window length.
+     * @param now_ms The current time.
+     * @param[out] stats Receives the statistics.
+     * @param age 0 for the running window, 1 for the last complete one, up to
+     *        `TELEMETRY_RING_WINDOWS - 1`.
+     * @return False if the window holds no samples.
+     */
+    bool window(uint16_t address, TelemetryMetric metric, TelemetryResolution resolution,
+                uint32_t now_ms, TelemetryWindow& stats, uint8_t age = 0) const;
+
+    /**
+     * @brief Returns the number of vehicles in the store.
+     * @return The vehicle count.
+     */
+    uint8_t vehicleCount() const;
+
+    /**
+     * @brief Removes all vehicles.
+     */
+    void clear();
+
+private:
+    /** @brief The samples of one window. */
+    struct Bucket {
+        uint32_t period; ///< Period number (time / window length) the samples belong to.
+        uint32_t sum;    ///< Sum of the samples.
+        uint16_t min;    ///< Smallest sample.
+        uint16_t max;    ///< Largest sample.
+        uint16_t count;  ///< Number of samples; 0 for an empty window.
+    };
+
+    static constexpr uint8_t METRICS = static_cast<uint8_t>(TelemetryMetric::COUNT);
+    static constexpr uint8_t RESOLUTIONS = static_cast<uint8_t>(TelemetryResolution::COUNT);
+
+    /** @brief The time series of one vehicle. */
+    struct Vehicle {
+        bool used;                 ///< True if the entry holds a vehicle.
+        uint16_t address;          ///< The address of the vehicle.
+        uint32_t heard_ms;         ///< Time of the last sample, for replacement.
+        uint8_t has_latest;        ///< Bitmap of the metrics in `latest`.
+        uint16_t latest[METRICS];  ///< The last sample of each metric.
+        Bucket buckets[METRICS][RESOLUTIONS][TELEMETRY_RING_WINDOWS]; ///< The window rings.
+    };
+
+    /**
+     * @brief Finds the entry of a vehicle.
+     * @return The entry, or nullptr.
+     */
+    const Vehicle* find(uint16_t address) const;
+
+    /**
+     * @brief Finds or creates the entry of a vehicle.
+     * @details A new vehicle takes a free entry or the least recently heard one.
+     */
+    Vehicle& acquire(uint16_t address, uint32_t now_ms);
+
+    Vehicle _vehicles[TELEMETRY_VEHICLES];   ///< The vehicle table.
+    uint8_t _dyn_sub_index[TELEMETRY_DYN_SLOTS]; ///< The sub-index of each DYN slot.
+};
+
+#endif // TELEMETRY_STORE_H
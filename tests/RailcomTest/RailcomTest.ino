@@ -4,6 +4,7 @@
 #include "mocks/MockRailcomTxHardware.h"
 #include "mocks/MockRailcomRxHardware.h"
 #include "mocks/MockDcc.h"
+#include <algorithm>
 
 // Minimal testing framework
 #define test(name) void test_##name()
@@ -37,25 +38,25 @@ test(short_address_e2e) {
   RailcomMessage* msg;
   uint16_t shortAddress = 100;
 
-  // Send the low part of the address first (alternator is initially false).
+  // The rotation starts with the high part, which is 0 for a short address.
   tx.sendAddress(shortAddress);
   tx.on_cutout_start();
   rxHardware.setRxBuffer(txHardware.getSentBytes());
   msg = rx.read();
   assertNotNull(msg);
-  assertEqual(msg->id, RailcomID::ADR_LOW);
-  assertEqual(static_cast<AdrMessage*>(msg)->address, shortAddress & 0x7F);
+  assertEqual(msg->id, RailcomID::ADR_HIGH);
+  assertEqual(static_cast<AdrMessage*>(msg)->address, 0);
   txHardware.clear();
   rxHardware.clear();
 
-  // Send the high part of the address (alternator is now true).
+  // The next cutout sends the low part.
   tx.sendAddress(shortAddress);
   tx.on_cutout_start();
   rxHardware.setRxBuffer(txHardware.getSentBytes());
   msg = rx.read();
   assertNotNull(msg);
-  assertEqual(msg->id, RailcomID::ADR_HIGH);
-  assertEqual(static_cast<AdrMessage*>(msg)->address, 0);
+  assertEqual(msg->id, RailcomID::ADR_LOW);
+  assertEqual(static_cast<AdrMessage*>(msg)->address, shortAddress & 0x7F);
   txHardware.clear();
   rxHardware.clear();
 }
@@ -249,8 +250,36 @@ void setup() {
   run_test(logon_error_cases_e2e);
   run_test(backoff_mechanism_e2e);
   run_test(data_space_request_e2e);
+  run_test(data_space_read_byte_offset);
   run_test(registration_via_address_0_e2e);
   run_test(padding_verification);
+  run_test(precomputed_replies_e2e);
+  run_test(cv_store);
+  run_test(cv_journal);
+  run_test(cv_auto_scheduler);
+  run_test(channel2_scheduler);
+  run_test(channel2_open_for_own_packets);
+  run_test(channel2_held_for_foreign_pom);
+  run_test(address_rotation_cache);
+  run_test(random_logon_backoff);
+  run_test(logon_manager);
+  run_test(data_space_reader);
+  run_test(data_space_reader_large);
+  run_test(data_space_segmented_tx);
+  run_test(tx_send_frame);
+  run_test(rx_block_read);
+  run_test(rx_datagrams_per_cutout);
+  run_test(decoder_runtime);
+  run_test(latency_trace);
+  run_test(rx_statistics);
+  run_test(rx_cutout_classifier);
+  run_test(rx_soft_decoding);
+  run_test(schema_codec);
+  run_test(channel2_coalescing);
+  run_test(dyn_publisher);
+  run_test(telemetry_store);
+  run_test(no_heap_after_begin);
+  run_test(dcc_parser_short_packets);
 
   Serial.println("All tests passed!");
 }
@@ -373,6 +402,16 @@ test(long_address_e2e) {
 }
 
 #include "DecoderStateMachine.h"
+#include "CvStore.h"
+#include "CvJournal.h"
+#include "mocks/MockCvFlashHardware.h"
+#include "LogonManager.h"
+#include "DataSpaceReader.h"
+#include "DecoderRuntime.h"
+#include "LatencyTrace.h"
+#include "RailcomSchema.h"
+#include "DynPublisher.h"
+#include "TelemetryStore.h"
 
 /**
  * @brief Verifies the complete RCN-218 logon procedure.
@@ -456,18 +495,18 @@ test(decoder_state_machine_e2e) {
   DecoderStateMachine sm(tx, DecoderType::LOCOMOTIVE, 100, 0b00000011, 0b00001010);
 
   // Simulate a DCC POM read command for CV 1
-  uint8_t dcc_data[] = {0, 100, 0b11100100, 1, 0}; // Address 100, Read CV 1
+  uint8_t dcc_data[] = {100, 0b11100100, 1, 0, 0}; // Address 100, Read CV 1
   DCCMessage msg(dcc_data, 5);
   sm.handleDccPacket(msg);
 
-  // Verify that a POM response with the dummy value 42 is sent
+  // Verify that a POM response with the stored value of CV 1 is sent
   tx.on_cutout_start();
   RailcomRx rx(&rxHardware);
   rxHardware.setRxBuffer(txHardware.getSentBytes());
   RailcomMessage* railcomMsg = rx.read();
   assertNotNull(railcomMsg);
   assertEqual(railcomMsg->id, RailcomID::POM);
-  assertEqual(static_cast<PomMessage*>(railcomMsg)->cvValue, 42);
+  assertEqual(static_cast<PomMessage*>(railcomMsg)->cvValue, 10);
 }
 
 /**
@@ -502,8 +541,7 @@ test(dynamic_channel1_management) {
 
   // 1. Simulate a DCC packet for a DIFFERENT locomotive.
   // We expect an address broadcast because the channel is open.
-  uint8_t other_loco_data[] = {0, 101, 0b01100000, 0};
-  DCCMessage other_loco_msg(other_loco_data, 4);
+  DCCMessage other_loco_msg = MockDcc::createSpeedPacket(101, 0);
   sm.handleDccPacket(other_loco_msg);
   tx.on_cutout_start();
   assertTrue(!txHardware.getSentBytes().empty()); // Should broadcast address
@@ -511,8 +549,7 @@ test(dynamic_channel1_management) {
 
   // 2. Simulate a DCC packet for THIS locomotive.
   // This should disable future broadcasts.
-  uint8_t my_loco_data[] = {0, 100, 0b01100000, 0};
-  DCCMessage my_loco_msg(my_loco_data, 4);
+  DCCMessage my_loco_msg = MockDcc::createSpeedPacket(100, 0);
   sm.handleDccPacket(my_loco_msg);
   tx.on_cutout_start();
   txHardware.clear(); // Clear any messages sent in response to this packet
@@ -542,30 +579,109 @@ test(data_space_request_e2e) {
   uint8_t dcc_data[] = {0xD0, 0x01, 0xED, 0x50, 0};
   DCCMessage dcc_msg(dcc_data, 5);
   sm.handleDccPacket(dcc_msg);
-  tx.on_cutout_start();
 
   // --- Verify the Response ---
   // Expected data from constructor: { 'D', 'B', ' ', 'C', 'l', 'a', 's', 's', ' ', '2', '1', '8' }
+  // It is sent from start offset 0 in blocks of header, 4 data bytes and CRC,
+  // one per cutout after each repeat of the read.
   std::vector<uint8_t> expected_data_full = { 'D', 'B', ' ', 'C', 'l', 'a', 's', 's', ' ', '2', '1', '8' };
 
-  std::vector<uint8_t> crc_buffer;
-  crc_buffer.push_back(expected_data_full.size());
-  crc_buffer.insert(crc_buffer.end(), expected_data_full.begin(), expected_data_full.end());
-  uint8_t expected_crc = RailcomEncoding::crc8(crc_buffer.data(), crc_buffer.size(), 5);
-
   std::vector<uint8_t> expected_raw_bytes;
-  expected_raw_bytes.push_back(RailcomEncoding::encode4of8(expected_data_full.size()));
-  for (uint8_t byte : expected_data_full) {
-    expected_raw_bytes.push_back(RailcomEncoding::encode4of8(byte));
+  for (uint8_t seq = 0; seq * DATA_SPACE_CHUNK_SIZE < expected_data_full.size(); ++seq) {
+    std::vector<uint8_t> crc_buffer;
+    bool last = (seq + 1) * DATA_SPACE_CHUNK_SIZE >= expected_data_full.size();
+    crc_buffer.push_back(DATA_SPACE_CHUNK_SIZE | (seq << DATASPACE_SEQ_SHIFT) | (last ? DATASPACE_LAST_BLOCK : 0));
+    crc_buffer.insert(crc_buffer.end(), expected_data_full.begin() + seq * DATA_SPACE_CHUNK_SIZE,
+                      expected_data_full.begin() + (seq + 1) * DATA_SPACE_CHUNK_SIZE);
+    uint8_t expected_crc = RailcomEncoding::crc8(crc_buffer.data(), crc_buffer.size(), 5);
+    crc_buffer.push_back(expected_crc);
+
+    uint8_t block[RAILCOM_MAX_DATAGRAM_BYTES];
+    size_t block_len = RailcomEncoding::encodeBytes(crc_buffer.data(), crc_buffer.size(), block);
+    expected_raw_bytes.insert(expected_raw_bytes.end(), block, block + block_len);
   }
-  expected_raw_bytes.push_back(RailcomEncoding::encode4of8(expected_crc));
 
-  const auto& sent_bytes = txHardware.getSentBytes();
+  std::vector<uint8_t> sent_bytes;
+  for (int cutout = 0; cutout < 3; ++cutout) {
+    if (cutout > 0) sm.handleDccPacket(dcc_msg); // The command station repeats the read.
+    tx.on_cutout_start();
+    const auto& bytes = txHardware.getSentBytes();
+    assertEqual(bytes.size(), RAILCOM_CH1_BYTES + RAILCOM_CH2_BYTES);
+    sent_bytes.insert(sent_bytes.end(), bytes.begin(), bytes.end());
+    txHardware.clear();
+  }
   assertEqual(sent_bytes.size(), expected_raw_bytes.size());
   for (size_t i = 0; i < sent_bytes.size(); ++i) {
     assertEqual(sent_bytes[i], expected_raw_bytes[i]);
   }
+
+  // The reply is complete; a further repeat starts it again.
+  assertTrue(!tx.isSendingDataSpace());
+  sm.handleDccPacket(dcc_msg);
+  tx.on_cutout_start();
+  assertEqual(txHardware.getSentBytes().size(), RAILCOM_CH1_BYTES + RAILCOM_CH2_BYTES);
+  assertEqual(txHardware.getSentBytes()[0], expected_raw_bytes[0]);
+  txHardware.clear();
+}
+
+/**
+ * @brief Verifies that the start field of a Data Space Read is a byte offset.
+ * @details The reply runs from the offset to the end of the data space, with a
+ *          short address. A read that differs from the one being answered
+ *          replaces the rest of its reply.
+ * @see RCN-218, Section 4.3
+ */
+test(data_space_read_byte_offset) {
+  MockRailcomTxHardware txHardware;
+  MockRailcomRxHardware rxHardware;
+  RailcomTx tx(&txHardware);
+  RailcomRx rx(&rxHardware);
+  DecoderStateMachine sm(tx, DecoderType::LOCOMOTIVE, 3, 0, 0b00001000, 0x0ABC, 0x12345678);
+  const uint8_t contents[] = { 0x10, 0x11, 0x12, 0x13, 0x20, 0x21, 0x22, 0x23, 0xF0, 0xF1 };
+  sm.setDataSpace(9, contents, sizeof(contents));
+
+  for (uint8_t start : { 0, 3, 9, 10 }) {
+    uint8_t dcc_data[] = { 0x03, 0xED, (uint8_t)(0x90 | start), 0 };
+    dcc_data[3] = dcc_data[0] ^ dcc_data[1] ^ dcc_data[2];
+    std::vector<uint8_t> received;
+    bool last = false;
+    for (uint8_t seq = 0; !last; ++seq) {
+      sm.handleDccPacket(DCCMessage(dcc_data, 4));
+      tx.on_cutout_start();
+      rxHardware.setRxBuffer(txHardware.getSentBytes());
+      txHardware.clear();
+      rx.expectDataSpaceResponse(9);
+      DataSpaceMessage* msg = static_cast<DataSpaceMessage*>(rx.read());
+      assertNotNull(msg);
+      assertTrue(msg->crc_ok);
+      assertEqual(msg->sequence, seq);
+      received.insert(received.end(), msg->data, msg->data + msg->len);
+      last = msg->last;
+    }
+    assertEqual(received.size(), sizeof(contents) - start);
+    for (size_t i = 0; i < received.size(); ++i) {
+      assertEqual(received[i], contents[start + i]);
+    }
+  }
+
+  // A read for another offset replaces the rest of the reply.
+  uint8_t first[] = { 0x03, 0xED, 0x90, 0x03 ^ 0xED ^ 0x90 };
+  uint8_t second[] = { 0x03, 0xED, 0x98, 0x03 ^ 0xED ^ 0x98 };
+  sm.handleDccPacket(DCCMessage(first, 4));
+  tx.on_cutout_start();
+  txHardware.clear();
+  sm.handleDccPacket(DCCMessage(second, 4));
+  tx.on_cutout_start();
+  rxHardware.setRxBuffer(txHardware.getSentBytes());
   txHardware.clear();
+  rx.expectDataSpaceResponse(9);
+  DataSpaceMessage* msg = static_cast<DataSpaceMessage*>(rx.read());
+  assertNotNull(msg);
+  assertEqual(msg->sequence, 0);
+  assertTrue(msg->last);
+  assertEqual(msg->len, 2);
+  assertEqual(msg->data[0], 0xF0);
+  assertTrue(!tx.isSendingDataSpace());
 }
 
 void loop() {
@@ -778,27 +894,32 @@ test(data_space_e2e_full) {
   uint8_t data[] = {0x01, 0x02, 0x03, 0xAA, 0xBB}; // len=5
   uint8_t dataSpaceNum = 5;
 
-  // 1. TX sends the data
-  tx.sendDataSpace(data, sizeof(data), dataSpaceNum);
-  tx.on_cutout_start();
-
-  // 2. RX receives the data
-  rxHardware.setRxBuffer(txHardware.getSentBytes());
-  rx.expectDataSpaceResponse(dataSpaceNum);
-  RailcomMessage* msg_raw = rx.read();
-
-  // 3. Verify the received data
-  assertNotNull(msg_raw);
-  DataSpaceMessage* msg = static_cast<DataSpaceMessage*>(msg_raw);
+  // 1. TX sends the data, split into a block of 4 bytes and a block of 1 byte
+  assertTrue(tx.sendDataSpace(data, sizeof(data), dataSpaceNum));
+
+  // 2. RX receives one block per cutout
+  std::vector<uint8_t> received;
+  for (int cutout = 0; cutout < 2; ++cutout) {
+    tx.on_cutout_start();
+    rxHardware.setRxBuffer(txHardware.getSentBytes());
+    txHardware.clear();
+    rx.expectDataSpaceResponse(dataSpaceNum);
+    RailcomMessage* msg_raw = rx.read();
+
+    // 3. Verify the received block
+    assertNotNull(msg_raw);
+    DataSpaceMessage* msg = static_cast<DataSpaceMessage*>(msg_raw);
+    assertEqual(msg->dataSpaceNum, dataSpaceNum);
+    assertEqual(msg->len, cutout == 0 ? DATA_SPACE_CHUNK_SIZE : 1);
+    assertTrue(msg->crc_ok);
+    received.insert(received.end(), msg->data, msg->data + msg->len);
+  }
+  assertTrue(tx.isIdle());
 
-  assertEqual(msg->dataSpaceNum, dataSpaceNum);
-  assertEqual(msg->len, sizeof(data));
-  assertTrue(msg->crc_ok);
+  assertEqual(received.size(), sizeof(data));
   for (size_t i = 0; i < sizeof(data); ++i) {
-    assertEqual(msg->data[i], data[i]);
+    assertEqual(received[i], data[i]);
   }
-
-  txHardware.clear();
 }
 
 
@@ -967,15 +1088,23 @@ test(boundary_value_e2e) {
   RailcomMessage* msg;
 
   // --- Test short address boundaries ---
-  tx.sendAddress(1);
+  // Each packet's cutout sends the next entry of the rotation, ADR_HIGH first;
+  // the short address itself is in ADR_LOW.
   tx.sendAddress(1);
   tx.on_cutout_start();
   rxHardware.setRxBuffer(txHardware.getSentBytes());
   msg = rx.read();
   assertNotNull(msg);
-  // Note: with the new queueing logic, we get ADR_HIGH first
   assertEqual(msg->id, RailcomID::ADR_HIGH);
   txHardware.clear();
+  tx.sendAddress(1); // The next packet's cutout.
+  tx.on_cutout_start();
+  rxHardware.setRxBuffer(txHardware.getSentBytes());
+  msg = rx.read();
+  assertNotNull(msg);
+  assertEqual(msg->id, RailcomID::ADR_LOW);
+  assertEqual(static_cast<AdrMessage*>(msg)->address, 1);
+  txHardware.clear();
 
 
   // --- Test TIME max value ---
@@ -1092,6 +1221,7 @@ test(backoff_mechanism_e2e) {
   MockRailcomTxHardware txHardware;
   RailcomTx tx(&txHardware);
   DecoderStateMachine sm(tx, DecoderType::LOCOMOTIVE, 0, 0, 0b00001000, 0x0ABC, 0x12345678);
+  sm.setLogonBackoff(LogonBackoff::LINEAR);
 
   uint8_t logon_enable_data[] = { RCN218::DCC_A_ADDRESS, (uint8_t)RCN218::CMD_LOGON_ENABLE, 0, 0, 0, 0 };
   DCCMessage logon_enable_msg(logon_enable_data, sizeof(logon_enable_data));
@@ -1215,3 +1345,1424 @@ test(padding_verification) {
   assertEqual(bytes2[2], 0xCC);
   txHardware.clear();
 }
+
+/**
+ * @brief Verifies that pre-encoded replies match the regularly encoded messages.
+ * @details Repeated POM reads are answered from the DecoderStateMachine's
+ *          pre-encoded frame cache.
+ * @see RCN-217, Section 5.1
+ */
+test(precomputed_replies_e2e) {
+  MockRailcomTxHardware txHardware;
+  MockRailcomTxHardware refHardware;
+  RailcomTx tx(&txHardware);
+  RailcomTx ref(&refHardware);
+
+  DecoderStateMachine sm(tx, DecoderType::LOCOMOTIVE, 100, 0b00000011, 0b00001010);
+  uint8_t dcc_data[] = {100, 0b11100100, 1, 0, 0}; // Address 100, Read CV 1
+  DCCMessage pom_msg(dcc_data, 5);
+  ref.sendPomResponse(10);
+  ref.on_cutout_start();
+  for (int i = 0; i < 2; ++i) {
+    sm.handleDccPacket(pom_msg);
+    tx.on_cutout_start();
+    const auto& sent = txHardware.getSentBytes();
+    const auto& expected = refHardware.getSentBytes();
+    assertEqual(sent.size(), expected.size());
+    for (size_t j = 0; j < sent.size(); ++j) assertEqual(sent[j], expected[j]);
+    txHardware.clear();
+  }
+}
+
+/**
+ * @brief Verifies the CV store's dense and sparse storage and its dirty tracking.
+ * @details Also checks that a POM write is stored and read back by the DecoderStateMachine.
+ */
+test(cv_store) {
+  CvStore store;
+  uint8_t value = 0;
+  assertTrue(!store.read(1, value));
+  assertTrue(store.define(1, 3));
+  assertTrue(store.write(1024, 7));
+  assertTrue(store.write(0x123456, 9));
+  assertTrue(store.write(2000, 11));
+  assertTrue(!store.write(0, 1));
+  assertTrue(store.read(0x123456, value));
+  assertEqual(value, 9);
+
+  // Iteration visits defined CVs in ascending order across both regions.
+  uint32_t cv = 0;
+  assertTrue(store.nextDefined(2, cv));
+  assertEqual(cv, 1024);
+  assertTrue(store.nextDefined(1025, cv));
+  assertEqual(cv, 2000);
+  assertTrue(store.nextDefined(2001, cv));
+  assertEqual(cv, 0x123456);
+
+  // `define` does not mark a CV dirty; each consumer is cleared independently.
+  assertEqual(store.dirtyCount(CvDirtyFlag::BROADCAST), 3);
+  assertTrue(!store.isDirty(CvDirtyFlag::BROADCAST, 1));
+  store.clearDirty(CvDirtyFlag::BROADCAST, 1024);
+  assertTrue(store.nextDirty(CvDirtyFlag::BROADCAST, 1, cv));
+  assertEqual(cv, 2000);
+  assertTrue(store.isDirty(CvDirtyFlag::PERSIST, 1024));
+
+  MockRailcomTxHardware txHardware;
+  MockRailcomRxHardware rxHardware;
+  RailcomTx tx(&txHardware);
+  DecoderStateMachine sm(tx, DecoderType::LOCOMOTIVE, 100, 0b00000011, 0b00001010);
+  uint8_t write_data[] = {100, 0b11101100, 3, 77, 0}; // Address 100, Write CV 3 = 77
+  DCCMessage write_msg(write_data, 5);
+  MockCvFlashHardware flash;
+  CvJournal journal(&flash, sm.cvs(), 0);
+  journal.begin();
+  sm.attachJournal(&journal);
+  sm.handleDccPacket(write_msg);
+  assertTrue(sm.cvs().read(3, value));
+  assertEqual(value, 77);
+  assertTrue(sm.cvs().isDirty(CvDirtyFlag::PERSIST, 3));
+
+  // Formatting the first sector needs an erase, which waits while the decoder is addressed.
+  tx.on_cutout_start();
+  sm.task();
+  sm.task();
+  assertTrue(journal.state() == CvJournalState::ERASE);
+  assertEqual(flash.getEraseCount(), 0);
+}
+
+/**
+ * @brief Verifies that CV writes are persisted in batches and survive a restart and compaction.
+ */
+test(cv_journal) {
+  MockCvFlashHardware flash;
+  {
+    CvStore store;
+    CvJournal journal(&flash, store, 0);
+    journal.begin();
+    store.write(1, 3);
+    store.write(17, 4);
+    store.write(0x10000, 5);
+
+    // Writes are deferred, e.g. while a reply is pending.
+    journal.task(true);
+    assertEqual(flash.getProgramCount(), 0);
+
+    // The first flush formats a sector (erase, header), then one page takes all three CVs.
+    journal.sync();
+    assertEqual(flash.getEraseCount(), 1);
+    assertEqual(journal.recordCount(), 3);
+    int programs = flash.getProgramCount();
+    store.write(17, 6);
+    journal.task();
+    assertEqual(flash.getProgramCount(), programs + 1);
+  }
+  {
+    CvStore store;
+    store.define(17, 99); // Factory default, overridden by the journal.
+    CvJournal journal(&flash, store, 0);
+    journal.begin();
+    uint8_t value = 0;
+    assertTrue(store.read(17, value));
+    assertEqual(value, 6);
+    assertTrue(store.read(0x10000, value));
+    assertEqual(value, 5);
+    assertEqual(store.dirtyCount(CvDirtyFlag::PERSIST), 0);
+
+    // Fill the sector to force a compaction into the other sector.
+    for (int i = 0; i < CV_JOURNAL_CAPACITY; ++i) {
+      store.write(17, i & 0xFF);
+      journal.sync();
+    }
+    assertEqual(flash.getEraseCount(), 2);
+    assertTrue(journal.recordCount() < 10);
+
+    // A compaction waits with its erase, but not with the pages before it.
+    int erases = flash.getEraseCount();
+    for (int i = 0; i < CV_JOURNAL_CAPACITY && journal.state() != CvJournalState::ERASE; ++i) {
+      store.write(17, i & 0xFF);
+      journal.task(false, true);
+    }
+    assertTrue(journal.state() == CvJournalState::ERASE);
+    journal.task(false, true);
+    assertEqual(flash.getEraseCount(), erases);
+    journal.task();
+    assertEqual(flash.getEraseCount(), erases + 1);
+    store.write(17, (CV_JOURNAL_CAPACITY - 1) & 0xFF);
+    journal.sync();
+  }
+  {
+    CvStore store;
+    CvJournal journal(&flash, store, 0);
+    journal.begin();
+    uint8_t value = 0;
+    assertTrue(store.read(1, value));
+    assertEqual(value, 3);
+    assertTrue(store.read(17, value));
+    assertEqual(value, (CV_JOURNAL_CAPACITY - 1) & 0xFF);
+  }
+}
+
+/**
+ * @brief Verifies that the CV_AUTO broadcast only uses free Channel 2 slots,
+ *        sends changed CVs first and keeps to its rate budget.
+ * @see RCN-217, Section 5.7
+ */
+test(cv_auto_scheduler) {
+  MockRailcomTxHardware txHardware;
+  MockRailcomRxHardware rxHardware;
+  RailcomTx tx(&txHardware);
+  RailcomRx rx(&rxHardware);
+  RailcomMessage* msg;
+  DecoderStateMachine sm(tx, DecoderType::LOCOMOTIVE, 100, 0, 0b00001000);
+  sm.setCvAutoRate(1);
+
+  // Start the broadcast with XF3 (long address format).
+  uint8_t dcc_data[] = {0xC0, 100, 0xDE, 0x03};
+  DCCMessage dcc_msg(dcc_data, 4);
+  sm.handleDccPacket(dcc_msg);
+  tx.on_cutout_start();
+  txHardware.clear();
+
+  // A pending reply occupies Channel 2, so no CV_AUTO is added.
+  tx.sendPomResponse(5);
+  sm.task();
+  tx.on_cutout_start();
+  assertEqual(txHardware.getSentBytes().size(), 2);
+  txHardware.clear();
+
+  // A changed CV is sent before the round-robin cycle.
+  sm.cvs().write(8, 7);
+  sm.task();
+  tx.on_cutout_start();
+  rxHardware.setRxBuffer(txHardware.getSentBytes());
+  msg = rx.read();
+  assertNotNull(msg);
+  assertEqual(msg->id, RailcomID::CV_AUTO);
+  assertEqual(static_cast<CvAutoMessage*>(msg)->cvAddress, 8);
+  assertEqual(static_cast<CvAutoMessage*>(msg)->cvValue, 7);
+  txHardware.clear();
+
+  sm.task();
+  tx.on_cutout_start();
+  rxHardware.setRxBuffer(txHardware.getSentBytes());
+  msg = rx.read();
+  assertNotNull(msg);
+  assertEqual(static_cast<CvAutoMessage*>(msg)->cvAddress, 1);
+  txHardware.clear();
+
+  // The burst is used up; the next message has to wait for the budget.
+  sm.task();
+  tx.on_cutout_start();
+  assertTrue(txHardware.getSentBytes().empty());
+}
+
+/**
+ * @brief Verifies that Channel 2 is packed into its 6-byte window by priority.
+ * @see RCN-217, Section 4.2
+ */
+test(channel2_scheduler) {
+  MockRailcomTxHardware txHardware;
+  MockRailcomRxHardware rxHardware;
+  RailcomTx tx(&txHardware);
+  RailcomRx rx(&rxHardware);
+  RailcomMessage* msg;
+
+  // CV_AUTO (6 bytes, low priority) is queued before a POM reply (2 bytes, high priority).
+  tx.sendCvAuto(3, 4);
+  tx.sendTime(5, true);
+  tx.sendPomResponse(42);
+
+  // The POM reply jumps the queue; TIME fills the window; CV_AUTO no longer fits.
+  tx.on_cutout_start();
+  const auto& first = txHardware.getSentBytes();
+  assertEqual(first.size(), 4);
+  rxHardware.setRxBuffer(first);
+  msg = rx.read();
+  assertNotNull(msg);
+  assertEqual(msg->id, RailcomID::POM);
+  txHardware.clear();
+
+  // A held cutout (packet for another decoder) keeps Channel 2 silent.
+  tx.holdChannel2();
+  tx.on_cutout_start();
+  assertTrue(txHardware.getSentBytes().empty());
+
+  // The remaining CV_AUTO is sent in the next open cutout.
+  tx.on_cutout_start();
+  rxHardware.setRxBuffer(txHardware.getSentBytes());
+  msg = rx.read();
+  assertNotNull(msg);
+  assertEqual(msg->id, RailcomID::CV_AUTO);
+  assertEqual(txHardware.getSentBytes().size(), 6);
+  assertTrue(tx.isChannel2Free());
+}
+
+/**
+ * @brief Verifies that Channel 2 stays open after speed packets for the decoder itself.
+ * @details Short and long addresses are sent in the standard DCC format; only a
+ *          packet for another decoder holds Channel 2.
+ * @see RCN-211, Section 3
+ */
+test(channel2_open_for_own_packets) {
+  MockRailcomTxHardware txHardware;
+  RailcomTx tx(&txHardware);
+  DecoderStateMachine shortSm(tx, DecoderType::LOCOMOTIVE, 3, 0b00000011, 0b00001010);
+
+  const uint8_t short_speed[] = { 0x03, 0x3F, 0x80, 0x03 ^ 0x3F ^ 0x80 };
+  shortSm.handleDccPacket(DCCMessage(short_speed, sizeof(short_speed)));
+  tx.sendInfo(120, 30, 0);
+  tx.on_cutout_start();
+  assertEqual(txHardware.getChannel2Bytes().size(), 6);
+  assertTrue(txHardware.getChannel1Bytes().empty()); // The decoder was addressed.
+  txHardware.clear();
+
+  const uint8_t other_speed[] = { 0x04, 0x3F, 0x80, 0x04 ^ 0x3F ^ 0x80 };
+  shortSm.handleDccPacket(DCCMessage(other_speed, sizeof(other_speed)));
+  tx.sendInfo(120, 30, 0);
+  tx.on_cutout_start();
+  assertTrue(txHardware.getChannel2Bytes().empty());
+  tx.on_cutout_start();
+  txHardware.clear();
+
+  MockRailcomTxHardware longHardware;
+  RailcomTx longTx(&longHardware);
+  DecoderStateMachine longSm(longTx, DecoderType::LOCOMOTIVE, 1234, 0b00000011, 0b00001010);
+  const uint8_t hi = 0xC0 | (1234 >> 8), lo = 1234 & 0xFF;
+  const uint8_t long_speed[] = { hi, lo, 0x3F, 0x80, (uint8_t)(hi ^ lo ^ 0x3F ^ 0x80) };
+  longSm.handleDccPacket(DCCMessage(long_speed, sizeof(long_speed)));
+  longTx.sendInfo(120, 30, 0);
+  longTx.on_cutout_start();
+  assertEqual(longHardware.getChannel2Bytes().size(), 6);
+  assertTrue(longHardware.getChannel1Bytes().empty());
+}
+
+/**
+ * @brief Verifies that a POM for another decoder holds Channel 2 and a POM for itself is answered.
+ * @details Decoder 1000 must neither answer the POM of loco 2000 in Channel 2 nor
+ *          skip its own Channel 1 broadcast for it.
+ * @see RCN-217, Section 5.1.1
+ */
+test(channel2_held_for_foreign_pom) {
+  MockRailcomTxHardware txHardware;
+  MockRailcomRxHardware rxHardware;
+  RailcomTx tx(&txHardware);
+  RailcomRx rx(&rxHardware);
+  DecoderStateMachine sm(tx, DecoderType::LOCOMOTIVE, 1000, 0b00000011, 0b00001010);
+
+  const uint8_t other_hi = 0xC0 | (2000 >> 8), other_lo = 2000 & 0xFF;
+  const uint8_t foreign_pom[] = { other_hi, other_lo, 0b11100100, 1, 0, (uint8_t)(other_hi ^ other_lo ^ 0b11100100 ^ 1) };
+  sm.handleDccPacket(DCCMessage(foreign_pom, sizeof(foreign_pom)));
+  tx.sendInfo(120, 30, 0);
+  tx.on_cutout_start();
+  assertTrue(txHardware.getChannel2Bytes().empty());
+  assertEqual(txHardware.getChannel1Bytes().size(), RAILCOM_CH1_BYTES);
+  tx.on_cutout_start(); // The held INFO goes out in the next open window.
+  txHardware.clear();
+
+  // The reply to a Data Space read for another decoder fills both channels.
+  const uint8_t foreign_read[] = { other_hi, other_lo, 0xED, 0x50, (uint8_t)(other_hi ^ other_lo ^ 0xED ^ 0x50) };
+  sm.handleDccPacket(DCCMessage(foreign_read, sizeof(foreign_read)));
+  tx.on_cutout_start();
+  assertTrue(txHardware.getChannel1Bytes().empty());
+  assertTrue(txHardware.getChannel2Bytes().empty());
+  txHardware.clear();
+
+  const uint8_t hi = 0xC0 | (1000 >> 8), lo = 1000 & 0xFF;
+  const uint8_t own_pom[] = { hi, lo, 0b11100100, 1, 0, (uint8_t)(hi ^ lo ^ 0b11100100 ^ 1) };
+  sm.handleDccPacket(DCCMessage(own_pom, sizeof(own_pom)));
+  tx.on_cutout_start();
+  rxHardware.setRxBuffer(txHardware.getChannel2Bytes());
+  RailcomMessage* msg = rx.read();
+  assertNotNull(msg);
+  assertEqual(msg->id, RailcomID::POM);
+  assertEqual(static_cast<PomMessage*>(msg)->cvValue, 10);
+  txHardware.clear();
+
+  MockRailcomTxHardware shortHardware;
+  RailcomTx shortTx(&shortHardware);
+  DecoderStateMachine shortSm(shortTx, DecoderType::LOCOMOTIVE, 3, 0b00000011, 0b00001010);
+  const uint8_t short_pom[] = { 0x03, 0b11100100, 1, 0, (uint8_t)(0x03 ^ 0b11100100 ^ 1) };
+  shortSm.handleDccPacket(DCCMessage(short_pom, sizeof(short_pom)));
+  shortTx.on_cutout_start();
+  rxHardware.setRxBuffer(shortHardware.getChannel2Bytes());
+  msg = rx.read();
+  assertNotNull(msg);
+  assertEqual(msg->id, RailcomID::POM);
+}
+
+/**
+ * @brief Verifies that the cached Channel 1 rotation follows address and INFO1 changes.
+ * @see RCN-217, Section 5.2.2
+ */
+test(address_rotation_cache) {
+  MockRailcomTxHardware txHardware;
+  RailcomTx tx(&txHardware);
+  uint16_t address = 4097;
+
+  Info1Message info1;
+  info1.on_track_direction_is_positive = true;
+  info1.travel_direction_is_positive = false;
+  info1.is_moving = false;
+  info1.is_in_consist = false;
+  info1.request_addressing = false;
+  tx.enableInfo1(info1);
+
+  // ADR_HIGH, ADR_LOW, INFO1 and back to ADR_HIGH.
+  std::vector<uint8_t> expected[] = {
+    RailcomEncoding::encodeDatagram(RailcomID::ADR_HIGH, (address >> 8) & 0x3F, 6),
+    RailcomEncoding::encodeDatagram(RailcomID::ADR_LOW, address & 0xFF, 8),
+    RailcomEncoding::encodeDatagram(RailcomID::INFO1, 0x01, 8),
+  };
+  for (int i = 0; i < 4; ++i) {
+    tx.sendAddress(address);
+    tx.on_cutout_start();
+    assertTrue(txHardware.getSentBytes() == expected[i % 3]);
+    txHardware.clear();
+  }
+
+  // A new INFO1 payload is picked up at its position in the rotation.
+  info1.is_moving = true;
+  tx.enableInfo1(info1);
+  tx.sendAddress(address);
+  tx.on_cutout_start();
+  txHardware.clear();
+  tx.sendAddress(address);
+  tx.on_cutout_start();
+  assertTrue(txHardware.getSentBytes() == RailcomEncoding::encodeDatagram(RailcomID::INFO1, 0x05, 8));
+  txHardware.clear();
+
+  // A new (short) address rebuilds the rotation.
+  tx.disableInfo1();
+  tx.sendAddress(3);
+  tx.on_cutout_start();
+  assertTrue(txHardware.getSentBytes() == RailcomEncoding::encodeDatagram(RailcomID::ADR_HIGH, 0, 8));
+}
+
+/**
+ * @brief Verifies the randomized logon backoff.
+ * @details The delays stay within the doubling window, depend only on the
+ *          unique ID, and differ between decoders, so two decoders that
+ *          collided once do not stay in lockstep.
+ * @see RCN-218, Section 7.2
+ */
+test(random_logon_backoff) {
+  uint8_t logon_enable_data[] = { RCN218::DCC_A_ADDRESS, (uint8_t)RCN218::CMD_LOGON_ENABLE, 0, 0, 0, 0 };
+  DCCMessage logon_enable_msg(logon_enable_data, sizeof(logon_enable_data));
+
+  // Records which of 40 LOGON_ENABLE commands a decoder answers; nobody selects it.
+  auto answers = [&](uint32_t productId) {
+    MockRailcomTxHardware txHardware;
+    RailcomTx tx(&txHardware);
+    DecoderStateMachine sm(tx, DecoderType::LOCOMOTIVE, 0, 0, 0b00001000, 0x0ABC, productId);
+    std::vector<int> answered;
+    for (int i = 0; i < 40; ++i) {
+      sm.handleDccPacket(logon_enable_msg);
+      tx.on_cutout_start();
+      if (!txHardware.getSentBytes().empty()) answered.push_back(i);
+      txHardware.clear();
+    }
+    return answered;
+  };
+
+  std::vector<int> a = answers(0x12345678);
+  assertTrue(a.size() >= 3);
+  assertEqual(a[0], 0);
+  // Every retry follows within the current window: 8, then 16, 32, ...
+  uint16_t window = LOGON_BACKOFF_MIN_WINDOW;
+  for (size_t i = 1; i < a.size(); ++i) {
+    assertTrue(a[i] - a[i - 1] >= 1);
+    assertTrue(a[i] - a[i - 1] <= window);
+    window *= 2;
+  }
+
+  // The same unique ID gives the same sequence; another one does not.
+  assertTrue(answers(0x12345678) == a);
+  assertTrue(answers(0x12345679) != a);
+}
+
+/**
+ * @brief Verifies the command station side of the logon with a LogonManager.
+ * @see RCN-218, Sections 3.2, 3.4 and 4
+ */
+test(logon_manager) {
+  MockRailcomTxHardware txHardware;
+  MockRailcomRxHardware rxHardware;
+  RailcomTx tx(&txHardware);
+  RailcomRx rx(&rxHardware);
+  LogonManager manager(rx, 0x1234, 0x56, 2000);
+
+  uint16_t reported = 0;
+  manager.onRegistered = [&](uint16_t, uint32_t, uint16_t address) { reported = address; };
+
+  // Sends the next logon packet to the decoders and lets the manager read the cutout.
+  auto cycle = [&](std::vector<DecoderStateMachine*> decoders) {
+    DCCMessage packet;
+    assertTrue(manager.nextPacket(packet));
+    std::vector<uint8_t> bus;
+    for (DecoderStateMachine* sm : decoders) {
+      txHardware.clear();
+      sm->handleDccPacket(packet);
+      tx.on_cutout_start();
+      std::vector<uint8_t> bytes = txHardware.getSentBytes();
+      if (bytes.size() > bus.size()) bus.resize(bytes.size(), 0xFF);
+      for (size_t i = 0; i < bytes.size(); ++i) bus[i] &= bytes[i];
+    }
+    rxHardware.setRxBuffer(bus);
+    assertTrue(manager.expectsReply());
+    manager.processCutout();
+  };
+
+  // A single decoder is registered with LOGON_ENABLE and LOGON_ASSIGN.
+  DecoderStateMachine sm(tx, DecoderType::LOCOMOTIVE, 0, 0, 0b00001000, 0x0ABC, 0x12345678);
+  cycle({ &sm });
+  cycle({ &sm });
+  assertEqual(sm.address(), 2000);
+  assertEqual(reported, 2000);
+  assertEqual(manager.registeredCount(), 1);
+  uint16_t address = 0;
+  assertTrue(manager.lookup(0x0ABC, 0x12345678, address));
+  assertEqual(address, 2000);
+  assertTrue(!manager.lookup(0x0ABC, 0x12345679, address));
+
+  // Two decoders answering at once are recognised as a collision.
+  DecoderStateMachine a(tx, DecoderType::LOCOMOTIVE, 0, 0, 0b00001000, 0x0ABC, 0x00000001);
+  DecoderStateMachine b(tx, DecoderType::LOCOMOTIVE, 0, 0, 0b00001000, 0x0ABC, 0x00000002);
+  cycle({ &a, &b });
+  assertEqual(manager.collisionCount(), 1);
+  assertTrue(rx.collisionDetected());
+
+  // A decoder logging on again gets its previous address.
+  DecoderStateMachine again(tx, DecoderType::LOCOMOTIVE, 0, 0, 0b00001000, 0x0ABC, 0x12345678);
+  cycle({ &again });
+  cycle({ &again });
+  assertEqual(again.address(), 2000);
+  assertEqual(manager.registeredCount(), 1);
+  assertTrue(!manager.addressPoolExhausted());
+
+  // The pool ends at the last long address; further new decoders get none.
+  LogonManager last(rx, 0x1234, 0x56, MAX_LONG_ADDRESS);
+  DecoderStateMachine c(tx, DecoderType::LOCOMOTIVE, 0, 0, 0b00001000, 0x0ABC, 0x00000003);
+  DecoderStateMachine d(tx, DecoderType::LOCOMOTIVE, 0, 0, 0b00001000, 0x0ABC, 0x00000004);
+  DCCMessage packet;
+  for (DecoderStateMachine* sm : { &c, &d }) {
+    for (int i = 0; i < 2; ++i) {
+      assertTrue(last.nextPacket(packet));
+      txHardware.clear();
+      sm->handleDccPacket(packet);
+      tx.on_cutout_start();
+      rxHardware.setRxBuffer(txHardware.getSentBytes());
+      last.processCutout();
+    }
+  }
+  assertEqual(c.address(), MAX_LONG_ADDRESS);
+  assertEqual(d.address(), 0);
+  assertEqual(last.registeredCount(), 1);
+  assertTrue(last.addressPoolExhausted());
+}
+
+/**
+ * @brief Verifies the pipelined, block-wise Data Space read by the command station.
+ * @see RCN-218, Section 4.3
+ */
+test(data_space_reader) {
+  MockRailcomTxHardware txHardware;
+  MockRailcomRxHardware rxHardware;
+  RailcomTx tx(&txHardware);
+  RailcomRx rx(&rxHardware);
+  DataSpaceReader reader(rx);
+
+  DecoderStateMachine sm(tx, DecoderType::LOCOMOTIVE, 3, 0, 0b00001000, 0x0ABC, 0x12345678);
+  uint8_t contents[13];
+  for (size_t i = 0; i < sizeof(contents); ++i) contents[i] = 0xF0 + i; // Uses all 8 bits.
+  sm.setDataSpace(7, contents, sizeof(contents));
+
+  size_t reported = 0;
+  reader.onComplete = [&](uint8_t, const uint8_t* data, size_t len) { if (data != nullptr) reported = len; };
+
+  uint8_t buffer[32] = {};
+  reader.start(3, 7, buffer, sizeof(buffer));
+  int packets = 0;
+  DCCMessage packet;
+  while (reader.nextPacket(packet)) {
+    packets++;
+    txHardware.clear();
+    sm.handleDccPacket(packet);
+    tx.on_cutout_start();
+    std::vector<uint8_t> bytes = txHardware.getSentBytes();
+    // The reply to the second request is disturbed and must be requested again.
+    if (packets == 2) bytes[3] ^= 0x01;
+    rxHardware.setRxBuffer(bytes);
+    assertTrue(reader.expectsReply());
+    reader.processCutout();
+  }
+
+  assertTrue(reader.state() == DataSpaceReadState::COMPLETE);
+  assertEqual(reader.length(), sizeof(contents));
+  assertEqual(reported, sizeof(contents));
+  for (size_t i = 0; i < sizeof(contents); ++i) {
+    assertEqual(buffer[i], contents[i]);
+  }
+  // Blocks 0-3 from offset 0, with block 3 ending the data space, then a new
+  // read at offset 4 for the disturbed block 1.
+  assertEqual(packets, 5);
+  assertEqual(reader.requestCount(), 5);
+  assertEqual(reader.retryCount(), 1);
+
+  // A packet for the decoder between two reads takes a block along; the
+  // sequence numbers put the blocks behind it in place.
+  memset(buffer, 0, sizeof(buffer));
+  reader.start(3, 7, buffer, sizeof(buffer));
+  packets = 0;
+  while (reader.nextPacket(packet)) {
+    packets++;
+    txHardware.clear();
+    sm.handleDccPacket(packet);
+    tx.on_cutout_start();
+    rxHardware.setRxBuffer(txHardware.getSentBytes());
+    reader.processCutout();
+    if (packets == 1) {
+      sm.handleDccPacket(MockDcc::createSpeedPacket(3, 10));
+      tx.on_cutout_start();
+    }
+  }
+  assertTrue(reader.state() == DataSpaceReadState::COMPLETE);
+  for (size_t i = 0; i < sizeof(contents); ++i) {
+    assertEqual(buffer[i], contents[i]);
+  }
+  assertEqual(packets, 4);
+
+  // A data space the decoder does not have is given up.
+  reader.start(3, 2, buffer, DATA_SPACE_CHUNK_SIZE);
+  while (reader.nextPacket(packet)) {
+    txHardware.clear();
+    sm.handleDccPacket(packet);
+    tx.on_cutout_start();
+    rxHardware.setRxBuffer(txHardware.getSentBytes());
+    reader.processCutout();
+  }
+  assertTrue(reader.state() == DataSpaceReadState::FAILED);
+}
+
+/**
+ * @brief Verifies that a data space larger than 64 bytes is stored and read in full.
+ * @details The reply runs through several sequence number cycles, and a block
+ *          lost in the middle is read again from the largest start offset.
+ * @see RCN-218, Section 4.3
+ */
+test(data_space_reader_large) {
+  MockRailcomTxHardware txHardware;
+  MockRailcomRxHardware rxHardware;
+  RailcomTx tx(&txHardware);
+  RailcomRx rx(&rxHardware);
+  DataSpaceReader reader(rx);
+
+  DecoderStateMachine sm(tx, DecoderType::LOCOMOTIVE, 3, 0, 0b00001000, 0x0ABC, 0x12345678);
+  static uint8_t contents[200];
+  for (size_t i = 0; i < sizeof(contents); ++i) contents[i] = (uint8_t)(i * 37 + 5);
+  assertTrue(sm.setDataSpace(7, contents, sizeof(contents)));
+  static uint8_t tooLarge[MAX_DATA_SPACE_SIZE + 1];
+  assertTrue(!sm.setDataSpace(8, tooLarge, sizeof(tooLarge)));
+
+  static uint8_t buffer[256];
+  memset(buffer, 0, sizeof(buffer));
+  reader.start(3, 7, buffer, sizeof(buffer));
+  int packets = 0;
+  DCCMessage packet;
+  while (reader.nextPacket(packet)) {
+    packets++;
+    txHardware.clear();
+    sm.handleDccPacket(packet);
+    tx.on_cutout_start();
+    std::vector<uint8_t> bytes = txHardware.getSentBytes();
+    // Block 19 carries bytes 76-79.
+    if (packets == 20) bytes[3] ^= 0x01;
+    rxHardware.setRxBuffer(bytes);
+    reader.processCutout();
+  }
+
+  assertTrue(reader.state() == DataSpaceReadState::COMPLETE);
+  assertEqual(reader.length(), sizeof(contents));
+  for (size_t i = 0; i < sizeof(contents); ++i) {
+    assertEqual(buffer[i], contents[i]);
+  }
+  // 50 blocks from offset 0, then blocks 0-16 of the read from offset 15,
+  // the last two of which cover bytes 75-82.
+  assertEqual(packets, 67);
+  assertEqual(reader.retryCount(), 1);
+}
+
+/**
+ * @brief Verifies that a large Data Space is sent in cutout-sized blocks.
+ * @see RCN-218, Section 4.3
+ */
+test(data_space_segmented_tx) {
+  MockRailcomTxHardware txHardware;
+  MockRailcomRxHardware rxHardware;
+  RailcomTx tx(&txHardware);
+  RailcomRx rx(&rxHardware);
+
+  uint8_t data[300];
+  for (size_t i = 0; i < sizeof(data); ++i) data[i] = (uint8_t)(i * 7);
+  assertTrue(tx.sendDataSpace(data, sizeof(data), 7));
+
+  // The arena holds 128 blocks; the 75 blocks above leave no room for 60 more.
+  uint8_t more[240] = {};
+  assertTrue(!tx.sendDataSpace(more, sizeof(more), 7));
+
+  std::vector<uint8_t> received;
+  int cutouts = 0;
+  while (!tx.isIdle()) {
+    // A cutout that belongs to another decoder keeps the block waiting.
+    if (cutouts == 10) {
+      tx.holdChannel2();
+      tx.on_cutout_start();
+      assertTrue(txHardware.getSentBytes().empty());
+    }
+    tx.on_cutout_start();
+    cutouts++;
+    assertTrue(txHardware.getSentBytes().size() <= RAILCOM_CH1_BYTES + RAILCOM_CH2_BYTES);
+    rxHardware.setRxBuffer(txHardware.getSentBytes());
+    txHardware.clear();
+    rx.expectDataSpaceResponse(7);
+    DataSpaceMessage* msg = static_cast<DataSpaceMessage*>(rx.read());
+    assertNotNull(msg);
+    assertTrue(msg->crc_ok);
+    received.insert(received.end(), msg->data, msg->data + msg->len);
+  }
+
+  assertEqual(cutouts, 75);
+  assertEqual(received.size(), sizeof(data));
+  for (size_t i = 0; i < sizeof(data); ++i) {
+    assertEqual(received[i], data[i]);
+  }
+}
+
+/**
+ * @brief Verifies that each cutout is handed to the HAL as one Channel 1 / Channel 2 frame.
+ */
+test(tx_send_frame) {
+  MockRailcomTxHardware txHardware;
+  RailcomTx tx(&txHardware);
+
+  // A queued ACK replaces the address broadcast in Channel 1.
+  tx.sendAddress(3);
+  tx.sendAck();
+  tx.on_cutout_start(50);
+  assertEqual(txHardware.getFrameCount(), 1);
+  auto ch1 = txHardware.getChannel1Bytes();
+  assertEqual(ch1.size(), (size_t)2);
+  assertEqual(ch1[0], RAILCOM_ACK1);
+  assertEqual(ch1[1], RAILCOM_ACK2);
+  assertEqual(txHardware.getChannel2Bytes().size(), (size_t)4);
+  assertEqual(txHardware.getChannel2Offset(), RAILCOM_CH2_DELAY_US - 50);
+  txHardware.clear();
+
+  // A held Channel 2 keeps the POM reply for the next cutout.
+  tx.sendAddress(3);
+  tx.sendPomResponse(42);
+  tx.holdChannel2();
+  tx.on_cutout_start();
+  assertEqual(txHardware.getChannel1Bytes().size(), (size_t)RAILCOM_CH1_BYTES);
+  assertTrue(txHardware.getChannel2Bytes().empty());
+  tx.on_cutout_start();
+  assertTrue(txHardware.getChannel1Bytes().empty());
+  assertEqual(txHardware.getChannel2Bytes().size(), (size_t)2);
+  assertEqual(txHardware.getFrameCount(), 2);
+  txHardware.clear();
+
+  // The Channel 1 queue is bounded; replies beyond it are dropped.
+  for (int i = 0; i < RAILCOM_CH1_QUEUE_SIZE + 2; ++i) {
+    tx.sendNack();
+  }
+  int nacks = 0;
+  while (!tx.isIdle()) {
+    tx.on_cutout_start();
+    if (!txHardware.getChannel1Bytes().empty()) nacks++;
+  }
+  assertEqual(nacks, RAILCOM_CH1_QUEUE_SIZE);
+}
+
+/**
+ * @brief Verifies that the receiver fetches the reply of a cutout with a single block read.
+ */
+test(rx_block_read) {
+  MockRailcomRxHardware rxHardware;
+  RailcomRx rx(&rxHardware);
+
+  RailcomFrame frame;
+  RailcomEncoding::encodeFrame(RailcomID::POM, 42, 8, frame);
+  rxHardware.setRxBuffer(std::vector<uint8_t>(frame.bytes, frame.bytes + frame.len));
+  RailcomMessage* msg = rx.read();
+  assertNotNull(msg);
+  assertEqual(msg->id, RailcomID::POM);
+  assertEqual(static_cast<PomMessage*>(msg)->cvValue, 42);
+  assertEqual(rxHardware.getBlockReads(), 1);
+
+  // An empty cutout ends in waitForFrame() without a read.
+  assertTrue(rx.read() == nullptr);
+  assertEqual(rxHardware.getBlockReads(), 1);
+
+  // The default implementation falls back to available() and read().
+  rxHardware.setRxBuffer({0x1E, 0x2D, 0x33});
+  uint8_t bytes[2];
+  uint32_t timestamps[2];
+  assertEqual(rxHardware.RailcomRxHardware::readBlock(bytes, sizeof(bytes), timestamps), (size_t)2);
+  assertEqual(bytes[0], 0x1E);
+  assertEqual(bytes[1], 0x2D);
+  assertEqual(rxHardware.available(), 1);
+}
+
+/**
+ * @brief Verifies that the datagrams of one cutout are returned by successive reads.
+ * @details The reply is read in one block, so ADR_HIGH in Channel 1 and the POM
+ *          reply in Channel 2 arrive together; neither may be lost.
+ */
+test(rx_datagrams_per_cutout) {
+  MockRailcomTxHardware txHardware;
+  MockRailcomRxHardware rxHardware;
+  RailcomTx tx(&txHardware);
+  RailcomRx rx(&rxHardware);
+
+  tx.sendAddress(1234);
+  tx.sendPomResponse(42);
+  tx.sendTime(30, true);
+  tx.on_cutout_start();
+  rxHardware.setRxBuffer(txHardware.getSentBytes());
+  RailcomMessage* msg = rx.read();
+  assertNotNull(msg);
+  assertEqual(msg->id, RailcomID::ADR_HIGH);
+  msg = rx.read();
+  assertNotNull(msg);
+  assertEqual(msg->id, RailcomID::POM);
+  assertEqual(static_cast<PomMessage*>(msg)->cvValue, 42);
+  msg = rx.read();
+  assertNotNull(msg);
+  assertEqual(msg->id, RailcomID::TIME);
+  assertTrue(rx.read() == nullptr);
+  assertEqual(rxHardware.getBlockReads(), 1);
+  txHardware.clear();
+
+  // The next cutout replaces the datagrams that were not read.
+  tx.sendPomResponse(7);
+  tx.sendExt(1, 10);
+  tx.on_cutout_start();
+  rxHardware.setRxBuffer(txHardware.getSentBytes());
+  assertNotNull(rx.read());
+  rxHardware.setRxBuffer(txHardware.getSentBytes());
+  msg = rx.read();
+  assertNotNull(msg);
+  assertEqual(static_cast<PomMessage*>(msg)->cvValue, 7);
+
+  // A channel-bundled datagram stays one message.
+  uint8_t split[RAILCOM_RX_MAX_DATAGRAMS];
+  RailcomFrame unique;
+  RailcomEncoding::encodeFrame(RailcomID::DECODER_UNIQUE, 0x0D12345678ULL, 44, unique);
+  assertEqual(RailcomRx::splitDatagrams(unique.bytes, unique.len, split), (size_t)1);
+}
+
+/**
+ * @brief Verifies the queues between the decoder core and the application core.
+ */
+test(decoder_runtime) {
+  MockRailcomTxHardware txHardware;
+  MockRailcomRxHardware rxHardware;
+  RailcomTx tx(&txHardware);
+  RailcomRx rx(&rxHardware);
+  DecoderStateMachine sm(tx, DecoderType::LOCOMOTIVE, 100, 0b00000011, 0b00001010);
+  DecoderRuntime runtime(sm, tx);
+
+  // A packet is handled on the decoder core and reported to the application.
+  uint8_t dcc_data[] = {100, 0b11100100, 1, 0, 0}; // Address 100, Read CV 1
+  uint32_t packet_end_us = time_us_32();
+  runtime.onPacketEnd(packet_end_us);
+  runtime.onPacket(DCCMessage(dcc_data, 5));
+  runtime.onCutout();
+  // The latency runs from the marked packet end to the start of send_frame().
+  assertEqual(tx.frameStartUs() - packet_end_us, runtime.worstCutoutLatencyUs());
+  rxHardware.setRxBuffer(txHardware.getChannel2Bytes());
+  RailcomMessage* msg = rx.read();
+  assertNotNull(msg);
+  assertEqual(msg->id, RailcomID::POM);
+
+  DecoderEvent event;
+  assertTrue(runtime.pollEvent(event));
+  assertEqual((int)event.type, (int)DecoderEventType::PACKET);
+  assertEqual(event.packet.getLength(), (size_t)5);
+  assertEqual(event.packet.getData()[1], 0b11100100);
+  assertEqual(event.address, 100);
+  assertEqual(event.timestamp_us, packet_end_us);
+  assertTrue(!runtime.pollEvent(event));
+
+  // A message of the application is sent once the decoder core has taken it over.
+  assertTrue(runtime.send(RailcomID::TIME, 0x85, 8));
+  runtime.onCutout();
+  assertTrue(txHardware.getChannel2Bytes().empty());
+  runtime.task();
+  runtime.onCutout();
+  rxHardware.setRxBuffer(txHardware.getChannel2Bytes());
+  msg = rx.read();
+  assertNotNull(msg);
+  assertEqual(msg->id, RailcomID::TIME);
+  assertEqual(runtime.cutoutCount(), (uint32_t)3);
+
+  // Neither queue blocks when it is full; the surplus is counted.
+  for (int i = 0; i < DECODER_EVENT_QUEUE_SIZE + 4; ++i) {
+    runtime.onPacket(DCCMessage(dcc_data, 5));
+    runtime.onCutout();
+  }
+  assertEqual(runtime.droppedEvents(), (uint32_t)5);
+  int sent = 0;
+  while (runtime.send(RailcomID::TIME, 0x85, 8)) sent++;
+  assertEqual(sent, DECODER_TX_QUEUE_SIZE - 1);
+}
+
+/**
+ * @brief Verifies the latency histograms of the reply stages.
+ */
+test(latency_trace) {
+  LatencyTrace trace;
+
+  // Stages only count after a packet end, and only once per packet.
+  trace.mark(LatencyStage::CH1_START, 500);
+  assertEqual(trace.histogram(LatencyStage::CH1_START).count, (uint32_t)0);
+
+  trace.packetEnd(1000);
+  trace.mark(LatencyStage::DECISION, 1010);
+  trace.mark(LatencyStage::DECISION, 1020);
+  trace.mark(LatencyStage::CH1_START, 1050);
+  trace.mark(LatencyStage::CH2_START, 1000 + 193 + 400);
+  trace.packetEnd(2000);
+  trace.mark(LatencyStage::CH1_START, 2090);
+
+  const LatencyHistogram& decision = trace.histogram(LatencyStage::DECISION);
+  assertEqual(decision.count, (uint32_t)1);
+  assertEqual(decision.buckets[0], (uint32_t)1);
+
+  const LatencyHistogram& ch1 = trace.histogram(LatencyStage::CH1_START);
+  assertEqual(ch1.count, (uint32_t)2);
+  assertEqual(ch1.min_us, (uint32_t)50);
+  assertEqual(ch1.max_us, (uint32_t)90);
+  assertEqual(ch1.buckets[50 / LATENCY_BUCKET_US], (uint32_t)1);
+  assertEqual(ch1.buckets[90 / LATENCY_BUCKET_US], (uint32_t)1);
+
+  // Samples beyond the last bucket are collected in it.
+  assertEqual(trace.histogram(LatencyStage::CH2_START).buckets[LATENCY_BUCKETS - 1], (uint32_t)1);
+  assertEqual(trace.histogram(LatencyStage::ENCODE_DONE).count, (uint32_t)0);
+
+  trace.dump(Serial);
+  trace.reset();
+  assertEqual(trace.histogram(LatencyStage::CH1_START).count, (uint32_t)0);
+}
+
+/**
+ * @brief Verifies that RailcomRx counts received and discarded replies.
+ */
+test(rx_statistics) {
+  MockRailcomRxHardware rxHardware;
+  RailcomRx rx(&rxHardware);
+  RailcomRxStats stats;
+
+  RailcomFrame frame;
+  RailcomEncoding::encodeFrame(RailcomID::POM, 42, 8, frame);
+  rxHardware.setRxBuffer(std::vector<uint8_t>(frame.bytes, frame.bytes + frame.len));
+  assertNotNull(rx.read());
+  // An empty cutout is not counted.
+  assertTrue(rx.read() == nullptr);
+
+  // Two decoders answering at once, with a lost byte.
+  rxHardware.setRxBuffer({0x1E, 0xFF, 0x00});
+  rxHardware.setOverrun(true);
+  assertTrue(rx.read() == nullptr);
+
+  rxHardware.setRxBuffer({RAILCOM_NACK, RAILCOM_NACK});
+  rx.read();
+
+  // A Data Space message with a wrong CRC is returned, but counted.
+  const uint8_t payload[] = {1, 2, 3};
+  uint8_t packed[5] = {3, 1, 2, 3, 0};
+  packed[4] = RailcomEncoding::crc8(packed, 4, 7) ^ 0x01;
+  uint8_t encoded[8];
+  size_t encodedLen = RailcomEncoding::encodeBytes(packed, sizeof(packed), encoded);
+  rxHardware.setRxBuffer(std::vector<uint8_t>(encoded, encoded + encodedLen));
+  rx.expectDataSpaceResponse(7);
+  DataSpaceMessage* ds = static_cast<DataSpaceMessage*>(rx.read());
+  assertNotNull(ds);
+  assertTrue(!ds->crc_ok);
+  assertEqual(memcmp(ds->data, payload, sizeof(payload)), 0);
+
+  assertTrue(rx.snapshotStats(stats));
+  assertEqual(stats.frames, 4u);
+  assertEqual(stats.bytes, (uint32_t)(frame.len + 3 + 2 + encodedLen));
+  assertEqual(stats.messages, 3u);
+  assertEqual(stats.perId[static_cast<uint8_t>(RailcomID::POM)], 1u);
+  assertEqual(stats.invalidCodes, 2u);
+  assertEqual(stats.collisions, 1u);
+  assertEqual(stats.overruns, 1u);
+  assertEqual(stats.nacks, 1u);
+  assertEqual(stats.dataSpace, 1u);
+  assertEqual(stats.crcFailures, 1u);
+
+  // A reset only moves the baseline.
+  rx.resetStats();
+  assertTrue(rx.snapshotStats(stats));
+  assertEqual(stats.frames, 0u);
+  assertEqual(stats.crcFailures, 0u);
+  rxHardware.setRxBuffer(std::vector<uint8_t>(frame.bytes, frame.bytes + frame.len));
+  rx.read();
+  assertTrue(rx.snapshotStats(stats));
+  assertEqual(stats.frames, 1u);
+  assertEqual(stats.perId[static_cast<uint8_t>(RailcomID::POM)], 1u);
+}
+
+/**
+ * @brief Verifies the classification of invalid codes and the quality scores.
+ */
+test(rx_cutout_classifier) {
+  // 0x1E and 0x2D are valid; 0x0C = 0x1E & 0x2D is what an overlap looks like.
+  const uint8_t clean[] = {0x1E, 0x2D};
+  const uint8_t overlap[] = {0x0C, 0x2D};
+  const uint8_t ch1Bit[] = {0x1C, 0x2D};       // One bit lost in Channel 1.
+  const uint8_t ch2Bit[] = {0x1E, 0x2D, 0x2C}; // One bit lost in Channel 2.
+  const uint8_t gained[] = {0x1F, 0x2D};       // One bit gained.
+  const uint8_t cutOff[] = {0x1E, 0x2D, 0x7F}; // The last byte ends in idle.
+  assertEqual(RailcomRx::classify(clean, 0), RailcomCutoutClass::EMPTY);
+  assertEqual(RailcomRx::classify(clean, 2), RailcomCutoutClass::CLEAN);
+  assertEqual(RailcomRx::classify(clean, 1), RailcomCutoutClass::TRUNCATED);
+  assertEqual(RailcomRx::classify(overlap, 2), RailcomCutoutClass::COLLISION);
+  assertEqual(RailcomRx::classify(ch1Bit, 2), RailcomCutoutClass::COLLISION);
+  assertEqual(RailcomRx::classify(ch2Bit, 3), RailcomCutoutClass::NOISE);
+  assertEqual(RailcomRx::classify(gained, 2), RailcomCutoutClass::NOISE);
+  assertEqual(RailcomRx::classify(cutOff, 3), RailcomCutoutClass::TRUNCATED);
+
+  MockRailcomRxHardware rxHardware;
+  RailcomRx rx(&rxHardware);
+  assertEqual(rx.quality(), 100);
+  assertEqual(rx.collisionLevel(), 0);
+
+  for (int i = 0; i < 32; ++i) {
+    rxHardware.setRxBuffer({0x0C, 0x2D});
+    rx.read();
+  }
+  assertEqual(rx.cutoutClass(), RailcomCutoutClass::COLLISION);
+  assertTrue(rx.collisionLevel() > 80);
+  assertEqual(rx.quality(), 100); // Collisions say nothing about the signal.
+
+  for (int i = 0; i < 32; ++i) {
+    rxHardware.setRxBuffer({0x1F, 0x2D});
+    rx.read();
+  }
+  assertEqual(rx.cutoutClass(), RailcomCutoutClass::NOISE);
+  assertTrue(rx.quality() < 20);
+  assertTrue(rx.collisionLevel() < 20);
+
+  RailcomRxStats stats;
+  assertTrue(rx.snapshotStats(stats));
+  assertEqual(stats.collisions, 32u);
+  assertEqual(stats.noise, 32u);
+  assertEqual(stats.truncated, 0u);
+
+  // An empty cutout leaves the scores alone.
+  uint8_t quality = rx.quality();
+  assertTrue(rx.read() == nullptr);
+  assertEqual(rx.cutoutClass(), RailcomCutoutClass::EMPTY);
+  assertEqual(rx.quality(), quality);
+}
+
+/**
+ * @brief Verifies the correction of single bit errors.
+ */
+test(rx_soft_decoding) {
+  SymbolCandidate candidates[RAILCOM_SOFT_CANDIDATES];
+  assertEqual(RailcomEncoding::softDecode4of8(0x1E, candidates), (size_t)1);
+  assertEqual(candidates[0].value, 4);
+  assertEqual(candidates[0].confidence, 100);
+  assertEqual(RailcomEncoding::softDecode4of8(0x1F, candidates), (size_t)5);
+  assertEqual(candidates[0].confidence, 20);
+  assertEqual(RailcomEncoding::softDecode4of8(0x0C, candidates), (size_t)0);
+
+  MockRailcomRxHardware rxHardware;
+  RailcomRx rx(&rxHardware);
+  RailcomFrame frame;
+  RailcomEncoding::encodeFrame(RailcomID::ADR_HIGH, 0x35, 6, frame);
+
+  // Off by default.
+  std::vector<uint8_t> bytes(frame.bytes, frame.bytes + frame.len);
+  bytes[0] ^= 0x80;
+  rxHardware.setRxBuffer(bytes);
+  assertTrue(rx.read() == nullptr);
+
+  // A flipped bit in the ID symbol is corrected only where the length leaves
+  // a single candidate, and then always to the sent message.
+  rx.setSoftDecoding(true);
+  int recovered = 0;
+  for (uint8_t bit = 0; bit < 8; ++bit) {
+    bytes.assign(frame.bytes, frame.bytes + frame.len);
+    bytes[0] ^= 1 << bit;
+    rxHardware.setRxBuffer(bytes);
+    RailcomMessage* msg = rx.read();
+    if (msg != nullptr) {
+      assertEqual(msg->id, RailcomID::ADR_HIGH);
+      assertEqual(static_cast<AdrMessage*>(msg)->address, 0x35);
+      recovered++;
+    }
+  }
+  assertTrue(recovered > 0);
+
+  // The CRC of a Data Space message picks the right value of any symbol.
+  uint8_t packed[5] = {3, 0x11, 0x22, 0x33, 0};
+  packed[4] = RailcomEncoding::crc8(packed, 4, 2);
+  uint8_t encoded[8];
+  size_t encodedLen = RailcomEncoding::encodeBytes(packed, sizeof(packed), encoded);
+  encoded[3] ^= 0x10;
+  rxHardware.setRxBuffer(std::vector<uint8_t>(encoded, encoded + encodedLen));
+  rx.expectDataSpaceResponse(2);
+  DataSpaceMessage* ds = static_cast<DataSpaceMessage*>(rx.read());
+  assertNotNull(ds);
+  assertTrue(ds->crc_ok);
+  assertEqual(ds->data[1], 0x22);
+
+  // Collisions are never corrected.
+  bytes.assign(frame.bytes, frame.bytes + frame.len);
+  bytes[0] &= bytes[1];
+  rxHardware.setRxBuffer(bytes);
+  assertTrue(rx.read() == nullptr);
+
+  RailcomRxStats stats;
+  assertTrue(rx.snapshotStats(stats));
+  assertEqual(stats.corrected, (uint32_t)recovered + 1);
+}
+
+/**
+ * @brief Verifies the codec generated from the message schemas.
+ */
+test(schema_codec) {
+  using namespace RailcomSchema;
+  // The codec is evaluated at compile time.
+  static_assert(pack<Time>(1, 5) == 0x85, "TIME layout");
+  static_assert(get<Dyn, Dyn::VALUE>(pack<Dyn>(0xA5, 0x3F)) == 0xA5, "DYN layout");
+  static_assert(unpad<AdrHigh>(0x35 << 2, 8) == 0x35, "ADR_HIGH padding");
+
+  // Values are cut to their field width and do not spill into neighbours.
+  uint64_t info = pack<Info>(0x12345, 0x1FF, 0x1FF);
+  assertEqual(info, (uint64_t)0x2345FFFF);
+  uint64_t speed = get<Info, Info::SPEED>(info);
+  assertEqual(speed, (uint64_t)0x2345);
+
+  // Transmitter and receiver agree on every field of a 44-bit message.
+  MockRailcomTxHardware txHardware;
+  MockRailcomRxHardware rxHardware;
+  RailcomTx tx(&txHardware);
+  RailcomRx rx(&rxHardware);
+  tx.sendDecoderUnique(0xFABC, 0x89ABCDEF);
+  tx.on_cutout_start();
+  rxHardware.setRxBuffer(txHardware.getSentBytes());
+  DecoderUniqueMessage* msg = static_cast<DecoderUniqueMessage*>(rx.read());
+  assertNotNull(msg);
+  assertEqual(msg->manufacturerId, 0xABC);
+  assertEqual(msg->productId, 0x89ABCDEFUL);
+}
+
+/**
+ * @brief Verifies that a newer value replaces a pending message of the same slot.
+ */
+test(channel2_coalescing) {
+  MockRailcomTxHardware txHardware;
+  MockRailcomRxHardware rxHardware;
+  RailcomTx tx(&txHardware);
+  RailcomRx rx(&rxHardware);
+
+  // Five TIME updates between two cutouts: only the last one is sent.
+  for (uint8_t t = 1; t <= 5; ++t) {
+    tx.sendTime(t, false);
+  }
+  tx.on_cutout_start();
+  assertEqual(txHardware.getChannel2Bytes().size(), (size_t)2);
+  rxHardware.setRxBuffer(txHardware.getChannel2Bytes());
+  TimeMessage* time = static_cast<TimeMessage*>(rx.read());
+  assertNotNull(time);
+  assertEqual(time->timeValue, 5);
+  assertTrue(tx.isChannel2Free());
+  txHardware.clear();
+
+  // DYN has one slot per sub-index; the update keeps its place in the order.
+  tx.sendDynamicData(1, 10);
+  tx.sendDynamicData(2, 20);
+  tx.sendDynamicData(1, 11);
+  tx.on_cutout_start();
+  const auto& window = txHardware.getChannel2Bytes();
+  assertEqual(window.size(), (size_t)6);
+  RailcomFrame expected;
+  RailcomEncoding::encodeMessage<RailcomSchema::Dyn>(expected, 11, 1);
+  assertTrue(memcmp(window.data(), expected.bytes, expected.len) == 0);
+  assertTrue(tx.isChannel2Free());
+  txHardware.clear();
+
+  // Messages without a slot are all sent.
+  tx.sendError(1);
+  tx.sendError(2);
+  tx.on_cutout_start();
+  assertEqual(txHardware.getChannel2Bytes().size(), (size_t)4);
+  txHardware.clear();
+
+  // EXT has one slot per type, STAT4 its own although it shares ID 3.
+  tx.sendExt(1, 10);
+  tx.sendExt(2, 20);
+  tx.sendStatus4(0x0F);
+  std::vector<uint8_t> sent;
+  for (int cutout = 0; cutout < 2; ++cutout) {
+    tx.on_cutout_start();
+    const auto& bytes = txHardware.getChannel2Bytes();
+    sent.insert(sent.end(), bytes.begin(), bytes.end());
+    txHardware.clear();
+  }
+  assertTrue(tx.isChannel2Free());
+  RailcomFrame ext1, ext2, stat4;
+  RailcomEncoding::encodeMessage<RailcomSchema::Ext>(ext1, 1, 10);
+  RailcomEncoding::encodeMessage<RailcomSchema::Ext>(ext2, 2, 20);
+  RailcomEncoding::encodeMessage<RailcomSchema::Stat4>(stat4, 0x0F);
+  assertEqual(sent.size(), (size_t)(ext1.len + ext2.len + stat4.len));
+  for (const RailcomFrame* frame : { &ext1, &ext2, &stat4 }) {
+    assertTrue(std::search(sent.begin(), sent.end(), frame->bytes, frame->bytes + frame->len) != sent.end());
+  }
+}
+
+/**
+ * @brief Verifies the scheduling of DYN sources into free Channel 2 windows.
+ * @see RCN-217, Section 5.2.8
+ */
+test(dyn_publisher) {
+  MockRailcomTxHardware txHardware;
+  RailcomTx tx(&txHardware);
+  DynPublisher pub(tx);
+  assertTrue(pub.add(0, 100, 1000, 2, RailcomPriority::HIGH)); // Speed
+  assertTrue(pub.add(5, 0, 500));                              // Temperature
+  assertTrue(pub.add(10, 0, 0));                               // Container level
+  assertTrue(!pub.add(DYN_PUBLISHER_SOURCES, 0, 0));
+  assertEqual(pub.sourceCount(), 3);
+
+  // Nothing is sent before a value is known.
+  assertEqual(pub.task(0), 0);
+
+  // One window holds two messages; the high-priority source goes first.
+  pub.update(0, 50);
+  pub.update(5, 20);
+  pub.update(10, 7);
+  assertEqual(pub.task(0), 2);
+  tx.on_cutout_start();
+  const auto& window = txHardware.getChannel2Bytes();
+  assertEqual(window.size(), (size_t)6);
+  RailcomFrame expected;
+  RailcomEncoding::encodeMessage<RailcomSchema::Dyn>(expected, 50, 0);
+  assertTrue(memcmp(window.data(), expected.bytes, expected.len) == 0);
+  txHardware.clear();
+  assertEqual(pub.task(1), 1);
+  tx.on_cutout_start();
+  txHardware.clear();
+  assertEqual(pub.task(2), 0);
+
+  // Changes within the deadband wait for the refresh; larger ones for the minimum interval.
+  pub.update(0, 51);
+  assertEqual(pub.task(200), 0);
+  pub.update(0, 60);
+  pub.update(0, 61);
+  assertEqual(pub.task(201), 1);
+  tx.on_cutout_start();
+  txHardware.clear();
+  pub.update(0, 70);
+  assertEqual(pub.task(250), 0);
+
+  // A pending reply keeps the publisher out of Channel 2.
+  tx.sendPomResponse(1);
+  assertEqual(pub.task(600), 0);
+  tx.on_cutout_start();
+  txHardware.clear();
+
+  // The changed speed goes before the due refresh of the temperature.
+  assertEqual(pub.task(600), 2);
+  tx.on_cutout_start();
+  RailcomEncoding::encodeMessage<RailcomSchema::Dyn>(expected, 70, 0);
+  assertTrue(memcmp(txHardware.getChannel2Bytes().data(), expected.bytes, expected.len) == 0);
+  assertEqual(pub.sentCount(), (uint32_t)6);
+
+  pub.remove(5);
+  assertEqual(pub.sourceCount(), 2);
+}
+
+/**
+ * @brief Verifies the per-vehicle windows of the telemetry store.
+ */
+test(telemetry_store) {
+  MockRailcomTxHardware txHardware;
+  MockRailcomRxHardware rxHardware;
+  RailcomTx tx(&txHardware);
+  RailcomRx rx(&rxHardware);
+  rx.setContext(DecoderContext::MOBILE);
+  TelemetryStore store;
+  TelemetryWindow stats;
+  uint16_t value;
+
+  // INFO messages read by the receiver feed speed and load of the addressed vehicle.
+  const uint8_t loads[] = { 40, 60, 20 };
+  for (uint8_t i = 0; i < 3; ++i) {
+    tx.sendInfo(100 + i, loads[i], 0);
+    tx.on_cutout_start();
+    rxHardware.setRxBuffer(txHardware.getChannel2Bytes());
+    txHardware.clear();
+    assertTrue(store.record(3, rx.read(), 1200 + i * 100));
+  }
+  assertTrue(store.latest(3, TelemetryMetric::MOTOR_LOAD, value));
+  assertEqual(value, 20);
+  assertTrue(store.window(3, TelemetryMetric::MOTOR_LOAD, TelemetryResolution::SECOND, 1500, stats));
+  assertEqual(stats.min, 20);
+  assertEqual(stats.max, 60);
+  assertEqual(stats.avg, 40);
+  assertEqual(stats.count, 3);
+
+  // A second later the samples are in the previous window; the minute window still holds them.
+  store.addSample(3, TelemetryMetric::MOTOR_LOAD, 80, 2100);
+  assertTrue(store.window(3, TelemetryMetric::MOTOR_LOAD, TelemetryResolution::SECOND, 2100, stats, 1));
+  assertEqual(stats.count, 3);
+  assertTrue(store.window(3, TelemetryMetric::MOTOR_LOAD, TelemetryResolution::SECOND, 2100, stats));
+  assertEqual(stats.avg, 80);
+  assertTrue(store.window(3, TelemetryMetric::MOTOR_LOAD, TelemetryResolution::MINUTE, 2100, stats));
+  assertEqual(stats.count, 4);
+  assertEqual(stats.max, 80);
+
+  // Windows that have rotated out of the ring are empty, not stale.
+  assertTrue(!store.window(3, TelemetryMetric::MOTOR_LOAD, TelemetryResolution::SECOND,
+                           2100 + TELEMETRY_RING_WINDOWS * 1000, stats, 1));
+  store.addSample(3, TelemetryMetric::MOTOR_LOAD, 10, 2100 + TELEMETRY_RING_WINDOWS * 1000);
+  assertTrue(store.window(3, TelemetryMetric::MOTOR_LOAD, TelemetryResolution::SECOND,
+                          2100 + TELEMETRY_RING_WINDOWS * 1000, stats));
+  assertEqual(stats.count, 1);
+
+  // A saturated count stops the sum as well, so the mean stays in range.
+  for (uint32_t i = 0; i < UINT16_MAX + 100UL; ++i) {
+    store.addSample(4, TelemetryMetric::SPEED, i < UINT16_MAX ? 100 : 60000, 2500);
+  }
+  assertTrue(store.window(4, TelemetryMetric::SPEED, TelemetryResolution::SECOND, 2500, stats));
+  assertEqual(stats.count, UINT16_MAX);
+  assertEqual(stats.avg, 100);
+  assertEqual(stats.max, 60000);
+
+  // Only tracked DYN sub-indices are recorded.
+  DynMessage dyn;
+  dyn.id = RailcomID::DYN;
+  dyn.subIndex = 7;
+  dyn.value = 33;
+  assertTrue(!store.record(3, &dyn, 3000));
+  assertTrue(store.trackDyn(TelemetryMetric::DYN_1, 7));
+  assertTrue(store.record(3, &dyn, 3000));
+  assertTrue(store.latest(3, TelemetryMetric::DYN_1, value));
+  assertEqual(value, 33);
+  assertTrue(!store.record(3, nullptr, 3000));
+
+  // A full table replaces the vehicle that was heard least recently.
+  for (uint16_t address = 10; address < 10 + TELEMETRY_VEHICLES; ++address) {
+    store.addSample(address, TelemetryMetric::SPEED, address, 4000 + address);
+  }
+  assertEqual(store.vehicleCount(), TELEMETRY_VEHICLES);
+  assertTrue(!store.latest(3, TelemetryMetric::SPEED, value));
+  assertTrue(store.latest(10 + TELEMETRY_VEHICLES - 1, TelemetryMetric::SPEED, value));
+}
+
+/**
+ * @brief Verifies that packets too short for their command fire no callback.
+ */
+test(dcc_parser_short_packets) {
+  RailcomDccParser parser;
+  int calls = 0;
+  parser.onLogonEnable = [&](uint8_t, uint16_t, uint8_t) { calls++; };
+  parser.onLogonAssign = [&](uint16_t, uint32_t, uint16_t) { calls++; };
+  parser.onPomWriteCv = [&](uint16_t, uint8_t, uint16_t) { calls++; };
+  parser.onFunction = [&](uint16_t, uint8_t, bool) { calls++; };
+
+  // Each packet lacks the last byte its command reads.
+  const uint8_t logon_enable[] = { RCN218::DCC_A_ADDRESS, RCN218::CMD_LOGON_ENABLE, 0x12, 0x34 };
+  const uint8_t logon_assign[] = { RCN218::DCC_A_ADDRESS, RCN218::CMD_LOGON_ASSIGN, 0, 1, 2, 3, 4, 0xC0 };
+  const uint8_t pom_write[] = { 0xC4, 0xD2, 0xEC, 0x07 };
+  const uint8_t function[] = { 0x03, 0xD5 };
+  parser.parse(DCCMessage(logon_enable, sizeof(logon_enable)), nullptr);
+  parser.parse(DCCMessage(logon_assign, sizeof(logon_assign)), nullptr);
+  parser.parse(DCCMessage(pom_write, sizeof(pom_write)), nullptr);
+  parser.parse(DCCMessage(function, sizeof(function)), nullptr);
+  assertEqual(calls, 0);
+
+  // With the missing byte, the same commands are recognised.
+  const uint8_t logon_enable_full[] = { RCN218::DCC_A_ADDRESS, RCN218::CMD_LOGON_ENABLE, 0x12, 0x34, 0x56 };
+  const uint8_t pom_write_full[] = { 0xC4, 0xD2, 0xEC, 0x07, 0x2A };
+  parser.parse(DCCMessage(logon_enable_full, sizeof(logon_enable_full)), nullptr);
+  parser.parse(DCCMessage(pom_write_full, sizeof(pom_write_full)), nullptr);
+  assertEqual(calls, 2);
+}
+
+// Counts the heap allocations of the whole sketch, for no_heap_after_begin.
+static uint32_t heapAllocations = 0;
+
+void* operator new(size_t size) {
+  heapAllocations++;
+  void* memory = malloc(size != 0 ? size : 1);
+  if (memory == nullptr) abort();
+  return memory;
+}
+
+void operator delete(void* memory) noexcept { free(memory); }
+void operator delete(void* memory, size_t) noexcept { free(memory); }
+
+/**
+ * @brief Verifies that decoding, sending and receiving allocate nothing once the objects are set up.
+ * @details Only the library calls are counted; the mocks store the bytes in
+ *          vectors, which reach their final capacity in the first round.
+ */
+test(no_heap_after_begin) {
+  MockRailcomTxHardware txHardware;
+  MockRailcomRxHardware rxHardware;
+  RailcomTx tx(&txHardware);
+  RailcomRx rx(&rxHardware);
+  DecoderStateMachine sm(tx, DecoderType::LOCOMOTIVE, 100, 0b00000011, 0b00001010);
+  DynPublisher pub(tx);
+  TelemetryStore store;
+  tx.begin();
+  rx.begin();
+  rx.setContext(DecoderContext::MOBILE);
+  pub.add(0, 0, 0);
+  uint8_t pom_read[] = {100, 0b11100100, 1, 0, 0}; // Address 100, Read CV 1
+  uint8_t block[DATA_SPACE_CHUNK_SIZE] = {1, 2, 3};
+  std::vector<uint8_t> reply;
+  reply.reserve(RAILCOM_RX_MAX_BYTES);
+
+  for (int round = 0; round < 2; ++round) {
+    txHardware.clear();
+    uint32_t before = heapAllocations;
+    sm.handleDccPacket(DCCMessage(pom_read, 5));
+    tx.sendAddress(100);
+    tx.on_cutout_start();
+    tx.sendInfo(120, 30, 0);
+    tx.on_cutout_start();
+    pub.update(0, round);
+    pub.task(round * 1000);
+    tx.sendDecoderUnique(0xABC, 0x12345678);
+    tx.sendDataSpace(block, sizeof(block), 1);
+    tx.on_cutout_start();
+    tx.on_cutout_start();
+    sm.task();
+    uint32_t tx_allocations = heapAllocations - before;
+
+    reply = txHardware.getChannel2Bytes();
+    rxHardware.setRxBuffer(reply);
+    before = heapAllocations;
+    RailcomMessage* msg = rx.read();
+    store.record(100, msg, round * 1000);
+    RailcomRxStats stats;
+    rx.snapshotStats(stats);
+    uint32_t rx_allocations = heapAllocations - before;
+
+    assertNotNull(msg);
+    if (round > 0) {
+      assertEqual(tx_allocations, (uint32_t)0);
+      assertEqual(rx_allocations, (uint32_t)0);
+    }
+  }
+  assertTrue(rx.arena().peak() <= RAILCOM_RX_ARENA_BYTES);
+  assertEqual(rx.arena().failures(), (uint32_t)0);
+}
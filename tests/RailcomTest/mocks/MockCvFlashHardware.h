@@ -0,0 +1,44 @@
+#ifndef MOCK_CV_FLASH_HARDWARE_H
+#define MOCK_CV_FLASH_HARDWARE_H
+
+#include "CvFlashHardware.h"
+#include <vector>
+#include <cstring>
+
+class MockCvFlashHardware : public CvFlashHardware {
+public:
+    MockCvFlashHardware(uint8_t sectorCount = 2)
+        : _flash((size_t)sectorCount * CV_FLASH_SECTOR_SIZE, 0xFF), _sector_count(sectorCount) {}
+
+    // --- Methods to inspect the mock ---
+    int getEraseCount() const { return _erase_count; }
+    int getProgramCount() const { return _program_count; }
+
+    // --- CvFlashHardware implementation ---
+    uint8_t sectorCount() const override { return _sector_count; }
+
+    void read(uint32_t offset, uint8_t* dst, size_t len) override {
+        memcpy(dst, &_flash[offset], len);
+    }
+
+    void eraseSector(uint8_t sector) override {
+        memset(&_flash[(size_t)sector * CV_FLASH_SECTOR_SIZE], 0xFF, CV_FLASH_SECTOR_SIZE);
+        _erase_count++;
+    }
+
+    void programPage(uint32_t offset, const uint8_t* data) override {
+        // Like NOR flash, programming can only clear bits.
+        for (size_t i = 0; i < CV_FLASH_PAGE_SIZE; ++i) {
+            _flash[offset + i] &= data[i];
+        }
+        _program_count++;
+    }
+
+private:
+    std::vector<uint8_t> _flash;
+    uint8_t _sector_count;
+    int _erase_count = 0;
+    int _program_count = 0;
+};
+
+#endif // MOCK_CV_FLASH_HARDWARE_H
@@ -6,17 +6,6 @@
 // Provides helper functions to create mock DCCMessage objects for testing.
 namespace MockDcc {
 
-/**
- * @brief Creates a DCC accessory decoder packet.
- */
-DCCMessage createAccessoryPacket(uint16_t address, bool thrown) {
-    uint8_t addr_high = 0b10000000 | ((address - 1) >> 2);
-    uint8_t addr_low = ((address - 1) & 0b11) << 4;
-    uint8_t cmd_byte = 0b10001000 | addr_low | (thrown ? 1 : 0);
-    uint8_t data[] = {addr_high, cmd_byte, (uint8_t)(addr_high ^ cmd_byte)};
-    return DCCMessage(data, sizeof(data));
-}
-
 /**
  * @brief Creates a DCC speed and direction packet for a locomotive.
  */
@@ -58,18 +47,24 @@ DCCMessage createDccALogonAssignPacket(uint8_t handle, uint16_t address) {
 }
 
 // Creates a DCC message for an accessory decoder.
-// See NMRA S-9.2.1
+// See RCN-213, 2.1: 10AAAAAA 1AAADAAR
 DCCMessage createAccessoryDccMessage(uint16_t address, bool activate, uint8_t output) {
-    // Accessory addresses are mapped to a specific byte format.
-    // Address bits 1-6 are in the first byte.
-    // Address bits 7-9 are inverted and in the second byte.
-    uint8_t byte1 = 0b10000000 | ((address - 1) & 0b00111111);
-    uint8_t byte2 = 0b10001000 | (~(address >> 6) & 0b00000111) | (activate ? 0b00000001 : 0) | (output & 0b00000110);
+    // Address bits 0-5 are in the first byte.
+    // Address bits 6-8 are inverted and in the second byte.
+    uint8_t byte1 = 0b10000000 | (address & 0b00111111);
+    uint8_t byte2 = 0b10000000 | ((~(address >> 6) & 0b00000111) << 4) | (activate ? 0b00001000 : 0) | (output & 0b00000111);
 
     uint8_t dcc_data[] = {byte1, byte2, (uint8_t)(byte1 ^ byte2)};
     return DCCMessage(dcc_data, 3);
 }
 
+/**
+ * @brief Creates a DCC accessory decoder packet.
+ */
+DCCMessage createAccessoryPacket(uint16_t address, bool thrown) {
+    return createAccessoryDccMessage(address, true, thrown ? 1 : 0);
+}
+
 } // namespace MockDcc
 
 #endif // MOCK_DCC_H
@@ -13,6 +13,9 @@ public:
     void clear() {
         _rxBuffer.clear();
     }
+    void setOverrun(bool overrun) {
+        _overrun = overrun;
+    }
 
     // --- RailcomRxHardware implementation ---
     void begin() override {}
@@ -32,8 +35,35 @@ public:
         return val;
     }
 
+    size_t readBlock(uint8_t* dst, size_t max, uint32_t* timestamps_us = nullptr) override {
+        size_t count = _rxBuffer.size() < max ? _rxBuffer.size() : max;
+        for (size_t i = 0; i < count; ++i) {
+            dst[i] = _rxBuffer[i];
+            // The bytes arrive back to back: 40 us per byte at 250 kBaud.
+            if (timestamps_us != nullptr) timestamps_us[i] = i * 40;
+        }
+        _rxBuffer.erase(_rxBuffer.begin(), _rxBuffer.begin() + count);
+        _blockReads++;
+        return count;
+    }
+
+    // The whole reply is loaded at once, so there is nothing to wait for.
+    bool waitForFrame(uint32_t /*timeout_ms*/) override {
+        return !_rxBuffer.empty();
+    }
+
+    bool overrunOccurred() override {
+        bool overrun = _overrun;
+        _overrun = false;
+        return overrun;
+    }
+
+    int getBlockReads() { return _blockReads; }
+
 private:
     std::vector<uint8_t> _rxBuffer;
+    int _blockReads = 0;
+    bool _overrun = false;
 };
 
 #endif // MOCK_RAILCOM_RX_HARDWARE_H
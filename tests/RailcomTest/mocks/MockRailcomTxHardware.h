@@ -9,8 +9,16 @@ class MockRailcomTxHardware : public RailcomTxHardware {
 public:
     // --- Methods to control the mock ---
     std::vector<uint8_t> getSentBytes() { return _sentBytes; }
+    std::vector<uint8_t> getChannel1Bytes() { return _ch1Bytes; }
+    std::vector<uint8_t> getChannel2Bytes() { return _ch2Bytes; }
+    uint32_t getChannel2Offset() { return _ch2Offset; }
+    int getFrameCount() { return _frames; }
     void clear() {
         _sentBytes.clear();
+        _ch1Bytes.clear();
+        _ch2Bytes.clear();
+        _ch2Offset = 0;
+        _frames = 0;
     }
 
     // --- RailcomTxHardware implementation ---
@@ -18,12 +26,25 @@ public:
     void end() override {}
     void task() override {}
 
-    void send_bytes(const std::vector<uint8_t>& bytes) override {
-        _sentBytes.insert(_sentBytes.end(), bytes.begin(), bytes.end());
+    void send(const uint8_t* bytes, size_t len) override {
+        _sentBytes.insert(_sentBytes.end(), bytes, bytes + len);
+    }
+
+    void send_frame(const uint8_t* ch1, size_t ch1_len,
+                    const uint8_t* ch2, size_t ch2_len, uint32_t ch2_offset_us) override {
+        _ch1Bytes.assign(ch1, ch1 + ch1_len);
+        _ch2Bytes.assign(ch2, ch2 + ch2_len);
+        _ch2Offset = ch2_offset_us;
+        _frames++;
+        RailcomTxHardware::send_frame(ch1, ch1_len, ch2, ch2_len, ch2_offset_us);
     }
 
 private:
     std::vector<uint8_t> _sentBytes;
+    std::vector<uint8_t> _ch1Bytes; // Channel 1 bytes of the last frame
+    std::vector<uint8_t> _ch2Bytes; // Channel 2 bytes of the last frame
+    uint32_t _ch2Offset = 0;
+    int _frames = 0;
 };
 
 #endif // MOCK_RAILCOM_TX_HARDWARE_H
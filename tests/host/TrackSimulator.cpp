@@ -0,0 +1,449 @@
+/**
+ * @file TrackSimulator.cpp
+ * @brief Implementation of the multi-decoder track simulator.
+ */
+#include "TrackSimulator.h"
+#include "RailcomEncoding.h"
+#include "RailcomProtocolDefs.h"
+#include "pico/time.h"
+#include <atomic>
+#include <cstring>
+#include <thread>
+
+/** @brief Manufacturer ID used for the simulated decoders (13 = DIY decoders). */
+static constexpr uint16_t SIM_MANUFACTURER_ID = 13;
+/** @brief First address handed out to a fixed locomotive. */
+static constexpr uint16_t SIM_FIRST_LOCO_ADDRESS = 1000;
+/** @brief First address handed out by LOGON_ASSIGN. */
+static constexpr uint16_t SIM_FIRST_ASSIGNED_ADDRESS = 5000;
+/** @brief ID of the simulated command station. */
+static constexpr uint16_t SIM_ZID = 0x1234;
+/** @brief Session ID used by the simulated command station. */
+static constexpr uint8_t SIM_SESSION_ID = 1;
+/** @brief Data space read from the fixed locomotives (5 = long name). */
+static constexpr uint8_t SIM_DATA_SPACE = 5;
+/** @brief Size of the data space of the fixed locomotives. */
+static constexpr size_t SIM_DATA_SPACE_SIZE = 32;
+/** @brief Duration of a DCC "1" bit in microseconds (NMRA S-9.1). */
+static constexpr uint32_t DCC_ONE_US = 116;
+/** @brief Duration of a DCC "0" bit in microseconds (NMRA S-9.1). */
+static constexpr uint32_t DCC_ZERO_US = 200;
+/** @brief Number of preamble bits, including the bits replaced by the cutout. */
+static constexpr uint32_t DCC_PREAMBLE_BITS = 17;
+
+/**
+ * @brief splitmix64, used to derive unique product IDs from the scenario seed.
+ */
+static uint64_t splitmix64(uint64_t& state) {
+    uint64_t z = (state += 0x9E3779B97F4A7C15ULL);
+    z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ULL;
+    z = (z ^ (z >> 27)) * 0x94D049BB133111EBULL;
+    return z ^ (z >> 31);
+}
+
+/**
+ * @brief Returns the time needed to send a packet, including its preamble.
+ */
+static uint32_t packetDurationUs(const DCCMessage& msg) {
+    uint32_t us = DCC_PREAMBLE_BITS * DCC_ONE_US + DCC_ONE_US; // Preamble and end bit.
+    const uint8_t* data = msg.getData();
+    for (size_t i = 0; i < msg.getLength(); ++i) {
+        int ones = __builtin_popcount(data[i]);
+        us += DCC_ZERO_US + ones * DCC_ONE_US + (8 - ones) * DCC_ZERO_US; // Start bit and data.
+    }
+    return us;
+}
+
+/**
+ * @brief Builds a packet and appends the XOR checksum.
+ */
+static DCCMessage makePacket(std::initializer_list<uint8_t> bytes) {
+    uint8_t data[12];
+    size_t len = 0;
+    uint8_t checksum = 0;
+    for (uint8_t b : bytes) {
+        data[len++] = b;
+        checksum ^= b;
+    }
+    data[len++] = checksum;
+    return DCCMessage(data, len);
+}
+
+/**
+ * @brief Fills the data space of a fixed locomotive.
+ * @details The contents depend on the address and use all 8 bits of a byte.
+ */
+static void simDataSpace(uint16_t address, uint8_t* data) {
+    for (size_t i = 0; i < SIM_DATA_SPACE_SIZE; ++i) {
+        data[i] = (uint8_t)(address * 131 + i * 17);
+    }
+}
+
+// --- SimResult ---
+
+double SimResult::collisionRate() const {
+    uint64_t busy = ch1.busy + ch2.busy;
+    return busy ? (double)(ch1.collisions + ch2.collisions) / busy : 0.0;
+}
+
+double SimResult::ch1Congestion() const {
+    return packets ? (double)ch1.collisions / packets : 0.0;
+}
+
+double SimResult::ch1Occupancy() const {
+    return ch1.busy ? (double)ch1.transmitters / ch1.busy : 0.0;
+}
+
+double SimResult::dataSpaceThroughput() const {
+    return simulatedUs ? dataSpaceBytes * 1e6 / simulatedUs : 0.0;
+}
+
+// --- CaptureTxHardware ---
+
+void CaptureTxHardware::send(const uint8_t* bytes, size_t len) {
+    std::vector<uint8_t>& channel = (SimClock::cutout_us < RAILCOM_CH2_DELAY_US) ? ch1 : ch2;
+    channel.insert(channel.end(), bytes, bytes + len);
+}
+
+void CaptureTxHardware::clear() {
+    ch1.clear();
+    ch2.clear();
+}
+
+// --- BusRxHardware ---
+
+int BusRxHardware::available() {
+    return (int)(_bytes.size() - _pos);
+}
+
+int BusRxHardware::read() {
+    return _pos < _bytes.size() ? _bytes[_pos++] : -1;
+}
+
+size_t BusRxHardware::readBlock(uint8_t* dst, size_t max, uint32_t* timestamps_us) {
+    size_t count = 0;
+    while (count < max && _pos < _bytes.size()) {
+        if (timestamps_us != nullptr) {
+            timestamps_us[count] = time_us_32();
+        }
+        dst[count++] = _bytes[_pos++];
+    }
+    return count;
+}
+
+bool BusRxHardware::waitForFrame(uint32_t timeout_ms) {
+    if (_pos >= _bytes.size()) {
+        SimClock::now_us += (uint64_t)timeout_ms * 1000;
+        return false;
+    }
+    return true;
+}
+
+void BusRxHardware::load(const std::vector<uint8_t>& bytes) {
+    _bytes = bytes;
+    _pos = 0;
+}
+
+// --- TrackSimulator ---
+
+TrackSimulator::VirtualDecoder::VirtualDecoder(uint16_t address, uint16_t manufacturerId, uint32_t productId)
+    : tx(&hardware), sm(tx, DecoderType::LOCOMOTIVE, address, 0, 0b00001000, manufacturerId, productId),
+      isNew(address == 0), registered(false) {
+}
+
+TrackSimulator::TrackSimulator(const SimConfig& config)
+    : _config(config), _detector(&_detectorHardware),
+      _logon(_detector, SIM_ZID, SIM_SESSION_ID, SIM_FIRST_ASSIGNED_ADDRESS), _reader(_detector),
+      _next_loco(0), _packet_count(0), _logon_sum_ms(0), _next_reader_loco(0), _reader_address(0),
+      _reader_buffer(), _noise_state(config.seed ^ 0xD1B54A32D192ED03ULL) {
+    _result.config = config;
+    _detector.setContext(DecoderContext::MOBILE);
+    _logon.onRegistered = [this](uint16_t, uint32_t, uint16_t address) {
+        handleRegistered(address);
+    };
+    _reader.onComplete = [this](uint8_t, const uint8_t* data, size_t len) {
+        handleDataSpace(data, len);
+    };
+
+    for (uint16_t i = 0; i < config.locomotives; ++i) {
+        uint16_t address = SIM_FIRST_LOCO_ADDRESS + i;
+        _decoders.emplace_back(new VirtualDecoder(address, SIM_MANUFACTURER_ID, address));
+        preRegister(*_decoders.back(), address);
+        uint8_t dataSpace[SIM_DATA_SPACE_SIZE];
+        simDataSpace(address, dataSpace);
+        _decoders.back()->sm.setDataSpace(SIM_DATA_SPACE, dataSpace, sizeof(dataSpace));
+        _known.push_back(address);
+    }
+
+    uint64_t state = config.seed;
+    for (uint16_t i = 0; i < config.newDecoders; ++i) {
+        // Unique IDs are random but must not clash with the fixed locomotives.
+        uint32_t productId = (uint32_t)splitmix64(state) | 0x80000000UL;
+        _decoders.emplace_back(new VirtualDecoder(0, SIM_MANUFACTURER_ID, productId));
+        _decoders.back()->sm.setLogonBackoff(config.backoff);
+    }
+
+    if (config.measureLatency) {
+        for (auto& decoder : _decoders) {
+            decoder->runtime.reset(new DecoderRuntime(decoder->sm, decoder->tx));
+        }
+    }
+}
+
+void TrackSimulator::preRegister(VirtualDecoder& decoder, uint16_t address) {
+    const DCCMessage packets[] = {
+        makePacket({ RCN218::DCC_A_ADDRESS, RCN218::CMD_LOGON_ENABLE, 0x00, 0x00, 0x00 }),
+        makePacket({ RCN218::DCC_A_ADDRESS, (uint8_t)(RCN218::CMD_LOGON_ASSIGN | ((SIM_MANUFACTURER_ID >> 8) & 0x0F)),
+                     (uint8_t)(SIM_MANUFACTURER_ID & 0xFF), 0, 0, (uint8_t)(address >> 8), (uint8_t)address,
+                     (uint8_t)(address >> 8), (uint8_t)address }),
+    };
+    for (const DCCMessage& packet : packets) {
+        decoder.sm.handleDccPacket(packet);
+        decoder.tx.on_cutout_start(RAILCOM_CH2_DELAY_US);
+    }
+    decoder.hardware.clear();
+}
+
+SimResult TrackSimulator::run() {
+    SimClock::wall = _config.measureLatency;
+    SimClock::set(0);
+    const uint64_t end_us = (uint64_t)_config.durationMs * 1000;
+    while (SimClock::now_us < end_us) {
+        if (_config.stopWhenRegistered && _config.newDecoders > 0 && _result.registered == _config.newDecoders) {
+            break;
+        }
+        step();
+    }
+
+    _result.simulatedUs = SimClock::now_us;
+    _result.dataSpaceRequests = _reader.requestCount();
+    _result.dataSpaceRetries = _reader.retryCount();
+    _result.logonMeanMs = _result.registered ? (uint32_t)(_logon_sum_ms / _result.registered) : 0;
+    for (auto& decoder : _decoders) {
+        if (decoder->runtime && decoder->runtime->worstCutoutLatencyUs() > _result.worstCutoutLatencyUs) {
+            _result.worstCutoutLatencyUs = decoder->runtime->worstCutoutLatencyUs();
+        }
+    }
+    SimClock::wall = false;
+    return _result;
+}
+
+void TrackSimulator::step() {
+    DCCMessage packet = nextPacket();
+    uint64_t packet_end = SimClock::now_us + packetDurationUs(packet);
+
+    // The packet is complete once its end bit has been received; the cutout follows.
+    SimClock::set(packet_end);
+    if (_config.measureLatency) {
+        // Every decoder has a CPU of its own, so each one starts at the end of the packet.
+        for (auto& decoder : _decoders) {
+            SimClock::set(packet_end);
+            decoder->hardware.clear();
+            decoder->runtime->onPacketEnd(time_us_32());
+            decoder->runtime->onPacket(packet);
+            decoder->runtime->onCutout();
+            DecoderEvent event;
+            while (decoder->runtime->pollEvent(event)) {
+            }
+        }
+        SimClock::set(packet_end);
+    } else {
+        for (auto& decoder : _decoders) {
+            decoder->sm.handleDccPacket(packet);
+        }
+
+        for (auto& decoder : _decoders) {
+            SimClock::cutout_us = 0;
+            decoder->hardware.clear();
+            decoder->tx.on_cutout_start();
+        }
+    }
+    SimClock::cutout_us = 0;
+    _result.packets++;
+
+    // Waiting on an empty window advances the clock; the detector runs in parallel
+    // to the track, so its waiting must not delay the next packet.
+    const uint64_t cutout_start = SimClock::now_us;
+    std::vector<uint8_t> bus;
+    std::vector<uint8_t> ch2;
+    bool ch1_collided = combine(1, bus, _result.ch1);
+    bool collided = combine(2, ch2, _result.ch2);
+    disturb(bus);
+    disturb(ch2);
+
+    if (_reader.expectsReply()) {
+        // A Data Space block extends over both channels.
+        bus.insert(bus.end(), ch2.begin(), ch2.end());
+        _detectorHardware.load(bus);
+        _reader.processCutout();
+    } else {
+        if (ch1_collided) {
+            _detectorHardware.load(bus);
+            if (_detector.read() != nullptr) {
+                _result.ch1.undetected++;
+            }
+        } else if (!bus.empty()) {
+            _detectorHardware.load(bus);
+            _detector.read();
+        }
+
+        _detectorHardware.load(ch2);
+        RailcomMessage* reply = nullptr;
+        if (_logon.expectsReply()) {
+            reply = _logon.processCutout();
+        } else if (!ch2.empty()) {
+            reply = _detector.read();
+        }
+        if (collided && reply != nullptr && !_detector.collisionDetected()) {
+            _result.ch2.undetected++;
+        }
+    }
+    SimClock::now_us = cutout_start;
+
+    for (auto& decoder : _decoders) {
+        if (decoder->runtime) {
+            decoder->runtime->task();
+        } else {
+            decoder->sm.task();
+        }
+    }
+}
+
+DCCMessage TrackSimulator::nextPacket() {
+    uint32_t n = _packet_count++;
+
+    DCCMessage packet;
+    bool discovery = _config.logonInterval > 0 && n % _config.logonInterval == 0;
+    if (_logon.nextPacket(packet, discovery)) {
+        return packet;
+    }
+
+    if (_config.dataSpaceInterval > 0 && n % _config.dataSpaceInterval == 0 && _config.locomotives > 0) {
+        if (_reader.state() != DataSpaceReadState::RUNNING) {
+            // Read the data space of the next fixed locomotive.
+            _reader_address = SIM_FIRST_LOCO_ADDRESS + _next_reader_loco;
+            _next_reader_loco = (_next_reader_loco + 1) % _config.locomotives;
+            _reader.start(_reader_address, SIM_DATA_SPACE, _reader_buffer, sizeof(_reader_buffer));
+        }
+        if (_reader.nextPacket(packet)) {
+            return packet;
+        }
+    }
+
+    if (_known.empty()) {
+        return makePacket({ 0xFF, 0x00 }); // Idle packet.
+    }
+
+    // 128 speed step instruction for the next locomotive.
+    uint16_t address = _known[_next_loco];
+    _next_loco = (_next_loco + 1) % _known.size();
+    if (address <= MAX_SHORT_ADDRESS) {
+        return makePacket({ (uint8_t)address, 0x3F, 0x80 });
+    }
+    return makePacket({ (uint8_t)(0xC0 | (address >> 8)), (uint8_t)address, 0x3F, 0x80 });
+}
+
+bool TrackSimulator::combine(uint8_t channel, std::vector<uint8_t>& bus, ChannelStats& stats) {
+    bus.clear();
+    uint32_t transmitters = 0;
+    bool collided = false;
+
+    for (auto& decoder : _decoders) {
+        const std::vector<uint8_t>& bytes = (channel == 1) ? decoder->hardware.ch1 : decoder->hardware.ch2;
+        if (bytes.empty()) continue;
+
+        if (transmitters > 0 && bytes != bus) {
+            collided = true;
+        }
+        if (bytes.size() > bus.size()) {
+            bus.resize(bytes.size(), 0xFF);
+        }
+        for (size_t i = 0; i < bytes.size(); ++i) {
+            bus[i] &= bytes[i];
+        }
+        transmitters++;
+    }
+
+    if (transmitters > 0) {
+        stats.busy++;
+        stats.transmitters += transmitters;
+    }
+    if (collided) {
+        stats.collisions++;
+    }
+    return collided;
+}
+
+void TrackSimulator::handleRegistered(uint16_t address) {
+    for (auto& decoder : _decoders) {
+        if (decoder->isNew && !decoder->registered && decoder->sm.address() == address) {
+            decoder->registered = true;
+            _result.registered++;
+            uint32_t ms = millis();
+            _logon_sum_ms += ms;
+            _result.logonMaxMs = ms;
+            break;
+        }
+    }
+    _known.push_back(address);
+}
+
+void TrackSimulator::handleDataSpace(const uint8_t* data, size_t len) {
+    if (data == nullptr) {
+        _result.dataSpaceFailed++;
+        return;
+    }
+    uint8_t expected[SIM_DATA_SPACE_SIZE];
+    simDataSpace(_reader_address, expected);
+    if (len != sizeof(expected) || memcmp(data, expected, len) != 0) {
+        _result.dataSpaceCorrupt++;
+        return;
+    }
+    _result.dataSpaceReads++;
+    _result.dataSpaceBytes += len;
+}
+
+void TrackSimulator::disturb(std::vector<uint8_t>& bus) {
+    if (_config.byteErrorRate <= 0.0) return;
+    for (uint8_t& byte : bus) {
+        uint64_t r = splitmix64(_noise_state);
+        if ((r >> 11) * (1.0 / 9007199254740992.0) < _config.byteErrorRate) {
+            uint8_t flip = (uint8_t)r;
+            byte ^= flip ? flip : 0x01;
+        }
+    }
+}
+
+// --- runScenarios ---
+
+std::vector<SimResult> runScenarios(const std::vector<SimConfig>& configs, unsigned threads) {
+    std::vector<SimResult> results(configs.size());
+    if (threads == 0) {
+        threads = std::thread::hardware_concurrency();
+        if (threads == 0) threads = 1;
+    }
+    if (threads > configs.size()) {
+        threads = (unsigned)configs.size();
+    }
+
+    // The 4-of-8 decode table is built on first use; do that before the threads start.
+    RailcomEncoding::decode4of8(0);
+
+    std::atomic<size_t> next(0);
+    auto worker = [&]() {
+        for (size_t i = next++; i < configs.size(); i = next++) {
+            TrackSimulator sim(configs[i]);
+            results[i] = sim.run();
+        }
+    };
+
+    std::vector<std::thread> pool;
+    for (unsigned t = 1; t < threads; ++t) {
+        pool.emplace_back(worker);
+    }
+    worker();
+    for (auto& thread : pool) {
+        thread.join();
+    }
+    return results;
+}
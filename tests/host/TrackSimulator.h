@@ -0,0 +1,251 @@
+/**
+ * @file TrackSimulator.h
+ * @brief Discrete-event simulation of many decoders sharing one RailCom bus.
+ * @details Each virtual decoder is a real `DecoderStateMachine` and `RailcomTx`
+ *          on top of a capturing hardware layer. The simulator plays the command
+ *          station: it sends one DCC packet after the other, opens a cutout after
+ *          each packet, superimposes what all decoders transmit in Channel 1 and
+ *          Channel 2 and hands the result to a `RailcomRx` acting as the
+ *          detector. The station registers new decoders with a LogonManager,
+ *          addresses all known locomotives round-robin and can read their data
+ *          spaces with a DataSpaceReader.
+ *
+ *          Time is simulated (see SimClock.h), so a run is deterministic and
+ *          only limited by CPU speed. Independent scenarios can be run on all
+ *          host cores with `runScenarios()`.
+ *
+ *          With `SimConfig::measureLatency`, every decoder runs behind a
+ *          `DecoderRuntime` and the microsecond timer also counts host time.
+ *          Each decoder then handles the packet and transmits its reply before
+ *          the next one starts, as if it had a CPU of its own, and the runtime
+ *          measures the time from the end of the packet to `send_frame()`.
+ */
+#ifndef TRACK_SIMULATOR_H
+#define TRACK_SIMULATOR_H
+
+#include "DataSpaceReader.h"
+#include "DecoderRuntime.h"
+#include "DecoderStateMachine.h"
+#include "LogonManager.h"
+#include "RailcomRx.h"
+#include "RailcomRxHardware.h"
+#include "RailcomTx.h"
+#include "RailcomTxHardware.h"
+#include <memory>
+#include <vector>
+
+/**
+ * @struct SimConfig
+ * @brief Parameters of one simulated layout.
+ */
+struct SimConfig {
+    uint16_t locomotives = 0;       ///< Decoders with a known address (addresses from 1000).
+    uint16_t newDecoders = 0;       ///< Decoders without an address that have to log on.
+    uint32_t durationMs = 10000;    ///< Simulated time after which the run stops.
+    uint8_t logonInterval = 4;      ///< Every n-th packet is a LOGON_ENABLE (0 disables discovery).
+    bool stopWhenRegistered = true; ///< Stop as soon as every new decoder is registered.
+    uint32_t seed = 1;              ///< Seed for the unique IDs of the new decoders.
+    LogonBackoff backoff = LogonBackoff::RANDOM; ///< Backoff strategy of the new decoders.
+    uint8_t dataSpaceInterval = 0;  ///< Every n-th packet reads a Data Space block (0 disables).
+    double byteErrorRate = 0.0;     ///< Probability that a byte on the bus is disturbed.
+    bool measureLatency = false;    ///< Runs the decoders through a DecoderRuntime and times the cutout on the host.
+};
+
+/**
+ * @struct ChannelStats
+ * @brief Bus statistics of one RailCom channel.
+ */
+struct ChannelStats {
+    uint64_t busy = 0;         ///< Cutouts in which at least one decoder transmitted.
+    uint64_t transmitters = 0; ///< Sum of the number of transmitting decoders.
+    uint64_t collisions = 0;   ///< Cutouts in which different transmissions overlapped.
+    uint64_t undetected = 0;   ///< Collisions that the detector still decoded as a valid message.
+};
+
+/**
+ * @struct SimResult
+ * @brief The outcome of one simulation run.
+ */
+struct SimResult {
+    SimConfig config;          ///< The simulated layout.
+    uint64_t simulatedUs = 0;  ///< Simulated time at the end of the run.
+    uint64_t packets = 0;      ///< Number of DCC packets (and cutouts).
+    ChannelStats ch1;          ///< Channel 1 statistics.
+    ChannelStats ch2;          ///< Channel 2 statistics.
+    uint16_t registered = 0;   ///< Number of new decoders that completed the logon.
+    uint32_t logonMeanMs = 0;  ///< Mean time from start to registration.
+    uint32_t logonMaxMs = 0;   ///< Time until the last decoder was registered.
+    uint32_t dataSpaceReads = 0;    ///< Data space transfers completed.
+    uint32_t dataSpaceFailed = 0;   ///< Data space transfers given up.
+    uint32_t dataSpaceCorrupt = 0;  ///< Completed transfers whose data differs from the decoder's.
+    uint64_t dataSpaceBytes = 0;    ///< Bytes read by completed transfers.
+    uint64_t dataSpaceRequests = 0; ///< Block requests sent, including repeats.
+    uint64_t dataSpaceRetries = 0;  ///< Block requests that were repeats.
+    uint32_t worstCutoutLatencyUs = 0; ///< Largest packet end to `send_frame()` time of any decoder, in host time.
+
+    /** @brief Fraction of busy Channel 1 and Channel 2 windows that collided. */
+    double collisionRate() const;
+    /** @brief Fraction of cutouts with a collision in Channel 1. */
+    double ch1Congestion() const;
+    /** @brief Mean number of decoders transmitting in a busy Channel 1 window. */
+    double ch1Occupancy() const;
+    /** @brief Data space bytes read per simulated second. */
+    double dataSpaceThroughput() const;
+};
+
+/**
+ * @class CaptureTxHardware
+ * @brief A transmitter HAL that records the bytes of one cutout.
+ * @details Bytes sent before the Channel 2 delay has elapsed belong to
+ *          Channel 1, all later bytes to Channel 2.
+ */
+class CaptureTxHardware : public RailcomTxHardware {
+public:
+    void begin() override {}
+    void end() override {}
+    void task() override {}
+    void send(const uint8_t* bytes, size_t len) override;
+
+    /** @brief Forgets the bytes of the previous cutout. */
+    void clear();
+
+    std::vector<uint8_t> ch1; ///< Bytes sent in Channel 1.
+    std::vector<uint8_t> ch2; ///< Bytes sent in Channel 2.
+};
+
+/**
+ * @class BusRxHardware
+ * @brief A receiver HAL that replays the superimposed bus signal of one window.
+ */
+class BusRxHardware : public RailcomRxHardware {
+public:
+    void begin() override {}
+    void end() override {}
+    void task() override {}
+    int available() override;
+    int read() override;
+    size_t readBlock(uint8_t* dst, size_t max, uint32_t* timestamps_us = nullptr) override;
+
+    /**
+     * @brief Reports whether the window carries bytes.
+     * @details An empty window lets the timeout pass on the simulated clock.
+     */
+    bool waitForFrame(uint32_t timeout_ms) override;
+
+    /** @brief Loads the bytes of the next window. */
+    void load(const std::vector<uint8_t>& bytes);
+
+private:
+    std::vector<uint8_t> _bytes;
+    size_t _pos = 0;
+};
+
+/**
+ * @class TrackSimulator
+ * @brief Simulates one layout with a command station, decoders and a detector.
+ */
+class TrackSimulator {
+public:
+    /**
+     * @brief Builds the layout.
+     * @param config The layout parameters.
+     */
+    explicit TrackSimulator(const SimConfig& config);
+
+    /**
+     * @brief Runs the simulation until the configured end.
+     * @return The collected statistics.
+     */
+    SimResult run();
+
+    /**
+     * @brief Sends one DCC packet followed by a cutout.
+     */
+    void step();
+
+private:
+    /** @brief A decoder on the track together with its HAL and transmitter. */
+    struct VirtualDecoder {
+        VirtualDecoder(uint16_t address, uint16_t manufacturerId, uint32_t productId);
+        CaptureTxHardware hardware;
+        RailcomTx tx;
+        DecoderStateMachine sm;
+        std::unique_ptr<DecoderRuntime> runtime; ///< Only with `SimConfig::measureLatency`.
+        bool isNew;
+        bool registered;
+    };
+
+    /**
+     * @brief Logs a decoder on before the simulation starts.
+     * @details Locomotives with a known address were registered in an earlier
+     *          session, so they do not take part in the discovery.
+     * @param decoder The decoder.
+     * @param address The address to assign.
+     */
+    void preRegister(VirtualDecoder& decoder, uint16_t address);
+
+    /**
+     * @brief Chooses the next packet the command station sends.
+     * @return The packet.
+     */
+    DCCMessage nextPacket();
+
+    /**
+     * @brief Superimposes the transmissions of all decoders in one channel.
+     * @details A decoder drives the line low for a 0 bit, so overlapping bytes
+     *          combine with a bitwise AND; an idle line reads as 0xFF.
+     * @param channel The channel (1 or 2).
+     * @param[out] bus The resulting bus signal.
+     * @param stats The statistics to update.
+     * @return True if different transmissions overlapped.
+     */
+    bool combine(uint8_t channel, std::vector<uint8_t>& bus, ChannelStats& stats);
+
+    /**
+     * @brief Records a registration reported by the LogonManager.
+     * @param address The assigned address.
+     */
+    void handleRegistered(uint16_t address);
+
+    /**
+     * @brief Checks a data space reported by the DataSpaceReader.
+     * @param data The data read, or nullptr if the transfer failed.
+     * @param len The number of bytes read.
+     */
+    void handleDataSpace(const uint8_t* data, size_t len);
+
+    /**
+     * @brief Disturbs bytes on the bus with the configured error rate.
+     * @param bus The bus signal of one channel.
+     */
+    void disturb(std::vector<uint8_t>& bus);
+
+    SimConfig _config;
+    SimResult _result;
+    std::vector<std::unique_ptr<VirtualDecoder>> _decoders;
+    BusRxHardware _detectorHardware;
+    RailcomRx _detector;
+    LogonManager _logon;
+    DataSpaceReader _reader;
+
+    std::vector<uint16_t> _known;   ///< Addresses the command station drives.
+    size_t _next_loco;              ///< Round-robin position in `_known`.
+    uint32_t _packet_count;         ///< Packets sent so far.
+    uint64_t _logon_sum_ms;         ///< Sum of the registration times.
+    size_t _next_reader_loco;       ///< Round-robin position of the data space reads.
+    uint16_t _reader_address;       ///< Locomotive whose data space is being read.
+    uint8_t _reader_buffer[MAX_DATA_SPACE_SIZE]; ///< Receives the data space.
+    uint64_t _noise_state;          ///< Random state for `disturb()`.
+};
+
+/**
+ * @brief Runs independent scenarios in parallel.
+ * @details Each scenario runs on one thread with its own simulated clock, so
+ *          the results do not depend on the number of threads.
+ * @param configs The scenarios.
+ * @param threads The number of worker threads, or 0 for one per host core.
+ * @return The results, in the order of `configs`.
+ */
+std::vector<SimResult> runScenarios(const std::vector<SimConfig>& configs, unsigned threads = 0);
+
+#endif // TRACK_SIMULATOR_H
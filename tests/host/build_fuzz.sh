@@ -0,0 +1,43 @@
+#!/bin/bash
+# Builds the fuzz targets in tests/host/fuzz under AddressSanitizer and
+# UndefinedBehaviorSanitizer and writes their seed corpora.
+# With clang the targets are linked with libFuzzer; with any other compiler
+# (or FUZZ_ENGINE=standalone) they are linked with fuzz_driver.cpp instead.
+#
+#   tests/host/build_fuzz.sh
+#   tests/host/fuzz/fuzz_rx tests/host/fuzz/corpus/rx -runs=1000000
+cd "$(dirname "$0")/../.." || exit 1
+
+CXX=${CXX:-$(command -v clang++ || echo g++)}
+CXXFLAGS=${CXXFLAGS:--O1 -g}
+SANITIZERS="-fsanitize=address,undefined -fno-sanitize-recover=undefined -fno-omit-frame-pointer"
+SOURCES=$(ls src/*.cpp | grep -v '/RP2040')
+INCLUDES="-Itests/host/shim -Isrc -Itests/RailcomTest/mocks"
+FUZZ=tests/host/fuzz
+
+if [ -z "$FUZZ_ENGINE" ]; then
+    if $CXX --version 2>/dev/null | grep -q clang; then
+        FUZZ_ENGINE=libfuzzer
+    else
+        FUZZ_ENGINE=standalone
+    fi
+fi
+if [ "$FUZZ_ENGINE" = libfuzzer ]; then
+    ENGINE="-fsanitize=fuzzer"
+else
+    ENGINE="$FUZZ/fuzz_driver.cpp"
+fi
+
+for TARGET in fuzz_rx fuzz_dcc_parser fuzz_data_space; do
+    echo "Building $FUZZ/$TARGET ($FUZZ_ENGINE)"
+    $CXX -std=gnu++17 $CXXFLAGS $SANITIZERS $INCLUDES $SOURCES $FUZZ/$TARGET.cpp $ENGINE -o $FUZZ/$TARGET
+    if [ $? -ne 0 ]; then
+        echo "Failed to build $FUZZ/$TARGET"
+        exit 1
+    fi
+done
+
+echo "Writing the seed corpora to $FUZZ/corpus"
+$CXX -std=gnu++17 $CXXFLAGS $INCLUDES $SOURCES $FUZZ/fuzz_seeds.cpp -o $FUZZ/fuzz_seeds || exit 1
+mkdir -p $FUZZ/corpus/rx $FUZZ/corpus/dcc_parser $FUZZ/corpus/data_space
+$FUZZ/fuzz_seeds $FUZZ/corpus || exit 1
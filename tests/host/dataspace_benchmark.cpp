@@ -0,0 +1,76 @@
+/**
+ * @file dataspace_benchmark.cpp
+ * @brief Measures the Data Space read throughput of the DataSpaceReader.
+ * @details The simulated command station reads the 32-byte data space of one
+ *          locomotive after the other, using every n-th packet for Data Space
+ *          reads and the rest for speed commands. Bytes on the bus are
+ *          disturbed at the given rate, which costs retries. Each line shows the
+ *          verified bytes per simulated second, averaged over the seeds.
+ *
+ *          Usage: dataspace_benchmark [-l locomotives] [-s seeds] [-d duration_ms] [-j threads]
+ */
+#include "TrackSimulator.h"
+#include <cstdlib>
+#include <string>
+
+int main(int argc, char** argv) {
+    uint16_t locomotives = 20;
+    uint32_t seeds = 4;
+    uint32_t durationMs = 10000;
+    unsigned threads = 0;
+
+    for (int i = 1; i + 1 < argc; i += 2) {
+        std::string opt = argv[i];
+        const char* arg = argv[i + 1];
+        if (opt == "-l") locomotives = (uint16_t)atoi(arg);
+        else if (opt == "-s") seeds = (uint32_t)atoi(arg);
+        else if (opt == "-d") durationMs = (uint32_t)atoi(arg);
+        else if (opt == "-j") threads = (unsigned)atoi(arg);
+        else {
+            fprintf(stderr, "unknown option %s\n", opt.c_str());
+            return 1;
+        }
+    }
+    if (seeds == 0) seeds = 1;
+    if (locomotives == 0) locomotives = 1;
+
+    const uint8_t intervals[] = { 1, 2, 4 };
+    const double errorRates[] = { 0.0, 0.001, 0.01, 0.03, 0.1 };
+    std::vector<SimConfig> configs;
+    for (uint8_t interval : intervals) {
+        for (double rate : errorRates) {
+            for (uint32_t seed = 1; seed <= seeds; ++seed) {
+                SimConfig config;
+                config.locomotives = locomotives;
+                config.durationMs = durationMs;
+                config.logonInterval = 0;
+                config.stopWhenRegistered = false;
+                config.seed = seed;
+                config.dataSpaceInterval = interval;
+                config.byteErrorRate = rate;
+                configs.push_back(config);
+            }
+        }
+    }
+
+    std::vector<SimResult> results = runScenarios(configs, threads);
+
+    printf("Data Space reads of %u locomotives, %u ms, %u seeds\n", locomotives, durationMs, seeds);
+    printf("%8s %10s %10s %10s %10s %8s %8s\n",
+           "interval", "byte_err", "bytes/s", "reads/s", "retries", "failed", "corrupt");
+    for (size_t first = 0; first < results.size(); first += seeds) {
+        double throughput = 0, reads = 0, retries = 0, failed = 0, corrupt = 0;
+        for (size_t i = first; i < first + seeds; ++i) {
+            const SimResult& r = results[i];
+            throughput += r.dataSpaceThroughput();
+            reads += r.dataSpaceReads * 1e6 / r.simulatedUs;
+            retries += r.dataSpaceRequests ? (double)r.dataSpaceRetries / r.dataSpaceRequests : 0.0;
+            failed += r.dataSpaceFailed;
+            corrupt += r.dataSpaceCorrupt;
+        }
+        printf("%8u %9.1f%% %10.1f %10.2f %9.1f%% %8.1f %8.1f\n",
+               results[first].config.dataSpaceInterval, 100.0 * results[first].config.byteErrorRate,
+               throughput / seeds, reads / seeds, 100.0 * retries / seeds, failed / seeds, corrupt / seeds);
+    }
+    return 0;
+}
@@ -0,0 +1,105 @@
+/**
+ * @file fuzz_dcc_parser.cpp
+ * @brief Fuzz target for RailcomDccParser::parse.
+ * @details The input is one DCC packet. A DCCMessage keeps its bytes in a
+ *          fixed buffer, so a parser that reads past the packet stays inside
+ *          the object and the sanitizers cannot see it. The packet is therefore
+ *          parsed twice, once with the unused part of the buffer filled with
+ *          0x00 and once with 0xFF, and the callbacks of both runs must agree:
+ *          the result may not depend on bytes that are not part of the packet.
+ */
+#include "RailcomDccParser.h"
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <new>
+#include <string>
+
+/**
+ * @brief Appends a formatted line to a call log.
+ */
+template <typename... A>
+static void logCall(std::string& log, const char* format, A... args) {
+    char line[96];
+    snprintf(line, sizeof(line), format, args...);
+    log += line;
+    log += '\n';
+}
+
+/**
+ * @brief Appends a byte range handed to a callback to a call log.
+ */
+static void logBytes(std::string& log, const uint8_t* data, size_t len) {
+    for (size_t i = 0; i < len; ++i) {
+        logCall(log, " %02X", (unsigned)data[i]);
+    }
+}
+
+/**
+ * @brief Parses a packet and records every callback.
+ * @param data The packet.
+ * @param size The packet length.
+ * @param fill The value of the buffer bytes behind the packet.
+ * @return The call log.
+ */
+static std::string parse(const uint8_t* data, size_t size, uint8_t fill) {
+    std::string log;
+    RailcomDccParser parser;
+    parser.onLogonEnable = [&](uint8_t group, uint16_t zid, uint8_t session) {
+        logCall(log, "logonEnable %u %u %u", (unsigned)group, (unsigned)zid, (unsigned)session);
+    };
+    parser.onSelect = [&](uint16_t mfr, uint32_t pid, uint8_t subCmd, const uint8_t* payload, size_t len) {
+        logCall(log, "select %u %lu %u %u", (unsigned)mfr, (unsigned long)pid, (unsigned)subCmd, (unsigned)len);
+        logBytes(log, payload, len);
+    };
+    parser.onLogonAssign = [&](uint16_t mfr, uint32_t pid, uint16_t address) {
+        logCall(log, "logonAssign %u %lu %u", (unsigned)mfr, (unsigned long)pid, (unsigned)address);
+    };
+    parser.onGetDataStart = [&]() { logCall(log, "getDataStart"); };
+    parser.onGetDataCont = [&]() { logCall(log, "getDataCont"); };
+    parser.onSetData = [&](const uint8_t* payload, size_t len) {
+        logCall(log, "setData %u", (unsigned)len);
+        logBytes(log, payload, len);
+    };
+    parser.onSetDataEnd = [&]() { logCall(log, "setDataEnd"); };
+    parser.onPomReadCv = [&](uint16_t cv, uint16_t address) {
+        logCall(log, "pomRead %u %u", (unsigned)cv, (unsigned)address);
+    };
+    parser.onPomWriteCv = [&](uint16_t cv, uint8_t value, uint16_t address) {
+        logCall(log, "pomWrite %u %u %u", (unsigned)cv, (unsigned)value, (unsigned)address);
+    };
+    parser.onPomWriteBit = [&](uint16_t cv, uint8_t bit, uint8_t value, uint16_t address) {
+        logCall(log, "pomBit %u %u %u %u", (unsigned)cv, (unsigned)bit, (unsigned)value, (unsigned)address);
+    };
+    parser.onAccessory = [&](uint16_t address, bool activate, uint8_t output) {
+        logCall(log, "accessory %u %d %u", (unsigned)address, (int)activate, (unsigned)output);
+    };
+    parser.onFunction = [&](uint16_t address, uint8_t function, bool state) {
+        logCall(log, "function %u %u %d", (unsigned)address, (unsigned)function, (int)state);
+    };
+    parser.onExtendedFunction = [&](uint16_t address, uint8_t command) {
+        logCall(log, "xf %u %u", (unsigned)address, (unsigned)command);
+    };
+    parser.onDataSpaceRead = [&](uint16_t address, uint8_t dataSpaceNum, uint8_t chunk) {
+        logCall(log, "dataSpaceRead %u %u %u", (unsigned)address, (unsigned)dataSpaceNum, (unsigned)chunk);
+    };
+
+    alignas(DCCMessage) uint8_t storage[sizeof(DCCMessage)];
+    memset(storage, fill, sizeof(storage));
+    const DCCMessage* msg = new (storage) DCCMessage(data, size);
+    bool responseSent = false;
+    parser.parse(*msg, &responseSent);
+    logCall(log, "response %d", (int)responseSent);
+    return log;
+}
+
+extern "C" int LLVMFuzzerTestOneInput(const uint8_t* data, size_t size) {
+    std::string zeros = parse(data, size, 0x00);
+    std::string ones = parse(data, size, 0xFF);
+    if (zeros != ones) {
+        fprintf(stderr, "The parser read behind the packet:\n--- 0x00 fill\n%s--- 0xFF fill\n%s",
+                zeros.c_str(), ones.c_str());
+        abort();
+    }
+    return 0;
+}
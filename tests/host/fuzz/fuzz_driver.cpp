@@ -0,0 +1,173 @@
+/**
+ * @file fuzz_driver.cpp
+ * @brief Runs a fuzz target where libFuzzer is not available.
+ * @details libFuzzer comes with clang only. With other compilers the targets
+ *          are linked with this driver instead, which accepts the same basic
+ *          options: it runs every file of the given corpus directories once and
+ *          then mutates them at random. Without coverage feedback it explores
+ *          less than libFuzzer, but it runs the same checks under the same
+ *          sanitizers and reproduces crash files.
+ *
+ *          The input of a failing run is written to `crash-input`.
+ *
+ *          Usage: fuzz_xxx [-runs=N] [-seed=S] [-max_len=N] [corpus_dir | file]...
+ */
+#include <csignal>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <dirent.h>
+#include <random>
+#include <string>
+#include <vector>
+
+extern "C" int LLVMFuzzerTestOneInput(const uint8_t* data, size_t size);
+
+/** @brief The input of the run in progress, saved if the run fails. */
+static std::vector<uint8_t> current;
+
+/**
+ * @brief Writes the input of the run in progress to `crash-input`.
+ */
+static void saveCurrent() {
+    FILE* file = fopen("crash-input", "wb");
+    if (file == nullptr) return;
+    fwrite(current.data(), 1, current.size(), file);
+    fclose(file);
+    fprintf(stderr, "Input of the failed run written to crash-input (%u bytes)\n", (unsigned)current.size());
+}
+
+extern "C" void __sanitizer_set_death_callback(void (*callback)(void)) __attribute__((weak));
+
+/**
+ * @brief Saves the input and lets the signal terminate the process.
+ */
+static void onSignal(int signal) {
+    saveCurrent();
+    std::signal(signal, SIG_DFL);
+    std::raise(signal);
+}
+
+/**
+ * @brief Reads a file.
+ * @return False if the file cannot be read.
+ */
+static bool readFile(const std::string& path, std::vector<uint8_t>& bytes) {
+    FILE* file = fopen(path.c_str(), "rb");
+    if (file == nullptr) return false;
+    bytes.clear();
+    uint8_t buffer[4096];
+    size_t n;
+    while ((n = fread(buffer, 1, sizeof(buffer), file)) > 0) {
+        bytes.insert(bytes.end(), buffer, buffer + n);
+    }
+    fclose(file);
+    return true;
+}
+
+/**
+ * @brief Adds a file, or all files of a directory, to the corpus.
+ */
+static void load(const std::string& path, std::vector<std::vector<uint8_t>>& corpus) {
+    DIR* dir = opendir(path.c_str());
+    if (dir == nullptr) {
+        std::vector<uint8_t> bytes;
+        if (readFile(path, bytes)) corpus.push_back(bytes);
+        else fprintf(stderr, "Cannot read %s\n", path.c_str());
+        return;
+    }
+    while (dirent* entry = readdir(dir)) {
+        if (entry->d_name[0] == '.') continue;
+        load(path + "/" + entry->d_name, corpus);
+    }
+    closedir(dir);
+}
+
+/**
+ * @brief Changes an input at one to four random places.
+ * @details Besides random bytes, the 4-of-8 signal bytes (ACK, NACK) and
+ *          boundary values are inserted, as they steer the parsers into their
+ *          special cases.
+ */
+static void mutate(std::vector<uint8_t>& input, size_t maxLen, std::mt19937& rng) {
+    static const uint8_t interesting[] = { 0x00, 0x01, 0x0F, 0x3C, 0x7F, 0x80, 0xAC, 0xE0, 0xF0, 0xFE, 0xFF };
+    int steps = 1 + rng() % 4;
+    for (int i = 0; i < steps; ++i) {
+        size_t pos = input.empty() ? 0 : rng() % input.size();
+        switch (rng() % 6) {
+            case 0: // Flip a bit.
+                if (!input.empty()) input[pos] ^= 1 << (rng() % 8);
+                break;
+            case 1: // Replace a byte.
+                if (!input.empty()) input[pos] = rng();
+                break;
+            case 2: // Insert a byte.
+                if (input.size() < maxLen) input.insert(input.begin() + pos, (uint8_t)rng());
+                break;
+            case 3: // Erase a byte.
+                if (!input.empty()) input.erase(input.begin() + pos);
+                break;
+            case 4: // Insert an interesting byte.
+                if (input.size() < maxLen) {
+                    input.insert(input.begin() + pos, interesting[rng() % sizeof(interesting)]);
+                }
+                break;
+            case 5: // Duplicate a range.
+                if (!input.empty()) {
+                    size_t len = 1 + rng() % (input.size() - pos);
+                    if (input.size() + len > maxLen) break;
+                    std::vector<uint8_t> range(input.begin() + pos, input.begin() + pos + len);
+                    input.insert(input.begin() + rng() % (input.size() + 1), range.begin(), range.end());
+                }
+                break;
+        }
+    }
+}
+
+/**
+ * @brief Runs the target on one input.
+ */
+static void run(const std::vector<uint8_t>& input) {
+    current = input;
+    // An exact copy on the heap, so that reads past the end are reported.
+    uint8_t* data = new uint8_t[input.size()];
+    memcpy(data, input.data(), input.size());
+    LLVMFuzzerTestOneInput(data, input.size());
+    delete[] data;
+}
+
+int main(int argc, char** argv) {
+    uint64_t runs = 0;
+    uint32_t seed = 1;
+    size_t maxLen = 64;
+    std::vector<std::vector<uint8_t>> corpus;
+
+    for (int i = 1; i < argc; ++i) {
+        const char* arg = argv[i];
+        if (strncmp(arg, "-runs=", 6) == 0) runs = strtoull(arg + 6, nullptr, 10);
+        else if (strncmp(arg, "-seed=", 6) == 0) seed = (uint32_t)strtoul(arg + 6, nullptr, 10);
+        else if (strncmp(arg, "-max_len=", 9) == 0) maxLen = strtoul(arg + 9, nullptr, 10);
+        else if (arg[0] == '-') fprintf(stderr, "Ignoring %s\n", arg);
+        else load(arg, corpus);
+    }
+
+    if (__sanitizer_set_death_callback != nullptr) __sanitizer_set_death_callback(saveCurrent);
+    std::signal(SIGABRT, onSignal);
+    std::signal(SIGSEGV, onSignal);
+
+    for (const std::vector<uint8_t>& input : corpus) {
+        run(input);
+    }
+    printf("Ran %u corpus inputs\n", (unsigned)corpus.size());
+    if (corpus.empty()) corpus.push_back(std::vector<uint8_t>());
+
+    std::mt19937 rng(seed);
+    for (uint64_t i = 0; i < runs; ++i) {
+        std::vector<uint8_t> input = corpus[rng() % corpus.size()];
+        mutate(input, maxLen, rng);
+        run(input);
+    }
+    printf("Ran %llu mutated inputs\n", (unsigned long long)runs);
+    return 0;
+}
@@ -0,0 +1,61 @@
+/**
+ * @file fuzz_rx.cpp
+ * @brief Fuzz target for the datagram and Data Space parsers of RailcomRx.
+ * @details The first input byte selects the receiver settings:
+ *          - bits 0-1: the `DecoderContext` (3 is treated as UNKNOWN),
+ *          - bit 2: soft decoding,
+ *          - bit 3: a Data Space reply is expected in every cutout,
+ *          - bits 4-7: the expected data space number.
+ *          The rest is a sequence of cutouts, each a length byte followed by
+ *          the bytes on the bus. A cutout longer than the receiver buffer is
+ *          read in several calls, as on the hardware. The further datagrams
+ *          of a cutout are returned by the calls for the cutouts behind it that
+ *          bring no bytes.
+ */
+#include "RailcomRx.h"
+#include "MockRailcomRxHardware.h"
+#include <cstdio>
+#include <cstdlib>
+
+extern "C" int LLVMFuzzerTestOneInput(const uint8_t* data, size_t size) {
+    if (size == 0) return 0;
+
+    MockRailcomRxHardware hardware;
+    RailcomRx rx(&hardware);
+    rx.begin();
+
+    uint8_t config = data[0];
+    uint8_t context = config & 0x03;
+    rx.setContext(context == 1 ? DecoderContext::MOBILE
+                  : context == 2 ? DecoderContext::STATIONARY : DecoderContext::UNKNOWN);
+    rx.setSoftDecoding(config & 0x04);
+    bool dataSpace = config & 0x08;
+    uint8_t dataSpaceNum = config >> 4;
+
+    size_t pos = 1;
+    while (pos < size) {
+        size_t len = data[pos++];
+        if (len > size - pos) len = size - pos;
+        hardware.setRxBuffer(std::vector<uint8_t>(data + pos, data + pos + len));
+        pos += len;
+
+        do {
+            if (dataSpace) rx.expectDataSpaceResponse(dataSpaceNum);
+            RailcomMessage* msg = rx.read();
+            if (msg != nullptr && dataSpace && static_cast<DataSpaceMessage*>(msg)->len > MAX_DATA_SPACE_PAYLOAD) {
+                fprintf(stderr, "Data Space length %u\n", static_cast<DataSpaceMessage*>(msg)->len);
+                abort();
+            }
+            rx.cutoutClass();
+            rx.ackReceived();
+        } while (hardware.available() > 0);
+    }
+
+    // A cutout yields at most one message per datagram.
+    RailcomRxStats stats;
+    if (rx.snapshotStats(stats) && stats.messages > stats.frames * RAILCOM_RX_MAX_DATAGRAMS) {
+        fprintf(stderr, "%u messages from %u cutouts\n", (unsigned)stats.messages, (unsigned)stats.frames);
+        abort();
+    }
+    return 0;
+}
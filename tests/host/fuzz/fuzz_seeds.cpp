@@ -0,0 +1,140 @@
+/**
+ * @file fuzz_seeds.cpp
+ * @brief Writes the seed corpora of the fuzz targets.
+ * @details The seeds are produced with the test mocks: the RailcomRx seeds are
+ *          the bus bytes of a RailcomTx for every message type, the DCC seeds
+ *          are the packets the tests and the LogonManager send, and the Data
+ *          Space seeds are payloads around the block size. A fuzzer starting
+ *          from valid inputs reaches the deeper branches much sooner.
+ *
+ *          Usage: fuzz_seeds corpus_dir
+ *          The files are written to corpus_dir/rx, corpus_dir/dcc_parser and
+ *          corpus_dir/data_space, which must exist.
+ */
+#include "RailcomTx.h"
+#include "MockDcc.h"
+#include "MockRailcomTxHardware.h"
+#include <cstdio>
+#include <functional>
+#include <string>
+
+/** @brief The corpus directory. */
+static std::string corpusDir;
+
+/**
+ * @brief Writes one seed file.
+ * @param target The corpus of the fuzz target.
+ * @param name The file name.
+ * @param bytes The seed.
+ */
+static void writeSeed(const char* target, const std::string& name, const std::vector<uint8_t>& bytes) {
+    std::string path = corpusDir + "/" + target + "/" + name;
+    FILE* file = fopen(path.c_str(), "wb");
+    if (file == nullptr) {
+        fprintf(stderr, "Cannot write %s\n", path.c_str());
+        exit(1);
+    }
+    fwrite(bytes.data(), 1, bytes.size(), file);
+    fclose(file);
+}
+
+/**
+ * @brief Writes the bus bytes of one cutout as RailcomRx seeds.
+ * @details One seed per decoder context, see fuzz_rx.cpp for the format.
+ * @param name The message name.
+ * @param send Queues the message on the transmitter.
+ * @param dataSpace True if the receiver has to expect a Data Space reply.
+ */
+static void rxSeed(const char* name, const std::function<void(RailcomTx&)>& send, bool dataSpace = false) {
+    MockRailcomTxHardware hardware;
+    RailcomTx tx(&hardware);
+    tx.begin();
+    send(tx);
+    tx.on_cutout_start();
+    std::vector<uint8_t> bus = hardware.getChannel1Bytes();
+    std::vector<uint8_t> ch2 = hardware.getChannel2Bytes();
+    bus.insert(bus.end(), ch2.begin(), ch2.end());
+
+    for (uint8_t context = 0; context < 3; ++context) {
+        std::vector<uint8_t> seed = { (uint8_t)(context | (dataSpace ? 0x08 : 0)), (uint8_t)bus.size() };
+        seed.insert(seed.end(), bus.begin(), bus.end());
+        writeSeed("rx", std::string(name) + "_" + std::to_string(context), seed);
+    }
+}
+
+/**
+ * @brief Writes a DCC packet as a DccParser seed.
+ */
+static void dccSeed(const char* name, const DCCMessage& msg) {
+    writeSeed("dcc_parser", name, std::vector<uint8_t>(msg.getData(), msg.getData() + msg.getLength()));
+}
+
+/**
+ * @brief Writes a DCC packet given as bytes as a DccParser seed.
+ */
+static void dccSeed(const char* name, std::initializer_list<uint8_t> bytes) {
+    writeSeed("dcc_parser", name, std::vector<uint8_t>(bytes));
+}
+
+int main(int argc, char** argv) {
+    if (argc != 2) {
+        fprintf(stderr, "usage: fuzz_seeds corpus_dir\n");
+        return 1;
+    }
+    corpusDir = argv[1];
+
+    // --- RailcomRx: one cutout of every message type ---
+    const uint8_t xpom[4] = { 1, 2, 3, 4 };
+    rxSeed("pom", [](RailcomTx& tx) { tx.sendPomResponse(0xA5); });
+    rxSeed("info", [](RailcomTx& tx) { tx.sendInfo(120, 50, 0x03); });
+    rxSeed("ext", [](RailcomTx& tx) { tx.sendExt(2, 77); });
+    rxSeed("adr_short", [](RailcomTx& tx) { tx.sendAddress(3); });
+    rxSeed("adr_long", [](RailcomTx& tx) { tx.sendAddress(1234); });
+    rxSeed("dyn", [](RailcomTx& tx) { tx.sendDynamicData(7, 200); });
+    rxSeed("dyn_twice", [](RailcomTx& tx) { tx.sendDynamicData(0, 1); tx.sendDynamicData(1, 2); });
+    rxSeed("xpom", [&](RailcomTx& tx) { tx.sendXpomResponse(2, xpom); });
+    rxSeed("block", [](RailcomTx& tx) { tx.sendBlock(0x12345678); });
+    rxSeed("srq", [](RailcomTx& tx) { tx.sendServiceRequest(100, true); });
+    rxSeed("stat1", [](RailcomTx& tx) { tx.sendStatus1(0x81); });
+    rxSeed("stat2", [](RailcomTx& tx) { tx.sendStatus2(0x42); });
+    rxSeed("stat4", [](RailcomTx& tx) { tx.sendStatus4(0x0F); });
+    rxSeed("time", [](RailcomTx& tx) { tx.sendTime(30, true); });
+    rxSeed("error", [](RailcomTx& tx) { tx.sendError(5); });
+    rxSeed("unique", [](RailcomTx& tx) { tx.sendDecoderUnique(0x0D, 0x12345678); });
+    rxSeed("state", [](RailcomTx& tx) { tx.sendDecoderState(1, 2, 3); });
+    rxSeed("ack", [](RailcomTx& tx) { tx.sendAck(); });
+    rxSeed("nack", [](RailcomTx& tx) { tx.sendNack(); });
+    const uint8_t space[] = { 1, 2, 3 };
+    rxSeed("data_space", [&](RailcomTx& tx) { tx.sendDataSpace(space, sizeof(space), 5); }, true);
+
+    // --- RailcomDccParser: the packets of the tests and the LogonManager ---
+    dccSeed("accessory", MockDcc::createAccessoryPacket(10, true));
+    dccSeed("accessory_output", MockDcc::createAccessoryDccMessage(300, true, 2));
+    dccSeed("speed_short", MockDcc::createSpeedPacket(3, 10));
+    dccSeed("speed_long", MockDcc::createSpeedPacket(1234, 10));
+    dccSeed("get_data_start", MockDcc::createDccAPacket(RCN218::CMD_GET_DATA_START));
+    dccSeed("get_data_cont", MockDcc::createDccAPacket(RCN218::CMD_GET_DATA_CONT));
+    dccSeed("set_data_end", MockDcc::createDccAPacket(RCN218::CMD_SET_DATA_END));
+    dccSeed("set_data", { RCN218::DCC_A_ADDRESS, RCN218::CMD_SET_DATA, 1, 2, 3, 4 });
+    dccSeed("logon_enable", { RCN218::DCC_A_ADDRESS, RCN218::CMD_LOGON_ENABLE, 0x12, 0x34, 0x56, 0x00 });
+    dccSeed("logon_assign", { RCN218::DCC_A_ADDRESS, RCN218::CMD_LOGON_ASSIGN | 0x0D, 0x00,
+                              0x12, 0x34, 0x56, 0x78, 0xC4, 0xD2, 0x00 });
+    dccSeed("select", { RCN218::DCC_A_ADDRESS, RCN218::CMD_SELECT | 0x0D, 0x00,
+                        0x12, 0x34, 0x56, 0x78, 0x01, 0x00 });
+    dccSeed("pom_read_short", { 0x03, 0xE4, 0x07, 0x00, 0x00 });
+    dccSeed("pom_write_long", { 0xC4, 0xD2, 0xEC, 0x07, 0x2A, 0x00 });
+    dccSeed("pom_bit_long", { 0xC4, 0xD2, 0xE8, 0x07, 0x0B, 0x00 });
+    dccSeed("function", { 0x03, 0xD5, 0x20, 0xF6 });
+    dccSeed("xf_short", { 0x03, 0xDE, 0x15 });
+    dccSeed("xf_long", { 0xC4, 0xD2, 0xDE, 0x05 });
+    dccSeed("data_space_read_short", { 0x03, 0xED, 0x51 });
+    dccSeed("data_space_read_long", { 0xC4, 0xD2, 0xED, 0x51, 0x00 });
+
+    // --- RailcomTx::sendDataSpace: payloads around the block size ---
+    for (uint8_t len : { 0, 1, 3, 4, 5, 8, 16, 31 }) {
+        std::vector<uint8_t> seed = { (uint8_t)(len % 16) };
+        for (uint8_t i = 0; i < len; ++i) seed.push_back(i * 37);
+        writeSeed("data_space", "len_" + std::to_string(len), seed);
+    }
+    return 0;
+}
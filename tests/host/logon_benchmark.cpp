@@ -0,0 +1,106 @@
+/**
+ * @file logon_benchmark.cpp
+ * @brief Measures the RCN-218 logon throughput of both backoff strategies.
+ * @details A batch of new decoders is put on a track together with some
+ *          registered locomotives. The simulated command station runs
+ *          LOGON_ENABLE / LOGON_ASSIGN cycles until every new decoder has an
+ *          address or the time limit is reached. Each line shows the
+ *          time to full registration, averaged over the seeds, for LINEAR and
+ *          RANDOM backoff.
+ *
+ *          Usage: logon_benchmark [-l locomotives] [-n new,decoders,...]
+ *                                 [-s seeds] [-d limit_ms] [-j threads]
+ */
+#include "TrackSimulator.h"
+#include <cstdlib>
+#include <string>
+
+/**
+ * @brief Parses a comma separated list of numbers.
+ */
+static std::vector<uint16_t> parseList(const char* text) {
+    std::vector<uint16_t> values;
+    std::string item;
+    for (const char* p = text;; ++p) {
+        if (*p == ',' || *p == '\0') {
+            if (!item.empty()) values.push_back((uint16_t)atoi(item.c_str()));
+            item.clear();
+            if (*p == '\0') break;
+        } else {
+            item += *p;
+        }
+    }
+    return values;
+}
+
+/**
+ * @brief Prints the averaged results of one strategy and layout.
+ */
+static void printCell(const SimResult* results, uint32_t seeds) {
+    uint32_t complete = 0;
+    double registered = 0, full = 0, collisions = 0;
+    for (uint32_t i = 0; i < seeds; ++i) {
+        registered += results[i].registered;
+        collisions += results[i].ch2.collisions;
+        if (results[i].registered == results[i].config.newDecoders) {
+            complete++;
+            full += results[i].logonMaxMs;
+        }
+    }
+    if (complete == seeds) {
+        printf(" %9.0fms %10.0f", full / seeds, collisions / seeds);
+    } else {
+        printf(" %5.0f/%-5u %10.0f", registered / seeds, results[0].config.newDecoders, collisions / seeds);
+    }
+}
+
+int main(int argc, char** argv) {
+    uint16_t locomotives = 10;
+    std::vector<uint16_t> newDecoders = { 1, 2, 5, 10, 20, 50, 100 };
+    uint32_t seeds = 8;
+    uint32_t limitMs = 120000;
+    unsigned threads = 0;
+
+    for (int i = 1; i + 1 < argc; i += 2) {
+        std::string opt = argv[i];
+        const char* arg = argv[i + 1];
+        if (opt == "-l") locomotives = (uint16_t)atoi(arg);
+        else if (opt == "-n") newDecoders = parseList(arg);
+        else if (opt == "-s") seeds = (uint32_t)atoi(arg);
+        else if (opt == "-d") limitMs = (uint32_t)atoi(arg);
+        else if (opt == "-j") threads = (unsigned)atoi(arg);
+        else {
+            fprintf(stderr, "unknown option %s\n", opt.c_str());
+            return 1;
+        }
+    }
+    if (seeds == 0) seeds = 1;
+
+    const LogonBackoff strategies[] = { LogonBackoff::LINEAR, LogonBackoff::RANDOM };
+    std::vector<SimConfig> configs;
+    for (uint16_t n : newDecoders) {
+        for (LogonBackoff strategy : strategies) {
+            for (uint32_t seed = 1; seed <= seeds; ++seed) {
+                SimConfig config;
+                config.locomotives = locomotives;
+                config.newDecoders = n;
+                config.durationMs = limitMs;
+                config.seed = seed;
+                config.backoff = strategy;
+                configs.push_back(config);
+            }
+        }
+    }
+
+    std::vector<SimResult> results = runScenarios(configs, threads);
+
+    printf("Time to full registration (or registered/total after %u ms), %u seeds\n", limitMs, seeds);
+    printf("%6s %12s %10s %12s %10s\n", "new", "linear", "collisions", "random", "collisions");
+    for (size_t first = 0; first < results.size(); first += 2 * seeds) {
+        printf("%6u", results[first].config.newDecoders);
+        printCell(&results[first], seeds);
+        printCell(&results[first + seeds], seeds);
+        printf("\n");
+    }
+    return 0;
+}
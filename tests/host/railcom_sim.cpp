@@ -0,0 +1,110 @@
+/**
+ * @file railcom_sim.cpp
+ * @brief Command line front end of the track simulator.
+ * @details Runs a sweep over layout sizes and seeds on all host cores and
+ *          prints one line per layout, averaged over the seeds.
+ *
+ *          Usage: railcom_sim [-l locomotives] [-n new,decoders,...] [-s seeds]
+ *                             [-d duration_ms] [-i logon_interval] [-j threads]
+ *                             [-t 1]
+ *          `-t 1` also measures the cutout latency of every decoder in host
+ *          time (see `SimConfig::measureLatency`).
+ */
+#include "TrackSimulator.h"
+#include <chrono>
+#include <cstdlib>
+#include <string>
+
+/**
+ * @brief Parses a comma separated list of numbers.
+ */
+static std::vector<uint16_t> parseList(const char* text) {
+    std::vector<uint16_t> values;
+    std::string item;
+    for (const char* p = text;; ++p) {
+        if (*p == ',' || *p == '\0') {
+            if (!item.empty()) values.push_back((uint16_t)atoi(item.c_str()));
+            item.clear();
+            if (*p == '\0') break;
+        } else {
+            item += *p;
+        }
+    }
+    return values;
+}
+
+int main(int argc, char** argv) {
+    uint16_t locomotives = 20;
+    std::vector<uint16_t> newDecoders = { 1, 10, 50, 100 };
+    uint32_t seeds = 8;
+    uint32_t durationMs = 60000;
+    uint8_t logonInterval = 4;
+    unsigned threads = 0;
+    bool measureLatency = false;
+
+    for (int i = 1; i + 1 < argc; i += 2) {
+        std::string opt = argv[i];
+        const char* arg = argv[i + 1];
+        if (opt == "-l") locomotives = (uint16_t)atoi(arg);
+        else if (opt == "-n") newDecoders = parseList(arg);
+        else if (opt == "-s") seeds = (uint32_t)atoi(arg);
+        else if (opt == "-d") durationMs = (uint32_t)atoi(arg);
+        else if (opt == "-i") logonInterval = (uint8_t)atoi(arg);
+        else if (opt == "-j") threads = (unsigned)atoi(arg);
+        else if (opt == "-t") measureLatency = atoi(arg) != 0;
+        else {
+            fprintf(stderr, "unknown option %s\n", opt.c_str());
+            return 1;
+        }
+    }
+
+    if (seeds == 0) seeds = 1;
+
+    std::vector<SimConfig> configs;
+    for (uint16_t n : newDecoders) {
+        for (uint32_t seed = 1; seed <= seeds; ++seed) {
+            SimConfig config;
+            config.locomotives = locomotives;
+            config.newDecoders = n;
+            config.durationMs = durationMs;
+            config.logonInterval = logonInterval;
+            config.seed = seed;
+            config.measureLatency = measureLatency;
+            configs.push_back(config);
+        }
+    }
+
+    auto start = std::chrono::steady_clock::now();
+    std::vector<SimResult> results = runScenarios(configs, threads);
+    double wallSeconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+    printf("%6s %6s %10s %10s %10s %10s %12s %12s %10s\n",
+           "locos", "new", "registered", "collision", "ch1_cong", "ch1_occ", "logon_mean", "logon_max", "undetected");
+    uint64_t simulatedUs = 0;
+    uint32_t worstLatencyUs = 0;
+    for (size_t first = 0; first < results.size(); first += seeds) {
+        double registered = 0, collision = 0, congestion = 0, occupancy = 0, mean = 0, max = 0, undetected = 0;
+        for (size_t i = first; i < first + seeds; ++i) {
+            const SimResult& r = results[i];
+            registered += r.registered;
+            collision += r.collisionRate();
+            congestion += r.ch1Congestion();
+            occupancy += r.ch1Occupancy();
+            mean += r.logonMeanMs;
+            max += r.logonMaxMs;
+            undetected += r.ch1.undetected + r.ch2.undetected;
+            simulatedUs += r.simulatedUs;
+            if (r.worstCutoutLatencyUs > worstLatencyUs) worstLatencyUs = r.worstCutoutLatencyUs;
+        }
+        printf("%6u %6u %10.1f %9.1f%% %9.1f%% %10.2f %10.0fms %10.0fms %10.1f\n",
+               results[first].config.locomotives, results[first].config.newDecoders,
+               registered / seeds, 100.0 * collision / seeds, 100.0 * congestion / seeds,
+               occupancy / seeds, mean / seeds, max / seeds, undetected / seeds);
+    }
+    if (measureLatency) {
+        printf("worst cutout latency (packet end to send_frame, host time): %u us\n", (unsigned)worstLatencyUs);
+    }
+    printf("%zu runs, %.1f s simulated in %.2f s (%.0fx real time)\n",
+           results.size(), simulatedUs / 1e6, wallSeconds, simulatedUs / 1e6 / wallSeconds);
+    return 0;
+}
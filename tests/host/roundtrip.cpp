@@ -0,0 +1,556 @@
+/**
+ * @file roundtrip.cpp
+ * @brief Property-based round trip of every message type through RailcomTx and RailcomRx.
+ * @details For each message type the field values are enumerated when the
+ *          domain is small and sampled at random otherwise, starting with the
+ *          corners (every field at its minimum or maximum). Each sample is sent
+ *          with the `RailcomTx` function of the type into a
+ *          `MockRailcomTxHardware`. The bytes of the channel carrying it are
+ *          read by one `RailcomRx` per `DecoderContext`, and the decoded
+ *          message is compared field by field with what was sent.
+ *
+ *          IDs 3 and 4 mean a different message depending on the context (EXT,
+ *          INFO1 or STAT4; INFO or STAT1). In a context where a message is not
+ *          the one the receiver resolves the ID to, only a message with the
+ *          same ID is required; the resolved message is checked by its own
+ *          case. RERAIL is left out, as it is only sent together with the
+ *          address and the receiver decodes one datagram per cutout.
+ *
+ *          A failing sample is shrunk field by field towards the minimum
+ *          before it is reported, and the program exits with status 1.
+ *
+ *          Usage: roundtrip [-n samples] [-e exhaustive_limit] [-s seed]
+ *                           [-m message] [-j threads]
+ */
+#include "RailcomRx.h"
+#include "RailcomTx.h"
+#include "MockRailcomRxHardware.h"
+#include "MockRailcomTxHardware.h"
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+#include <thread>
+#include <vector>
+
+/** @brief The largest number of fields of a message. */
+constexpr uint8_t MAX_FIELDS = 5;
+/** @brief The number of decoder contexts. */
+constexpr uint8_t CONTEXTS = 3;
+/** @brief Samples per work item; items run in parallel. */
+constexpr uint64_t CHUNK_SAMPLES = 1 << 16;
+
+/** @brief Bit masks of the contexts in which a message is decoded as itself. */
+constexpr uint8_t IN_UNKNOWN = 1 << static_cast<uint8_t>(DecoderContext::UNKNOWN);
+constexpr uint8_t IN_MOBILE = 1 << static_cast<uint8_t>(DecoderContext::MOBILE);
+constexpr uint8_t IN_STATIONARY = 1 << static_cast<uint8_t>(DecoderContext::STATIONARY);
+constexpr uint8_t IN_ALL = IN_UNKNOWN | IN_MOBILE | IN_STATIONARY;
+
+static const char* const CONTEXT_NAMES[CONTEXTS] = { "UNKNOWN", "MOBILE", "STATIONARY" };
+
+/**
+ * @struct FieldSpec
+ * @brief A field of a message and the values the transmitter accepts for it.
+ */
+struct FieldSpec {
+    const char* name;
+    uint32_t min;
+    uint32_t max;
+};
+
+/**
+ * @struct MessageCase
+ * @brief How one message type is sent, and what the receiver must return.
+ */
+struct MessageCase {
+    const char* name;
+    RailcomID id;            ///< The ID of the message.
+    uint8_t contexts;        ///< Contexts in which the ID is decoded as this message.
+    uint8_t channel;         ///< The channel carrying the message.
+    uint8_t cutouts;         ///< Cutouts per sample; `send` is called before each.
+    uint8_t checked;         ///< The cutout that carries the message.
+    uint8_t fieldCount;
+    FieldSpec fields[MAX_FIELDS];
+    void (*send)(RailcomTx& tx, const uint32_t* v);               ///< Queues the message.
+    void (*expect)(const uint32_t* v, uint32_t* fields);          ///< The fields the receiver must return.
+    void (*observe)(const RailcomMessage* msg, uint32_t* fields); ///< The fields the receiver returned.
+};
+
+/** @brief The sent values are the expected ones. */
+static void same(const uint32_t* v, uint32_t* fields) {
+    for (uint8_t i = 0; i < MAX_FIELDS; ++i) fields[i] = v[i];
+}
+
+/** @brief Reads the single status byte of STAT1, STAT2 and STAT4. */
+template <typename M>
+static void observeStatus(const RailcomMessage* msg, uint32_t* f) {
+    f[0] = static_cast<const M*>(msg)->status;
+}
+
+/** @brief Sends an XPOM reply of a fixed sequence number. */
+template <uint8_t SEQUENCE>
+static void sendXpom(RailcomTx& tx, const uint32_t* v) {
+    const uint8_t values[4] = { (uint8_t)v[0], (uint8_t)v[1], (uint8_t)v[2], (uint8_t)v[3] };
+    tx.sendXpomResponse(SEQUENCE, values);
+}
+
+static void observeXpom(const RailcomMessage* msg, uint32_t* f) {
+    const XpomMessage* m = static_cast<const XpomMessage*>(msg);
+    for (uint8_t i = 0; i < 4; ++i) f[i] = m->cvValues[i];
+    f[4] = m->sequence;
+}
+
+/** @brief The fields of an XPOM reply; the sequence number is fixed per case. */
+#define XPOM_FIELDS(SEQUENCE) \
+    { { "cvValue0", 0, 255 }, { "cvValue1", 0, 255 }, { "cvValue2", 0, 255 }, { "cvValue3", 0, 255 }, \
+      { "sequence", SEQUENCE, SEQUENCE } }
+
+/** @brief Every message type with its fields. */
+static const MessageCase CASES[] = {
+    { "POM", RailcomID::POM, IN_ALL, 2, 1, 0, 1, { { "cvValue", 0, 255 } },
+      [](RailcomTx& tx, const uint32_t* v) { tx.sendPomResponse(v[0]); }, same,
+      [](const RailcomMessage* m, uint32_t* f) { f[0] = static_cast<const PomMessage*>(m)->cvValue; } },
+    // The address alternates between ADR_HIGH and ADR_LOW in Channel 1.
+    { "ADR_HIGH", RailcomID::ADR_HIGH, IN_ALL, 1, 2, 0, 1, { { "address", 1, 10239 } },
+      [](RailcomTx& tx, const uint32_t* v) { tx.sendAddress(v[0]); },
+      [](const uint32_t* v, uint32_t* f) { f[0] = v[0] <= MAX_SHORT_ADDRESS ? 0 : v[0] >> 8; },
+      [](const RailcomMessage* m, uint32_t* f) { f[0] = static_cast<const AdrMessage*>(m)->address; } },
+    { "ADR_LOW", RailcomID::ADR_LOW, IN_ALL, 1, 2, 1, 1, { { "address", 1, 10239 } },
+      [](RailcomTx& tx, const uint32_t* v) { tx.sendAddress(v[0]); },
+      [](const uint32_t* v, uint32_t* f) { f[0] = v[0] & 0xFF; },
+      [](const RailcomMessage* m, uint32_t* f) { f[0] = static_cast<const AdrMessage*>(m)->address; } },
+    { "EXT", RailcomID::EXT, IN_ALL, 2, 1, 0, 2, { { "type", 0, 7 }, { "position", 0, 255 } },
+      [](RailcomTx& tx, const uint32_t* v) { tx.sendExt(v[0], v[1]); }, same,
+      [](const RailcomMessage* m, uint32_t* f) {
+          const ExtMessage* e = static_cast<const ExtMessage*>(m);
+          f[0] = e->type;
+          f[1] = e->position;
+      } },
+    // INFO1 is the third datagram of the Channel 1 rotation.
+    { "INFO1", RailcomID::INFO1, IN_MOBILE, 1, 3, 2, 5,
+      { { "onTrackDirection", 0, 1 }, { "travelDirection", 0, 1 }, { "moving", 0, 1 },
+        { "inConsist", 0, 1 }, { "requestAddressing", 0, 1 } },
+      [](RailcomTx& tx, const uint32_t* v) {
+          Info1Message info1;
+          info1.on_track_direction_is_positive = v[0];
+          info1.travel_direction_is_positive = v[1];
+          info1.is_moving = v[2];
+          info1.is_in_consist = v[3];
+          info1.request_addressing = v[4];
+          tx.enableInfo1(info1);
+          tx.sendAddress(3);
+      },
+      same,
+      [](const RailcomMessage* m, uint32_t* f) {
+          const Info1Message* i = static_cast<const Info1Message*>(m);
+          f[0] = i->on_track_direction_is_positive;
+          f[1] = i->travel_direction_is_positive;
+          f[2] = i->is_moving;
+          f[3] = i->is_in_consist;
+          f[4] = i->request_addressing;
+      } },
+    { "STAT4", RailcomID::STAT4, IN_UNKNOWN | IN_STATIONARY, 2, 1, 0, 1, { { "status", 0, 255 } },
+      [](RailcomTx& tx, const uint32_t* v) { tx.sendStatus4(v[0]); }, same, observeStatus<Stat4Message> },
+    { "INFO", RailcomID::INFO, IN_MOBILE, 2, 1, 0, 3,
+      { { "speed", 0, 65535 }, { "motorLoad", 0, 255 }, { "statusFlags", 0, 255 } },
+      [](RailcomTx& tx, const uint32_t* v) { tx.sendInfo(v[0], v[1], v[2]); }, same,
+      [](const RailcomMessage* m, uint32_t* f) {
+          const InfoMessage* i = static_cast<const InfoMessage*>(m);
+          f[0] = i->speed;
+          f[1] = i->motorLoad;
+          f[2] = i->statusFlags;
+      } },
+    { "STAT1", RailcomID::STAT1, IN_ALL, 2, 1, 0, 1, { { "status", 0, 255 } },
+      [](RailcomTx& tx, const uint32_t* v) { tx.sendStatus1(v[0]); }, same, observeStatus<Stat1Message> },
+    // Time values above 127 are sent as 127.
+    { "TIME", RailcomID::TIME, IN_ALL, 2, 1, 0, 2, { { "timeValue", 0, 255 }, { "unitIsSecond", 0, 1 } },
+      [](RailcomTx& tx, const uint32_t* v) { tx.sendTime(v[0], v[1]); },
+      [](const uint32_t* v, uint32_t* f) {
+          f[0] = v[0] > 127 ? 127 : v[0];
+          f[1] = v[1];
+      },
+      [](const RailcomMessage* m, uint32_t* f) {
+          const TimeMessage* t = static_cast<const TimeMessage*>(m);
+          f[0] = t->timeValue;
+          f[1] = t->unit_is_second;
+      } },
+    { "ERROR", RailcomID::ERROR, IN_ALL, 2, 1, 0, 1, { { "errorCode", 0, 255 } },
+      [](RailcomTx& tx, const uint32_t* v) { tx.sendError(v[0]); }, same,
+      [](const RailcomMessage* m, uint32_t* f) { f[0] = static_cast<const ErrorMessage*>(m)->errorCode; } },
+    { "DYN", RailcomID::DYN, IN_ALL, 2, 1, 0, 2, { { "subIndex", 0, 63 }, { "value", 0, 255 } },
+      [](RailcomTx& tx, const uint32_t* v) { tx.sendDynamicData(v[0], v[1]); }, same,
+      [](const RailcomMessage* m, uint32_t* f) {
+          const DynMessage* d = static_cast<const DynMessage*>(m);
+          f[0] = d->subIndex;
+          f[1] = d->value;
+      } },
+    { "XPOM_0", RailcomID::XPOM_0, IN_ALL, 2, 1, 0, 5, XPOM_FIELDS(0), sendXpom<0>, same, observeXpom },
+    { "XPOM_1", RailcomID::XPOM_1, IN_ALL, 2, 1, 0, 5, XPOM_FIELDS(1), sendXpom<1>, same, observeXpom },
+    { "XPOM_2", RailcomID::XPOM_2, IN_ALL, 2, 1, 0, 5, XPOM_FIELDS(2), sendXpom<2>, same, observeXpom },
+    { "XPOM_3", RailcomID::XPOM_3, IN_ALL, 2, 1, 0, 5, XPOM_FIELDS(3), sendXpom<3>, same, observeXpom },
+    { "STAT2", RailcomID::STAT2, IN_ALL, 2, 1, 0, 1, { { "status", 0, 255 } },
+      [](RailcomTx& tx, const uint32_t* v) { tx.sendStatus2(v[0]); }, same, observeStatus<Stat2Message> },
+    { "CV_AUTO", RailcomID::CV_AUTO, IN_ALL, 2, 1, 0, 2, { { "cvAddress", 0, 0xFFFFFF }, { "cvValue", 0, 255 } },
+      [](RailcomTx& tx, const uint32_t* v) { tx.sendCvAuto(v[0], v[1]); }, same,
+      [](const RailcomMessage* m, uint32_t* f) {
+          const CvAutoMessage* c = static_cast<const CvAutoMessage*>(m);
+          f[0] = c->cvAddress;
+          f[1] = c->cvValue;
+      } },
+    { "BLOCK", RailcomID::BLOCK, IN_ALL, 2, 1, 0, 1, { { "data", 0, 0xFFFFFFFF } },
+      [](RailcomTx& tx, const uint32_t* v) { tx.sendBlock(v[0]); }, same,
+      [](const RailcomMessage* m, uint32_t* f) { f[0] = static_cast<const BlockMessage*>(m)->data; } },
+    { "DECODER_STATE", RailcomID::DECODER_STATE, IN_ALL, 2, 1, 0, 3,
+      { { "changeFlags", 0, 255 }, { "changeCount", 0, 4095 }, { "protocolCaps", 0, 65535 } },
+      [](RailcomTx& tx, const uint32_t* v) { tx.sendDecoderState(v[0], v[1], v[2]); }, same,
+      [](const RailcomMessage* m, uint32_t* f) {
+          const DecoderStateMessage* s = static_cast<const DecoderStateMessage*>(m);
+          f[0] = s->changeFlags;
+          f[1] = s->changeCount;
+          f[2] = s->protocolCaps;
+      } },
+    { "SRQ", RailcomID::SRQ, IN_ALL, 1, 1, 0, 2,
+      { { "accessoryAddress", 0, MAX_ACCESSORY_ADDRESS }, { "isExtended", 0, 1 } },
+      [](RailcomTx& tx, const uint32_t* v) { tx.sendServiceRequest(v[0], v[1]); }, same,
+      [](const RailcomMessage* m, uint32_t* f) {
+          const SrqMessage* s = static_cast<const SrqMessage*>(m);
+          f[0] = s->accessoryAddress;
+          f[1] = s->isExtended;
+      } },
+    { "DECODER_UNIQUE", RailcomID::DECODER_UNIQUE, IN_ALL, 2, 1, 0, 2,
+      { { "manufacturerId", 0, 4095 }, { "productId", 0, 0xFFFFFFFF } },
+      [](RailcomTx& tx, const uint32_t* v) { tx.sendDecoderUnique(v[0], v[1]); }, same,
+      [](const RailcomMessage* m, uint32_t* f) {
+          const DecoderUniqueMessage* u = static_cast<const DecoderUniqueMessage*>(m);
+          f[0] = u->manufacturerId;
+          f[1] = u->productId;
+      } },
+};
+
+constexpr size_t CASE_COUNT = sizeof(CASES) / sizeof(CASES[0]);
+
+/**
+ * @struct Mismatch
+ * @brief The first difference found for a sample.
+ */
+struct Mismatch {
+    uint8_t context;   ///< The context of the receiver.
+    int8_t field;      ///< The field that differs, or -1 if the message is missing or has another ID.
+    bool missing;      ///< True if the receiver returned no message.
+    uint8_t id;        ///< The ID the receiver returned.
+    uint32_t expected; ///< The expected field value.
+    uint32_t received; ///< The decoded field value.
+};
+
+/**
+ * @class RoundTrip
+ * @brief A transmitter and one receiver per context, with mock hardware.
+ */
+class RoundTrip {
+public:
+    explicit RoundTrip(const MessageCase& c) : _case(c), _tx(&_txHardware) {
+        _tx.begin();
+        for (uint8_t i = 0; i < CONTEXTS; ++i) {
+            _rx[i] = new RailcomRx(&_rxHardware[i]);
+            _rx[i]->begin();
+            _rx[i]->setContext(static_cast<DecoderContext>(i));
+        }
+    }
+
+    ~RoundTrip() {
+        for (RailcomRx* rx : _rx) delete rx;
+    }
+
+    /**
+     * @brief Sends one sample and decodes it in every context.
+     * @param v The field values.
+     * @param[out] mismatch Receives the first difference.
+     * @return True if every context returned the expected message.
+     */
+    bool check(const uint32_t* v, Mismatch& mismatch) {
+        std::vector<uint8_t> bytes;
+        for (uint8_t cutout = 0; cutout < _case.cutouts; ++cutout) {
+            _txHardware.clear();
+            _case.send(_tx, v);
+            _tx.on_cutout_start();
+            if (cutout == _case.checked) {
+                bytes = _case.channel == 1 ? _txHardware.getChannel1Bytes() : _txHardware.getChannel2Bytes();
+            }
+        }
+
+        uint32_t expected[MAX_FIELDS] = {};
+        _case.expect(v, expected);
+        for (uint8_t ctx = 0; ctx < CONTEXTS; ++ctx) {
+            mismatch = Mismatch();
+            mismatch.context = ctx;
+            mismatch.field = -1;
+            _rxHardware[ctx].setRxBuffer(bytes);
+            const RailcomMessage* msg = _rx[ctx]->read();
+            if (msg == nullptr) {
+                mismatch.missing = true;
+                return false;
+            }
+            mismatch.id = static_cast<uint8_t>(msg->id);
+            if (msg->id != _case.id) return false;
+            if (!(_case.contexts & (1 << ctx))) continue;
+
+            uint32_t received[MAX_FIELDS] = {};
+            _case.observe(msg, received);
+            for (uint8_t f = 0; f < MAX_FIELDS; ++f) {
+                if (received[f] == expected[f]) continue;
+                mismatch.field = f;
+                mismatch.expected = expected[f];
+                mismatch.received = received[f];
+                return false;
+            }
+        }
+        return true;
+    }
+
+private:
+    const MessageCase& _case;
+    MockRailcomTxHardware _txHardware;
+    RailcomTx _tx;
+    MockRailcomRxHardware _rxHardware[CONTEXTS];
+    RailcomRx* _rx[CONTEXTS];
+};
+
+/**
+ * @brief A splitmix64 generator, so that runs are the same on every host.
+ */
+class Random {
+public:
+    explicit Random(uint64_t seed) : _state(seed) {}
+
+    uint64_t next() {
+        uint64_t z = (_state += 0x9E3779B97F4A7C15ULL);
+        z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ULL;
+        z = (z ^ (z >> 27)) * 0x94D049BB133111EBULL;
+        return z ^ (z >> 31);
+    }
+
+    /**
+     * @brief Returns a value of a field, favouring the ends of the range.
+     */
+    uint32_t value(const FieldSpec& field) {
+        uint64_t r = next();
+        switch (r & 0x0F) {
+            case 0: return field.min;
+            case 1: return field.max;
+            case 2: return field.min + ((r >> 8) & 0x0F) > field.max ? field.max : field.min + ((r >> 8) & 0x0F);
+            default: return field.min + (uint32_t)((r >> 8) % ((uint64_t)field.max - field.min + 1));
+        }
+    }
+
+private:
+    uint64_t _state;
+};
+
+/**
+ * @brief Returns the number of value combinations of a message.
+ * @return The count, saturated at UINT64_MAX.
+ */
+static uint64_t domainSize(const MessageCase& c) {
+    uint64_t size = 1;
+    for (uint8_t f = 0; f < c.fieldCount; ++f) {
+        uint64_t range = (uint64_t)c.fields[f].max - c.fields[f].min + 1;
+        if (size > UINT64_MAX / range) return UINT64_MAX;
+        size *= range;
+    }
+    return size;
+}
+
+/**
+ * @brief Sets the field values of sample `index` of a message.
+ * @details Exhaustive runs count through the domain. Random runs start with
+ *          the corners, then draw from a generator seeded by the index.
+ */
+static void makeSample(const MessageCase& c, bool exhaustive, uint64_t index, uint64_t seed, uint32_t* v) {
+    for (uint8_t f = 0; f < MAX_FIELDS; ++f) v[f] = 0;
+    if (exhaustive) {
+        for (uint8_t f = 0; f < c.fieldCount; ++f) {
+            uint64_t range = (uint64_t)c.fields[f].max - c.fields[f].min + 1;
+            v[f] = c.fields[f].min + (uint32_t)(index % range);
+            index /= range;
+        }
+    } else if (index < (1u << c.fieldCount)) {
+        for (uint8_t f = 0; f < c.fieldCount; ++f) {
+            v[f] = (index >> f) & 1 ? c.fields[f].max : c.fields[f].min;
+        }
+    } else {
+        Random random(seed ^ (index * 0xD1B54A32D192ED03ULL));
+        for (uint8_t f = 0; f < c.fieldCount; ++f) v[f] = random.value(c.fields[f]);
+    }
+}
+
+/**
+ * @brief Shrinks a failing sample.
+ * @details Each field in turn is set to its minimum, moved halfway towards it,
+ *          or has single bits cleared, as long as the sample keeps failing.
+ * @param engine The round trip of the message.
+ * @param c The message.
+ * @param[in,out] v The failing sample; receives the shrunk one.
+ * @param[out] mismatch The mismatch of the shrunk sample.
+ */
+static void minimize(RoundTrip& engine, const MessageCase& c, uint32_t* v, Mismatch& mismatch) {
+    engine.check(v, mismatch);
+    bool progress = true;
+    while (progress) {
+        progress = false;
+        for (uint8_t f = 0; f < c.fieldCount; ++f) {
+            uint32_t original = v[f];
+            std::vector<uint32_t> candidates = { c.fields[f].min };
+            for (uint32_t step = (original - c.fields[f].min) / 2; step > 0; step /= 2) {
+                candidates.push_back(original - step);
+            }
+            for (uint8_t bit = 32; bit-- > 0;) {
+                uint32_t cleared = original & ~(1u << bit);
+                if (cleared != original && cleared >= c.fields[f].min) candidates.push_back(cleared);
+            }
+            for (uint32_t candidate : candidates) {
+                if (candidate >= original) continue;
+                v[f] = candidate;
+                Mismatch m;
+                if (!engine.check(v, m)) {
+                    mismatch = m;
+                    progress = true;
+                    break;
+                }
+                v[f] = original;
+            }
+        }
+    }
+}
+
+/**
+ * @struct CaseResult
+ * @brief The outcome of the samples of one message.
+ */
+struct CaseResult {
+    std::atomic<uint64_t> samples{0};
+    std::atomic<uint64_t> failures{0};
+    std::atomic<bool> reported{false};
+    uint32_t example[MAX_FIELDS] = {};  ///< The first failure, shrunk.
+    Mismatch mismatch = {};             ///< Its mismatch.
+};
+
+/**
+ * @struct WorkItem
+ * @brief A range of samples of one message.
+ */
+struct WorkItem {
+    size_t caseIndex;
+    uint64_t first;
+    uint64_t count;
+};
+
+int main(int argc, char** argv) {
+    uint64_t samples = 1000000;
+    uint64_t exhaustiveLimit = 1 << 20;
+    uint64_t seed = 1;
+    std::string only;
+    unsigned threads = 0;
+
+    for (int i = 1; i + 1 < argc; i += 2) {
+        std::string opt = argv[i];
+        const char* arg = argv[i + 1];
+        if (opt == "-n") samples = strtoull(arg, nullptr, 10);
+        else if (opt == "-e") exhaustiveLimit = strtoull(arg, nullptr, 10);
+        else if (opt == "-s") seed = strtoull(arg, nullptr, 10);
+        else if (opt == "-m") only = arg;
+        else if (opt == "-j") threads = (unsigned)atoi(arg);
+        else {
+            fprintf(stderr, "unknown option %s\n", opt.c_str());
+            return 1;
+        }
+    }
+
+    std::vector<WorkItem> items;
+    std::vector<bool> exhaustive(CASE_COUNT);
+    for (size_t i = 0; i < CASE_COUNT; ++i) {
+        if (!only.empty() && only != CASES[i].name) continue;
+        uint64_t size = domainSize(CASES[i]);
+        exhaustive[i] = size <= exhaustiveLimit;
+        uint64_t total = exhaustive[i] ? size : samples;
+        for (uint64_t first = 0; first < total; first += CHUNK_SAMPLES) {
+            items.push_back({ i, first, total - first < CHUNK_SAMPLES ? total - first : CHUNK_SAMPLES });
+        }
+    }
+    if (items.empty()) {
+        fprintf(stderr, "unknown message %s\n", only.c_str());
+        return 1;
+    }
+
+    if (threads == 0) {
+        threads = std::thread::hardware_concurrency();
+        if (threads == 0) threads = 1;
+    }
+    if (threads > items.size()) threads = (unsigned)items.size();
+
+    std::vector<CaseResult> results(CASE_COUNT);
+    std::atomic<size_t> next(0);
+    auto worker = [&]() {
+        for (size_t n = next++; n < items.size(); n = next++) {
+            const WorkItem& item = items[n];
+            const MessageCase& c = CASES[item.caseIndex];
+            CaseResult& result = results[item.caseIndex];
+            RoundTrip engine(c);
+            uint32_t v[MAX_FIELDS];
+            Mismatch mismatch;
+            uint64_t failures = 0;
+            for (uint64_t s = item.first; s < item.first + item.count; ++s) {
+                makeSample(c, exhaustive[item.caseIndex], s, seed, v);
+                if (engine.check(v, mismatch)) continue;
+                failures++;
+                if (!result.reported.exchange(true)) {
+                    minimize(engine, c, v, mismatch);
+                    memcpy(result.example, v, sizeof(v));
+                    result.mismatch = mismatch;
+                }
+            }
+            result.samples += item.count;
+            result.failures += failures;
+        }
+    };
+
+    auto start = std::chrono::steady_clock::now();
+    std::vector<std::thread> pool;
+    for (unsigned t = 1; t < threads; ++t) {
+        pool.emplace_back(worker);
+    }
+    worker();
+    for (auto& thread : pool) {
+        thread.join();
+    }
+    double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+    printf("%-15s %10s %11s %9s\n", "message", "samples", "mode", "failures");
+    uint64_t total = 0;
+    uint64_t failed = 0;
+    for (size_t i = 0; i < CASE_COUNT; ++i) {
+        const CaseResult& result = results[i];
+        if (result.samples == 0) continue;
+        const MessageCase& c = CASES[i];
+        total += result.samples;
+        failed += result.failures;
+        printf("%-15s %10llu %11s %9llu\n", c.name, (unsigned long long)result.samples,
+               exhaustive[i] ? "exhaustive" : "random", (unsigned long long)result.failures);
+        if (result.failures == 0) continue;
+
+        printf("    minimal failing sample:");
+        for (uint8_t f = 0; f < c.fieldCount; ++f) {
+            printf(" %s=%lu", c.fields[f].name, (unsigned long)result.example[f]);
+        }
+        const Mismatch& m = result.mismatch;
+        printf("\n    in %s context: ", CONTEXT_NAMES[m.context]);
+        if (m.missing) printf("no message decoded\n");
+        else if (m.field < 0) printf("decoded with ID %u instead of %u\n", m.id, static_cast<uint8_t>(c.id));
+        else printf("%s sent as %lu, decoded as %lu\n", c.fields[m.field].name,
+                    (unsigned long)m.expected, (unsigned long)m.received);
+    }
+    printf("%llu samples in %.2f s (%.2f million/s, %u threads), %llu failures\n",
+           (unsigned long long)total, seconds, total / seconds / 1e6, threads, (unsigned long long)failed);
+    return failed == 0 ? 0 : 1;
+}
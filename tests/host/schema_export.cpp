@@ -0,0 +1,40 @@
+/**
+ * @file schema_export.cpp
+ * @brief Writes the message layouts of RailcomSchema.h as a JavaScript table.
+ * @details The web encoder (`tools/encoder.html`) builds its input fields from
+ *          this table, so it packs payloads exactly like `RailcomTx`. Run it
+ *          after changing a layout:
+ *
+ *          tests/host/schema_export > tools/railcom_schema.js
+ */
+#include "RailcomSchema.h"
+#include <cstdio>
+
+/**
+ * @brief Prints one schema as a JavaScript object literal.
+ */
+struct JsExporter {
+    template <typename M>
+    void visit() {
+        printf("  { name: \"%s\", ids: [", M::NAME);
+        for (uint8_t i = 0; i < RailcomSchema::idCount<M>(); ++i) {
+            printf(i ? ", %d" : "%d", static_cast<int>(M::ID) + i);
+        }
+        printf("], bits: %u, fields: [\n", M::BITS);
+        for (size_t i = 0; i < RailcomSchema::fieldCount<M>(); ++i) {
+            const RailcomField& f = M::FIELDS[i];
+            printf("    { name: \"%s\", offset: %u, bits: %u },\n", f.name, f.offset, f.width);
+        }
+        printf("  ] },\n");
+    }
+};
+
+int main() {
+    printf("// Generated by tests/host/schema_export from src/RailcomSchema.h. Do not edit.\n");
+    printf("// Offsets count from the least significant payload bit, without padding.\n");
+    printf("const RAILCOM_SCHEMA = [\n");
+    JsExporter exporter;
+    RailcomSchema::forEach(exporter);
+    printf("];\n");
+    return 0;
+}
@@ -0,0 +1,57 @@
+/**
+ * @file Arduino.h
+ * @brief Minimal Arduino API for building the library on a host computer.
+ * @details Only what the platform-independent sources in `src/` use is
+ *          provided. Time comes from SimClock.
+ */
+#ifndef HOST_ARDUINO_H
+#define HOST_ARDUINO_H
+
+#include <cstdint>
+#include <cstddef>
+#include <cstdio>
+#include <cstdarg>
+#include <cstring>
+#include <sys/types.h>
+#include "SimClock.h"
+
+inline unsigned long millis() { return (unsigned long)(SimClock::now_us / 1000); }
+inline unsigned long micros() { return (unsigned long)SimClock::now_us; }
+inline void delay(unsigned long ms) { SimClock::now_us += (uint64_t)ms * 1000; }
+inline void delayMicroseconds(unsigned int us) { SimClock::now_us += us; }
+
+inline void randomSeed(unsigned long seed) { SimClock::rng_state = seed ? (uint32_t)seed : 1; }
+inline long random(long howbig) {
+    // xorshift32: deterministic per thread, independent of the C library.
+    uint32_t x = SimClock::rng_state;
+    x ^= x << 13;
+    x ^= x >> 17;
+    x ^= x << 5;
+    SimClock::rng_state = x;
+    return howbig > 0 ? (long)(x % (uint32_t)howbig) : 0;
+}
+inline long random(long howsmall, long howbig) {
+    return howsmall >= howbig ? howsmall : howsmall + random(howbig - howsmall);
+}
+
+class Print {
+public:
+    virtual ~Print() {}
+    virtual size_t write(uint8_t c) { return fputc(c, stdout) == EOF ? 0 : 1; }
+    size_t print(const char* s) { return fputs(s, stdout) >= 0 ? strlen(s) : 0; }
+    size_t print(long v) { return ::printf("%ld", v); }
+    size_t print(unsigned long v) { return ::printf("%lu", v); }
+    size_t print(int v) { return print((long)v); }
+    size_t print(unsigned int v) { return print((unsigned long)v); }
+    size_t println() { return print("\n"); }
+    template <typename T> size_t println(T v) { return print(v) + println(); }
+    size_t printf(const char* format, ...) {
+        va_list args;
+        va_start(args, format);
+        int n = vprintf(format, args);
+        va_end(args);
+        return n < 0 ? 0 : n;
+    }
+};
+
+#endif // HOST_ARDUINO_H
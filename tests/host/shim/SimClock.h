@@ -0,0 +1,48 @@
+/**
+ * @file SimClock.h
+ * @brief Simulated time for running the library on a host computer.
+ * @details Every thread has its own clock, so independent simulations can run
+ *          in parallel without influencing each other. `millis()` and `micros()`
+ *          return the simulated time, which only advances when the simulator
+ *          says so. `sleep_us()` inside a cutout advances a separate cutout
+ *          offset, which tells Channel 1 and Channel 2 transmissions apart.
+ *
+ *          With `wall` set, the microsecond timer also counts the host time
+ *          since the last `set()`, so the time the library spends on the host
+ *          CPU can be measured with it; `millis()` stays simulated.
+ */
+#ifndef SIM_CLOCK_H
+#define SIM_CLOCK_H
+
+#include <chrono>
+#include <cstdint>
+
+namespace SimClock {
+    inline thread_local uint64_t now_us = 0;    ///< Simulated time in microseconds.
+    inline thread_local uint32_t cutout_us = 0; ///< Time slept since the current cutout started.
+    inline thread_local uint32_t rng_state = 1; ///< State of the `random()` generator.
+    inline thread_local bool wall = false;      ///< Adds the host time since `set()` to the microsecond timer.
+    inline thread_local std::chrono::steady_clock::time_point set_at; ///< Host time of the last `set()`.
+
+    /**
+     * @brief Sets the simulated time and restarts the cutout offset.
+     * @param us The time in microseconds.
+     */
+    inline void set(uint64_t us) {
+        now_us = us;
+        cutout_us = 0;
+        if (wall) set_at = std::chrono::steady_clock::now();
+    }
+
+    /**
+     * @brief Returns the host time since the last `set()` if `wall` is set.
+     * @return The time in microseconds, or 0.
+     */
+    inline uint64_t wall_us() {
+        if (!wall) return 0;
+        return (uint64_t)std::chrono::duration_cast<std::chrono::microseconds>(
+            std::chrono::steady_clock::now() - set_at).count();
+    }
+}
+
+#endif // SIM_CLOCK_H
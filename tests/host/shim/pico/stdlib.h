@@ -0,0 +1,10 @@
+/**
+ * @file stdlib.h
+ * @brief Host replacement for the Pico SDK standard header.
+ */
+#ifndef HOST_PICO_STDLIB_H
+#define HOST_PICO_STDLIB_H
+
+#include "time.h"
+
+#endif // HOST_PICO_STDLIB_H
@@ -0,0 +1,15 @@
+/**
+ * @file time.h
+ * @brief Host replacement for the Pico SDK timer functions.
+ */
+#ifndef HOST_PICO_TIME_H
+#define HOST_PICO_TIME_H
+
+#include "../SimClock.h"
+
+/** @brief Sleeping inside a cutout only advances the cutout offset. */
+inline void sleep_us(uint64_t us) { SimClock::cutout_us += (uint32_t)us; }
+inline uint64_t time_us_64() { return SimClock::now_us + SimClock::cutout_us + SimClock::wall_us(); }
+inline uint32_t time_us_32() { return (uint32_t)time_us_64(); }
+
+#endif // HOST_PICO_TIME_H
@@ -17,101 +17,59 @@ const RailcomID = {
   12: "CV_AUTO", 13: "DECODER_STATE", 14: "RERAIL", 15: "DECODER_UNIQUE"
 };
 
-const messagePayloads = {
-    0: [{ name: "CV", bits: 12 }, { name: "Value", bits: 8 }],
-    1: [{ name: "Address part", bits: 8 }],
-    2: [{ name: "Address part", bits: 8 }],
-    3: [
-        {
+// Input widgets for individual schema fields, keyed by "MESSAGE.field".
+// Fields without an entry get a number input.
+const fieldInputs = {
+    'TIME.unitIsSecond': {
+        type: 'select',
+        options: [
+            { value: 0, text: '0.1 seconds' },
+            { value: 1, text: '1 second' }
+        ]
+    },
+    'DYN.value': { type: 'slider' },
+};
+
+// The input fields of every ID, built from the message layouts in
+// railcom_schema.js (generated from src/RailcomSchema.h), so payloads are
+// packed exactly like the library does. IDs shared by several messages get a
+// 'Type' selector; bits not covered by a field become hidden zero fields.
+const messagePayloads = {};
+for (const id in RailcomID) {
+    const schemas = RAILCOM_SCHEMA.filter(schema => schema.ids.includes(Number(id)));
+    const fields = [];
+    if (schemas.length > 1) {
+        fields.push({
             name: "Type",
             bits: 0,
             type: 'select',
-            options: [
-                { value: 'EXT', text: 'EXT' },
-                { value: 'STAT4', text: 'STAT4' }
-            ]
-        },
-        {
-            name: "Source",
-            bits: 2,
-            type: 'select',
-            options: [
-                { value: 0b00, text: 'Decoder' },
-                { value: 0b01, text: 'Detector' }
-            ],
-            condition: { field: 'Type', value: 'EXT' }
-        },
-        {
-            name: "Decoder Padding",
-            bits: 1,
-            type: 'hidden',
-            value: 0,
-            condition: { field: 'Type', value: 'EXT' }
-        },
-        {
-            name: "Decoder Location Address",
-            bits: 11,
-            condition: { field: 'Type', value: 'EXT' }
-        },
-        {
-            name: "Detector Location Type",
-            bits: 4,
-            type: 'select',
-            condition: { field: 'Type', value: 'EXT' },
-            options: [
-                { value: 0, text: 'nur Ortsinformation (0)' }, { value: 1, text: 'nur Ortsinformation (1)' },
-                { value: 2, text: 'nur Ortsinformation (2)' }, { value: 3, text: 'nur Ortsinformation (3)' },
-                { value: 4, text: 'nur Ortsinformation (4)' }, { value: 5, text: 'nur Ortsinformation (5)' },
-                { value: 6, text: 'nur Ortsinformation (6)' }, { value: 7, text: 'nur Ortsinformation (7)' },
-                { value: 10, text: 'Dieseltankstelle (10)' }, { value: 11, text: 'Kohlebansen (11)' },
-                { value: 12, text: 'Wasserkran (12)' }, { value: 13, text: 'Besandungsanlage (13)' },
-                { value: 14, text: 'Ladestation (Akku) (14)' }, { value: 15, 'text': 'Allgemeine Füllstation (15)' }
-            ]
-        },
-        {
-            name: "Detector Location Address",
-            bits: 8,
-            condition: { field: 'Type', value: 'EXT' }
-        },
-        ...[1, 2, 3, 4].map(i => ({
-            name: `Turnout Pair ${i}`,
-            bits: 2,
-            type: 'select',
-            options: [
-                { value: 0b00, text: 'Off' },
-                { value: 0b01, text: 'Red' },
-                { value: 0b10, text: 'Green' }
-            ],
-            condition: { field: 'Type', value: 'STAT4' }
-        }))
-    ],
-    4: [{ name: "Status", bits: 8 }],
-    5: [
-        {
-            name: "Unit",
-            bits: 1,
-            type: 'select',
-            options: [
-                { value: 0, text: '0.1 seconds' },
-                { value: 1, text: '1 second' }
-            ]
-        },
-        {
-            name: "Time Value",
-            bits: 7
+            options: schemas.map(schema => ({ value: schema.name, text: schema.name }))
+        });
+    }
+    schemas.forEach(schema => {
+        const condition = schemas.length > 1 ? { field: 'Type', value: schema.name } : undefined;
+        const reserved = (bits, offset) => ({
+            name: `${schema.name} reserved ${offset}`, bits: bits, type: 'hidden', value: 0, condition: condition
+        });
+        let next = schema.bits; // Fields are listed most significant first.
+        schema.fields.forEach(field => {
+            if (next > field.offset + field.bits) {
+                fields.push(reserved(next - field.offset - field.bits, field.offset + field.bits));
+            }
+            fields.push({
+                name: field.name,
+                bits: field.bits,
+                condition: condition,
+                ...fieldInputs[`${schema.name}.${field.name}`]
+            });
+            next = field.offset;
+        });
+        if (next > 0) {
+            fields.push(reserved(next, 0));
         }
-    ],
-    6: [{ name: "Error code", bits: 8 }],
-    7: [{ name: "Value", bits: 8, type: 'slider' }, { name: "Subindex", bits: 6 }],
-    8: [{ name: "Sequence", bits: 2 }, { name: "CV", bits: 16 }, { name: "Value", bits: 8 }],
-    9: [{ name: "Sequence", bits: 2 }, { name: "CV", bits: 16 }, { name: "Value", bits: 8 }],
-    10: [{ name: "Sequence", bits: 2 }, { name: "CV", bits: 16 }, { name: "Value", bits: 8 }],
-    11: [{ name: "Sequence", bits: 2 }, { name: "CV", bits: 16 }, { name: "Value", bits: 8 }],
-    12: [{ name: "CV", bits: 12 }, { name: "Value", bits: 8 }],
-    13: [{ name: "State", bits: 16 }],
-    14: [{ name: "Rerail counter", bits: 8 }],
-    15: [{ name: "Unique ID part", bits: 32 }],
-};
+    });
+    messagePayloads[id] = fields;
+}
 
 
 document.addEventListener('DOMContentLoaded', () => {
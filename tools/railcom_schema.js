@@ -0,0 +1,78 @@
+// Generated by tests/host/schema_export from src/RailcomSchema.h. Do not edit.
+// Offsets count from the least significant payload bit, without padding.
+const RAILCOM_SCHEMA = [
+  { name: "POM", ids: [0], bits: 8, fields: [
+    { name: "cvValue", offset: 0, bits: 8 },
+  ] },
+  { name: "ADR_HIGH", ids: [1], bits: 6, fields: [
+    { name: "address", offset: 0, bits: 6 },
+  ] },
+  { name: "ADR_LOW", ids: [2], bits: 8, fields: [
+    { name: "address", offset: 0, bits: 8 },
+  ] },
+  { name: "EXT", ids: [3], bits: 14, fields: [
+    { name: "type", offset: 8, bits: 6 },
+    { name: "position", offset: 0, bits: 8 },
+  ] },
+  { name: "INFO1", ids: [3], bits: 8, fields: [
+    { name: "requestAddressing", offset: 4, bits: 1 },
+    { name: "isInConsist", offset: 3, bits: 1 },
+    { name: "isMoving", offset: 2, bits: 1 },
+    { name: "travelDirectionIsPositive", offset: 1, bits: 1 },
+    { name: "onTrackDirectionIsPositive", offset: 0, bits: 1 },
+  ] },
+  { name: "STAT4", ids: [3], bits: 8, fields: [
+    { name: "status", offset: 0, bits: 8 },
+  ] },
+  { name: "INFO", ids: [4], bits: 32, fields: [
+    { name: "speed", offset: 16, bits: 16 },
+    { name: "motorLoad", offset: 8, bits: 8 },
+    { name: "statusFlags", offset: 0, bits: 8 },
+  ] },
+  { name: "STAT1", ids: [4], bits: 8, fields: [
+    { name: "status", offset: 0, bits: 8 },
+  ] },
+  { name: "TIME", ids: [5], bits: 8, fields: [
+    { name: "unitIsSecond", offset: 7, bits: 1 },
+    { name: "timeValue", offset: 0, bits: 7 },
+  ] },
+  { name: "ERROR", ids: [6], bits: 8, fields: [
+    { name: "errorCode", offset: 0, bits: 8 },
+  ] },
+  { name: "DYN", ids: [7], bits: 14, fields: [
+    { name: "value", offset: 6, bits: 8 },
+    { name: "subIndex", offset: 0, bits: 6 },
+  ] },
+  { name: "XPOM", ids: [8, 9, 10, 11], bits: 32, fields: [
+    { name: "cvValue0", offset: 24, bits: 8 },
+    { name: "cvValue1", offset: 16, bits: 8 },
+    { name: "cvValue2", offset: 8, bits: 8 },
+    { name: "cvValue3", offset: 0, bits: 8 },
+  ] },
+  { name: "STAT2", ids: [8], bits: 8, fields: [
+    { name: "status", offset: 0, bits: 8 },
+  ] },
+  { name: "CV_AUTO", ids: [12], bits: 32, fields: [
+    { name: "cvAddress", offset: 8, bits: 24 },
+    { name: "cvValue", offset: 0, bits: 8 },
+  ] },
+  { name: "BLOCK", ids: [13], bits: 32, fields: [
+    { name: "data", offset: 0, bits: 32 },
+  ] },
+  { name: "DECODER_STATE", ids: [13], bits: 44, fields: [
+    { name: "changeFlags", offset: 36, bits: 8 },
+    { name: "changeCount", offset: 24, bits: 12 },
+    { name: "protocolCaps", offset: 8, bits: 16 },
+  ] },
+  { name: "RERAIL", ids: [14], bits: 8, fields: [
+    { name: "counter", offset: 0, bits: 8 },
+  ] },
+  { name: "SRQ", ids: [14], bits: 12, fields: [
+    { name: "isExtended", offset: 11, bits: 1 },
+    { name: "accessoryAddress", offset: 0, bits: 11 },
+  ] },
+  { name: "DECODER_UNIQUE", ids: [15], bits: 44, fields: [
+    { name: "manufacturerId", offset: 32, bits: 12 },
+    { name: "productId", offset: 0, bits: 32 },
+  ] },
+];